@@ -0,0 +1,49 @@
+/*
+ * aloha.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_ALOHA_H_
+#define INC_ALOHA_H_
+
+#include <stdint.h>
+#include <config_options.h>
+
+/* Beacon block of a contention frame, right after the common header. The first two fields are those of the TDMA
+ * schedule block, multi-byte fields are little endian. See NOTE 24 in uwb_master.c. */
+#define ALOHA_BEACON_FIRST_SLOT_IDX 0  /* Beacon RX to the start of slot 0, in microseconds */
+#define ALOHA_BEACON_SLOT_LEN_IDX 2    /* Slot length, in microseconds */
+#define ALOHA_BEACON_SLOTS_IDX 4       /* Slots in the frame */
+#define ALOHA_BEACON_LEN 5
+
+/* Beacon to beacon: guard, contention slots and the time the master needs to launch the next beacon */
+#define ALOHA_FRAME_US (TDMA_FIRST_SLOT_US + (uint32_t)ALOHA_SLOTS * TDMA_SLOT_US + TDMA_LAUNCH_US)
+
+#define ALOHA_NO_SLOT (-1)
+
+typedef struct
+{
+  uint32_t attempts;    /* Polls sent in a slot */
+  uint32_t successes;   /* Polls answered by the master */
+  uint32_t failures;    /* Polls not answered: collision or loss */
+  uint32_t frames;      /* Beacons received */
+} AlohaStats;
+
+/* Tag side state, one per slave */
+typedef struct
+{
+  uint32_t seed;      /* xorshift32 state, never 0 */
+  uint8_t window;     /* The next attempt falls in one of this many frames, 1 after a success, doubled per failure */
+  uint8_t skip;       /* Frames to let pass before that attempt */
+  uint8_t pending;    /* An attempt waits for its result */
+  AlohaStats stats;
+} AlohaTag;
+
+void aloha_init(AlohaTag *tag, uint32_t seed);
+int aloha_access(AlohaTag *tag, uint8_t slots);
+void aloha_result(AlohaTag *tag, int acknowledged);
+void aloha_beacon_encode(uint8_t *buffer);
+int aloha_beacon_access(AlohaTag *tag, const uint8_t *buffer, uint16_t length, uint32_t *offset_us);
+
+#endif /* INC_ALOHA_H_ */
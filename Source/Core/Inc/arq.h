@@ -0,0 +1,51 @@
+/*
+ * arq.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_ARQ_H_
+#define INC_ARQ_H_
+
+#include <stdint.h>
+
+#define ARQ_WINDOW 128        /* Sequence numbers up to this far ahead of the last accepted one are new */
+#define ARQ_RESYNC_STALE 3    /* Consecutive stale frames after which the peer is assumed to have restarted */
+
+typedef enum
+{
+  ARQ_NEW,        /* Ahead of the last accepted frame, within ARQ_WINDOW */
+  ARQ_DUPLICATE,  /* Same sequence number as the last accepted frame, i.e. a retransmission */
+  ARQ_STALE       /* Behind the last accepted frame: late or reordered */
+} ArqVerdict;
+
+typedef struct
+{
+  uint32_t accepted;    /* New frames received */
+  uint32_t duplicates;  /* Retransmissions received */
+  uint32_t stale;       /* Late or reordered frames received */
+  uint32_t retries;     /* Retransmissions sent */
+  uint32_t recovered;   /* Transfers completed by a retransmission */
+  uint32_t dropped;     /* Transfers given up after the last retry */
+} ArqStats;
+
+/* One per peer */
+typedef struct
+{
+  uint8_t rxValid;    /* A frame has been accepted since arq_init() or a resync */
+  uint8_t rxSn;       /* Sequence number of the last accepted frame */
+  uint8_t staleRun;
+  uint8_t attempt;    /* Retransmissions of the transfer in progress */
+  uint8_t maxRetries;
+  uint32_t seed;      /* Backoff generator state, never 0 */
+  ArqStats stats;
+} ArqLink;
+
+void arq_init(ArqLink *link, uint8_t max_retries, uint32_t seed);
+ArqVerdict arq_receive(ArqLink *link, uint8_t sn);
+void arq_begin(ArqLink *link);
+int arq_retry(ArqLink *link);
+void arq_done(ArqLink *link);
+uint32_t arq_backoff_us(ArqLink *link, uint32_t min_us, uint32_t span_us);
+
+#endif /* INC_ARQ_H_ */
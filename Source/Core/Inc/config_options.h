@@ -62,6 +62,187 @@
 #define CONFIG_SPI_FAST_RATE
 //#define CONFIG_SPI_SLOW_RATE
 
+/*
+ * DW IC event delivery
+ * When defined, radio events are signalled on the DW_IRQn EXTI line and dwt_isr() runs in interrupt context.
+ * Otherwise the application polls the IRQS status bit and runs dwt_isr() from its main loop.
+ */
+#define CONFIG_DWIC_IRQ_MODE
+
+/*
+ * DW IC register shadow
+ * When defined, the host-owned configuration registers are kept in RAM (see dwt_setregshadow()) so that reading them
+ * back, e.g. in dwt_configure(), does not cost an SPI transaction.
+ */
+#define CONFIG_DWIC_REG_SHADOW
+
+/*
+ * Ranging scheme
+ * When defined, the slave starts in double-sided TWR (poll, response, final and a report carrying the distance back), otherwise in
+ * single-sided TWR. The master follows whichever poll it receives and uwb_slave_set_ranging_mode() switches at runtime.
+ */
+//#define CONFIG_RANGING_DS_TWR
+
+/*
+ * High-rate ranging
+ * When defined, both roles use the shortest preamble (64 symbols) at 6.8 Mbps and the slave ranges every
+ * RNG_HIGH_RATE_PERIOD_MS instead of once a second. Per exchange printf is compiled out (RANGING_LOG) and the slave
+ * prints a rate_bench line once a second instead: achieved rate, success ratio and time spent in each phase.
+ */
+//#define CONFIG_HIGH_RATE_RANGING
+#define RNG_HIGH_RATE_PERIOD_MS 10
+
+#ifdef CONFIG_HIGH_RATE_RANGING
+#define RANGING_LOG(...)
+#else
+#define RANGING_LOG(...) printf(__VA_ARGS__)
+#endif
+
+/*
+ * Controller input debounce
+ * CONTROLLER_IN_1/2 raise an EXTI on both edges, the master only takes the new relay command once both inputs have
+ * been stable for this long, so contact bounce does not turn into a burst of commands.
+ */
+#define CONTROLLER_DEBOUNCE_MS 20
+
+/*
+ * Push-mode command delivery
+ * When defined, the master sends a command frame as soon as its controller inputs change instead of waiting for the next
+ * poll, and the slave keeps a sniff-mode receiver open between exchanges to catch it. PUSH_SNIFF_ON_PAC and
+ * PUSH_SNIFF_OFF_US are the receiver on time (in PACs, plus one) and off time (in ~1 us units) of that window, the off
+ * time must stay well below the preamble duration (131 us at 128 symbols, 66 us at 64) for a push to be detected.
+ * CONFIG_NO_PUSH_COMMANDS (from the build) leaves it out, commands then go with the next exchange.
+ */
+#ifndef CONFIG_NO_PUSH_COMMANDS
+#define CONFIG_PUSH_COMMANDS
+#endif
+#define PUSH_SNIFF_ON_PAC 2
+#define PUSH_SNIFF_OFF_US 16
+
+/*
+ * Relay fail-safe
+ * The slave re-arms a TIM2 supervisor on every in-range exchange. If none comes for CONFIG_FAILSAFE_TIMEOUT_MS, both
+ * relays are forced off from the TIM2 interrupt whatever the main loop is doing. The worst case cutoff is this timeout
+ * plus the interrupt latency, it must be longer than the ranging period.
+ */
+#define CONFIG_FAILSAFE_TIMEOUT_MS 2500
+
+/*
+ * Retransmission (ARQ)
+ * A failed exchange is retried by the slave up to ARQ_MAX_RETRIES times, the poll going out again ARQ_BACKOFF_MIN_US plus
+ * a random part of up to ARQ_BACKOFF_SPAN_US (times the attempt) after the timeout or error, instead of waiting for the
+ * next ranging period. The master repeats a push that no poll has followed within ARQ_PUSH_ACK_MS plus a random part of
+ * up to ARQ_PUSH_BACKOFF_MS (times the attempt), in whole ms as it is timed on the SysTick. 0 retries turns
+ * retransmission off, duplicate and stale frame detection stays on.
+ */
+#define ARQ_MAX_RETRIES 3
+#define ARQ_BACKOFF_MIN_US 300
+#define ARQ_BACKOFF_SPAN_US 700
+#define ARQ_PUSH_ACK_MS 5
+#define ARQ_PUSH_BACKOFF_MS 4
+
+/*
+ * Hardware frame filtering
+ * Each board takes a 16-bit short address hashed from its 96-bit unique ID. When defined, the DW IC frame filter only
+ * accepts data frames of the node's PAN ID or the broadcast PAN (0xFFFF) addressed to that short address or broadcast
+ * (and, on the master, ACK frames), so frames for other nodes are dropped without waking the MCU, and the slave
+ * acknowledges pushed commands in hardware (auto-ACK). The PAN ID is the pair's with CONFIG_PAIRING, CONFIG_PAN_ID
+ * without it.
+ */
+#define CONFIG_FRAME_FILTERING
+#define CONFIG_PAN_ID 0xDECA
+
+/*
+ * TDMA superframe (one master, several slaves)
+ * When defined, the master opens each superframe with a beacon listing the short address owning each slot, and a slave
+ * polls only in its own slot, TDMA_FIRST_SLOT_US + slot * TDMA_SLOT_US after the beacon it received, instead of once
+ * per ranging period. Slot 0 is left to slaves not listed yet, their poll registers them. A slave silent for
+ * TDMA_EXPIRE_SUPERFRAMES superframes loses its slot. TDMA_SLOT_US must hold a whole exchange at the configured data
+ * rate (about 900 us SS-TWR at 6.8 Mbps, twice that DS-TWR, so it doubles with CONFIG_RANGING_DS_TWR; a slave switched
+ * to DS-TWR at runtime needs the DS-TWR slot too), TDMA_LAUNCH_US is the idle time the master keeps before each beacon
+ * to arm it from its main loop. Pushed commands are turned off, they would fall into the slots.
+ */
+//#define CONFIG_TDMA
+#define TDMA_MAX_SLAVES 32
+#define TDMA_FIRST_SLOT_US 1000
+#ifdef CONFIG_RANGING_DS_TWR
+#define TDMA_SLOT_US 2000
+#else
+#define TDMA_SLOT_US 1000
+#endif
+#define TDMA_DS_TWR_MIN_SLOT_US 1800 /* Poll, response, final and report with their turn-arounds at 6.8 Mbps */
+#define TDMA_LAUNCH_US 1500
+#define TDMA_EXPIRE_SUPERFRAMES 8
+
+/*
+ * Slotted ALOHA (unscheduled slaves)
+ * When defined, the beacon opens a contention frame of ALOHA_SLOTS slots instead of listing slot owners: each slave polls
+ * in a slot drawn at random, the master answers every poll it receives and its response acknowledges the slot. A slave
+ * not answered takes its slot to have collided and lets a random number of frames pass before the next attempt, over a
+ * window doubled per failure up to 2^ALOHA_MAX_BACKOFF_EXP frames. Nothing to register or expire, so slaves may come and
+ * go every frame. Uses the beacon and slot timing of CONFIG_TDMA, which it turns on.
+ */
+//#define CONFIG_ALOHA
+#define ALOHA_SLOTS 16
+#define ALOHA_MAX_BACKOFF_EXP 6 /* At most 7, the window is kept in a byte */
+
+#if defined(CONFIG_ALOHA) && !defined(CONFIG_TDMA)
+#define CONFIG_TDMA
+#endif
+
+#ifdef CONFIG_TDMA
+#undef CONFIG_PUSH_COMMANDS
+#endif
+
+#if defined(CONFIG_TDMA) && defined(CONFIG_RANGING_DS_TWR) && TDMA_SLOT_US < TDMA_DS_TWR_MIN_SLOT_US
+#error "TDMA_SLOT_US is too short for a DS-TWR exchange, see TDMA_DS_TWR_MIN_SLOT_US"
+#endif
+
+/*
+ * Multi-responder ranging (one slave, several masters)
+ * When defined, the slave's poll goes to the broadcast address with a table of up to MULTI_RESP_MAX master addresses,
+ * and the master in entry n answers n * MULTI_RESP_SLOT_UUS after the usual turn-around: one poll and one response per
+ * master give every distance, N + 1 frames instead of 2N. A master not listed yet answers in the slot after the table
+ * and is listed from the next poll, one silent for MULTI_RESP_EXPIRE_POLLS polls is dropped. SS-TWR only. The relay
+ * command is still only taken from the master the slave is bound to, the others only range.
+ */
+//#define CONFIG_MULTI_RESPONDER
+#define MULTI_RESP_MAX 4
+#define MULTI_RESP_SLOT_UUS 400
+#define MULTI_RESP_EXPIRE_POLLS 8
+
+#if defined(CONFIG_MULTI_RESPONDER) && defined(CONFIG_TDMA)
+#error "CONFIG_MULTI_RESPONDER and CONFIG_TDMA both give the slots of the air to the master, define only one"
+#endif
+
+/*
+ * Pairing (one master, one slave)
+ * When defined, a master and a slave pair on their first power-up and keep each other's short address in flash, see
+ * pairing.c. A paired node only ranges with its peer, on a PAN ID of the pair (the master's short address), so the DW IC
+ * drops the frames of other pairs; a slave whose master is lost keeps its relays off and never takes another master.
+ * Install one pair at a time: power the master and the slave of a new pair while the pairs already installed are
+ * running, they are not candidates any more. Both controller inputs on at power-up clear the pairing of that board,
+ * clear both boards of a pair. CONFIG_NO_PAIRING (from the build) leaves it out, every node then shares CONFIG_PAN_ID
+ * and a slave ranges with whichever master answers first. Not used with CONFIG_TDMA or CONFIG_MULTI_RESPONDER, where a
+ * node ranges with several peers on CONFIG_PAN_ID.
+ */
+#if !defined(CONFIG_NO_PAIRING) && !defined(CONFIG_TDMA) && !defined(CONFIG_MULTI_RESPONDER)
+#define CONFIG_PAIRING
+#endif
+
+/*
+ * SPI throughput benchmark
+ * When defined, main() runs spi_bench_run() before the ranging role and prints polled vs DMA figures on the UART.
+ */
+//#define CONFIG_SPI_BENCHMARK
+
+/*
+ * Hot path micro-benchmark
+ * When defined, main() runs hot_bench_run() before the ranging role and prints per call cycle counts of the driver and
+ * ranging helpers on the UART.
+ */
+//#define CONFIG_HOT_BENCHMARK
+
 /*
  * Changing threshold to 5ns for DW3000 B0 red board devices.
  * ~10% of ranging attempts have a larger than usual difference between Ipatov and STS.
@@ -0,0 +1,22 @@
+/*
+ * controller_input.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_CONTROLLER_INPUT_H_
+#define INC_CONTROLLER_INPUT_H_
+
+#include <stdint.h>
+
+#define CONTROLLER_INPUT_TICK_HZ 10000  /* TIM3 counts in 100 us steps */
+#define CONTROLLER_INPUT_ALL 0x03       /* CONTROLLER_IN_1 and CONTROLLER_IN_2 */
+
+void controller_input_init(uint32_t debounce_ms);
+void controller_input_edge(void);
+void controller_input_settled(void);
+uint8_t controller_input_read(void);
+uint8_t controller_input_state(void);
+int controller_input_changed(uint8_t *state);
+
+#endif /* INC_CONTROLLER_INPUT_H_ */
@@ -0,0 +1,25 @@
+/*
+ * cycle_counter.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_CYCLE_COUNTER_H_
+#define INC_CYCLE_COUNTER_H_
+
+#include "main.h"
+
+/* Starts the Cortex-M4 DWT cycle counter, used to time code paths in core clock cycles */
+static inline void cycle_counter_init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cycle_counter_read(void)
+{
+  return DWT->CYCCNT;
+}
+
+#endif /* INC_CYCLE_COUNTER_H_ */
@@ -0,0 +1,27 @@
+/*
+ * failsafe.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_FAILSAFE_H_
+#define INC_FAILSAFE_H_
+
+#include <stdint.h>
+
+#define FAILSAFE_TICK_HZ 10000          /* TIM2 counts in 100 us steps */
+#define FAILSAFE_MAX_TIMEOUT_MS 50000   /* Keeps the cutoff measurement within one DWT cycle counter wrap (51 s at 84 MHz) */
+
+typedef struct
+{
+  uint32_t trips;         /* Number of times the supervisor forced the relays off */
+  uint32_t lastCutoffUs;  /* Last kick to relays off, in microseconds */
+  uint32_t maxCutoffUs;   /* Worst case seen since failsafe_init() */
+} FailsafeStats;
+
+void failsafe_init(uint32_t timeout_ms);
+void failsafe_kick(void);
+void failsafe_stats(FailsafeStats *stats);
+void failsafe_expired(void);
+
+#endif /* INC_FAILSAFE_H_ */
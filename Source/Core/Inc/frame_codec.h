@@ -0,0 +1,59 @@
+/*
+ * frame_codec.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_FRAME_CODEC_H_
+#define INC_FRAME_CODEC_H_
+
+#include <stdint.h>
+
+/* Common header of the master and slave frames: IEEE 802.15.4 data frame with PAN ID compression and 16-bit
+ * addresses, followed by the function code. See NOTE 3 in uwb_master.c. */
+#define FRAME_HDR_LEN 10
+#define FRAME_SN_IDX 2
+#define FRAME_PAN_IDX 3
+#define FRAME_DST_IDX 5
+#define FRAME_SRC_IDX 7
+#define FRAME_FUNC_IDX 9
+#define FRAME_FCS_LEN 2
+#define FRAME_INVALID (-1)
+
+#define FRAME_FC_DATA 0x8841      /* Data frame, PAN ID compression, 16-bit destination and source */
+#define FRAME_FC_ACK_REQ 0x0020   /* Acknowledgement request bit of the frame control */
+#define FRAME_FC_TYPE_MASK 0x0007
+#define FRAME_FC_TYPE_ACK 0x0002
+#define FRAME_ACK_LEN 5           /* Frame control, sequence number and FCS */
+#define FRAME_BROADCAST 0xFFFF
+
+/* A frame kept in the DW IC TX buffer between transmissions. dwt_writetxdata() writes from a start offset up to 127
+ * (REG_DIRECT_OFFSET_MAX_LEN) directly, whatever the length, and from a larger one through the indirect pointer at the
+ * cost of one more SPI transaction; a patch at offset + index follows the same rule. The slot must end within
+ * TX_BUFFER_MAX_LEN. */
+typedef struct
+{
+  uint16_t offset;  /* Start in the TX buffer */
+  uint16_t length;  /* Frame length including the FCS */
+  uint8_t ranging;  /* Ranging bit of TX_FCTRL */
+} FrameSlot;
+
+void frame_set_address(uint16_t pan_id, uint16_t address);
+uint16_t frame_get_address(void);
+
+void frame_stage(const FrameSlot *slot, const uint8_t *frame);
+void frame_patch(const FrameSlot *slot, uint16_t index, const uint8_t *data, uint16_t length);
+void frame_set_byte(const FrameSlot *slot, uint16_t index, uint8_t value);
+void frame_select(const FrameSlot *slot);
+void frame_set_dest(const FrameSlot *slot, uint16_t address);
+void frame_set_pan(const FrameSlot *slot, uint16_t pan_id);
+
+int frame_check_header(const uint8_t *header);
+uint16_t frame_get_source(const uint8_t *header);
+uint16_t frame_get_dest(const uint8_t *header);
+uint16_t frame_get_pan(const uint8_t *header);
+int frame_read_header(uint8_t *buffer, uint16_t datalength);
+int frame_read_ack(uint16_t datalength);
+int frame_read_payload(uint8_t *buffer, uint16_t size, uint16_t datalength);
+
+#endif /* INC_FRAME_CODEC_H_ */
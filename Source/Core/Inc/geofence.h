@@ -0,0 +1,41 @@
+/*
+ * geofence.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_GEOFENCE_H_
+#define INC_GEOFENCE_H_
+
+#include <stdint.h>
+
+/* Range validation states of the slave */
+typedef enum
+{
+  GEOFENCE_IN_RANGE,      /* Last range at or below the enter distance, outputs follow the master */
+  GEOFENCE_SUSPECT,       /* Range above the exit distance, confirmation window running, outputs held */
+  GEOFENCE_OUT_OF_RANGE,  /* Ranges stayed above the exit distance for the confirmation window, outputs off */
+  GEOFENCE_LOST           /* No valid range for the lost timeout, outputs off */
+} GeofenceState;
+
+typedef struct
+{
+  int32_t exitMm;      /* A range above this starts the confirmation window */
+  int32_t enterMm;     /* A range at or below this is back in range, enterMm < exitMm gives the hysteresis */
+  uint32_t confirmMs;  /* How long ranges must stay beyond the hysteresis band before OUT_OF_RANGE */
+  uint32_t lostMs;     /* Time without a valid range before LOST */
+} GeofenceConfig;
+
+typedef struct
+{
+  GeofenceConfig cfg;
+  GeofenceState state;
+  uint32_t suspectTick;
+  uint32_t lastRangeTick;
+} Geofence;
+
+void geofence_init(Geofence *gf, const GeofenceConfig *cfg, uint32_t now);
+GeofenceState geofence_range(Geofence *gf, int32_t distanceMm, uint32_t now);
+GeofenceState geofence_tick(Geofence *gf, uint32_t now);
+
+#endif /* INC_GEOFENCE_H_ */
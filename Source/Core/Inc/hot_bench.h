@@ -0,0 +1,20 @@
+/*
+ * hot_bench.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_HOT_BENCH_H_
+#define INC_HOT_BENCH_H_
+
+#include <stdint.h>
+
+void hot_bench_run(void);
+
+#ifdef HOT_BENCH_HOST
+/* Host build (Source/Tools/hot_bench_host.c): the monotonic clock in ns stands in for the DWT cycle counter */
+uint32_t hot_bench_host_clock(void);
+#define HOT_BENCH_CLOCK_HZ 1000000000UL
+#endif
+
+#endif /* INC_HOT_BENCH_H_ */
@@ -36,19 +36,7 @@ extern "C" {
 
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
-typedef enum
-{
-  RELAY_ON = GPIO_PIN_SET,
-  RELAY_OFF = GPIO_PIN_RESET
-} RelayState;
-
-typedef enum
-{
-  ALL_OFF = 0,
-  REL_1_ON,
-  REL_2_ON,
-  ALL_ON
-} OutputStatus;
+
 /* USER CODE END ET */
 
 /* Exported constants --------------------------------------------------------*/
@@ -0,0 +1,40 @@
+/*
+ * output_channels.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_OUTPUT_CHANNELS_H_
+#define INC_OUTPUT_CHANNELS_H_
+
+#include <stdint.h>
+
+/* Output block carried by the command (master) and status (slave) frames, right after the common header or the
+ * response timestamps. Multi-byte fields are little endian. See NOTE 19 in uwb_master.c. */
+#define OUTPUT_MSG_VERSION 1
+#define OUTPUT_MSG_LEN 10
+#define OUTPUT_MSG_VERSION_IDX 0
+#define OUTPUT_MSG_CHANNELS_IDX 1
+#define OUTPUT_MSG_STATE_IDX 2
+#define OUTPUT_MSG_MASK_IDX 6
+
+#define OUTPUT_CHANNELS_MAX 32
+
+/* Decoded output block. In a command the mask holds the channels the command changes, in a status the channels of the
+ * last command that have been applied. */
+typedef struct
+{
+  uint8_t channels;  /* Channels of the sender, bit n of state and mask is channel n */
+  uint32_t state;    /* Output levels, 1 = on */
+  uint32_t mask;
+} OutputMsg;
+
+void output_channels_init(void);
+uint8_t output_channels_count(void);
+uint32_t output_channels_all(void);
+void output_channels_write(uint32_t state, uint32_t mask);
+uint32_t output_channels_read(void);
+void output_msg_encode(uint8_t *buffer, const OutputMsg *msg);
+int output_msg_decode(const uint8_t *buffer, OutputMsg *msg);
+
+#endif /* INC_OUTPUT_CHANNELS_H_ */
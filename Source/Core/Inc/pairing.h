@@ -0,0 +1,19 @@
+/*
+ * pairing.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_PAIRING_H_
+#define INC_PAIRING_H_
+
+#include <stdint.h>
+
+#define PAIRING_NONE 0xFFFF  /* No peer stored, as FRAME_BROADCAST */
+
+uint16_t pairing_load(void);
+int pairing_store(uint16_t peer);
+int pairing_clear_requested(void);
+uint16_t pairing_pan_id(uint16_t master_address);
+
+#endif /* INC_PAIRING_H_ */
@@ -0,0 +1,12 @@
+/*
+ * spi_bench.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_SPI_BENCH_H_
+#define INC_SPI_BENCH_H_
+
+void spi_bench_run(void);
+
+#endif /* INC_SPI_BENCH_H_ */
@@ -0,0 +1,46 @@
+/*
+ * tdma.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_TDMA_H_
+#define INC_TDMA_H_
+
+#include <stdint.h>
+#include <config_options.h>
+
+/* Schedule block carried by the beacon right after the common header. Multi-byte fields are little endian, entry n of
+ * the slot table is the short address owning slot n + 1, FRAME_BROADCAST when free. See NOTE 22 in uwb_master.c. */
+#define TDMA_BEACON_FIRST_SLOT_IDX 0  /* Beacon RX to the start of slot 0, in microseconds */
+#define TDMA_BEACON_SLOT_LEN_IDX 2    /* Slot length, in microseconds */
+#define TDMA_BEACON_SLOTS_IDX 4
+#define TDMA_BEACON_LEN (TDMA_BEACON_SLOTS_IDX + 2 * TDMA_MAX_SLAVES)
+
+#define TDMA_JOIN_SLOT 0   /* Left to slaves not in the slot table yet, their poll registers them */
+#define TDMA_NO_SLOT (-1)
+
+typedef struct
+{
+  uint16_t address;   /* FRAME_BROADCAST when the slot is free */
+  uint8_t lastSeen;   /* Superframe of the last poll */
+} TdmaEntry;
+
+/* Master side registry, entry n owns slot n + 1 */
+typedef struct
+{
+  TdmaEntry entries[TDMA_MAX_SLAVES];
+  uint8_t superframe;
+  uint8_t slots;      /* Slots scheduled after the join slot: highest owned slot */
+  uint8_t changed;    /* The slot table differs from the last encoded beacon */
+} TdmaSchedule;
+
+void tdma_init(TdmaSchedule *schedule);
+int tdma_lookup(const TdmaSchedule *schedule, uint16_t address);
+int tdma_register(TdmaSchedule *schedule, uint16_t address);
+void tdma_start_superframe(TdmaSchedule *schedule);
+uint32_t tdma_superframe_us(const TdmaSchedule *schedule);
+void tdma_beacon_encode(TdmaSchedule *schedule, uint8_t *buffer);
+int tdma_beacon_find(const uint8_t *buffer, uint16_t length, uint16_t address, uint32_t *offset_us);
+
+#endif /* INC_TDMA_H_ */
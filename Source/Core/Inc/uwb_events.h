@@ -0,0 +1,15 @@
+/*
+ * uwb_events.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_UWB_EVENTS_H_
+#define INC_UWB_EVENTS_H_
+
+#include <deca_device_api.h>
+
+void uwb_events_init(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr);
+void uwb_events_dispatch(void);
+
+#endif /* INC_UWB_EVENTS_H_ */
@@ -11,6 +11,6 @@
 #include <stdint.h>
 
 int uwb_master(void);
-void set_tx_param(uint8_t parameter);
+void set_tx_outputs(uint32_t outputs);
 
 #endif /* INC_UWB_MASTER_H_ */
@@ -8,6 +8,18 @@
 #ifndef INC_UWB_SLAVE_H_
 #define INC_UWB_SLAVE_H_
 
+#include <deca_device_api.h>
+
+/* Ranging scheme used by the slave, see NOTE 14 in uwb_slave.c */
+typedef enum
+{
+  RANGING_SS_TWR,
+  RANGING_DS_TWR
+} RangingMode;
+
 int uwb_slave(void);
+void uwb_slave_set_ranging_mode(RangingMode mode);
+/* SS-TWR distance from the snapshot of the last response and its embedded timestamps, in millimetres */
+int32_t calculate_distance(const dwt_rangingsnapshot_t *snapshot);
 
 #endif /* INC_UWB_SLAVE_H_ */
@@ -0,0 +1,25 @@
+/*
+ * xorshift.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INC_XORSHIFT_H_
+#define INC_XORSHIFT_H_
+
+#include <stdint.h>
+
+/* Next number of a xorshift32 generator, shared by the ARQ backoff and the slotted ALOHA slot draw. The state must not
+ * be 0, it would stay 0. */
+static inline uint32_t xorshift32(uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+#endif /* INC_XORSHIFT_H_ */
@@ -0,0 +1,143 @@
+/*
+ * aloha.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "aloha.h"
+#include "xorshift.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aloha_init()
+ *
+ * @brief Resets a tag: it tries in the first frame it hears, counters cleared.
+ *
+ * @param  tag   tag state
+ * @param  seed  slot and backoff generator seed, should differ between devices (e.g. the MCU unique ID)
+ *
+ * @return none
+ */
+void aloha_init(AlohaTag *tag, uint32_t seed)
+{
+  /* Unique IDs of one batch differ in a few bits only, mix them so that the tags do not draw related slots */
+  seed ^= seed >> 16;
+  seed *= 0x85EBCA6B;
+  seed ^= seed >> 13;
+  seed *= 0xC2B2AE35;
+  seed ^= seed >> 16;
+
+  *tag = (AlohaTag){0};
+  tag->seed = seed ? seed : 1;
+  tag->window = 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aloha_access()
+ *
+ * @brief Called for each beacon. While backing off the frame is let pass, otherwise a slot is drawn at random. The
+ *        result of the attempt must be given to aloha_result() before the next beacon.
+ *
+ * @param  tag    tag state
+ * @param  slots  contention slots announced by the beacon
+ *
+ * @return slot to poll in, ALOHA_NO_SLOT to stay silent this frame
+ */
+int aloha_access(AlohaTag *tag, uint8_t slots)
+{
+  tag->stats.frames++;
+
+  if (slots == 0)
+  {
+    return ALOHA_NO_SLOT;
+  }
+
+  if (tag->skip != 0)
+  {
+    tag->skip--;
+    return ALOHA_NO_SLOT;
+  }
+
+  tag->pending = 1;
+  tag->stats.attempts++;
+  return (int)(xorshift32(&tag->seed) % slots);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aloha_result()
+ *
+ * @brief Outcome of the last attempt. The master's response is the acknowledgement of the slot; without it the tag
+ *        takes the slot to have collided and backs off over twice as many frames (binary exponential backoff, up to
+ *        2^ALOHA_MAX_BACKOFF_EXP). A success resets the window, the tag tries again in the next frame.
+ *
+ * @param  tag           tag state
+ * @param  acknowledged  the master answered the poll
+ *
+ * @return none
+ */
+void aloha_result(AlohaTag *tag, int acknowledged)
+{
+  if (!tag->pending)
+  {
+    return;
+  }
+  tag->pending = 0;
+
+  if (acknowledged)
+  {
+    tag->stats.successes++;
+    tag->window = 1;
+    tag->skip = 0;
+    return;
+  }
+
+  tag->stats.failures++;
+  if (tag->window < (1u << ALOHA_MAX_BACKOFF_EXP))
+  {
+    tag->window *= 2;
+  }
+  tag->skip = (uint8_t)(xorshift32(&tag->seed) % tag->window);
+}
+
+/* Fills ALOHA_BEACON_LEN bytes, the block does not change from one frame to the next */
+void aloha_beacon_encode(uint8_t *buffer)
+{
+  buffer[ALOHA_BEACON_FIRST_SLOT_IDX] = (uint8_t)TDMA_FIRST_SLOT_US;
+  buffer[ALOHA_BEACON_FIRST_SLOT_IDX + 1] = (uint8_t)(TDMA_FIRST_SLOT_US >> 8);
+  buffer[ALOHA_BEACON_SLOT_LEN_IDX] = (uint8_t)TDMA_SLOT_US;
+  buffer[ALOHA_BEACON_SLOT_LEN_IDX + 1] = (uint8_t)(TDMA_SLOT_US >> 8);
+  buffer[ALOHA_BEACON_SLOTS_IDX] = ALOHA_SLOTS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn aloha_beacon_access()
+ *
+ * @brief Slave side: reads a received contention block and runs aloha_access() on the slots it announces. The frame
+ *        layout comes from the beacon, so master and slave need not agree on ALOHA_SLOTS.
+ *
+ * @param  tag        tag state
+ * @param  buffer     received contention block
+ * @param  length     its length in bytes
+ * @param  offset_us  beacon RX to the start of the slot to poll in
+ *
+ * @return slot to poll in, ALOHA_NO_SLOT to stay silent this frame or if the block is too short
+ */
+int aloha_beacon_access(AlohaTag *tag, const uint8_t *buffer, uint16_t length, uint32_t *offset_us)
+{
+  uint32_t first_us, slot_us;
+  int slot;
+
+  if (length < ALOHA_BEACON_LEN)
+  {
+    return ALOHA_NO_SLOT;
+  }
+
+  slot = aloha_access(tag, buffer[ALOHA_BEACON_SLOTS_IDX]);
+  if (slot == ALOHA_NO_SLOT)
+  {
+    return ALOHA_NO_SLOT;
+  }
+
+  first_us = (uint32_t)buffer[ALOHA_BEACON_FIRST_SLOT_IDX] | ((uint32_t)buffer[ALOHA_BEACON_FIRST_SLOT_IDX + 1] << 8);
+  slot_us = (uint32_t)buffer[ALOHA_BEACON_SLOT_LEN_IDX] | ((uint32_t)buffer[ALOHA_BEACON_SLOT_LEN_IDX + 1] << 8);
+  *offset_us = first_us + (uint32_t)slot * slot_us;
+  return slot;
+}
@@ -0,0 +1,122 @@
+/*
+ * arq.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "arq.h"
+#include "xorshift.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_init()
+ *
+ * @brief Resets a link: no frame accepted yet, counters cleared.
+ *
+ * @param  link         peer state
+ * @param  max_retries  retransmissions allowed per transfer, 0 turns retransmission off
+ * @param  seed         backoff generator seed, should differ between devices (e.g. the MCU unique ID)
+ *
+ * @return none
+ */
+void arq_init(ArqLink *link, uint8_t max_retries, uint32_t seed)
+{
+  *link = (ArqLink){0};
+  link->maxRetries = max_retries;
+  link->seed = seed ? seed : 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_receive()
+ *
+ * @brief Classifies a received sequence number against the last accepted one. A new frame becomes the last accepted,
+ *        duplicates and stale frames leave the window where it is. After ARQ_RESYNC_STALE stale frames in a row the
+ *        peer is taken to have restarted its numbering and the frame is accepted as new.
+ *
+ * @param  link  peer state
+ * @param  sn    sequence number of the received frame
+ *
+ * @return ARQ_NEW, ARQ_DUPLICATE or ARQ_STALE
+ */
+ArqVerdict arq_receive(ArqLink *link, uint8_t sn)
+{
+  uint8_t ahead = (uint8_t)(sn - link->rxSn);
+
+  if (link->rxValid && ahead == 0)
+  {
+    link->stats.duplicates++;
+    return ARQ_DUPLICATE;
+  }
+
+  if (link->rxValid && ahead > ARQ_WINDOW && ++link->staleRun < ARQ_RESYNC_STALE)
+  {
+    link->stats.stale++;
+    return ARQ_STALE;
+  }
+
+  link->rxValid = 1;
+  link->rxSn = sn;
+  link->staleRun = 0;
+  link->stats.accepted++;
+  return ARQ_NEW;
+}
+
+/* A new transfer starts, retries left over from a superseded one are forgotten */
+void arq_begin(ArqLink *link)
+{
+  link->attempt = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_retry()
+ *
+ * @brief Called when a transfer failed. Counts a retransmission if one is left, otherwise drops the transfer.
+ *
+ * @param  link  peer state
+ *
+ * @return 1 if the transfer should be sent again, 0 if it has been given up
+ */
+int arq_retry(ArqLink *link)
+{
+  if (link->attempt < link->maxRetries)
+  {
+    link->attempt++;
+    link->stats.retries++;
+    return 1;
+  }
+
+  if (link->maxRetries != 0)
+  {
+    link->stats.dropped++;
+  }
+  link->attempt = 0;
+  return 0;
+}
+
+/* The transfer in progress has completed */
+void arq_done(ArqLink *link)
+{
+  if (link->attempt != 0)
+  {
+    link->stats.recovered++;
+    link->attempt = 0;
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn arq_backoff_us()
+ *
+ * @brief Random wait before a retransmission, so that devices that failed together do not retry together. The span
+ *        grows with each attempt of the transfer in progress.
+ *
+ * @param  link     peer state
+ * @param  min_us   shortest wait
+ * @param  span_us  random part of the wait on the first retry
+ *
+ * @return wait in microseconds, min_us to min_us + attempt * span_us - 1
+ */
+uint32_t arq_backoff_us(ArqLink *link, uint32_t min_us, uint32_t span_us)
+{
+  uint32_t span = span_us * (link->attempt ? link->attempt : 1);
+  uint32_t x = xorshift32(&link->seed);
+
+  return span ? min_us + x % span : min_us;
+}
@@ -0,0 +1,131 @@
+/*
+ * controller_input.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "controller_input.h"
+#include "main.h"
+#include "tim.h"
+
+static uint8_t initialised = 0;
+static volatile uint8_t latched_state = 0;
+static volatile uint8_t change_event = 0;
+
+/* Inputs as a channel mask, bit n is CONTROLLER_IN_(n+1) and commands output channel n. Not debounced, usable before
+ * controller_input_init(). */
+uint8_t controller_input_read(void)
+{
+  GPIO_PinState in1 = HAL_GPIO_ReadPin(CONTROLLER_IN_1_GPIO_Port, CONTROLLER_IN_1_Pin);
+  GPIO_PinState in2 = HAL_GPIO_ReadPin(CONTROLLER_IN_2_GPIO_Port, CONTROLLER_IN_2_Pin);
+
+  return (in1 ? 1 : 0) | (in2 ? 2 : 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn controller_input_init()
+ *
+ * @brief Latches the current inputs and sets TIM3 up as a one-shot debounce timer. From here on every edge on
+ *        CONTROLLER_IN_1/2 restarts the timer, and the inputs are only sampled once they have been quiet for
+ *        debounce_ms.
+ *
+ * @param  debounce_ms  quiet time required after the last edge, 1 to 6553
+ *
+ * @return none
+ */
+void controller_input_init(uint32_t debounce_ms)
+{
+  if (debounce_ms == 0)
+  {
+    debounce_ms = 1;
+  }
+  else if (debounce_ms > 0xFFFF / (CONTROLLER_INPUT_TICK_HZ / 1000))
+  {
+    debounce_ms = 0xFFFF / (CONTROLLER_INPUT_TICK_HZ / 1000);
+  }
+
+  __HAL_TIM_DISABLE(&htim3);
+  __HAL_TIM_SET_PRESCALER(&htim3, tim_apb1_clock_hz() / CONTROLLER_INPUT_TICK_HZ - 1);
+  __HAL_TIM_SET_AUTORELOAD(&htim3, debounce_ms * (CONTROLLER_INPUT_TICK_HZ / 1000) - 1);
+
+  /* One pulse with URS, as the fail-safe timer: a restart from controller_input_edge() does not raise the interrupt */
+  htim3.Instance->CR1 |= TIM_CR1_OPM | TIM_CR1_URS;
+  htim3.Instance->EGR = TIM_EGR_UG;
+  __HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_UPDATE);
+  __HAL_TIM_ENABLE_IT(&htim3, TIM_IT_UPDATE);
+
+  latched_state = controller_input_read();
+  change_event = 0;
+  initialised = 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn controller_input_edge()
+ *
+ * @brief EXTI callback of CONTROLLER_IN_1/2, restarts the debounce window. Contact bounce only keeps pushing the
+ *        sample point back, it never reaches the radio layer.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void controller_input_edge(void)
+{
+  if (!initialised)
+  {
+    return;
+  }
+
+  htim3.Instance->EGR = TIM_EGR_UG;
+  htim3.Instance->CR1 |= TIM_CR1_CEN;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn controller_input_settled()
+ *
+ * @brief TIM3 update, the inputs have been stable for the debounce time. A new state is latched and flagged, a
+ *        glitch that came back to the latched state is dropped.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void controller_input_settled(void)
+{
+  uint8_t state = controller_input_read();
+
+  if (state != latched_state)
+  {
+    latched_state = state;
+    change_event = 1;
+  }
+}
+
+/* Latched (debounced) relay command */
+uint8_t controller_input_state(void)
+{
+  return latched_state;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn controller_input_changed()
+ *
+ * @brief Consumes the change event. Several changes between two calls collapse into one carrying the last state.
+ *
+ * @param  state  latched input mask, written when a change is reported
+ *
+ * @return 1 if the latched state changed since the last call, 0 otherwise
+ */
+int controller_input_changed(uint8_t *state)
+{
+  if (!change_event)
+  {
+    return 0;
+  }
+
+  __disable_irq();
+  change_event = 0;
+  *state = latched_state;
+  __enable_irq();
+
+  return 1;
+}
@@ -104,6 +104,22 @@ static void dwt_force_clocks(int clocks);
 static uint32_t _dwt_otpread(uint16_t address);                     // Read non-volatile memory
 static void _dwt_otpprogword32(uint32_t data, uint16_t address);  // Program the non-volatile memory
 
+// -------------------------------------------------------------------------------------------------------------------
+// Register shadow
+//
+// Host-owned configuration registers (4 bytes each) mirrored in RAM when the register shadow is on, see dwt_setregshadow().
+// The IC does not change these on its own, so a copy stays good until the next reset or sleep.
+static const uint32_t dwt_regshadowids[] =
+{
+    SYS_CFG_ID, SYS_ENABLE_LO_ID, SYS_ENABLE_HI_ID, ACK_RESP_ID, CHAN_CTRL_ID, GPIO_MODE_ID,
+    DTUNE0_ID, LDO_CTRL_ID, CLK_CTRL_ID, SEQ_CTRL_ID, LED_CTRL_ID
+};
+
+#define DWT_REG_SHADOW_NUM  (sizeof(dwt_regshadowids) / sizeof(dwt_regshadowids[0]))
+
+// Max number of bytes collected in one write combining burst, see dwt_beginwritecombine()
+#define DWT_WC_MAX_LEN      (32)
+
 // -------------------------------------------------------------------------------------------------------------------
 // Data for DW3000 Decawave Transceiver control
 //
@@ -133,6 +149,14 @@ typedef struct
     dwt_cb_t    cbRxErr;              // Callback for RX error events
     dwt_cb_t    cbSPIErr;             // Callback for SPI error events
     dwt_cb_t    cbSPIRdy;             // Callback for SPI ready events
+    uint8_t     regshadowon;          // Serve the registers in dwt_regshadowids[] from regshadow when set
+    uint16_t    regshadowvalid;       // Bit n set when regshadow[n] holds the current register value
+    uint8_t     regshadow[DWT_REG_SHADOW_NUM][4]; // RAM copy of the registers in dwt_regshadowids[]
+    uint8_t     wcon;                 // Write combining allowed (see dwt_setwritecombine)
+    uint8_t     wcdepth;              // Write combining scope nesting depth, writes are collected while non-zero
+    uint16_t    wclen;                // Number of bytes collected in wcbuf
+    uint32_t    wcaddr;               // Register address (regFileID + index) of wcbuf[0]
+    uint8_t     wcbuf[DWT_WC_MAX_LEN]; // Collected write burst
 } dwt_local_data_t ;
 
 
@@ -181,28 +205,28 @@ int dwt_setlocaldataptr(unsigned int index)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
-* @brief  this function is used to read/write to the DW3000 device registers
+* @brief  this function composes the SPI header for a DW3000 register access
 *
 * input parameters:
-* @param recordNumber  - ID of register file or buffer being accessed
-* @param index         - byte index into register file or buffer being accessed
-* @param length        - number of bytes being written
-* @param buffer        - pointer to buffer containing the 'length' bytes to be written
-* @param rw            - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT
+* @param regFileID     - ID of register file or buffer being accessed
+* @param indx          - byte index into register file or buffer being accessed
+* @param length        - number of bytes being read/written
+* @param mode          - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT/DW3000_SPI_AND_OR_x
 *
-* no return value
+* output parameters
+* @param header        - 2 byte buffer the header is composed in
+*
+* returns the length of the header
 */
-static
-void dwt_xfer3000
+uint16_t dwt_xferheader
 (
-    const uint32_t    regFileID,  //0x0, 0x04-0x7F ; 0x10000, 0x10004, 0x10008-0x1007F; 0x20000 etc
-    const uint16_t    indx,       //sub-index, calculated from regFileID 0..0x7F,
+    const uint32_t    regFileID,
+    const uint16_t    indx,
     const uint16_t    length,
-    volatile uint8_t  *buffer,
-    const spi_modes_e mode
+    const spi_modes_e mode,
+    uint8_t           *header
 )
 {
-    uint8_t  header[2];           // Buffer to compose header in
     uint16_t cnt = 0;             // Counter for length of a header
 
     uint16_t reg_file     = 0x1F & ((regFileID + indx) >> 16);
@@ -250,6 +274,36 @@ void dwt_xfer3000
         cnt = 2;
     }
 
+    return cnt;
+} // end dwt_xferheader()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function is used to read/write to the DW3000 device registers
+*
+* input parameters:
+* @param recordNumber  - ID of register file or buffer being accessed
+* @param index         - byte index into register file or buffer being accessed
+* @param length        - number of bytes being written
+* @param buffer        - pointer to buffer containing the 'length' bytes to be written
+* @param rw            - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT
+*
+* no return value
+*/
+static
+void _dwt_xferspi
+(
+    const uint32_t    regFileID,  //0x0, 0x04-0x7F ; 0x10000, 0x10004, 0x10008-0x1007F; 0x20000 etc
+    const uint16_t    indx,       //sub-index, calculated from regFileID 0..0x7F,
+    const uint16_t    length,
+    volatile uint8_t  *buffer,
+    const spi_modes_e mode
+)
+{
+    uint8_t  header[2];           // Buffer to compose header in
+    uint16_t cnt;                 // Length of the header
+
+    cnt = dwt_xferheader(regFileID, indx, length, mode, header);
+
     switch (mode)
     {
     case    DW3000_SPI_AND_OR_8:
@@ -306,8 +360,322 @@ void dwt_xfer3000
         break;
     }
 
+} // end _dwt_xferspi()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function sends the write burst collected in a write combining scope, if any
+*
+* no return value
+*/
+static void dwt_wcflush(void)
+{
+    uint16_t length = pdw3000local->wclen;
+
+    if (length != 0)
+    {
+        pdw3000local->wclen = 0;
+        _dwt_xferspi(pdw3000local->wcaddr, 0, length, pdw3000local->wcbuf, DW3000_SPI_WR_BIT);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function is used to read/write to the DW3000 device registers. Inside a write combining scope, plain
+*         writes that continue the previous one in the same register file are collected and sent as one burst; any
+*         other access sends the collected burst first, so the device sees the accesses in order.
+*
+* input parameters:
+* @param recordNumber  - ID of register file or buffer being accessed
+* @param index         - byte index into register file or buffer being accessed
+* @param length        - number of bytes being written
+* @param buffer        - pointer to buffer containing the 'length' bytes to be written
+* @param rw            - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT
+*
+* no return value
+*/
+static
+void _dwt_xfer3000
+(
+    const uint32_t    regFileID,
+    const uint16_t    indx,
+    const uint16_t    length,
+    volatile uint8_t  *buffer,
+    const spi_modes_e mode
+)
+{
+    uint32_t addr = regFileID + indx;
+    uint16_t j;
+
+    if ((pdw3000local->wcdepth == 0) || (mode != DW3000_SPI_WR_BIT) || (pdw3000local->spicrc != DWT_SPI_CRC_MODE_NO))
+    {
+        dwt_wcflush();
+        _dwt_xferspi(regFileID, indx, length, buffer, mode);
+        return;
+    }
+
+    if ((pdw3000local->wclen != 0) &&
+        ((addr != (pdw3000local->wcaddr + pdw3000local->wclen)) || ((addr >> 16) != (pdw3000local->wcaddr >> 16))
+         || ((pdw3000local->wclen + length) > DWT_WC_MAX_LEN)))
+    {
+        dwt_wcflush();
+    }
+
+    if (length > DWT_WC_MAX_LEN)
+    {
+        _dwt_xferspi(regFileID, indx, length, buffer, mode);
+        return;
+    }
+
+    if (pdw3000local->wclen == 0)
+    {
+        pdw3000local->wcaddr = addr;
+    }
+
+    for (j = 0; j < length; j++)
+    {
+        pdw3000local->wcbuf[pdw3000local->wclen++] = buffer[j];
+    }
+} // end _dwt_xfer3000()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function finds the register shadow entry that holds all of an access
+*
+* input parameters:
+* @param addr    - register address of the access, i.e. regFileID + index
+* @param length  - number of bytes accessed
+*
+* returns the index in dwt_regshadowids[], or -1 if the access is not entirely within one shadowed register
+*/
+static int dwt_regshadowfind(uint32_t addr, uint16_t length)
+{
+    int i;
+
+    for (i = 0; i < (int)DWT_REG_SHADOW_NUM; i++)
+    {
+        if ((addr >= dwt_regshadowids[i]) && ((addr + length) <= (dwt_regshadowids[i] + 4)))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function updates the register shadow after a write. Entries that are fully overwritten become valid,
+*         valid entries that are partly overwritten are patched, other entries are left invalid.
+*
+* input parameters:
+* @param addr    - register address of the write, i.e. regFileID + index
+* @param length  - number of bytes written
+* @param buffer  - the bytes written
+*
+* no return value
+*/
+static void dwt_regshadowwrite(uint32_t addr, uint16_t length, const volatile uint8_t *buffer)
+{
+    uint32_t lo, hi, a;
+    int i;
+
+    for (i = 0; i < (int)DWT_REG_SHADOW_NUM; i++)
+    {
+        lo = dwt_regshadowids[i];
+        hi = lo + 4;
+
+        if ((addr >= hi) || ((addr + length) <= lo))
+        {
+            continue;
+        }
+
+        if (((addr > lo) || ((addr + length) < hi)) && !(pdw3000local->regshadowvalid & (1 << i)))
+        {
+            continue;
+        }
+
+        for (a = (addr > lo) ? addr : lo; (a < hi) && (a < (addr + length)); a++)
+        {
+            pdw3000local->regshadow[i][a - lo] = buffer[a - addr];
+        }
+        pdw3000local->regshadowvalid |= (1 << i);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function invalidates the register shadow entries overlapping an access
+*
+* input parameters:
+* @param addr    - register address of the access, i.e. regFileID + index
+* @param length  - number of bytes accessed
+*
+* no return value
+*/
+static void dwt_regshadowdrop(uint32_t addr, uint16_t length)
+{
+    int i;
+
+    for (i = 0; i < (int)DWT_REG_SHADOW_NUM; i++)
+    {
+        if ((addr < (dwt_regshadowids[i] + 4)) && ((addr + length) > dwt_regshadowids[i]))
+        {
+            pdw3000local->regshadowvalid &= ~(1 << i);
+        }
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+* @brief  this function is used to read/write to the DW3000 device registers, through the register shadow when it is on:
+*         - reads of a shadowed register are served from RAM, the first one loads the whole register
+*         - AND/OR accesses to a valid shadowed register are applied in RAM and the result written out as a plain write
+*         - writes go to the device and update the shadow
+*
+* input parameters:
+* @param recordNumber  - ID of register file or buffer being accessed
+* @param index         - byte index into register file or buffer being accessed
+* @param length        - number of bytes being written
+* @param buffer        - pointer to buffer containing the 'length' bytes to be written
+* @param rw            - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT
+*
+* no return value
+*/
+static
+void dwt_xfer3000
+(
+    const uint32_t    regFileID,
+    const uint16_t    indx,
+    const uint16_t    length,
+    volatile uint8_t  *buffer,
+    const spi_modes_e mode
+)
+{
+    uint32_t addr = regFileID + indx;
+    uint16_t width;
+    uint16_t j;
+    uint8_t  *reg;
+    int      i;
+
+    if (!pdw3000local->regshadowon)
+    {
+        _dwt_xfer3000(regFileID, indx, length, buffer, mode);
+        return;
+    }
+
+    switch (mode)
+    {
+    case DW3000_SPI_RD_BIT:
+        i = dwt_regshadowfind(addr, length);
+        if (i < 0)
+        {
+            _dwt_xfer3000(regFileID, indx, length, buffer, mode);
+            break;
+        }
+
+        reg = pdw3000local->regshadow[i];
+        if (!(pdw3000local->regshadowvalid & (1 << i)))
+        {
+            _dwt_xfer3000(dwt_regshadowids[i], 0, 4, reg, DW3000_SPI_RD_BIT);
+            pdw3000local->regshadowvalid |= (1 << i);
+        }
+
+        for (j = 0; j < length; j++)
+        {
+            buffer[j] = reg[addr - dwt_regshadowids[i] + j];
+        }
+        break;
+
+    case DW3000_SPI_AND_OR_8:
+    case DW3000_SPI_AND_OR_16:
+    case DW3000_SPI_AND_OR_32:
+        width = length / 2; // buffer holds the AND mask followed by the OR mask
+        i = dwt_regshadowfind(addr, width);
+        if ((i < 0) || !(pdw3000local->regshadowvalid & (1 << i)))
+        {
+            _dwt_xfer3000(regFileID, indx, length, buffer, mode);
+            dwt_regshadowdrop(addr, width);
+            break;
+        }
+
+        reg = &pdw3000local->regshadow[i][addr - dwt_regshadowids[i]];
+        for (j = 0; j < width; j++)
+        {
+            reg[j] = (reg[j] & buffer[j]) | buffer[width + j];
+        }
+        _dwt_xfer3000(regFileID, indx, width, reg, DW3000_SPI_WR_BIT);
+        break;
+
+    default:
+        _dwt_xfer3000(regFileID, indx, length, buffer, mode);
+        dwt_regshadowwrite(addr, length, buffer);
+        break;
+    }
+
 } // end dwt_xfer3000()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function turns the register shadow on or off, see dwt_setregshadow() in deca_device_api.h
+ *
+ * input parameters:
+ * @param enable - 1 to serve the host-owned configuration registers from RAM, 0 to always access the device
+ *
+ * no return value
+ */
+void dwt_setregshadow(int enable)
+{
+    pdw3000local->regshadowvalid = 0;
+    pdw3000local->regshadowon = (enable != 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function drops the register shadow contents, they are reloaded from the device on the next read
+ *
+ * no return value
+ */
+void dwt_invalidateregshadow(void)
+{
+    pdw3000local->regshadowvalid = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function opens a write combining scope, see dwt_beginwritecombine() in deca_device_api.h. Scopes nest.
+ *
+ * no return value
+ */
+void dwt_beginwritecombine(void)
+{
+    if (pdw3000local->wcon)
+    {
+        pdw3000local->wcdepth++;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function closes a write combining scope and sends any writes still collected
+ *
+ * no return value
+ */
+void dwt_endwritecombine(void)
+{
+    dwt_wcflush();
+
+    if (pdw3000local->wcdepth != 0)
+    {
+        pdw3000local->wcdepth--;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function allows or prevents write combining, it is allowed by default after dwt_initialise()
+ *
+ * input parameters:
+ * @param enable - 1 to let dwt_beginwritecombine() scopes collect writes, 0 to send every write on its own
+ *
+ * no return value
+ */
+void dwt_setwritecombine(int enable)
+{
+    dwt_wcflush();
+    pdw3000local->wcdepth = 0;
+    pdw3000local->wcon = (enable != 0);
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief  this function is used to write to the DW3000 device registers
  *
@@ -346,6 +714,7 @@ void dwt_writetodevice
  */
 void dwt_wakeup_ic(void)
 {
+    dwt_invalidateregshadow();
     wakeup_device_with_io();
 }
 
@@ -373,6 +742,73 @@ void dwt_readfromdevice
     dwt_xfer3000(regFileID, index, length, buffer, DW3000_SPI_RD_BIT);
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function stores a 32-bit register value in DW3000 (little endian) byte order, for dwt_xfer_async() writes
+ *
+ * no return value
+ */
+static void dwt_xferword(uint8_t *buffer, uint32_t value)
+{
+    int j;
+
+    for (j = 0; j < 4; j++)
+    {
+        buffer[j] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function queues a batch of register file / buffer accesses on the platform SPI transfer queue,
+ *         cb is called from interrupt context when the last one has completed
+ *
+ * input parameters:
+ * @param xfers - array of count access descriptors
+ * @param count - number of descriptors, 1 to DWT_XFER_MAX_BATCH
+ * @param cb    - completion callback, may be NULL
+ * @param arg   - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the batch has been queued, or DWT_ERROR for error
+ */
+int dwt_xfer_async(const dwt_xfer_t *xfers, uint8_t count, dwt_xfer_cb_t cb, void *arg)
+{
+    dwt_spi_xfer_t spi[DWT_XFER_MAX_BATCH];
+    uint8_t i;
+
+    // The SPI CRC of a read is checked with a further register read, which cannot be done from the queue
+    if ((count == 0) || (count > DWT_XFER_MAX_BATCH) || (pdw3000local->spicrc != DWT_SPI_CRC_MODE_NO))
+    {
+        return DWT_ERROR;
+    }
+
+    // Collected writes go out before the batch is queued
+    dwt_wcflush();
+
+    for (i = 0; i < count; i++)
+    {
+        spi_modes_e mode = (xfers[i].dir == DWT_XFER_WRITE) ? DW3000_SPI_WR_BIT : DW3000_SPI_RD_BIT;
+
+        if (xfers[i].length == 0)
+        {
+            return DWT_ERROR;
+        }
+
+        if ((mode == DW3000_SPI_WR_BIT) && pdw3000local->regshadowon)
+        {
+            dwt_regshadowwrite(xfers[i].regFileID + xfers[i].index, xfers[i].length, xfers[i].buffer);
+        }
+
+        spi[i].headerLength = (uint8_t)dwt_xferheader(xfers[i].regFileID, xfers[i].index, xfers[i].length, mode, spi[i].header);
+        spi[i].read = (xfers[i].dir == DWT_XFER_WRITE) ? 0 : 1;
+        spi[i].length = xfers[i].length;
+        spi[i].buffer = xfers[i].buffer;
+    }
+
+    return (queuetospi(spi, count, cb, arg) == 0) ? DWT_SUCCESS : DWT_ERROR;
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief  this function is used to read 32-bit value from the DW3000 device registers
  *
@@ -789,6 +1225,11 @@ int dwt_initialise(int mode)
     pdw3000local->cbSPIRdy = NULL;
     pdw3000local->cbSPIErr = NULL;
 
+    dwt_invalidateregshadow();  // The device has just been reset or powered up
+    pdw3000local->wcon = 1;
+    pdw3000local->wcdepth = 0;
+    pdw3000local->wclen = 0;
+
     // Read and validate device ID return -1 if not recognised
     if (dwt_check_dev_id()!=DWT_SUCCESS)
     {
@@ -1120,10 +1561,12 @@ void dwt_configuretxrf(dwt_txconfig_t *config)
  */
 void dwt_configurestskey(dwt_sts_cp_key_t* pStsKey)
 {
+    dwt_beginwritecombine();
     dwt_write32bitreg(STS_KEY0_ID, pStsKey->key0);
     dwt_write32bitreg(STS_KEY1_ID, pStsKey->key1);
     dwt_write32bitreg(STS_KEY2_ID, pStsKey->key2);
     dwt_write32bitreg(STS_KEY3_ID, pStsKey->key3);
+    dwt_endwritecombine();
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -1138,10 +1581,12 @@ void dwt_configurestskey(dwt_sts_cp_key_t* pStsKey)
  */
 void dwt_configurestsiv(dwt_sts_cp_iv_t* pStsIv)
 {
+    dwt_beginwritecombine();
     dwt_write32bitreg(STS_IV0_ID, pStsIv->iv0);
     dwt_write32bitreg(STS_IV1_ID, pStsIv->iv1);
     dwt_write32bitreg(STS_IV2_ID, pStsIv->iv2);
     dwt_write32bitreg(STS_IV3_ID, pStsIv->iv3);
+    dwt_endwritecombine();
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -1212,6 +1657,8 @@ void dwt_configmrxlut(int channel)
         lut5 = (uint32_t)CH9_DGC_LUT_5;
         lut6 = (uint32_t)CH9_DGC_LUT_6;
     }
+    // The LUT registers and DGC_CFG0/1 are contiguous, they go out as two bursts
+    dwt_beginwritecombine();
     dwt_write32bitoffsetreg(DGC_LUT_0_CFG_ID, 0x0, lut0);
     dwt_write32bitoffsetreg(DGC_LUT_1_CFG_ID, 0x0, lut1);
     dwt_write32bitoffsetreg(DGC_LUT_2_CFG_ID, 0x0, lut2);
@@ -1221,6 +1668,7 @@ void dwt_configmrxlut(int channel)
     dwt_write32bitoffsetreg(DGC_LUT_6_CFG_ID, 0x0, lut6);
     dwt_write32bitoffsetreg(DGC_CFG0_ID, 0x0, DWT_DGC_CFG0);
     dwt_write32bitoffsetreg(DGC_CFG1_ID, 0x0, DWT_DGC_CFG1);
+    dwt_endwritecombine();
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -1237,6 +1685,8 @@ void dwt_restoreconfig(void)
     uint8_t channel = 5;
     uint16_t chan_ctrl;
 
+    dwt_invalidateregshadow();  // Registers not held in AON came back with their reset values
+
     if (pdw3000local->bias_tune != 0)
     {
         _dwt_prog_ldo_and_bias_tune();
@@ -1244,8 +1694,10 @@ void dwt_restoreconfig(void)
     dwt_write8bitoffsetreg(LDO_RLOAD_ID, 1, LDO_RLOAD_VAL_B1);
     /*Restoring indirect access register B configuration as this is not preserved when device is in DEEPSLEEP/SLEEP state.
      * Indirect access register B is configured to point to the "Double buffer diagnostic SET 2"*/
+    dwt_beginwritecombine();
     dwt_write32bitreg(INDIRECT_ADDR_B_ID, (BUF1_RX_FINFO >> 16));
     dwt_write32bitreg(ADDR_OFFSET_B_ID, BUF1_RX_FINFO & 0xffff);
+    dwt_endwritecombine();
 
     /* Restore OPS table configuration */
     _dwt_kick_ops_table_on_wakeup();
@@ -1377,6 +1829,9 @@ int dwt_configure(dwt_config_t *config)
     pdw3000local->ststhreshold = (int16_t)((((uint32_t)sts_len) * 8) * STSQUAL_THRESH_64);
     pdw3000local->stsconfig = config->stsMode;
 
+    // Adjacent register writes up to the PLL calibration go out as bursts
+    dwt_beginwritecombine();
+
     /////////////////////////////////////////////////////////////////////////
     //SYS_CFG
     //clear the PHR Mode, PHR Rate, STS Protocol, SDC, PDOA Mode,
@@ -1515,6 +1970,8 @@ int dwt_configure(dwt_config_t *config)
     //Verify PLL lock bit is cleared
     dwt_write8bitoffsetreg(SYS_STATUS_ID, 0, SYS_STATUS_CP_LOCK_BIT_MASK);
 
+    dwt_endwritecombine();
+
     ///////////////////////
     // auto cal the PLL and change to IDLE_PLL state
     dwt_setdwstate(DWT_DW_IDLE);
@@ -1738,6 +2195,54 @@ int dwt_writetxdata(uint16_t txDataLength, volatile uint8_t *txDataBytes, uint16
         return DWT_ERROR;
 } // end dwt_writetxdata()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief Asynchronous version of dwt_writetxdata(), cb is called from interrupt context once the data is in the TX buffer
+ *
+ * input parameters
+ * @param txDataLength   - total length of data (in bytes) to write to the tx buffer, see dwt_writetxdata()
+ * @param txDataBytes    - pointer to the user's buffer containing the data to send, must stay valid until cb is called
+ * @param txBufferOffset - offset in the DW IC's TX Buffer at which to start writing data
+ * @param cb             - completion callback, may be NULL
+ * @param arg            - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the write has been queued, or DWT_ERROR for error
+ */
+int dwt_writetxdata_async(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset, dwt_xfer_cb_t cb, void *arg)
+{
+    dwt_xfer_t xfers[3];
+    uint8_t    indirect[8];
+
+#ifdef DWT_API_ERROR_CHECK
+    assert((pdw3000local->longFrames && (txDataLength <= EXT_FRAME_LEN)) ||\
+           (txDataLength <= STD_FRAME_LEN));
+    assert((txBufferOffset + txDataLength) < TX_BUFFER_MAX_LEN);
+#endif
+
+    if ((txBufferOffset + txDataLength) >= TX_BUFFER_MAX_LEN)
+    {
+        return DWT_ERROR;
+    }
+
+    if (txBufferOffset <= REG_DIRECT_OFFSET_MAX_LEN)
+    {
+        /* Directly write the data to the IC TX buffer */
+        xfers[0] = (dwt_xfer_t){ TX_BUFFER_ID, txBufferOffset, txDataLength, txDataBytes, DWT_XFER_WRITE };
+        return dwt_xfer_async(xfers, 1, cb, arg);
+    }
+
+    /* Program the indirect offset register A for specified offset to TX buffer, then write the data through it.
+     * The 4 byte register values are copied by the queue, so they can live on the stack. */
+    dwt_xferword(&indirect[0], TX_BUFFER_ID >> 16);
+    dwt_xferword(&indirect[4], txBufferOffset);
+    xfers[0] = (dwt_xfer_t){ INDIRECT_ADDR_A_ID, 0, 4, &indirect[0], DWT_XFER_WRITE };
+    xfers[1] = (dwt_xfer_t){ ADDR_OFFSET_A_ID,   0, 4, &indirect[4], DWT_XFER_WRITE };
+    xfers[2] = (dwt_xfer_t){ INDIRECT_POINTER_A_ID, 0, txDataLength, txDataBytes, DWT_XFER_WRITE };
+
+    return dwt_xfer_async(xfers, 3, cb, arg);
+} // end dwt_writetxdata_async()
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This API function configures the TX frame control register before the transmission of a frame
  *
@@ -1860,6 +2365,171 @@ void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset)
     }
 }
 
+// RX_FINFO up to the end of TX_TIME in register file 0, read as one burst when not in double buffer mode
+#define DWT_SNAPSHOT_RX_TIME_OFFSET   (RX_TIME_0_ID - RX_FINFO_ID)
+#define DWT_SNAPSHOT_TX_TIME_OFFSET   (TX_TIME_LO_ID - RX_FINFO_ID)
+#define DWT_SNAPSHOT_LEN              (DWT_SNAPSHOT_TX_TIME_OFFSET + TX_TIME_TX_STAMP_LEN)
+// RX_FINFO up to the end of CIA_DIAG_0 in the double buffer diagnostic set
+#define DWT_SNAPSHOT_DB_RX_TIME_OFFSET  (BUF0_RX_TIME - BUF0_RX_FINFO)
+#define DWT_SNAPSHOT_DB_DIAG_OFFSET     (BUF0_CIA_DIAG_0 - BUF0_RX_FINFO)
+#define DWT_SNAPSHOT_DB_LEN             (DWT_SNAPSHOT_DB_DIAG_OFFSET + 4)
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function sign extends the 13-bit clock offset field of CIA_DIAG_0
+ *
+ * input parameters
+ * @param regval - CIA_DIAG_0 value masked with CIA_DIAG_0_COE_PPM_BIT_MASK
+ *
+ * returns the clock offset as a signed 16-bit value
+ */
+static int16_t dwt_signextendclockoffset(uint16_t regval)
+{
+    if (regval & B11_SIGN_EXTEND_TEST)
+    {
+        regval |= B11_SIGN_EXTEND_MASK;             // sign extend bit #12 to the whole short
+    }
+
+    return (int16_t) regval ;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function assembles a 40-bit little endian timestamp
+ */
+static uint64_t dwt_timestamp40(const uint8_t *ts)
+{
+    uint64_t val = 0;
+    int i;
+
+    for (i = 4; i >= 0; i--)
+    {
+        val = (val << 8) | ts[i];
+    }
+
+    return val;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read everything needed to complete a ranging exchange after a good frame has been received:
+ *        frame info, RX and TX timestamps, clock offset and the first bytes of the frame.
+ *
+ *        Not in double buffer mode: RX_FINFO..TX_TIME in one burst, CIA_DIAG_0, RX buffer.
+ *        In double buffer mode: RX_FINFO..CIA_DIAG_0 of the buffer set the host is accessing, TX_TIME, RX buffer.
+ *
+ * input parameters
+ * @param snapshot - pointer to the structure to fill in
+ * @param buffer   - the buffer into which the start of the frame will be read, may be NULL if length is 0
+ * @param length   - maximum number of frame bytes to read, the read is cut to the received frame length
+ *
+ * output parameters
+ *
+ * returns the number of frame bytes read into buffer
+ */
+uint16_t dwt_readrangingsnapshot(dwt_rangingsnapshot_t *snapshot, uint8_t *buffer, uint16_t length)
+{
+    uint8_t  regs[DWT_SNAPSHOT_LEN];
+    uint8_t  *rx_time;
+    uint8_t  *tx_time;
+    uint16_t diag;
+
+    switch (pdw3000local->dblbuffon)    //check if in double buffer mode and if so which buffer host is currently accessing
+    {
+    case DBL_BUFF_ACCESS_BUFFER_1:
+        //!!! Assumes that Indirect pointer register B was already set. This is done in the dwt_setdblrxbuffmode when mode is enabled.
+        dwt_readfromdevice(INDIRECT_POINTER_B_ID, 0, DWT_SNAPSHOT_DB_LEN, regs);
+        break;
+    case DBL_BUFF_ACCESS_BUFFER_0:
+        dwt_readfromdevice(BUF0_RX_FINFO, 0, DWT_SNAPSHOT_DB_LEN, regs);
+        break;
+    default:
+        dwt_readfromdevice(RX_FINFO_ID, 0, DWT_SNAPSHOT_LEN, regs);
+        break;
+    }
+
+    if (pdw3000local->dblbuffon)
+    {
+        // TX_TIME is not part of the buffer set, read it behind the diagnostics
+        dwt_readfromdevice(TX_TIME_LO_ID, 0, TX_TIME_TX_STAMP_LEN, &regs[DWT_SNAPSHOT_DB_LEN]);
+        rx_time = &regs[DWT_SNAPSHOT_DB_RX_TIME_OFFSET];
+        tx_time = &regs[DWT_SNAPSHOT_DB_LEN];
+        diag = (uint16_t)regs[DWT_SNAPSHOT_DB_DIAG_OFFSET] | ((uint16_t)regs[DWT_SNAPSHOT_DB_DIAG_OFFSET + 1] << 8);
+    }
+    else
+    {
+        rx_time = &regs[DWT_SNAPSHOT_RX_TIME_OFFSET];
+        tx_time = &regs[DWT_SNAPSHOT_TX_TIME_OFFSET];
+        diag = dwt_read16bitoffsetreg(CIA_DIAG_0_ID, 0);
+    }
+
+    snapshot->finfo = (uint32_t)regs[0] | ((uint32_t)regs[1] << 8) | ((uint32_t)regs[2] << 16) | ((uint32_t)regs[3] << 24);
+    snapshot->dataLength = (uint16_t)(snapshot->finfo & RX_FINFO_RXFLEN_BIT_MASK);
+    snapshot->rxStamp = dwt_timestamp40(rx_time);
+    snapshot->txStamp = dwt_timestamp40(tx_time);
+    snapshot->clockOffset = dwt_signextendclockoffset(diag & CIA_DIAG_0_COE_PPM_BIT_MASK);
+
+    if (length > snapshot->dataLength)
+    {
+        length = snapshot->dataLength;
+    }
+
+    if (length > 0)
+    {
+        dwt_readrxdata(buffer, length, 0);
+    }
+
+    return length;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief Asynchronous version of dwt_readrxdata(), cb is called from interrupt context once buffer has been filled
+ *
+ * input parameters
+ * @param buffer - the buffer into which the data will be read, must stay valid until cb is called
+ * @param length - the length of data to read (in bytes)
+ * @param rxBufferOffset - the offset in the rx buffer from which to read the data
+ * @param cb     - completion callback, may be NULL
+ * @param arg    - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the read has been queued, or DWT_ERROR for error
+ */
+int dwt_readrxdata_async(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset, dwt_xfer_cb_t cb, void *arg)
+{
+    dwt_xfer_t xfers[3];
+    uint8_t    indirect[8];
+    uint32_t   rx_buff_addr;
+
+    if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)  //if the flag is 0x3 we are reading from RX_BUFFER_1
+    {
+        rx_buff_addr=RX_BUFFER_1_ID;
+    }
+    else //reading from RX_BUFFER_0 - also when non-double buffer mode
+    {
+        rx_buff_addr=RX_BUFFER_0_ID;
+    }
+
+    if ((rxBufferOffset + length) > RX_BUFFER_MAX_LEN)
+    {
+        return DWT_ERROR;
+    }
+
+    if (rxBufferOffset <= REG_DIRECT_OFFSET_MAX_LEN)
+    {
+        /* Directly read data from the IC to the buffer */
+        xfers[0] = (dwt_xfer_t){ rx_buff_addr, rxBufferOffset, length, buffer, DWT_XFER_READ };
+        return dwt_xfer_async(xfers, 1, cb, arg);
+    }
+
+    /* Program the indirect offset registers A for specified offset to RX buffer, then read the data through it */
+    dwt_xferword(&indirect[0], rx_buff_addr >> 16);
+    dwt_xferword(&indirect[4], rxBufferOffset);
+    xfers[0] = (dwt_xfer_t){ INDIRECT_ADDR_A_ID, 0, 4, &indirect[0], DWT_XFER_WRITE };
+    xfers[1] = (dwt_xfer_t){ ADDR_OFFSET_A_ID,   0, 4, &indirect[4], DWT_XFER_WRITE };
+    xfers[2] = (dwt_xfer_t){ INDIRECT_POINTER_A_ID, 0, length, buffer, DWT_XFER_READ };
+
+    return dwt_xfer_async(xfers, 3, cb, arg);
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the 18 bit data from the Accumulator buffer, from an offset location give by offset parameter
  *        for 18 bit complex samples, each sample is 6 bytes (3 real and 3 imaginary)
@@ -1937,12 +2607,7 @@ int16_t dwt_readclockoffset(void)
         break;
     }
 
-    if (regval & B11_SIGN_EXTEND_TEST)
-    {
-        regval |= B11_SIGN_EXTEND_MASK;             // sign extend bit #12 to the whole short
-    }
-
-    return (int16_t) regval ;
+    return dwt_signextendclockoffset(regval);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -2046,66 +2711,86 @@ int dwt_readstsstatus(uint16_t* stsStatus, int sts_num)
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
- * @brief this function reads the RX signal quality diagnostic data
- *
- * input parameters
- * @param diagnostics - diagnostic structure pointer, this will contain the diagnostic data read from the DW3000
+ * @brief this function lists the register reads that make up the RX diagnostics for the current diagnostic logging and
+ *        double buffer modes
  *
  * output parameters
+ * @param xfers - filled with up to 2 read descriptors
+ * @param temp  - DB_MAX_DIAG_SIZE buffer the diagnostic registers are read into
  *
- * no return value
+ * returns the number of reads
  */
-void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
+static uint8_t dwt_diagnosticsreads(dwt_xfer_t *xfers, uint8_t *temp)
 {
-    int i;
-    int offset_0xd;
-    int offset_buff = BUF0_RX_FINFO;
-    uint8_t temp[DB_MAX_DIAG_SIZE];  //address from 0xC0000 to 0xD0068 (108*2 bytes) - when using normal mode, or 232 length for max logging when in Double Buffer mode
+    uint32_t offset_buff = BUF0_RX_FINFO;
+    uint16_t length;
 
     //minimal diagnostics - 40 bytes
 
     switch (pdw3000local->dblbuffon) //check if in double buffer mode and if so which buffer host is currently accessing
     {
     case DBL_BUFF_ACCESS_BUFFER_1:
-        offset_buff = BUF1_RX_FINFO;
-        __attribute__ ((fallthrough));
-        //no break
     case DBL_BUFF_ACCESS_BUFFER_0:
 
+        if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MAX)
+        {
+            length = DB_MAX_DIAG_SIZE;
+        }
+        else if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MID)
+        {
+            length = DB_MID_DIAG_SIZE;
+        }
+        else
+        {
+            length = DB_MIN_DIAG_SIZE;
+        }
+
         if (pdw3000local->dblbuffon == DBL_BUFF_ACCESS_BUFFER_1)
         {
             /* Program the indirect offset registers B for specified offset to swinging set buffer B */
             //!!! Assumes that Indirect pointer register B was already set. This is done in the dwt_setdblrxbuffmode when mode is enabled.
             /* Indirectly read data from the IC to the buffer */
-            if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MAX)
-            {
-                dwt_readfromdevice(INDIRECT_POINTER_B_ID, 0, DB_MAX_DIAG_SIZE, temp);
-            }
-            else if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MID)
-            {
-                dwt_readfromdevice(INDIRECT_POINTER_B_ID, 0, DB_MID_DIAG_SIZE, temp);
-            }
-            else
-            {
-                dwt_readfromdevice(INDIRECT_POINTER_B_ID, 0, DB_MIN_DIAG_SIZE, temp);
-            }
+            offset_buff = INDIRECT_POINTER_B_ID;
         }
-        else
+
+        xfers[0] = (dwt_xfer_t){ offset_buff, 0, length, temp, DWT_XFER_READ };
+        return 1;
+
+    default:  //double buffer is off
+
+        if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_ALL)
         {
-            if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MAX)
-            {
-                dwt_readfromdevice(offset_buff, 0, DB_MAX_DIAG_SIZE, temp);
-            }
-            else if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_MID)
-            {
-                dwt_readfromdevice(offset_buff, 0, DB_MID_DIAG_SIZE, temp);
-            }
-            else
-            {
-                dwt_readfromdevice(offset_buff, 0, DB_MIN_DIAG_SIZE, temp);
-            }
+            xfers[0] = (dwt_xfer_t){ IP_TOA_LO_ID, 0, 108, temp, DWT_XFER_READ };          //read form 0xC0000 space  (108 bytes)
+            xfers[1] = (dwt_xfer_t){ STS_DIAG_4_ID, 0, 108, &temp[108], DWT_XFER_READ };   //read from 0xD0000 space  (108 bytes)
+            return 2;
         }
 
+        xfers[0] = (dwt_xfer_t){ IP_TOA_LO_ID, 0, 40, temp, DWT_XFER_READ };
+        return 1;
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function decodes the diagnostic registers read as listed by dwt_diagnosticsreads()
+ *
+ * input parameters
+ * @param temp - the raw diagnostic register data
+ *
+ * output parameters
+ * @param diagnostics - diagnostic structure pointer
+ *
+ * no return value
+ */
+static void dwt_decodediagnostics(dwt_rxdiag_t *diagnostics, const uint8_t *temp)
+{
+    int i;
+    int offset_0xd;
+
+    switch (pdw3000local->dblbuffon) //check if in double buffer mode and if so which buffer host is currently accessing
+    {
+    case DBL_BUFF_ACCESS_BUFFER_1:
+    case DBL_BUFF_ACCESS_BUFFER_0:
+
         for (i = 0; i < (CIA_I_RX_TIME_LEN+1); i++)
         {
             diagnostics->tdoa[i] = temp[i + BUF0_TDOA - BUF0_RX_FINFO]; // timestamp difference of the 2 STS RX timestamps
@@ -2187,16 +2872,6 @@ void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
 
     default:  //double buffer is off
 
-        if (pdw3000local->cia_diagnostic & DW_CIA_DIAG_LOG_ALL)
-        {
-            dwt_readfromdevice(IP_TOA_LO_ID, 0, 108, temp);   //read form 0xC0000 space  (108 bytes)
-            dwt_readfromdevice(STS_DIAG_4_ID, 0, 108, &temp[108]);  //read from 0xD0000 space  (108 bytes)
-        }
-        else
-        {
-            dwt_readfromdevice(IP_TOA_LO_ID, 0, 40, temp);
-        }
-
         for (i = 0; i < CIA_I_RX_TIME_LEN; i++)
         {
             diagnostics->ipatovRxTime[i] = temp[i];                                 // RX timestamp from Ipatov sequence
@@ -2273,6 +2948,107 @@ void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
     }
 }
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief this function reads the RX signal quality diagnostic data
+ *
+ * input parameters
+ * @param diagnostics - diagnostic structure pointer, this will contain the diagnostic data read from the DW3000
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
+{
+    dwt_xfer_t xfers[2];
+    uint8_t temp[DB_MAX_DIAG_SIZE];  //address from 0xC0000 to 0xD0068 (108*2 bytes) - when using normal mode, or 232 length for max logging when in Double Buffer mode
+    uint8_t count;
+    uint8_t i;
+
+    count = dwt_diagnosticsreads(xfers, temp);
+
+    for (i = 0; i < count; i++)
+    {
+        dwt_readfromdevice(xfers[i].regFileID, xfers[i].index, xfers[i].length, xfers[i].buffer);
+    }
+
+    dwt_decodediagnostics(diagnostics, temp);
+}
+
+// State of the pending dwt_readdiagnostics_async() request
+static struct
+{
+    uint8_t         temp[DB_MAX_DIAG_SIZE];
+    dwt_rxdiag_t    *diagnostics;
+    dwt_xfer_cb_t   cb;
+    void            *arg;
+    volatile uint8_t busy;
+} diag_async;
+
+static void dwt_readdiagnostics_done(int status, void *arg)
+{
+    dwt_xfer_cb_t cb = diag_async.cb;
+    (void)arg;
+
+    if (status == DWT_SUCCESS)
+    {
+        dwt_decodediagnostics(diag_async.diagnostics, diag_async.temp);
+    }
+
+    diag_async.busy = 0;
+
+    if (cb != NULL)
+    {
+        cb(status, diag_async.arg);
+    }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief Asynchronous version of dwt_readdiagnostics(), diagnostics is decoded from interrupt context just before cb is
+ *        called. Only one request can be pending at a time.
+ *
+ * input parameters
+ * @param diagnostics - diagnostic structure pointer, must stay valid until cb is called
+ * @param cb          - completion callback, may be NULL
+ * @param arg         - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the read has been queued, or DWT_ERROR for error
+ */
+int dwt_readdiagnostics_async(dwt_rxdiag_t *diagnostics, dwt_xfer_cb_t cb, void *arg)
+{
+    dwt_xfer_t xfers[2];
+    decaIrqStatus_t stat;
+    uint8_t count;
+    int ret;
+
+    // The DW IC interrupt is the other context requests are made from
+    stat = decamutexon();
+
+    if (diag_async.busy)
+    {
+        decamutexoff(stat);
+        return DWT_ERROR;
+    }
+
+    diag_async.busy = 1;
+    diag_async.diagnostics = diagnostics;
+    diag_async.cb = cb;
+    diag_async.arg = arg;
+
+    count = dwt_diagnosticsreads(xfers, diag_async.temp);
+    ret = dwt_xfer_async(xfers, count, dwt_readdiagnostics_done, NULL);
+
+    if (ret != DWT_SUCCESS)
+    {
+        diag_async.busy = 0;
+    }
+
+    decamutexoff(stat);
+    return ret;
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the TX timestamp (adjusted with the programmed antenna delay)
  *
@@ -2903,6 +3679,9 @@ void dwt_entersleep(int idle_rc)
     // Copy config to AON - upload the new configuration
     dwt_write8bitoffsetreg(AON_CTRL_ID, 0, 0);
     dwt_write8bitoffsetreg(AON_CTRL_ID, 0, AON_CTRL_ARRAY_SAVE_BIT_MASK);
+
+    // The device may now go to sleep, which does not preserve the shadowed registers
+    dwt_invalidateregshadow();
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -4070,6 +4849,7 @@ void dwt_softreset(void)
 
     // Reset HIF, TX, RX and PMSC
     dwt_write8bitoffsetreg(SOFT_RST_ID, 0, DWT_RESET_ALL);
+    dwt_invalidateregshadow();
 
     // DW3000 needs a 10us sleep to let clk PLL lock after reset - the PLL will automatically lock after the reset
     // Could also have polled the PLL lock flag, but then the SPI needs to be <= 7MHz !! So a simple delay is easier
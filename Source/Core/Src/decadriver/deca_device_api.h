@@ -358,6 +358,45 @@ typedef void(*dwt_spierrcb_t)(void);
 // Call-back type for all interrupt events
 typedef void (*dwt_cb_t)(const dwt_cb_data_t *);
 
+// Asynchronous transfers (see dwt_xfer_async)
+#define DWT_XFER_READ           (0)
+#define DWT_XFER_WRITE          (1)
+#define DWT_XFER_MAX_BATCH      (4)     // max number of descriptors in one dwt_xfer_async() batch
+#define DWT_SPI_MAX_HEADER_LEN  (3)
+
+// Register file / buffer access descriptor for dwt_xfer_async()
+typedef struct
+{
+    uint32_t regFileID;   // ID of register file or buffer being accessed
+    uint16_t index;       // byte index into register file or buffer being accessed
+    uint16_t length;      // number of bytes to read or write, must not be 0
+    uint8_t  *buffer;     // data to write or buffer to read into, must stay valid until the batch completes
+    uint8_t  dir;         // DWT_XFER_READ or DWT_XFER_WRITE
+} dwt_xfer_t;
+
+// SPI transaction handed to the platform transfer queue (see queuetospi)
+typedef struct
+{
+    uint8_t  header[DWT_SPI_MAX_HEADER_LEN];
+    uint8_t  headerLength;
+    uint8_t  read;        // 1 to read length bytes into buffer, 0 to write them from buffer
+    uint16_t length;
+    uint8_t  *buffer;
+} dwt_spi_xfer_t;
+
+// Call-back type for asynchronous transfer completion, status is DWT_SUCCESS or DWT_ERROR
+typedef void (*dwt_xfer_cb_t)(int status, void *arg);
+
+// Everything needed to finish a ranging exchange, filled in by dwt_readrangingsnapshot()
+typedef struct
+{
+    uint64_t rxStamp;       // adjusted RX timestamp of the received frame (40 bits)
+    uint64_t txStamp;       // TX timestamp of the last transmitted frame (40 bits)
+    uint32_t finfo;         // RX_FINFO register of the received frame
+    uint16_t dataLength;    // received frame length including the FCS, from finfo
+    int16_t  clockOffset;   // clock offset as returned by dwt_readclockoffset()
+} dwt_rangingsnapshot_t;
+
 
 #define SQRT_FACTOR             181 /*Factor of sqrt(2) for calculation*/
 #define STS_LEN_SUPPORTED       7   /*The supported STS length options*/
@@ -1013,6 +1052,23 @@ void dwt_settxantennadelay(uint16_t antennaDly);
  */
 int dwt_writetxdata(uint16_t txDataLength, volatile uint8_t *txDataBytes, uint16_t txBufferOffset);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief Asynchronous version of dwt_writetxdata(). The write is queued behind any transfers in progress and cb is called
+ *        from the SPI DMA interrupt once the data is in the TX buffer. txDataBytes must stay valid until then.
+ *
+ * input parameters
+ * @param txDataLength   - total length of data (in bytes) to write to the tx buffer, see dwt_writetxdata()
+ * @param txDataBytes    - pointer to the user's buffer containing the data to send
+ * @param txBufferOffset - offset in the DW IC's TX Buffer at which to start writing data
+ * @param cb             - completion callback, may be NULL
+ * @param arg            - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the write has been queued, or DWT_ERROR for error
+ */
+int dwt_writetxdata_async(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset, dwt_xfer_cb_t cb, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This API function configures the TX frame control register before the transmission of a frame
  *
@@ -1648,6 +1704,24 @@ void dwt_configureframefilter(uint16_t enabletype, uint16_t filtermode);
  */
 uint8_t dwt_generatecrc8(volatile const uint8_t* byteArray, int flen, uint8_t crcInit);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function composes the SPI header of a register access as dwt_xfer3000() sends it: fast command (length
+ *         0), short (offset 0, read or write) or full (2 bytes, also AND-OR). Exposed for hot_bench.c.
+ *
+ * input parameters:
+ * @param regFileID     - ID of register file or buffer being accessed
+ * @param indx          - byte index into register file or buffer being accessed
+ * @param length        - number of bytes being read/written, 0 for a fast command
+ * @param mode          - DW3000_SPI_WR_BIT/DW3000_SPI_RD_BIT/DW3000_SPI_AND_OR_x
+ *
+ * output parameters
+ * @param header        - 2 byte buffer the header is composed in
+ *
+ * returns the length of the header
+ */
+uint16_t dwt_xferheader(const uint32_t regFileID, const uint16_t indx, const uint16_t length, const spi_modes_e mode,
+                        uint8_t *header);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to enable SPI CRC check in DW3000
  *
@@ -1720,6 +1794,39 @@ void dwt_softreset(void);
  */
 void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief This is used to read everything needed to complete a ranging exchange after a good frame has been received:
+ *        frame info, RX and TX timestamps, clock offset and the first bytes of the frame. It takes 3 SPI transactions
+ *        (2 when length is 0) instead of one per item, and follows the double buffer mode like the individual reads.
+ *
+ * input parameters
+ * @param snapshot - pointer to the structure to fill in
+ * @param buffer   - the buffer into which the start of the frame will be read, may be NULL if length is 0
+ * @param length   - maximum number of frame bytes to read, the read is cut to the received frame length
+ *
+ * output parameters
+ *
+ * returns the number of frame bytes read into buffer
+ */
+uint16_t dwt_readrangingsnapshot(dwt_rangingsnapshot_t *snapshot, uint8_t *buffer, uint16_t length);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief Asynchronous version of dwt_readrxdata(). The read is queued and cb is called from the SPI DMA interrupt once
+ *        buffer has been filled, so the caller can carry on (e.g. build the next frame) while the data is clocked in.
+ *
+ * input parameters
+ * @param buffer - the buffer into which the data will be read, must stay valid until cb is called
+ * @param length - the length of data to read (in bytes)
+ * @param rxBufferOffset - the offset in the rx buffer from which to read the data
+ * @param cb     - completion callback, may be NULL
+ * @param arg    - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the read has been queued, or DWT_ERROR for error
+ */
+int dwt_readrxdata_async(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset, dwt_xfer_cb_t cb, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to read the data from the RX scratch buffer, from an offset location given by offset parameter.
  *
@@ -1831,6 +1938,22 @@ int dwt_readstsstatus(uint16_t* stsStatus, int sts_num);
  */
 void dwt_readdiagnostics(dwt_rxdiag_t * diagnostics);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief Asynchronous version of dwt_readdiagnostics(). The diagnostic registers are read through the transfer queue and
+ *        decoded into diagnostics from the SPI DMA interrupt just before cb is called.
+ *        Only one asynchronous diagnostics read can be pending at a time.
+ *
+ * input parameters
+ * @param diagnostics - diagnostic structure pointer, must stay valid until cb is called
+ * @param cb          - completion callback, may be NULL
+ * @param arg         - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the read has been queued, or DWT_ERROR if one is already pending or the queue is full
+ */
+int dwt_readdiagnostics_async(dwt_rxdiag_t *diagnostics, dwt_xfer_cb_t cb, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief This is used to enable/disable the event counter in the IC
  *
@@ -2120,6 +2243,97 @@ void dwt_readfromdevice
     uint8_t   *buffer             // input parameter - pointer to buffer in which to return the read data.
 );
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function queues a batch of register file / buffer accesses. They run back to back on the SPI, in order and
+ *         after any transfers already queued, while the caller carries on. cb is called from the SPI DMA interrupt once
+ *         the last one has completed. Register writes of up to 4 bytes are copied when queued, longer write buffers and
+ *         all read buffers must stay valid until cb is called.
+ *         Not available in SPI CRC mode.
+ *
+ * input parameters:
+ * @param xfers - array of count access descriptors
+ * @param count - number of descriptors, 1 to DWT_XFER_MAX_BATCH
+ * @param cb    - completion callback, may be NULL
+ * @param arg   - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the batch has been queued, or DWT_ERROR for error
+ */
+int dwt_xfer_async(const dwt_xfer_t *xfers, uint8_t count, dwt_xfer_cb_t cb, void *arg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function turns the RAM shadow of the host-owned configuration registers on or off. These are SYS_CFG,
+ *         SYS_ENABLE, ACK_RESP, CHAN_CTRL, GPIO_MODE, DTUNE0, LDO_CTRL, CLK_CTRL, SEQ_CTRL and LED_CTRL, which the IC
+ *         never changes on its own. With the shadow on, reads of these registers are served from RAM (the first one
+ *         after an invalidate loads the register) and AND/OR updates are computed in RAM and sent as plain writes.
+ *         The shadow is invalidated by dwt_initialise(), dwt_softreset(), dwt_entersleep(), dwt_wakeup_ic() and
+ *         dwt_restoreconfig(). Any other reset of the IC (e.g. through its RSTn pin) must be followed by
+ *         dwt_invalidateregshadow() or dwt_initialise().
+ *         Asynchronous reads (dwt_xfer_async) always go to the device.
+ *
+ * input parameters:
+ * @param enable - 1 to enable the shadow, 0 to disable it. The shadow starts empty either way.
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setregshadow(int enable);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function empties the register shadow (see dwt_setregshadow), the registers are reloaded from the device
+ *         as they are read
+ *
+ * input parameters:
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_invalidateregshadow(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function opens a write combining scope. Until the matching dwt_endwritecombine(), plain register writes
+ *         that continue the previous write in the same register file (e.g. DGC_LUT_0..6) are collected and sent as one
+ *         SPI burst. Any read, AND/OR access or non-adjacent write sends the collected burst first, so the device still
+ *         sees every access in program order; only the number of SPI transactions changes.
+ *         Scopes nest and are used by dwt_configure(), dwt_configmrxlut(), dwt_configurestskey(), dwt_configurestsiv()
+ *         and dwt_restoreconfig(). A scope must not be open while dwt_isr() can run, and must not span a delay that
+ *         relies on an earlier write having reached the device.
+ *
+ * input parameters:
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_beginwritecombine(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function closes a write combining scope (see dwt_beginwritecombine) and sends any collected writes
+ *
+ * input parameters:
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_endwritecombine(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief  this function allows or prevents write combining. It is allowed by default after dwt_initialise(); turning it
+ *         off makes every write its own SPI transaction again, e.g. to compare timings.
+ *
+ * input parameters:
+ * @param enable - 1 to allow write combining, 0 to prevent it
+ *
+ * output parameters
+ *
+ * no return value
+ */
+void dwt_setwritecombine(int enable);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * @brief  this function is used to read 32-bit value from the DW3000 device registers
  *
@@ -2394,6 +2608,27 @@ extern int writetospi(uint16_t headerLength, const uint8_t *headerBuffer, uint16
  */
 extern int readfromspi(uint16_t headerLength, /*const*/ uint8_t *headerBuffer, uint16_t readlength, volatile uint8_t *readBuffer);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @brief
+ * NB: In porting this to a particular microprocessor, the implementer needs to define this function in deca_spi.c to
+ * support the asynchronous dwt_xfer_async() API.
+ * Low level abstract function to queue a batch of SPI transactions, each with its own chip select frame. The batch runs
+ * after any transactions already queued and cb is called (from interrupt context) when its last transaction is done.
+ *
+ * Note: The body of this function is defined in deca_spi.c and is platform specific
+ *
+ * input parameters:
+ * @param xfers - pointer to count transaction descriptors
+ * @param count - number of transactions in the batch
+ * @param cb    - batch completion callback, may be NULL
+ * @param arg   - passed to cb
+ *
+ * output parameters
+ *
+ * returns DWT_SUCCESS if the batch has been queued, or DWT_ERROR for error
+ */
+extern int queuetospi(const dwt_spi_xfer_t *xfers, uint8_t count, dwt_xfer_cb_t cb, void *arg);
+
 #ifdef STM32F429xx
 /*! ------------------------------------------------------------------------------------------------------------------
 * @brief This function sets the CS to '0' for ms delay and than raises it up
@@ -0,0 +1,111 @@
+/*
+ * failsafe.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "failsafe.h"
+#include "main.h"
+#include "tim.h"
+#include "cycle_counter.h"
+#include "output_channels.h"
+
+static volatile uint32_t kick_cycles;
+static volatile FailsafeStats failsafe;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn failsafe_init()
+ *
+ * @brief Sets TIM2 up as a one-shot supervisor: once kicked, the update interrupt fires timeout_ms later unless kicked
+ *        again and forces all the output channels off from interrupt context. The timer stays stopped until the first kick.
+ *
+ * @param  timeout_ms  time without a kick before the relays are cut, 1 to FAILSAFE_MAX_TIMEOUT_MS
+ *
+ * @return none
+ */
+void failsafe_init(uint32_t timeout_ms)
+{
+  if (timeout_ms == 0)
+  {
+    timeout_ms = 1;
+  }
+  else if (timeout_ms > FAILSAFE_MAX_TIMEOUT_MS)
+  {
+    timeout_ms = FAILSAFE_MAX_TIMEOUT_MS;
+  }
+
+  output_channels_init();
+
+  __HAL_TIM_DISABLE(&htim2);
+  __HAL_TIM_SET_PRESCALER(&htim2, tim_apb1_clock_hz() / FAILSAFE_TICK_HZ - 1);
+  __HAL_TIM_SET_AUTORELOAD(&htim2, timeout_ms * (FAILSAFE_TICK_HZ / 1000) - 1);
+
+  /* One pulse: the counter stops on the update event. URS keeps the UG of failsafe_kick() from raising the interrupt. */
+  htim2.Instance->CR1 |= TIM_CR1_OPM | TIM_CR1_URS;
+  htim2.Instance->EGR = TIM_EGR_UG; /* Loads the prescaler */
+  __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_UPDATE);
+  __HAL_TIM_ENABLE_IT(&htim2, TIM_IT_UPDATE);
+
+  cycle_counter_init();
+  failsafe.trips = 0;
+  failsafe.lastCutoffUs = 0;
+  failsafe.maxCutoffUs = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn failsafe_kick()
+ *
+ * @brief Restarts the timeout from now. UG clears both the counter and the prescaler, so the relays are cut exactly
+ *        timeout_ms after the last kick plus the interrupt latency, not up to one tick early.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void failsafe_kick(void)
+{
+  kick_cycles = cycle_counter_read();
+  htim2.Instance->EGR = TIM_EGR_UG;
+  htim2.Instance->CR1 |= TIM_CR1_CEN;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn failsafe_stats()
+ *
+ * @brief Copies the trip count and the measured cutoff latency.
+ *
+ * @param  stats  destination
+ *
+ * @return none
+ */
+void failsafe_stats(FailsafeStats *stats)
+{
+  __disable_irq();
+  stats->trips = failsafe.trips;
+  stats->lastCutoffUs = failsafe.lastCutoffUs;
+  stats->maxCutoffUs = failsafe.maxCutoffUs;
+  __enable_irq();
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn failsafe_expired()
+ *
+ * @brief TIM2 update, no kick for the whole timeout. The relays are written first, the bookkeeping comes after.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void failsafe_expired(void)
+{
+  uint32_t cutoff_us;
+
+  output_channels_write(0, output_channels_all());
+
+  cutoff_us = (cycle_counter_read() - kick_cycles) / (SystemCoreClock / 1000000);
+  failsafe.trips++;
+  failsafe.lastCutoffUs = cutoff_us;
+  if (cutoff_us > failsafe.maxCutoffUs)
+  {
+    failsafe.maxCutoffUs = cutoff_us;
+  }
+}
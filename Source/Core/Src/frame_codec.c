@@ -0,0 +1,254 @@
+/*
+ * frame_codec.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <deca_device_api.h>
+#include "frame_codec.h"
+
+/* Slot TX_FCTRL currently points at, so sending the same frame again does not rewrite it */
+static const FrameSlot *selected_slot = NULL;
+
+/* Addressing of this node, written into every staged frame and checked against every received one */
+static uint16_t own_pan_id = 0xDECA;
+static uint16_t own_address = FRAME_BROADCAST;
+
+static void put_u16(uint8_t *buffer, uint16_t value)
+{
+  buffer[0] = (uint8_t)value;
+  buffer[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t get_u16(const uint8_t *buffer)
+{
+  return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_set_address()
+ *
+ * @brief Sets the PAN ID and short address used by frame_stage() and frame_check_header(). Must be called before the
+ *        frames are staged, a later change of PAN ID also needs frame_set_pan() on them. The same values go to the DW
+ *        IC frame filter, see dwt_setpanid() and dwt_setaddress16().
+ *
+ * @param  pan_id   PAN ID shared by the master and the slave, FRAME_BROADCAST while pairing
+ * @param  address  16-bit short address of this node
+ *
+ * @return none
+ */
+void frame_set_address(uint16_t pan_id, uint16_t address)
+{
+  own_pan_id = pan_id;
+  own_address = address;
+}
+
+uint16_t frame_get_address(void)
+{
+  return own_address;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_stage()
+ *
+ * @brief Writes a whole frame (without its FCS, which the DW IC appends) into its slot of the TX buffer. Done once at
+ *        start up, afterwards only the bytes that change are patched in. The TX buffer keeps its content as long as
+ *        the DW IC is not put to sleep. The PAN ID and source address are filled in, the destination is broadcast
+ *        until frame_set_dest() is called.
+ *
+ * @param  slot   destination in the TX buffer
+ * @param  frame  slot->length bytes, the last two are not written
+ *
+ * @return none
+ */
+void frame_stage(const FrameSlot *slot, const uint8_t *frame)
+{
+  uint8_t addressing[FRAME_FUNC_IDX - FRAME_PAN_IDX];
+
+  dwt_writetxdata(slot->length - FRAME_FCS_LEN, (uint8_t *)frame, slot->offset);
+  selected_slot = NULL;
+
+  put_u16(&addressing[FRAME_PAN_IDX - FRAME_PAN_IDX], own_pan_id);
+  put_u16(&addressing[FRAME_DST_IDX - FRAME_PAN_IDX], FRAME_BROADCAST);
+  put_u16(&addressing[FRAME_SRC_IDX - FRAME_PAN_IDX], own_address);
+  frame_patch(slot, FRAME_PAN_IDX, addressing, sizeof(addressing));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_patch()
+ *
+ * @brief Overwrites length bytes of a staged frame, one SPI write of exactly those bytes.
+ *
+ * @param  slot    staged frame
+ * @param  index   first byte in the frame
+ * @param  data    new content
+ * @param  length  number of bytes
+ *
+ * @return none
+ */
+void frame_patch(const FrameSlot *slot, uint16_t index, const uint8_t *data, uint16_t length)
+{
+  dwt_writetxdata(length, (uint8_t *)data, slot->offset + index);
+}
+
+/* Single byte patch, e.g. sequence number or parameter */
+void frame_set_byte(const FrameSlot *slot, uint16_t index, uint8_t value)
+{
+  dwt_writetxdata(1, &value, slot->offset + index);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_select()
+ *
+ * @brief Points TX_FCTRL at the slot for the next transmission. Skipped when it already does.
+ *
+ * @param  slot  staged frame
+ *
+ * @return none
+ */
+void frame_select(const FrameSlot *slot)
+{
+  if (slot != selected_slot)
+  {
+    dwt_writetxfctrl(slot->length, slot->offset, slot->ranging);
+    selected_slot = slot;
+  }
+}
+
+/* Destination address of a staged frame */
+void frame_set_dest(const FrameSlot *slot, uint16_t address)
+{
+  uint8_t dest[2];
+
+  put_u16(dest, address);
+  frame_patch(slot, FRAME_DST_IDX, dest, sizeof(dest));
+}
+
+/* PAN ID of a staged frame, e.g. the broadcast PAN while pairing */
+void frame_set_pan(const FrameSlot *slot, uint16_t pan_id)
+{
+  uint8_t pan[2];
+
+  put_u16(pan, pan_id);
+  frame_patch(slot, FRAME_PAN_IDX, pan, sizeof(pan));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_check_header()
+ *
+ * @brief Checks that a received header is a data frame of our PAN or the broadcast PAN, addressed to this node or
+ *        broadcast. With the DW IC frame filter on, anything else has already been dropped in hardware; the check
+ *        stays for when it is off. The acknowledgement request bit is not part of the match.
+ *
+ * @param  header  FRAME_HDR_LEN bytes read from the RX buffer
+ *
+ * @return the function code, or FRAME_INVALID if the frame is not for this node
+ */
+int frame_check_header(const uint8_t *header)
+{
+  uint16_t pan_id = get_u16(&header[FRAME_PAN_IDX]);
+  uint16_t dest = get_u16(&header[FRAME_DST_IDX]);
+
+  if ((get_u16(header) & ~FRAME_FC_ACK_REQ) != FRAME_FC_DATA || (pan_id != own_pan_id && pan_id != FRAME_BROADCAST) ||
+      (dest != own_address && dest != FRAME_BROADCAST))
+  {
+    return FRAME_INVALID;
+  }
+
+  return header[FRAME_FUNC_IDX];
+}
+
+/* Short address of the sender of a checked header */
+uint16_t frame_get_source(const uint8_t *header)
+{
+  return get_u16(&header[FRAME_SRC_IDX]);
+}
+
+/* Destination of a checked header: this node or FRAME_BROADCAST */
+uint16_t frame_get_dest(const uint8_t *header)
+{
+  return get_u16(&header[FRAME_DST_IDX]);
+}
+
+/* PAN ID of a checked header: ours or FRAME_BROADCAST */
+uint16_t frame_get_pan(const uint8_t *header)
+{
+  return get_u16(&header[FRAME_PAN_IDX]);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_read_header()
+ *
+ * @brief Reads only the header of the received frame and checks it, so a foreign frame costs FRAME_HDR_LEN bytes of
+ *        SPI whatever its length. The payload is fetched with frame_read_payload() once the function code is known.
+ *
+ * @param  buffer      at least FRAME_HDR_LEN bytes
+ * @param  datalength  received frame length including the FCS
+ *
+ * @return the function code, or FRAME_INVALID if the frame is too short or not for this node
+ */
+int frame_read_header(uint8_t *buffer, uint16_t datalength)
+{
+  if (datalength < FRAME_HDR_LEN + FRAME_FCS_LEN)
+  {
+    return FRAME_INVALID;
+  }
+
+  dwt_readrxdata(buffer, FRAME_HDR_LEN, 0);
+  return frame_check_header(buffer);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_read_ack()
+ *
+ * @brief Reads an IEEE 802.15.4 acknowledgement, as sent by the DW IC auto-ACK in reply to a frame with the
+ *        acknowledgement request bit set.
+ *
+ * @param  datalength  received frame length including the FCS
+ *
+ * @return the acknowledged sequence number, or FRAME_INVALID if the frame is not an acknowledgement
+ */
+int frame_read_ack(uint16_t datalength)
+{
+  uint8_t ack[FRAME_ACK_LEN - FRAME_FCS_LEN];
+
+  if (datalength != FRAME_ACK_LEN)
+  {
+    return FRAME_INVALID;
+  }
+
+  dwt_readrxdata(ack, sizeof(ack), 0);
+  if ((get_u16(ack) & FRAME_FC_TYPE_MASK) != FRAME_FC_TYPE_ACK)
+  {
+    return FRAME_INVALID;
+  }
+
+  return ack[FRAME_SN_IDX];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn frame_read_payload()
+ *
+ * @brief Reads the bytes after the header into buffer[FRAME_HDR_LEN], leaving out the FCS.
+ *
+ * @param  buffer      receive buffer, header already in place
+ * @param  size        size of buffer
+ * @param  datalength  received frame length including the FCS
+ *
+ * @return DWT_SUCCESS, or DWT_ERROR if the frame does not fit in buffer
+ */
+int frame_read_payload(uint8_t *buffer, uint16_t size, uint16_t datalength)
+{
+  uint16_t length = datalength - FRAME_FCS_LEN;
+
+  if (datalength < FRAME_HDR_LEN + FRAME_FCS_LEN || length > size)
+  {
+    return DWT_ERROR;
+  }
+
+  if (length > FRAME_HDR_LEN)
+  {
+    dwt_readrxdata(&buffer[FRAME_HDR_LEN], length - FRAME_HDR_LEN, FRAME_HDR_LEN);
+  }
+
+  return DWT_SUCCESS;
+}
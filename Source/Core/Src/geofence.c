@@ -0,0 +1,100 @@
+/*
+ * geofence.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "geofence.h"
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn geofence_init()
+ *
+ * @brief Starts the state machine in GEOFENCE_LOST, the first range decides where it goes from there.
+ *
+ * @param  gf   state machine
+ * @param  cfg  distances and time windows, copied
+ * @param  now  current tick in milliseconds
+ *
+ * @return none
+ */
+void geofence_init(Geofence *gf, const GeofenceConfig *cfg, uint32_t now)
+{
+  gf->cfg = *cfg;
+  gf->state = GEOFENCE_LOST;
+  gf->suspectTick = now;
+  gf->lastRangeTick = now;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn geofence_range()
+ *
+ * @brief Feeds one valid range. Only a range at or below enterMm brings the state back to GEOFENCE_IN_RANGE, and only
+ *        one above exitMm starts a confirmation window, so a range jittering around the limit does not toggle outputs.
+ *        A far range after GEOFENCE_LOST goes straight to GEOFENCE_OUT_OF_RANGE as the outputs are already off.
+ *
+ * @param  gf          state machine
+ * @param  distanceMm  measured distance
+ * @param  now         current tick in milliseconds
+ *
+ * @return the new state
+ */
+GeofenceState geofence_range(Geofence *gf, int32_t distanceMm, uint32_t now)
+{
+  int near = (distanceMm <= gf->cfg.enterMm);
+  int far = (distanceMm > gf->cfg.exitMm);
+
+  gf->lastRangeTick = now;
+
+  switch (gf->state)
+  {
+    case GEOFENCE_IN_RANGE:
+      if (far)
+      {
+        gf->state = GEOFENCE_SUSPECT;
+        gf->suspectTick = now;
+      }
+      break;
+    case GEOFENCE_SUSPECT:
+      if (near)
+      {
+        gf->state = GEOFENCE_IN_RANGE;
+      }
+      break;
+    case GEOFENCE_OUT_OF_RANGE:
+      if (near)
+      {
+        gf->state = GEOFENCE_IN_RANGE;
+      }
+      break;
+    case GEOFENCE_LOST:
+      gf->state = near ? GEOFENCE_IN_RANGE : GEOFENCE_OUT_OF_RANGE;
+      break;
+  }
+
+  return geofence_tick(gf, now);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn geofence_tick()
+ *
+ * @brief Applies the time windows, must be called from the main loop whether or not a range came in so that
+ *        GEOFENCE_OUT_OF_RANGE is reached confirmMs after the first far range and GEOFENCE_LOST lostMs after the last
+ *        valid range, independent of the ranging rate.
+ *
+ * @param  gf   state machine
+ * @param  now  current tick in milliseconds
+ *
+ * @return the new state
+ */
+GeofenceState geofence_tick(Geofence *gf, uint32_t now)
+{
+  if (gf->state != GEOFENCE_LOST && (now - gf->lastRangeTick) >= gf->cfg.lostMs)
+  {
+    gf->state = GEOFENCE_LOST;
+  }
+  else if (gf->state == GEOFENCE_SUSPECT && (now - gf->suspectTick) >= gf->cfg.confirmMs)
+  {
+    gf->state = GEOFENCE_OUT_OF_RANGE;
+  }
+
+  return gf->state;
+}
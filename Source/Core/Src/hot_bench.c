@@ -0,0 +1,177 @@
+/*
+ * hot_bench.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <stdio.h>
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <port.h>
+#include <config_options.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include <pwm_utils.h>
+#include <uwb_slave.h>
+#include <hot_bench.h>
+#ifndef HOT_BENCH_HOST
+#include <cycle_counter.h>
+#endif
+
+#define BENCH_CALLS      (64)    /* Calls per timed batch */
+#define BENCH_BATCHES    (32)    /* Batches per path, the minimum is the figure least disturbed by interrupts */
+#define BENCH_CRC_LONG   (127)   /* Largest standard frame */
+#define BENCH_ERR_COUNT  (STS_LOG_REG_FAILED_ERR + 1)
+
+/* Status of a good frame, and of a frame with a PHY header error and a preamble timeout. CPERR is left out of both, it
+ * makes check_for_status_errors() read the STS status over SPI. */
+#define STATUS_GOOD      (SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_RXFR_BIT_MASK)
+#define STATUS_ERRORS    (SYS_STATUS_RXPHE_BIT_MASK | SYS_STATUS_RXPTO_BIT_MASK | SYS_STATUS_RXFR_BIT_MASK)
+
+#define LED_CHANNEL      TIM_CHANNEL_4
+
+extern TIM_HandleTypeDef htim1;
+
+/* Results land here so the calls under test cannot be optimised away */
+static volatile uint32_t sink32;
+static volatile uint64_t sink64;
+
+static uint8_t crc_buf[BENCH_CRC_LONG];
+static uint8_t ts_field[RESP_MSG_TS_LEN];
+static uint32_t errors[BENCH_ERR_COUNT];
+
+#ifdef HOT_BENCH_HOST
+#define bench_clock()    hot_bench_host_clock()
+#define bench_clock_hz() HOT_BENCH_CLOCK_HZ
+#else
+#define bench_clock()    cycle_counter_read()
+#define bench_clock_hz() SystemCoreClock
+#endif
+
+/* Prints ticks per call with two decimals, printf has no float support on target */
+static void print_per_call(uint32_t ticks)
+{
+  uint32_t hundredths = (uint32_t)(((uint64_t)ticks * 100 + BENCH_CALLS / 2) / BENCH_CALLS);
+
+  printf(",%lu.%02lu", (unsigned long)(hundredths / 100), (unsigned long)(hundredths % 100));
+}
+
+/* hot_bench,<path>,<calls>,<min>,<mean>: ticks per call of the fastest and of the average batch */
+static void report(const char *path, uint32_t min, uint32_t sum)
+{
+  printf("hot_bench,%s,%u", path, BENCH_CALLS);
+  print_per_call(min);
+  print_per_call(sum / BENCH_BATCHES);
+  printf("\r\n");
+}
+
+/* Times BENCH_BATCHES batches of BENCH_CALLS runs of stmt, which may use the call index i */
+#define BENCH_PATH(path, stmt)                            \
+  do                                                      \
+  {                                                       \
+    uint32_t min = UINT32_MAX;                            \
+    uint32_t sum = 0;                                     \
+    for (int batch = 0; batch < BENCH_BATCHES; batch++)   \
+    {                                                     \
+      uint32_t start = bench_clock();                     \
+      for (uint32_t i = 0; i < BENCH_CALLS; i++)          \
+      {                                                   \
+        stmt;                                             \
+      }                                                   \
+      uint32_t ticks = bench_clock() - start;             \
+      min = ticks < min ? ticks : min;                    \
+      sum += ticks;                                       \
+    }                                                     \
+    report(path, min, sum);                               \
+  } while (0)
+
+static void bench_driver(void)
+{
+  uint8_t header[DWT_SPI_MAX_HEADER_LEN];
+
+  /* The CRC table is only built by dwt_enablespicrccheck(), its contents do not change the time taken */
+  BENCH_PATH("crc8_4", sink32 = dwt_generatecrc8(crc_buf, 4, (uint8_t)i));
+  BENCH_PATH("crc8_127", sink32 = dwt_generatecrc8(crc_buf, BENCH_CRC_LONG, (uint8_t)i));
+
+  /* The three header forms dwt_xfer3000() composes: fast command, one byte and two byte address */
+  BENCH_PATH("xferheader_fast", sink32 = dwt_xferheader(CMD_TXRXOFF, 0, 0, DW3000_SPI_WR_BIT, header));
+  BENCH_PATH("xferheader_short", sink32 = dwt_xferheader(RX_BUFFER_0_ID, 0, 16, DW3000_SPI_RD_BIT, header));
+  BENCH_PATH("xferheader_full", sink32 = dwt_xferheader(SYS_STATUS_ID, 0, 4, DW3000_SPI_RD_BIT, header));
+  BENCH_PATH("xferheader_and_or", sink32 = dwt_xferheader(SYS_CFG_ID, 0, 8, DW3000_SPI_AND_OR_32, header));
+
+  /* One 5 byte register read each, so these include the SPI transaction */
+  BENCH_PATH("get_rx_timestamp_u64", sink64 = get_rx_timestamp_u64());
+  BENCH_PATH("get_tx_timestamp_u64", sink64 = get_tx_timestamp_u64());
+}
+
+static void bench_ranging(void)
+{
+  dwt_rangingsnapshot_t snapshot = {
+    .rxStamp = 0x0012345678ULL,
+    .txStamp = 0x0002345678ULL,
+    .clockOffset = 100,
+  };
+  uint32_t ts;
+
+  BENCH_PATH("resp_msg_set_ts", resp_msg_set_ts(ts_field, 0x0123456789ULL + i));
+  BENCH_PATH("resp_msg_get_ts", { resp_msg_get_ts(ts_field, &ts); sink32 = ts; });
+  BENCH_PATH("calculate_distance", sink32 = (uint32_t)calculate_distance(&snapshot));
+  BENCH_PATH("check_for_status_errors_good", check_for_status_errors(STATUS_GOOD, errors));
+  BENCH_PATH("check_for_status_errors_bad", check_for_status_errors(STATUS_ERRORS, errors));
+}
+
+/* On the error LED channel, which initErrorLed() has started. Left off afterwards, as at boot. */
+static void bench_pwm(void)
+{
+  TimerParams params = {
+    .timerHandle = &htim1,
+    .timerChannel = LED_CHANNEL,
+    .clockFrequencyHz = HAL_RCC_GetPCLK2Freq(),
+  };
+
+  BENCH_PATH("updatePwmSignal", updatePwmSignal(&params, 100, (uint8_t)(i & 1) * 50));
+  updatePwmSignal(&params, 100, 0);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn hot_bench_run()
+ *
+ * @brief Times the code on the ranging path one function at a time: SPI header composition and CRC in the DW IC
+ *        driver, the timestamp helpers, the distance computation, the status error check and the PWM update. Prints
+ *        hot_bench_clock,<hz> and then one CSV line per path on the debug UART:
+ *        hot_bench,<path>,<calls>,<min>,<mean>
+ *        in clock ticks per call, the loop overhead included (path "empty"). Ticks are DWT cycles on target and ns of
+ *        host time in the host build. The DW IC is reset, so this runs before the ranging role is started.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void hot_bench_run(void)
+{
+#ifndef HOT_BENCH_HOST
+  cycle_counter_init();
+#endif
+
+  port_set_dw_ic_spi_fastrate();
+  reset_DWIC();
+  Sleep(2);
+
+  while (!dwt_checkidlerc()) { };
+
+  if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
+  {
+    printf("hot_bench: INIT FAILED\r\n");
+    return;
+  }
+
+  memset(crc_buf, 0xA5, sizeof(crc_buf));
+
+  printf("hot_bench_clock,%lu\r\n", (unsigned long)bench_clock_hz());
+  printf("hot_bench,path,calls,min,mean\r\n");
+
+  BENCH_PATH("empty", sink32 = i);
+  bench_driver();
+  bench_ranging();
+  bench_pwm();
+}
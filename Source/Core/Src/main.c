@@ -18,6 +18,7 @@
 /* USER CODE END Header */
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
+#include "dma.h"
 #include "spi.h"
 #include "tim.h"
 #include "usart.h"
@@ -29,6 +30,13 @@
 #include "uwb_master.h"
 #include "uwb_slave.h"
 #include "error_led.h"
+#include <config_options.h>
+#ifdef CONFIG_SPI_BENCHMARK
+#include "spi_bench.h"
+#endif
+#ifdef CONFIG_HOT_BENCHMARK
+#include "hot_bench.h"
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -89,12 +97,23 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_SPI1_Init();
   MX_USART2_UART_Init();
   MX_TIM1_Init();
+  MX_TIM2_Init();
+  MX_TIM3_Init();
   /* USER CODE BEGIN 2 */
   initErrorLed();
 
+#ifdef CONFIG_SPI_BENCHMARK
+  spi_bench_run();
+#endif
+
+#ifdef CONFIG_HOT_BENCHMARK
+  hot_bench_run();
+#endif
+
   // When flashing STM boards (master and slave), One of the following
   // function calls will be commented accordingly
 //  uwb_slave(); // Acts as the slave (066BFF535157808667101914)
@@ -161,6 +180,8 @@ void SystemClock_Config(void)
 
 /* USER CODE BEGIN 4 */
 
+/* HAL_TIM_PeriodElapsedCallback() is in timer_events.c, shared with the host simulation */
+
 /* USER CODE END 4 */
 
 /**
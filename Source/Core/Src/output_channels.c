@@ -0,0 +1,217 @@
+/*
+ * output_channels.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "output_channels.h"
+#include "main.h"
+
+typedef struct
+{
+  GPIO_TypeDef *port;
+  uint16_t pin;
+} OutputPin;
+
+/* Output channel n is entry n. A panel with more switched channels lists its pins here (and configures them as
+ * outputs in gpio.c), up to OUTPUT_CHANNELS_MAX. */
+static const OutputPin channel_pins[] = {
+  {RELAY_1_OUT_GPIO_Port, RELAY_1_OUT_Pin},
+  {RELAY_2_OUT_GPIO_Port, RELAY_2_OUT_Pin},
+};
+
+#define OUTPUT_CHANNELS (sizeof(channel_pins) / sizeof(channel_pins[0]))
+#define OUTPUT_GROUPS ((OUTPUT_CHANNELS + 3) / 4)  /* Channels are looked up four at a time */
+#define OUTPUT_PORTS_MAX 3
+
+/* Lookup tables of one GPIO port, built once by output_channels_init() */
+typedef struct
+{
+  GPIO_TypeDef *port;
+  uint16_t pins;                        /* Pins of this port used by a channel */
+  uint16_t pins_of[OUTPUT_GROUPS][16];  /* Pins of the channels set in each value of each 4-channel group */
+  uint32_t channels_of[4][16];          /* Channels driven by each value of each 4-pin group of the port */
+} OutputPort;
+
+static OutputPort ports[OUTPUT_PORTS_MAX];
+static uint8_t port_count = 0;
+
+static OutputPort *port_map(GPIO_TypeDef *port)
+{
+  uint8_t i;
+
+  for (i = 0; i < port_count; i++)
+  {
+    if (ports[i].port == port)
+    {
+      return &ports[i];
+    }
+  }
+
+  if (port_count == OUTPUT_PORTS_MAX)
+  {
+    Error_Handler();
+  }
+
+  ports[port_count].port = port;
+  return &ports[port_count++];
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn output_channels_init()
+ *
+ * @brief Builds the per-port lookup tables from the channel list, so that writing or reading all the channels costs
+ *        a fixed number of table lookups and one register access per port, whatever the channel count.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void output_channels_init(void)
+{
+  uint8_t ch, value, bit;
+
+  if (port_count != 0)
+  {
+    return;
+  }
+
+  for (ch = 0; ch < OUTPUT_CHANNELS; ch++)
+  {
+    OutputPort *map = port_map(channel_pins[ch].port);
+    uint16_t pin = channel_pins[ch].pin;
+
+    map->pins |= pin;
+    for (value = 0; value < 16; value++)
+    {
+      if (value & (1 << (ch % 4)))
+      {
+        map->pins_of[ch / 4][value] |= pin;
+      }
+    }
+
+    for (bit = 0; bit < 16; bit++)
+    {
+      if (pin == (1 << bit))
+      {
+        break;
+      }
+    }
+    for (value = 0; value < 16; value++)
+    {
+      if (value & (1 << (bit % 4)))
+      {
+        map->channels_of[bit / 4][value] |= 1UL << ch;
+      }
+    }
+  }
+}
+
+uint8_t output_channels_count(void)
+{
+  return OUTPUT_CHANNELS;
+}
+
+/* Mask with a bit set for each channel */
+uint32_t output_channels_all(void)
+{
+  return (OUTPUT_CHANNELS == 32) ? 0xFFFFFFFFUL : ((1UL << OUTPUT_CHANNELS) - 1);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn output_channels_write()
+ *
+ * @brief Drives the channels selected by mask to their level in state, the others are left as they are. One BSRR
+ *        write per port, so the channels of a port switch together. Safe from interrupt context.
+ *
+ * @param  state  bit n is the level of channel n, 1 = on
+ * @param  mask   channels to drive
+ *
+ * @return none
+ */
+void output_channels_write(uint32_t state, uint32_t mask)
+{
+  uint8_t i, group;
+
+  for (i = 0; i < port_count; i++)
+  {
+    const OutputPort *map = &ports[i];
+    uint16_t on = 0;
+    uint16_t touched = 0;
+
+    for (group = 0; group < OUTPUT_GROUPS; group++)
+    {
+      on |= map->pins_of[group][(state >> (4 * group)) & 0xF];
+      touched |= map->pins_of[group][(mask >> (4 * group)) & 0xF];
+    }
+
+    if (touched)
+    {
+      map->port->BSRR = (on & touched) | ((uint32_t)(touched & ~on) << 16);
+    }
+  }
+}
+
+/* Current output levels read back from the pins, bit n is channel n */
+uint32_t output_channels_read(void)
+{
+  uint32_t state = 0;
+  uint8_t i, group;
+
+  for (i = 0; i < port_count; i++)
+  {
+    uint16_t levels = ports[i].port->IDR & ports[i].pins;
+
+    for (group = 0; group < 4; group++)
+    {
+      state |= ports[i].channels_of[group][(levels >> (4 * group)) & 0xF];
+    }
+  }
+
+  return state;
+}
+
+static void put_u32(uint8_t *buffer, uint32_t value)
+{
+  buffer[0] = (uint8_t)value;
+  buffer[1] = (uint8_t)(value >> 8);
+  buffer[2] = (uint8_t)(value >> 16);
+  buffer[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get_u32(const uint8_t *buffer)
+{
+  return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+/* Fills OUTPUT_MSG_LEN bytes */
+void output_msg_encode(uint8_t *buffer, const OutputMsg *msg)
+{
+  buffer[OUTPUT_MSG_VERSION_IDX] = OUTPUT_MSG_VERSION;
+  buffer[OUTPUT_MSG_CHANNELS_IDX] = msg->channels;
+  put_u32(&buffer[OUTPUT_MSG_STATE_IDX], msg->state);
+  put_u32(&buffer[OUTPUT_MSG_MASK_IDX], msg->mask);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn output_msg_decode()
+ *
+ * @brief Decodes an output block. Channels the local side does not have are dropped from state and mask, so a
+ *        sender with more or fewer channels only drives the ones both sides have.
+ *
+ * @param  buffer  OUTPUT_MSG_LEN received bytes
+ * @param  msg     decoded block
+ *
+ * @return 1 if the block is valid, 0 on an unknown version or channel count
+ */
+int output_msg_decode(const uint8_t *buffer, OutputMsg *msg)
+{
+  if (buffer[OUTPUT_MSG_VERSION_IDX] != OUTPUT_MSG_VERSION || buffer[OUTPUT_MSG_CHANNELS_IDX] > OUTPUT_CHANNELS_MAX)
+  {
+    return 0;
+  }
+
+  msg->channels = buffer[OUTPUT_MSG_CHANNELS_IDX];
+  msg->state = get_u32(&buffer[OUTPUT_MSG_STATE_IDX]) & output_channels_all();
+  msg->mask = get_u32(&buffer[OUTPUT_MSG_MASK_IDX]) & output_channels_all();
+  return 1;
+}
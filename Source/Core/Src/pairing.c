@@ -0,0 +1,108 @@
+/*
+ * pairing.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "pairing.h"
+#include "controller_input.h"
+#include "main.h"
+
+/* Last 128 KB sector of the STM32F411RE, left out of the FLASH region in STM32F411RETX_FLASH.ld. Each change of the
+ * peer appends one word, the sector is only erased once it is full. */
+#define PAIRING_SECTOR FLASH_SECTOR_7
+#define PAIRING_ADDR (FLASH_BASE + 0x60000UL)
+#define PAIRING_WORDS (0x20000UL / 4)
+#define PAIRING_ERASED 0xFFFFFFFFUL
+#define PAIRING_TAG 0xB1700000UL       /* Upper half of a record, the lower half is the peer */
+#define PAIRING_TAG_MASK 0xFFFF0000UL
+
+static uint32_t record_at(uint32_t index)
+{
+  return *(const volatile uint32_t *)(PAIRING_ADDR + 4 * index);
+}
+
+/* Last stored peer and the index of the first erased word, PAIRING_WORDS when the sector is full. A word that is
+ * neither erased nor a record (a write cut by a reset) is skipped. */
+static uint16_t scan(uint32_t *next)
+{
+  uint16_t peer = PAIRING_NONE;
+  uint32_t i;
+
+  for (i = 0; i < PAIRING_WORDS; i++)
+  {
+    uint32_t record = record_at(i);
+
+    if (record == PAIRING_ERASED)
+    {
+      break;
+    }
+    if ((record & PAIRING_TAG_MASK) == PAIRING_TAG)
+    {
+      peer = (uint16_t)record;
+    }
+  }
+
+  *next = i;
+  return peer;
+}
+
+/* Stored peer, PAIRING_NONE if this node has not paired yet or the pairing was cleared */
+uint16_t pairing_load(void)
+{
+  uint32_t next;
+
+  return scan(&next);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn pairing_store()
+ *
+ * @brief Keeps the peer across power cycles, PAIRING_NONE clears it. Nothing is written if it is already stored. The
+ *        CPU stalls while the flash is programmed (about 16 us per word), and about 1 s more for the erase once every
+ *        32768 changes. Called from the main loop only.
+ *
+ * @param  peer  short address of the other node of the pair
+ *
+ * @return 1 if the peer is stored, 0 if the flash reported an error
+ */
+int pairing_store(uint16_t peer)
+{
+  uint32_t next;
+  HAL_StatusTypeDef status = HAL_OK;
+
+  if (scan(&next) == peer)
+  {
+    return 1;
+  }
+
+  HAL_FLASH_Unlock();
+  if (next == PAIRING_WORDS)
+  {
+    FLASH_EraseInitTypeDef erase = {.TypeErase = FLASH_TYPEERASE_SECTORS, .Sector = PAIRING_SECTOR, .NbSectors = 1,
+                                    .VoltageRange = FLASH_VOLTAGE_RANGE_3};
+    uint32_t sector_error;
+
+    status = HAL_FLASHEx_Erase(&erase, &sector_error);
+    next = 0;
+  }
+  if (status == HAL_OK)
+  {
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, PAIRING_ADDR + 4 * next, PAIRING_TAG | peer);
+  }
+  HAL_FLASH_Lock();
+
+  return status == HAL_OK;
+}
+
+/* Both controller inputs on at power-up ask for the stored pairing to be cleared, on the master and on the slave */
+int pairing_clear_requested(void)
+{
+  return controller_input_read() == CONTROLLER_INPUT_ALL;
+}
+
+/* A pair uses the short address of its master as PAN ID, unique as long as the short addresses are. Never 0xFFFF, see
+ * port_get_short_address(). */
+uint16_t pairing_pan_id(uint16_t master_address)
+{
+  return master_address;
+}
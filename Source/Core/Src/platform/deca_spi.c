@@ -11,6 +11,7 @@
  * @author DecaWave
  */
 
+#include <string.h>
 #include <deca_spi.h>
 #include <deca_device_api.h>
 #include <port.h>
@@ -19,6 +20,36 @@
 
 extern  SPI_HandleTypeDef hspi1;    /*clocked from 72MHz*/
 
+/* Bodies of at least this many bytes go through DMA2 (SPI1_RX Stream0, SPI1_TX Stream3), 0 keeps everything polled */
+static uint16_t         spi_dma_threshold = DECA_SPI_DMA_THRESHOLD;
+
+/* Asynchronous transfer queue entry. Write bodies of up to 4 bytes (register writes) are copied into data */
+typedef struct
+{
+    dwt_spi_xfer_t  xfer;
+    uint8_t         data[4];
+    spi_dma_cb_t    cb;         /* set on the last entry of a batch only */
+    void            *arg;
+} spi_queue_entry_t;
+
+static spi_queue_entry_t spi_queue[DECA_SPI_QUEUE_LEN];
+static volatile uint8_t  spi_queue_head = 0;
+static volatile uint8_t  spi_queue_count = 0;
+static int               spi_queue_status = 0;
+
+/* Queue running: SPI1 is owned by the DMA chain. CS and the DW IC IRQ mask are released once the queue drains */
+static volatile uint8_t spi_dma_active = 0;
+static decaIrqStatus_t  spi_dma_stat;
+
+/* Transactions (header + body) shorter than this many bytes bypass the HAL and drive the SPI1 registers directly */
+static uint16_t         spi_fast_limit = DECA_SPI_FAST_LIMIT;
+
+/* Number of SPI transactions (CS frames) sent to the DW IC, for benchmarking. Updated from several interrupt levels
+ * without locking, so it is only exact while a single context drives the SPI */
+static uint32_t         spi_xfer_cnt = 0;
+
+static void spi_queue_run(void);
+
 
 /****************************************************************************//**
  *
@@ -47,8 +78,178 @@ int closespi(void)
     return 0;
 } // end closespi()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_dma_set_threshold()
+ *
+ * Sets the body length from which readfromspi()/writetospi() use DMA, 0 disables DMA for the blocking calls
+ */
+void spi_dma_set_threshold(uint16_t bytes)
+{
+    spi_dma_threshold = bytes;
+} // end spi_dma_set_threshold()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_xfer_count()
+ *
+ * returns the number of SPI transactions sent to the DW IC so far
+ */
+uint32_t spi_xfer_count(void)
+{
+    return spi_xfer_cnt;
+} // end spi_xfer_count()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_dma_busy()
+ *
+ * returns 1 while the asynchronous transfer queue is running, 0 otherwise
+ */
+int spi_dma_busy(void)
+{
+    return spi_dma_active;
+} // end spi_dma_busy()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_dma_wait()
+ *
+ * Blocks until the asynchronous transfer queue has drained.
+ * NOTE: the DMA interrupts have a higher preemption priority than the DW IC EXTI line, so this may be called from dwt_isr()
+ *       but not from a queue completion callback
+ */
+static void spi_dma_wait(void)
+{
+    while(spi_dma_active)
+    {
+    }
+} // end spi_dma_wait()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_lock()
+ *
+ * Takes SPI1 for a polled transaction: waits for the transfer queue to drain and masks the DW IC IRQ.
+ * The queue can be started from dwt_isr() between the wait and decamutexon(), so it is checked again under the mutex.
+ * returns the DW IC IRQ state to hand back to decamutexoff()
+ */
+static decaIrqStatus_t spi_lock(void)
+{
+    decaIrqStatus_t  stat ;
+
+    for(;;)
+    {
+        spi_dma_wait();
+        stat = decamutexon() ;
+        if(!spi_dma_active)
+        {
+            return stat;
+        }
+        decamutexoff(stat);
+    }
+} // end spi_lock()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_dma_use()
+ *
+ * returns 1 if a body of this length should be moved by DMA
+ */
+static int spi_dma_use(uint16_t bodyLength)
+{
+    return (spi_dma_threshold != 0) && (bodyLength >= spi_dma_threshold);
+} // end spi_dma_use()
+
+
+
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_fast_set_limit()
+ *
+ * Sets the transaction length (header + body) below which the register level path is used, 0 disables it
+ */
+void spi_fast_set_limit(uint16_t bytes)
+{
+    spi_fast_limit = bytes;
+} // end spi_fast_set_limit()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_fast_use()
+ *
+ * returns 1 if a transaction of this length should use the register level path
+ */
+static inline int spi_fast_use(uint16_t headerLength, uint16_t bodyLength)
+{
+    return (uint32_t)headerLength + bodyLength < spi_fast_limit;
+} // end spi_fast_use()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_fast_byte()
+ *
+ * Clocks one byte out on MOSI and returns the byte clocked in on MISO. RXNE is always drained, so no overrun is left
+ * behind for the HAL calls that follow.
+ */
+static inline uint8_t spi_fast_byte(SPI_TypeDef *spi, uint8_t out)
+{
+    while((spi->SR & SPI_SR_TXE) == 0)
+    {
+    }
+
+    *(volatile uint8_t *)&spi->DR = out;
+
+    while((spi->SR & SPI_SR_RXNE) == 0)
+    {
+    }
+
+    return *(volatile uint8_t *)&spi->DR;
+} // end spi_fast_byte()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_fast_xfer()
+ *
+ * Register level SPI1 transaction for short register accesses: no HAL state checks, locking or timeouts.
+ * CS is driven through BSRR and the DW IC IRQ is masked for the duration as in the HAL path.
+ * When readBuffer is NULL the body is written from bodyBuffer, otherwise bodyLength bytes are read into readBuffer.
+ */
+static inline void spi_fast_xfer(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength,
+                                 volatile const uint8_t *bodyBuffer, volatile uint8_t *readBuffer)
+{
+    SPI_TypeDef *spi = hspi1.Instance;
+    decaIrqStatus_t  stat ;
+
+    stat = spi_lock() ;
+
+    if((spi->CR1 & SPI_CR1_SPE) == 0)
+    {
+        spi->CR1 |= SPI_CR1_SPE;
+    }
+
+    DW_NSS_GPIO_Port->BSRR = (uint32_t)DW_NSS_Pin << 16U; /**< Put chip select line low */
+    spi_xfer_cnt++;
+
+    while(headerLength-- > 0)
+    {
+        (void)spi_fast_byte(spi, *headerBuffer++);
+    }
+
+    if(readBuffer != NULL)
+    {
+        while(bodyLength-- > 0)
+        {
+            *readBuffer++ = spi_fast_byte(spi, 0); /* MOSI held at 0 while reading */
+        }
+    }
+    else
+    {
+        while(bodyLength-- > 0)
+        {
+            (void)spi_fast_byte(spi, *bodyBuffer++);
+        }
+    }
+
+    while((spi->SR & SPI_SR_BSY) != 0)
+    {
+    }
 
+    DW_NSS_GPIO_Port->BSRR = DW_NSS_Pin; /**< Put chip select line high */
 
+    decamutexoff(stat);
+} // end spi_fast_xfer()
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * Function: writetospiwithcrc()
@@ -65,10 +266,12 @@ int writetospiwithcrc(
                 uint8_t crc8)
 {
     decaIrqStatus_t  stat ;
-    stat = decamutexon() ;
+
+    stat = spi_lock() ;
     while (HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY);
 
     HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_RESET); /**< Put chip select line low */
+    spi_xfer_cnt++;
 
     HAL_SPI_Transmit(&hspi1, (uint8_t *)headerBuffer, headerLength, 10);    /* Send header in polling mode */
     HAL_SPI_Transmit(&hspi1, (uint8_t *)bodyBuffer, bodyLength, 10);        /* Send data in polling mode */
@@ -93,11 +296,29 @@ int writetospi(uint16_t       headerLength,
                volatile const uint8_t *bodyBuffer)
 {
     decaIrqStatus_t  stat ;
-    stat = decamutexon() ;
+
+    if(spi_fast_use(headerLength, bodyLength))
+    {
+        spi_fast_xfer(headerLength, headerBuffer, bodyLength, bodyBuffer, NULL);
+        return 0;
+    }
+
+    if(spi_dma_use(bodyLength))
+    {
+        /* Long bodies (TX buffer writes) go through the DMA queue, wait for it to drain to keep the call blocking */
+        if(writetospi_dma(headerLength, headerBuffer, bodyLength, (const uint8_t *)bodyBuffer, NULL, NULL) == 0)
+        {
+            spi_dma_wait();
+            return 0;
+        }
+    }
+
+    stat = spi_lock() ;
 
     while (HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY);
 
     HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_RESET); /**< Put chip select line low */
+    spi_xfer_cnt++;
 
     HAL_SPI_Transmit(&hspi1, (uint8_t *)headerBuffer, headerLength, HAL_MAX_DELAY); /* Send header in polling mode */
 
@@ -153,12 +374,30 @@ int readfromspi(uint16_t  headerLength,
     int i;
 
     decaIrqStatus_t  stat ;
-    stat = decamutexon() ;
+
+    if(spi_fast_use(headerLength, readlength))
+    {
+        spi_fast_xfer(headerLength, headerBuffer, readlength, NULL, readBuffer);
+        return 0;
+    }
+
+    if(spi_dma_use(readlength))
+    {
+        /* Long reads (RX buffer, CIR/accumulator dumps) go through the DMA queue, wait for it to drain to keep the call blocking */
+        if(readfromspi_dma(headerLength, headerBuffer, readlength, (uint8_t *)readBuffer, NULL, NULL) == 0)
+        {
+            spi_dma_wait();
+            return 0;
+        }
+    }
+
+    stat = spi_lock() ;
 
     /* Blocking: Check whether previous transfer has been finished */
     while (HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY);
 
     HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_RESET); /**< Put chip select line low */
+    spi_xfer_cnt++;
 
     /* Send header */
     for(i=0; i<headerLength; i++)
@@ -194,6 +433,260 @@ int readfromspi(uint16_t  headerLength,
     return 0;
 } // end readfromspi()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: queuetospi()
+ *
+ * Appends a batch of transactions to the asynchronous transfer queue and starts it if idle. Transactions run back to back,
+ * each with its own CS frame: the header is sent in polling mode and the body is moved by DMA from the SPI1 DMA interrupt.
+ * cb is called from the DMA interrupt once the last transaction of the batch has completed, with 0 or -1 if any of the
+ * transactions failed. Callbacks may queue further transfers but must not call the blocking SPI functions.
+ * The DW IC IRQ is masked while the queue is running.
+ * returns 0 when the batch has been queued, or -1 if it does not fit in the queue
+ */
+int queuetospi(const dwt_spi_xfer_t *xfers, uint8_t count, dwt_xfer_cb_t cb, void *arg)
+{
+    uint32_t primask;
+    uint8_t  start = 0;
+    uint8_t  i;
+
+    if(count == 0)
+    {
+        return -1;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        if(xfers[i].headerLength > DECA_MAX_SPI_HEADER_LENGTH)
+        {
+            return -1;
+        }
+    }
+
+    /* The DMA interrupt pops entries, so the queue indices are updated with interrupts disabled */
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(count > (DECA_SPI_QUEUE_LEN - spi_queue_count))
+    {
+        __set_PRIMASK(primask);
+        return -1;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        spi_queue_entry_t *entry = &spi_queue[(spi_queue_head + spi_queue_count + i) % DECA_SPI_QUEUE_LEN];
+
+        entry->xfer = xfers[i];
+        if(!entry->xfer.read && (entry->xfer.length <= sizeof(entry->data)))
+        {
+            memcpy(entry->data, xfers[i].buffer, xfers[i].length);
+            entry->xfer.buffer = entry->data;
+        }
+        entry->cb  = (i == count - 1) ? cb : NULL;
+        entry->arg = (i == count - 1) ? arg : NULL;
+    }
+    spi_queue_count += count;
+
+    if(!spi_dma_active)
+    {
+        spi_dma_active = 1;
+        spi_dma_stat = decamutexon();
+        start = 1;
+    }
+
+    __set_PRIMASK(primask);
+
+    if(start)
+    {
+        spi_queue_run();
+    }
+
+    return 0;
+} // end queuetospi()
+
+int readfromspi_dma(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t readlength, uint8_t *readBuffer,
+                    spi_dma_cb_t cb, void *arg)
+{
+    dwt_spi_xfer_t xfer;
+
+    if(headerLength > DECA_MAX_SPI_HEADER_LENGTH)
+    {
+        return -1;
+    }
+
+    memcpy(xfer.header, headerBuffer, headerLength);
+    xfer.headerLength = headerLength;
+    xfer.read = 1;
+    xfer.length = readlength;
+    xfer.buffer = readBuffer;
+
+    return queuetospi(&xfer, 1, cb, arg);
+} // end readfromspi_dma()
+
+int writetospi_dma(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength, const uint8_t *bodyBuffer,
+                   spi_dma_cb_t cb, void *arg)
+{
+    dwt_spi_xfer_t xfer;
+
+    if(headerLength > DECA_MAX_SPI_HEADER_LENGTH)
+    {
+        return -1;
+    }
+
+    memcpy(xfer.header, headerBuffer, headerLength);
+    xfer.headerLength = headerLength;
+    xfer.read = 0;
+    xfer.length = bodyLength;
+    xfer.buffer = (uint8_t *)bodyBuffer;
+
+    return queuetospi(&xfer, 1, cb, arg);
+} // end writetospi_dma()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_queue_start()
+ *
+ * Lowers CS, sends the header in polling mode and starts the DMA transfer of the body.
+ * For reads the body buffer is cleared first, as it is also the TX source of the full duplex transfer and MOSI must be
+ * held at 0 while reading.
+ * returns 0 when the body transfer has been started, 1 if the transaction is already complete (no body), or -1 for error
+ */
+static int spi_queue_start(dwt_spi_xfer_t *xfer)
+{
+    HAL_StatusTypeDef ret;
+
+    while (HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY);
+
+    HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_RESET); /**< Put chip select line low */
+    spi_xfer_cnt++;
+
+    HAL_SPI_Transmit(&hspi1, xfer->header, xfer->headerLength, HAL_MAX_DELAY); /* Send header in polling mode */
+
+    if(xfer->length == 0)
+    {
+        HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_SET); /**< Put chip select line high */
+        return 1;
+    }
+
+    if(xfer->read)
+    {
+        memset(xfer->buffer, 0, xfer->length);
+        ret = HAL_SPI_Receive_DMA(&hspi1, xfer->buffer, xfer->length);
+    }
+    else
+    {
+        ret = HAL_SPI_Transmit_DMA(&hspi1, xfer->buffer, xfer->length);
+    }
+
+    if(ret != HAL_OK)
+    {
+        HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_SET); /**< Put chip select line high */
+        return -1;
+    }
+
+    return 0;
+} // end spi_queue_start()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_queue_finish()
+ *
+ * Pops the transaction at the head of the queue and, if it ends a batch, calls the batch completion callback
+ */
+static void spi_queue_finish(int status)
+{
+    spi_queue_entry_t *entry = &spi_queue[spi_queue_head];
+    spi_dma_cb_t cb = entry->cb;
+    void *arg = entry->arg;
+    uint32_t primask;
+
+    if(status != 0)
+    {
+        spi_queue_status = -1;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    spi_queue_head = (spi_queue_head + 1) % DECA_SPI_QUEUE_LEN;
+    spi_queue_count--;
+    __set_PRIMASK(primask);
+
+    if(cb != NULL)
+    {
+        status = spi_queue_status;
+        spi_queue_status = 0;
+        cb(status, arg);
+    }
+} // end spi_queue_finish()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_queue_run()
+ *
+ * Starts the next queued transaction, or releases SPI1 and the DW IC IRQ once the queue is empty
+ */
+static void spi_queue_run(void)
+{
+    uint32_t primask;
+    int ret;
+
+    for(;;)
+    {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        if(spi_queue_count == 0)
+        {
+            spi_dma_active = 0;
+            decamutexoff(spi_dma_stat);
+            __set_PRIMASK(primask);
+            return;
+        }
+        __set_PRIMASK(primask);
+
+        ret = spi_queue_start(&spi_queue[spi_queue_head].xfer);
+        if(ret == 0)
+        {
+            return;
+        }
+        spi_queue_finish((ret > 0) ? 0 : -1);
+    }
+} // end spi_queue_run()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_queue_complete()
+ *
+ * Ends the DMA transaction in flight: raises CS, completes it and moves on to the next one
+ */
+static void spi_queue_complete(int status)
+{
+    HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_SET); /**< Put chip select line high */
+
+    spi_queue_finish(status);
+    spi_queue_run();
+} // end spi_queue_complete()
+
+/* HAL SPI DMA completion callbacks (RX only reads complete through HAL_SPI_RxCpltCallback) */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if((hspi == &hspi1) && spi_dma_active)
+    {
+        spi_queue_complete(0);
+    }
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if((hspi == &hspi1) && spi_dma_active)
+    {
+        spi_queue_complete(0);
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    if((hspi == &hspi1) && spi_dma_active)
+    {
+        spi_queue_complete(-1);
+    }
+}
+
 /****************************************************************************//**
  *
  *                              END OF DW1000 SPI section
@@ -21,6 +21,14 @@ extern "C" {
 #include <deca_types.h>
 
 #define DECA_MAX_SPI_HEADER_LENGTH      (3)                     // max number of bytes in header (for formating & sizing)
+#define DECA_SPI_DMA_THRESHOLD          (32)                    // bodies of at least this many bytes are moved by DMA
+#define DECA_SPI_FAST_LIMIT             (8)                     // transactions shorter than this use the register level path
+#define DECA_SPI_QUEUE_LEN              (8)                     // max number of transactions waiting in the asynchronous queue
+
+/* SPI DMA transfer completion callback, called from the DMA interrupt once CS has been released.
+ * status is 0 on success or -1 if the transfer failed. Same signature as dwt_xfer_cb_t. */
+typedef void (*spi_dma_cb_t)(int status, void *arg);
+
 /*! ------------------------------------------------------------------------------------------------------------------
  * Function: openspi()
  *
@@ -37,6 +45,57 @@ int openspi(void) ;
  */
 int closespi(void) ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: readfromspi_dma()
+ *
+ * Queues a read of readlength bytes through SPI1 DMA, see queuetospi(). The header is sent in polling mode, the body is
+ * clocked in by DMA and cb (may be NULL) is called from the DMA interrupt when the transfer is complete.
+ * returns 0 when the transfer has been queued, or -1 if the queue is full
+ */
+int readfromspi_dma(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t readlength, uint8_t *readBuffer,
+                    spi_dma_cb_t cb, void *arg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: writetospi_dma()
+ *
+ * Queues a write of bodyLength bytes through SPI1 DMA, see readfromspi_dma(). Bodies longer than 4 bytes are not copied,
+ * bodyBuffer must then stay valid until cb is called.
+ * returns 0 when the transfer has been queued, or -1 if the queue is full
+ */
+int writetospi_dma(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength, const uint8_t *bodyBuffer,
+                   spi_dma_cb_t cb, void *arg);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_dma_set_threshold()
+ *
+ * Sets the body length from which the blocking readfromspi()/writetospi() calls use DMA, 0 keeps them polled.
+ * Defaults to DECA_SPI_DMA_THRESHOLD.
+ */
+void spi_dma_set_threshold(uint16_t bytes);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_fast_set_limit()
+ *
+ * Sets the transaction length (header + body) below which readfromspi()/writetospi() drive the SPI1 registers directly
+ * instead of going through the HAL, 0 disables the register level path. Defaults to DECA_SPI_FAST_LIMIT.
+ */
+void spi_fast_set_limit(uint16_t bytes);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_dma_busy()
+ *
+ * returns 1 while the asynchronous transfer queue is running, 0 otherwise
+ */
+int spi_dma_busy(void);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_xfer_count()
+ *
+ * returns the number of SPI transactions (CS frames) sent to the DW IC since start-up, used to count the SPI traffic
+ * of driver calls in spi_bench_run()
+ */
+uint32_t spi_xfer_count(void);
+
 #ifdef __cplusplus
 }
 #endif
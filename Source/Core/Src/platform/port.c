@@ -15,6 +15,7 @@
 //#include <stm32f1xx_hal_conf.h>
 //#include <usbd_cdc_if.h>
 #include "main.h"
+#include "controller_input.h"
 
 /****************************************************************************//**
  *
@@ -165,7 +166,10 @@ void reset_DWIC(void)
 /* @fn      setup_DWICRSTnIRQ
  * @brief   setup the DW_RESET pin mode
  *          0 - output Open collector mode
- *          !0 - input mode with connected EXTI0 IRQ
+ *          !0 - input mode with connected EXTI8 IRQ
+ *          DW_RESET is PA8, its EXTI line shares EXTI9_5_IRQn with DW_IRQn
+ *          (PA9), while EXTI0_IRQn belongs to CONTROLLER_IN_1 (PC0): only
+ *          the pin's own EXTI line is released, the NVIC lines are left alone
  * */
 void setup_DWICRSTnIRQ(int enable)
 {
@@ -179,12 +183,12 @@ void setup_DWICRSTnIRQ(int enable)
         GPIO_InitStruct.Pull = GPIO_NOPULL;
         HAL_GPIO_Init(DW_RESET_GPIO_Port, &GPIO_InitStruct);
 
-        HAL_NVIC_EnableIRQ(EXTI0_IRQn);     //pin #0 -> EXTI #0
-        HAL_NVIC_SetPriority(EXTI0_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);   //pin #8 -> EXTI #8
+        HAL_NVIC_SetPriority(EXTI9_5_IRQn, 5, 0);
     }
     else
     {
-        HAL_NVIC_DisableIRQ(EXTI0_IRQn);    //pin #0 -> EXTI #0
+        HAL_GPIO_DeInit(DW_RESET_GPIO_Port, DW_RESET_Pin);  //releases EXTI #8
 
         //put the pin back to tri-state ... as
         //output open-drain (not active)
@@ -197,6 +201,27 @@ void setup_DWICRSTnIRQ(int enable)
     }
 }
 
+/* @fn      port_init_dwic_irq
+ * @brief   setup the DW_IRQn pin as rising edge EXTI input
+ *          the NVIC line is left disabled, port_set_dwic_isr() enables it
+ *          once the handler is installed
+ * */
+void port_init_dwic_irq(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct;
+
+    port_DisableEXT_IRQ();
+
+    GPIO_InitStruct.Pin = DW_IRQn_Pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+    GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(DW_IRQn_GPIO_Port, &GPIO_InitStruct);
+
+    __HAL_GPIO_EXTI_CLEAR_IT(DW_IRQn_Pin);
+    HAL_NVIC_SetPriority(DECAIRQ_EXTI_IRQn, 5, 0);
+}
+
 /*! ------------------------------------------------------------------------------------------------------------------
 * @fn wakeup_device_with_io()
 *
@@ -264,6 +289,32 @@ int port_is_switch_on(uint16_t GPIOpin)
     return ((GPIO_ReadInputDataBit(TA_SW1_GPIO, GPIOpin))?(0):(1));
 }
 
+/* @fn      port_get_short_address
+ * @brief   16-bit short address of this board, a hash of the 96-bit unique ID.
+ *          0xFFFF (broadcast) and 0xFFFE (no short address) are never returned
+ * @return  the short address
+ * */
+uint16_t port_get_short_address(void)
+{
+    uint32_t uid[3] = {HAL_GetUIDw0(), HAL_GetUIDw1(), HAL_GetUIDw2()};
+    uint32_t h = 0;
+    int i;
+
+    /* murmur3 finaliser on each word, so that neighbouring dies (IDs differing in a few bits) spread out */
+    for (i = 0; i < 3; i++)
+    {
+        h ^= uid[i];
+        h ^= h >> 16;
+        h *= 0x85EBCA6BUL;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35UL;
+        h ^= h >> 16;
+    }
+
+    h = (h ^ (h >> 16)) & 0xFFFF;
+    return (h >= 0xFFFE) ? (uint16_t)(h & 0x7FFF) : (uint16_t)h;
+}
+
 
 /* @fn      led_off
  * @brief   switch off the led from led_t enumeration
@@ -430,6 +481,11 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
         signalResetDone = 1;
         break;
 
+    case CONTROLLER_IN_1_Pin :
+    case CONTROLLER_IN_2_Pin :
+        controller_input_edge();
+        break;
+
     case DW_IRQn_Pin :
         {
             //while (HAL_GPIO_ReadPin(DECAIRQ_GPIO, DW_IRQn_Pin) == GPIO_PIN_SET)
@@ -466,6 +522,7 @@ __INLINE void process_deca_irq(void)
 /* @fn      port_DisableEXT_IRQ
  * @brief   wrapper to disable DW_IRQ pin IRQ
  *          in current implementation it disables all IRQ from lines 5:9
+ *          (DW_RESET on PA8 shares the line)
  * */
 __INLINE void port_DisableEXT_IRQ(void)
 {
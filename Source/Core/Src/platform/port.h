@@ -29,7 +29,7 @@ extern "C" {
 #define EVB1000_LED_SUPPORT 0
 #define EVB1000_LCD_SUPPORT 0
 
-/* DW IC IRQ (EXTI15_10_IRQ) handler type. */
+/* DW IC IRQ (EXTI9_5_IRQ) handler type. */
 typedef void (*port_dwic_isr_t)(void);
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -98,13 +98,13 @@ typedef enum
  *******************************************************************************/
 
 
-#define DECAIRQ_EXTI_IRQn       (EXTI15_10_IRQn)
+#define DECAIRQ_EXTI_IRQn       (EXTI9_5_IRQn)
 
 #define DW_RSTn                     DW_RESET_Pin
 #define DW_RSTn_GPIO                DW_RESET_GPIO_Port
 
-//TODO: Amila random values for DW_IRQn pin since it is not used for this project
-#define DW_IRQn_Pin					GPIO_PIN_0
+/* DWM3000 shield IRQ output is routed to Arduino D8 (PA9) */
+#define DW_IRQn_Pin                 GPIO_PIN_9
 #define DW_IRQn_GPIO_Port           GPIOA
 
 #define DECAIRQ                     DW_IRQn_Pin
@@ -162,6 +162,7 @@ unsigned long portGetTickCnt(void);
 int port_is_boot1_on(uint16_t x);
 int port_is_switch_on(uint16_t GPIOpin);
 int port_is_boot1_low(void);
+uint16_t port_get_short_address(void);
 
 
 void port_set_dw_ic_spi_slowrate(void);
@@ -177,6 +178,7 @@ int  peripherals_init(void);
 void spi_peripheral_init(void);
 
 void setup_DWICRSTnIRQ(int enable);
+void port_init_dwic_irq(void);
 
 void reset_DWIC(void);
 
@@ -36,6 +36,11 @@ extern "C" {
  * 1 uus = 512 / 499.2 s and 1 s = 499.2 * 128 dtu. */
 #define UUS_TO_DWT_TIME 63898
 
+/* Device time units per second (499.2 MHz * 128) and the distance light travels in one of them, in Q16 millimetres
+ * (~4.6903 mm). Used by the fixed-point ranging kernels. */
+#define DWT_TIME_PER_S 63897600000ULL
+#define DWT_TIME_TO_MM_Q16 ((int64_t)(((uint64_t)SPEED_OF_LIGHT * 1000 * 65536 + DWT_TIME_PER_S / 2) / DWT_TIME_PER_S))
+
 
 
 #define TX_CHANGEABLE_DATA              (10)/*Can change the length of TX data by this size*/
@@ -458,3 +458,96 @@ void resp_msg_set_ts(volatile uint8_t *ts_field, const uint64_t ts)
         ts_field[i] = (uint8_t)(ts >> (i * 8));
     }
 }
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tof_q10_to_mm()
+ *
+ * @brief Scale a time of flight in Q10 device time units to millimetres by DWT_TIME_TO_MM_Q16, saturating to the int32
+ *        range. The product stays below 2^61 for |tof_q10| < 2^42.
+ *
+ * @param  tof_q10  time of flight in Q10 device time units
+ *
+ * @return distance in millimetres
+ */
+static int32_t tof_q10_to_mm(int64_t tof_q10)
+{
+    int64_t mm = (tof_q10 * DWT_TIME_TO_MM_Q16 + (1LL << 25)) >> 26;
+
+    if (mm > INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (mm < INT32_MIN)
+    {
+        return INT32_MIN;
+    }
+
+    return (int32_t)mm;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ss_twr_distance_mm()
+ *
+ * @brief Single-sided two-way ranging distance in integer arithmetic, see shared_functions.h for the error bound.
+ *
+ *        2 * ToF = rtd_init - rtd_resp + rtd_resp * clock_offset / 2^26 is formed exactly in Q26 and halved into Q10.
+ *
+ * @param  rtd_init  round trip delay measured by the initiator, in device time units
+ *         rtd_resp  reply delay reported by the responder, in device time units
+ *         clock_offset  clock offset as returned by dwt_readclockoffset()
+ *
+ * @return distance in millimetres
+ */
+int32_t ss_twr_distance_mm(int32_t rtd_init, int32_t rtd_resp, int16_t clock_offset)
+{
+    int64_t tof2_q26;
+
+    tof2_q26 = (((int64_t)rtd_init - rtd_resp) << 26) + (int64_t)rtd_resp * clock_offset;
+
+    return tof_q10_to_mm((tof2_q26 + (1 << 16)) >> 17);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ds_twr_distance_mm()
+ *
+ * @brief Double-sided two-way ranging distance in integer arithmetic, see shared_functions.h for the error bound.
+ *
+ *        ToF = (round1 * round2 - reply1 * reply2) / (round1 + round2 + reply1 + reply2). Both products are exact in
+ *        64 bits for delays below 2^31, the difference is the only value that needs scaling before the division.
+ *
+ * @param  round1  initiator poll TX to response RX, in device time units
+ *         reply1  responder poll RX to response TX, in device time units
+ *         round2  responder response TX to final RX, in device time units
+ *         reply2  initiator response RX to final TX, in device time units
+ *
+ * @return distance in millimetres, INT32_MAX if a delay is 2^31 device time units or more
+ */
+int32_t ds_twr_distance_mm(uint32_t round1, uint32_t reply1, uint32_t round2, uint32_t reply2)
+{
+    int64_t num, den, tof_q10;
+
+    if ((round1 | reply1 | round2 | reply2) & 0x80000000UL)
+    {
+        return INT32_MAX;
+    }
+
+    num = (int64_t)round1 * round2 - (int64_t)reply1 * reply2;
+    den = (int64_t)round1 + round2 + reply1 + reply2;
+
+    if (den == 0)
+    {
+        return INT32_MAX;
+    }
+
+    if ((num < (1LL << 52)) && (num > -(1LL << 52)))
+    {
+        num <<= 10;
+        tof_q10 = ((num < 0) ? (num - den / 2) : (num + den / 2)) / den;
+    }
+    else
+    {
+        tof_q10 = (num / den) << 10; /* far beyond any usable range, resolution no longer matters */
+    }
+
+    return tof_q10_to_mm(tof_q10);
+}
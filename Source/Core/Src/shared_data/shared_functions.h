@@ -94,6 +94,41 @@ void final_msg_get_ts(const uint8_t *ts_field, uint32_t *ts);
 void final_msg_set_ts(uint8_t *ts_field, uint64_t ts);
 void resp_msg_set_ts(volatile uint8_t *ts_field, const uint64_t ts);
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ss_twr_distance_mm()
+ *
+ * @brief Single-sided two-way ranging distance in integer arithmetic:
+ *        distance = (rtd_init - rtd_resp * (1 - clock_offset / 2^26)) / 2 * DWT_TIME_UNITS * SPEED_OF_LIGHT
+ *        Against the same formula evaluated in double the error is at most 0.51 mm (rounding to the millimetre and of
+ *        the Q10 time of flight) plus 0.75 ppm of the distance (the Q16 scale factor), so under 1 mm up to 600 m, for
+ *        any clock offset. Results beyond +/-2^31 mm saturate to INT32_MAX/INT32_MIN. Source/Tools/twr_accuracy checks
+ *        the bound on the host.
+ *
+ * @param  rtd_init  round trip delay measured by the initiator, in device time units
+ *         rtd_resp  reply delay reported by the responder, in device time units
+ *         clock_offset  clock offset as returned by dwt_readclockoffset()
+ *
+ * @return distance in millimetres
+ */
+int32_t ss_twr_distance_mm(int32_t rtd_init, int32_t rtd_resp, int16_t clock_offset);
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn ds_twr_distance_mm()
+ *
+ * @brief Double-sided two-way ranging distance in integer arithmetic:
+ *        ToF = (round1 * round2 - reply1 * reply2) / (round1 + round2 + reply1 + reply2)
+ *        The clock offset between the two ends cancels out, so no clock offset input is needed. The error against the
+ *        same formula evaluated in double has the same bound as ss_twr_distance_mm().
+ *
+ * @param  round1  initiator poll TX to response RX, in device time units
+ *         reply1  responder poll RX to response TX, in device time units
+ *         round2  responder response TX to final RX, in device time units
+ *         reply2  initiator response RX to final TX, in device time units
+ *
+ * @return distance in millimetres, INT32_MAX if a delay is 2^31 device time units (33 ms) or more
+ */
+int32_t ds_twr_distance_mm(uint32_t round1, uint32_t reply1, uint32_t round2, uint32_t reply2);
+
 
 
 #ifdef __cplusplus
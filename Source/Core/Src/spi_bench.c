@@ -0,0 +1,238 @@
+/*
+ * spi_bench.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <stdio.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include <cycle_counter.h>
+#include <spi_bench.h>
+
+#define BENCH_ROUNDS      (16)
+#define BENCH_MAX_LEN     (1016)
+
+/* Two CYCCNT samples of the idle loop further apart than this means the loop was preempted by the DMA interrupt */
+#define IDLE_GAP_CYCLES   (50)
+
+/* One byte fast access headers for the RX buffer (read) and TX buffer (write), offset 0 */
+#define RX_BUFFER_HEADER  ((uint8_t)((RX_BUFFER_0_ID >> 16) << 1))
+#define TX_BUFFER_HEADER  ((uint8_t)(0x80 | ((TX_BUFFER_ID >> 16) << 1)))
+
+static const uint16_t bench_sizes[] = { 16, 64, 128, 512, BENCH_MAX_LEN };
+
+extern dwt_config_t config_options;
+
+static uint8_t bench_buf[BENCH_MAX_LEN];
+
+static uint32_t bytes_per_s(uint16_t len, uint32_t cycles)
+{
+  return (uint32_t)(((uint64_t)len * SystemCoreClock) / (cycles ? cycles : 1));
+}
+
+static void report(const char *op, const char *mode, uint16_t len, uint32_t cycles, uint32_t busy_pct)
+{
+  printf("spi_bench,%s,%s,%u,%lu,%lu,%lu\r\n", op, mode, len, (unsigned long)cycles,
+      (unsigned long)bytes_per_s(len, cycles), (unsigned long)busy_pct);
+}
+
+/* Prints the SPI transaction count and cycle time of one driver call: spi_bench_xfers,<op>,<mode>,<transactions>,<cycles> */
+static void report_xfers(const char *op, const char *mode, uint32_t xfers, uint32_t cycles)
+{
+  printf("spi_bench_xfers,%s,%s,%lu,%lu\r\n", op, mode, (unsigned long)xfers, (unsigned long)cycles);
+}
+
+/* Counts the SPI transactions and time of dwt_configure(), on a cold register shadow (first configuration after
+ * dwt_initialise()) and on a warm one (profile switch) */
+static void count_configure(const char *mode, int shadow, int combine)
+{
+  uint32_t xfers, start;
+
+  dwt_setregshadow(shadow);
+  dwt_setwritecombine(combine);
+
+  for (int pass = 0; pass < 2; pass++)
+  {
+    xfers = spi_xfer_count();
+    start = cycle_counter_read();
+    if (dwt_configure(&config_options) == DWT_ERROR)
+    {
+      printf("spi_bench: CONFIG FAILED\r\n");
+      break;
+    }
+    report_xfers(pass ? "reconfigure" : "configure", mode, spi_xfer_count() - xfers, cycle_counter_read() - start);
+  }
+
+  dwt_setregshadow(0);
+  dwt_setwritecombine(1);
+}
+
+/* Counts the SPI transactions and time of the reads that finish a ranging exchange on the initiator, one call per
+ * item against dwt_readrangingsnapshot(). With nothing received the snapshot skips the RX buffer read, so expect one
+ * transaction less than after a real frame. */
+#define RESP_LEN 20
+static void count_snapshot(void)
+{
+  dwt_rangingsnapshot_t snapshot;
+  uint32_t xfers, start;
+
+  xfers = spi_xfer_count();
+  start = cycle_counter_read();
+  dwt_readrxdata(bench_buf, RESP_LEN, 0);
+  (void)dwt_readtxtimestamplo32();
+  (void)dwt_readrxtimestamplo32();
+  (void)dwt_readclockoffset();
+  report_xfers("ranging_reads", "separate", spi_xfer_count() - xfers, cycle_counter_read() - start);
+
+  xfers = spi_xfer_count();
+  start = cycle_counter_read();
+  (void)dwt_readrangingsnapshot(&snapshot, bench_buf, RESP_LEN);
+  report_xfers("ranging_reads", "snapshot", spi_xfer_count() - xfers, cycle_counter_read() - start);
+}
+
+/* Times the blocking API, the CPU is busy for the whole transfer */
+static uint32_t time_blocking(int write, uint16_t len)
+{
+  uint32_t start = cycle_counter_read();
+
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+  {
+    if (write)
+    {
+      dwt_writetodevice(TX_BUFFER_ID, 0, len, bench_buf);
+    }
+    else
+    {
+      dwt_readfromdevice(RX_BUFFER_0_ID, 0, len, bench_buf);
+    }
+  }
+
+  return (cycle_counter_read() - start) / BENCH_ROUNDS;
+}
+
+/* Times one short register access, the kind dwt_read32bitoffsetreg()/dwt_write8bitoffsetreg() issue */
+static uint32_t time_register(int write)
+{
+  uint32_t start = cycle_counter_read();
+
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+  {
+    if (write)
+    {
+      dwt_write8bitoffsetreg(TX_BUFFER_ID, 0, 0x5A);
+    }
+    else
+    {
+      (void)dwt_read32bitoffsetreg(SYS_STATUS_ID, 0);
+    }
+  }
+
+  return (cycle_counter_read() - start) / BENCH_ROUNDS;
+}
+
+/* Times the DMA API and counts the cycles the CPU was left free while the transfer ran */
+static uint32_t time_async(int write, uint16_t len, uint32_t *busy_pct)
+{
+  uint8_t header = write ? TX_BUFFER_HEADER : RX_BUFFER_HEADER;
+  uint32_t total = 0;
+  uint32_t idle = 0;
+
+  for (int i = 0; i < BENCH_ROUNDS; i++)
+  {
+    uint32_t start = cycle_counter_read();
+    int ret = write ? writetospi_dma(1, &header, len, bench_buf, NULL, NULL) : readfromspi_dma(1, &header, len, bench_buf, NULL, NULL);
+
+    if (ret != 0)
+    {
+      return 0;
+    }
+
+    uint32_t prev = cycle_counter_read();
+    while (spi_dma_busy())
+    {
+      uint32_t now = cycle_counter_read();
+      if (now - prev < IDLE_GAP_CYCLES)
+      {
+        idle += now - prev;
+      }
+      prev = now;
+    }
+    total += cycle_counter_read() - start;
+  }
+
+  *busy_pct = total ? (uint32_t)(((uint64_t)(total - idle) * 100) / total) : 100;
+  return total / BENCH_ROUNDS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn spi_bench_run()
+ *
+ * @brief Counts the SPI transactions of dwt_configure() with and without the register shadow and write combining,
+ *        then measures the per transaction cost of short register accesses (HAL vs register level path) and DW IC
+ *        buffer read/write throughput over SPI1 with the polled and the DMA transport. Prints one CSV line per case on
+ *        the debug UART:
+ *        spi_bench_xfers,<op>,<mode>,<transactions>,<cycles> and spi_bench,<op>,<mode>,<bytes>,<cycles>,<bytes_per_s>,<busy_pct>
+ *        The DW IC is reset and reconfigured, so this runs before the ranging role is started.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void spi_bench_run(void)
+{
+  cycle_counter_init();
+
+  port_set_dw_ic_spi_fastrate();
+  reset_DWIC();
+  Sleep(2);
+
+  while (!dwt_checkidlerc()) { };
+
+  if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
+  {
+    printf("spi_bench: INIT FAILED\r\n");
+    return;
+  }
+
+  /* SPI traffic of dwt_configure() with and without the register shadow and write combining, and of the ranging reads */
+  printf("spi_bench_xfers,op,mode,transactions,cycles\r\n");
+  count_configure("direct", 0, 0);
+  count_configure("shadow", 1, 0);
+  count_configure("combine", 0, 1);
+  count_configure("shadow+combine", 1, 1);
+  count_snapshot();
+
+  printf("spi_bench,op,mode,bytes,cycles,bytes_per_s,busy_pct\r\n");
+
+  /* Per transaction cost of short register accesses, HAL path vs register level path */
+  spi_fast_set_limit(0);
+  report("read32", "hal", 4, time_register(0), 100);
+  report("write8", "hal", 1, time_register(1), 100);
+
+  spi_fast_set_limit(DECA_SPI_FAST_LIMIT);
+  report("read32", "ll", 4, time_register(0), 100);
+  report("write8", "ll", 1, time_register(1), 100);
+
+  for (uint32_t i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++)
+  {
+    uint16_t len = bench_sizes[i];
+    uint32_t busy_pct;
+    uint32_t cycles;
+
+    for (int write = 0; write <= 1; write++)
+    {
+      const char *op = write ? "write" : "read";
+
+      spi_dma_set_threshold(0);
+      report(op, "polled", len, time_blocking(write, len), 100);
+
+      spi_dma_set_threshold(DECA_SPI_DMA_THRESHOLD);
+      report(op, "blocking", len, time_blocking(write, len), 100);
+
+      cycles = time_async(write, len, &busy_pct);
+      report(op, "dma", len, cycles, busy_pct);
+    }
+  }
+}
@@ -0,0 +1,175 @@
+/*
+ * tdma.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "tdma.h"
+#include "frame_codec.h"
+
+/* Resets the registry: all slots free, only the join slot scheduled */
+void tdma_init(TdmaSchedule *schedule)
+{
+  uint8_t i;
+
+  *schedule = (TdmaSchedule){0};
+  for (i = 0; i < TDMA_MAX_SLAVES; i++)
+  {
+    schedule->entries[i].address = FRAME_BROADCAST;
+  }
+  schedule->changed = 1;
+}
+
+/* Slot owned by a slave, TDMA_NO_SLOT if it is not registered */
+int tdma_lookup(const TdmaSchedule *schedule, uint16_t address)
+{
+  uint8_t i;
+
+  for (i = 0; i < TDMA_MAX_SLAVES; i++)
+  {
+    if (schedule->entries[i].address == address)
+    {
+      return i + 1;
+    }
+  }
+
+  return TDMA_NO_SLOT;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_register()
+ *
+ * @brief Called for each poll received. A registered slave is marked as seen in this superframe, a new one gets the
+ *        lowest free slot, listed from the next beacon on.
+ *
+ * @param  schedule  master registry
+ * @param  address   short address of the polling slave
+ *
+ * @return slot of the slave, TDMA_NO_SLOT if the table is full or the address is not a unicast one
+ */
+int tdma_register(TdmaSchedule *schedule, uint16_t address)
+{
+  int slot = tdma_lookup(schedule, address);
+  TdmaEntry *entry;
+
+  if (slot == TDMA_NO_SLOT)
+  {
+    if (address == FRAME_BROADCAST || (slot = tdma_lookup(schedule, FRAME_BROADCAST)) == TDMA_NO_SLOT)
+    {
+      return TDMA_NO_SLOT;
+    }
+
+    schedule->entries[slot - 1].address = address;
+    if (slot > schedule->slots)
+    {
+      schedule->slots = slot;
+    }
+    schedule->changed = 1;
+  }
+
+  entry = &schedule->entries[slot - 1];
+  entry->lastSeen = schedule->superframe;
+  return slot;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_start_superframe()
+ *
+ * @brief Called before each beacon. Frees the slots of slaves silent for more than TDMA_EXPIRE_SUPERFRAMES and trims
+ *        the superframe to the highest slot still owned.
+ *
+ * @param  schedule  master registry
+ *
+ * @return none
+ */
+void tdma_start_superframe(TdmaSchedule *schedule)
+{
+  uint8_t i;
+
+  schedule->superframe++;
+  schedule->slots = 0;
+
+  for (i = 0; i < TDMA_MAX_SLAVES; i++)
+  {
+    TdmaEntry *entry = &schedule->entries[i];
+
+    if (entry->address == FRAME_BROADCAST)
+    {
+      continue;
+    }
+
+    if ((uint8_t)(schedule->superframe - entry->lastSeen) > TDMA_EXPIRE_SUPERFRAMES)
+    {
+      entry->address = FRAME_BROADCAST;
+      schedule->changed = 1;
+      continue;
+    }
+
+    schedule->slots = i + 1;
+  }
+}
+
+/* Beacon to beacon: guard, join slot, owned slots and the time the master needs to launch the next beacon */
+uint32_t tdma_superframe_us(const TdmaSchedule *schedule)
+{
+  return TDMA_FIRST_SLOT_US + (1 + (uint32_t)schedule->slots) * TDMA_SLOT_US + TDMA_LAUNCH_US;
+}
+
+/* Fills TDMA_BEACON_LEN bytes */
+void tdma_beacon_encode(TdmaSchedule *schedule, uint8_t *buffer)
+{
+  uint8_t i;
+
+  buffer[TDMA_BEACON_FIRST_SLOT_IDX] = (uint8_t)TDMA_FIRST_SLOT_US;
+  buffer[TDMA_BEACON_FIRST_SLOT_IDX + 1] = (uint8_t)(TDMA_FIRST_SLOT_US >> 8);
+  buffer[TDMA_BEACON_SLOT_LEN_IDX] = (uint8_t)TDMA_SLOT_US;
+  buffer[TDMA_BEACON_SLOT_LEN_IDX + 1] = (uint8_t)(TDMA_SLOT_US >> 8);
+
+  for (i = 0; i < TDMA_MAX_SLAVES; i++)
+  {
+    buffer[TDMA_BEACON_SLOTS_IDX + 2 * i] = (uint8_t)schedule->entries[i].address;
+    buffer[TDMA_BEACON_SLOTS_IDX + 2 * i + 1] = (uint8_t)(schedule->entries[i].address >> 8);
+  }
+
+  schedule->changed = 0;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tdma_beacon_find()
+ *
+ * @brief Slave side: looks a short address up in a received schedule block. The number of slots is taken from the
+ *        block length, so master and slave need not agree on TDMA_MAX_SLAVES.
+ *
+ * @param  buffer     received schedule block
+ * @param  length     its length in bytes
+ * @param  address    own short address
+ * @param  offset_us  beacon RX to the start of the slot to poll in
+ *
+ * @return slot of the address, TDMA_JOIN_SLOT if it is not listed, TDMA_NO_SLOT if the block is too short
+ */
+int tdma_beacon_find(const uint8_t *buffer, uint16_t length, uint16_t address, uint32_t *offset_us)
+{
+  uint32_t first_us, slot_us;
+  uint16_t i;
+  int slot = TDMA_JOIN_SLOT;
+
+  if (length < TDMA_BEACON_SLOTS_IDX)
+  {
+    return TDMA_NO_SLOT;
+  }
+
+  first_us = (uint32_t)buffer[TDMA_BEACON_FIRST_SLOT_IDX] | ((uint32_t)buffer[TDMA_BEACON_FIRST_SLOT_IDX + 1] << 8);
+  slot_us = (uint32_t)buffer[TDMA_BEACON_SLOT_LEN_IDX] | ((uint32_t)buffer[TDMA_BEACON_SLOT_LEN_IDX + 1] << 8);
+
+  for (i = 0; TDMA_BEACON_SLOTS_IDX + 2 * i + 1 < length; i++)
+  {
+    if (((uint16_t)buffer[TDMA_BEACON_SLOTS_IDX + 2 * i] | ((uint16_t)buffer[TDMA_BEACON_SLOTS_IDX + 2 * i + 1] << 8)) ==
+        address)
+    {
+      slot = i + 1;
+      break;
+    }
+  }
+
+  *offset_us = first_us + (uint32_t)slot * slot_us;
+  return slot;
+}
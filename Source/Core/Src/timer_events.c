@@ -0,0 +1,25 @@
+/*
+ * timer_events.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Update interrupts of the application timers, shared by the target build and the host simulation (Tools/hal_shim),
+ * so a timer added here is taken in both.
+ */
+#include "main.h"
+#include "tim.h"
+#include "failsafe.h"
+#include "controller_input.h"
+
+/* TIM2: relay fail-safe timeout, TIM3: controller input debounce */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM2)
+  {
+    failsafe_expired();
+  }
+  else if (htim->Instance == TIM3)
+  {
+    controller_input_settled();
+  }
+}
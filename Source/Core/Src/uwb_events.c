@@ -0,0 +1,67 @@
+/*
+ * uwb_events.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <port.h>
+#include <config_options.h>
+#include <uwb_events.h>
+
+/* DW IC events the ranging roles are driven by: TX done, good RX frame, RX timeouts and RX errors */
+#define UWB_EVENTS_TX_MASK  (SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK)
+#define UWB_EVENTS_RX_MASK  (SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK)
+#define UWB_EVENTS_TO_MASK  (SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK)
+#define UWB_EVENTS_ERR_MASK (SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK | \
+                             SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK)
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uwb_events_init()
+ *
+ * @brief Registers the role callbacks with the driver, unmasks the DW IC events they handle and, in IRQ mode, installs
+ *        dwt_isr() on the DW_IRQn EXTI line. Must be called after dwt_configure().
+ *
+ * @param  cbTxDone  TX frame sent callback, may be NULL
+ * @param  cbRxOk    good frame received callback
+ * @param  cbRxTo    RX frame wait / preamble timeout callback
+ * @param  cbRxErr   RX error callback
+ *
+ * @return none
+ */
+void uwb_events_init(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr)
+{
+  dwt_setcallbacks(cbTxDone, cbRxOk, cbRxTo, cbRxErr, NULL, NULL);
+
+  /* Drop anything latched during start-up so the IRQ line is low before it is unmasked */
+  dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_TX | SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR);
+
+  dwt_setinterrupt(UWB_EVENTS_TX_MASK | UWB_EVENTS_RX_MASK | UWB_EVENTS_TO_MASK | UWB_EVENTS_ERR_MASK, 0, DWT_ENABLE_INT_ONLY);
+
+#ifdef CONFIG_DWIC_IRQ_MODE
+  port_init_dwic_irq();
+  port_set_dwic_isr(dwt_isr);
+#endif
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn uwb_events_dispatch()
+ *
+ * @brief Called once per main loop iteration. In IRQ mode the core sleeps until the next interrupt (a DW IC event or the
+ *        1 ms SysTick), otherwise any pending DW IC event is serviced here.
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void uwb_events_dispatch(void)
+{
+#ifdef CONFIG_DWIC_IRQ_MODE
+  __WFI();
+#else
+  if (dwt_checkirq())
+  {
+    dwt_isr();
+  }
+#endif
+}
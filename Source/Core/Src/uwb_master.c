@@ -2,17 +2,32 @@
 #include <deca_regs.h>
 #include <deca_spi.h>
 #include <port.h>
+#include <config_options.h>
 #include <shared_defines.h>
 #include <shared_functions.h>
 #include <stdio.h>
 #include <uwb_master.h>
 #include "main.h"
 #include "error_led.h"
+#include "uwb_events.h"
+#include "cycle_counter.h"
+#include "controller_input.h"
+#include "frame_codec.h"
+#include "output_channels.h"
+#include "arq.h"
+#include "tdma.h"
+#include "aloha.h"
+#include "pairing.h"
+#include "xorshift.h"
 
 /* Default communication configuration. We use default non-STS DW mode. */
 static dwt_config_t config = {
         5,               /* Channel number. */
+#ifdef CONFIG_HIGH_RATE_RANGING
+        DWT_PLEN_64,     /* Preamble length. Used in TX only. Shortest supported, see NOTE 15 below. */
+#else
         DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+#endif
         DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
         9,               /* TX preamble code. Used in TX only. */
         9,               /* RX preamble code. Used in RX only. */
@@ -20,7 +35,11 @@ static dwt_config_t config = {
         DWT_BR_6M8,      /* Data rate. */
         DWT_PHRMODE_STD, /* PHY header mode. */
         DWT_PHRRATE_STD, /* PHY header rate. */
+#ifdef CONFIG_HIGH_RATE_RANGING
+        (65 + 8 - 8),    /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+#else
         (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+#endif
         DWT_STS_MODE_OFF, /* STS disabled */
         DWT_STS_LEN_64,/* STS length see allowed values in Enum dwt_sts_lengths_e */
         DWT_PDOA_M0      /* PDOA mode off */
@@ -30,40 +49,48 @@ static dwt_config_t config = {
 #define TX_ANT_DLY 16385
 #define RX_ANT_DLY 16385
 
-static const uint8_t tx_no_relay[] =
-  {0x41, 0x88, 0, 0xCA, 0xDE, 'E', 'S', 'D', '0', 0xE1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-static const uint8_t tx_first_relay[] =
-  {0x41, 0x88, 0, 0xCA, 0xDE, 'E', 'S', 'D', '1', 0xE1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-static const uint8_t tx_second_relay[] =
-  {0x41, 0x88, 0, 0xCA, 0xDE, 'E', 'S', 'D', '2', 0xE1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-static const uint8_t tx_all_relays[] =
-  {0x41, 0x88, 0, 0xCA, 0xDE, 'E', 'S', 'D', '3', 0xE1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-
-/* Frames used in the ranging process. See NOTE 3 below. */
-//static uint8_t rx_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'B', 'I', 'T', 'R', 0xE0, 0, 0};
-static const uint8_t rx_prefix[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'B', 'I', 'T'};
-static const uint8_t rx_suffix = 0xE0;
-
-#define TX_BUF_LEN 20
-volatile static uint8_t tx_resp_msg[TX_BUF_LEN];
-
-/* Length of the common part of the message (up to and including the function code, see NOTE 3 below). */
-#define ALL_MSG_COMMON_LEN 10
-/* Index to access some of the fields in the frames involved in the process. */
-#define ALL_MSG_SN_IDX 2
+/* Function codes of the single-sided exchange. See NOTE 3 below. */
+#define POLL_FUNC_CODE 0xE0
+#define RESP_FUNC_CODE 0xE1
+
+/* Function codes of the double-sided exchange. See NOTE 14 below. */
+#define DS_POLL_FUNC_CODE 0xE2
+#define FINAL_FUNC_CODE 0xE3
+#define REPORT_FUNC_CODE 0xE4
+/* Function code of a command pushed on an input change. See NOTE 16 below. */
+#define PUSH_FUNC_CODE 0xE5
+
+/* Frames sent by the master, staged once in the DW IC TX buffer and patched in place. The PAN ID and addresses are
+ * filled in by frame_stage() and frame_set_dest(). See NOTE 18 and 21 below. */
+static const uint8_t tx_resp_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 0, 0, RESP_FUNC_CODE, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static const FrameSlot resp_slot = {0, sizeof(tx_resp_msg), 1};
+
+/* Index to access some of the fields in the frames involved in the process, after the common header (FRAME_HDR_LEN, see NOTE 3 below). */
 #define RESP_MSG_POLL_RX_TS_IDX 10
 #define RESP_MSG_RESP_TX_TS_IDX 14
 #define RESP_MSG_TS_LEN 4
+#define RESP_MSG_OUTPUT_IDX 18
+#define POLL_MSG_OUTPUT_IDX 10
+#define POLL_MSG_STATUS_IDX 20
+#define POLL_MSG_RESPONDERS_IDX 21
+#define PUSH_MSG_OUTPUT_IDX 10
+#define FINAL_MSG_POLL_TX_TS_IDX 10
+#define FINAL_MSG_RESP_RX_TS_IDX 14
+#define FINAL_MSG_FINAL_TX_TS_IDX 18
+#define REPORT_MSG_DIST_IDX 10
 /* Frame sequence number, incremented after each transmission. */
 static uint8_t frame_seq_nb = 0;
 
 /* Buffer to store received messages.
  * Its size is adjusted to longest frame that this example code is supposed to handle. */
-#define RX_BUF_LEN 12//Must be less than FRAME_LEN_MAX_EX
+#ifdef CONFIG_MULTI_RESPONDER
+#define RX_BUF_LEN (POLL_MSG_RESPONDERS_IDX + 2 * MULTI_RESP_MAX + FRAME_FCS_LEN)
+#else
+#define RX_BUF_LEN 24//Must be less than FRAME_LEN_MAX_EX
+#endif
 static uint8_t rx_buffer[RX_BUF_LEN];
 
-#define RX_PREFIX_LEN 8
-#define RX_PARAM_IDX 8
 
 /* Hold copy of status register state here for reference so that it can be examined at a debug breakpoint. */
 static uint32_t status_reg = 0;
@@ -75,16 +102,113 @@ static uint32_t status_reg = 0;
 static uint64_t poll_rx_ts;
 static uint64_t resp_tx_ts;
 
+/* DS-TWR distance report sent back to the initiator once the final has been received. See NOTE 14 below. */
+static const uint8_t tx_report_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 0, 0, REPORT_FUNC_CODE, 0, 0, 0, 0, 0, 0};
+static const FrameSlot report_slot = {32, sizeof(tx_report_msg), 0};
+static volatile uint8_t await_final = 0;
+static volatile uint8_t distance_event = 0;
+static volatile int32_t distance_to_slave;
+
+#ifdef CONFIG_PUSH_COMMANDS
+/* Command pushed to the slave on an input change, the output block is the same as in the response. The frame requests an
+ * acknowledgement (0x61), sent by the slave's DW IC. See NOTE 16 and 21 below. */
+static const uint8_t tx_push_msg[] = {0x61, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 0, 0, PUSH_FUNC_CODE, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static const FrameSlot push_slot = {64, sizeof(tx_push_msg), 0};
+static volatile uint8_t push_in_flight = 0;
+static volatile uint8_t push_sent = 0;    /* Set by tx_done_cb() when the frame that completed was a push */
+static uint8_t push_pending = 0;
+static volatile uint8_t push_unacked = 0; /* Push sent and no poll since, repeated after ARQ_PUSH_ACK_MS. See NOTE 20 below. */
+static uint8_t push_sn;
+static volatile uint32_t push_sent_tick;
+static uint32_t push_retry_ms;
+static uint32_t push_edge_cycles;
+static volatile uint32_t push_done_cycles;
+static volatile uint8_t push_acked = 0;   /* Set by the RX callback on the slave's hardware acknowledgement */
+static volatile uint32_t push_ack_cycles;
+#endif
+
+#ifdef CONFIG_TDMA
+/* Superframe beacon, its schedule block is rewritten when a slot changes owner. See NOTE 22 below. */
+#define BEACON_FUNC_CODE 0xE6
+#define BEACON_MSG_TDMA_IDX 10
+#ifdef CONFIG_ALOHA
+/* With slotted ALOHA the beacon carries the constant contention block instead. See NOTE 24 below. */
+#define BEACON_BLOCK_LEN ALOHA_BEACON_LEN
+#else
+#define BEACON_BLOCK_LEN TDMA_BEACON_LEN
+static TdmaSchedule schedule;
+#endif
+static const uint8_t tx_beacon_msg[FRAME_HDR_LEN + BEACON_BLOCK_LEN + FRAME_FCS_LEN] = {0x41, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 0, 0,
+                                                                                        BEACON_FUNC_CODE};
+static const FrameSlot beacon_slot = {96, sizeof(tx_beacon_msg), 0};
+static uint32_t beacon_time;            /* DW IC time of the next beacon, in 512/499.2 MHz / 256 units */
+static uint16_t resp_dest = FRAME_BROADCAST; /* Destination currently in the staged response and report */
+
+/* A DS-TWR final not received this long after the response is taken as lost, so the next beacon is not held back */
+#define FINAL_WAIT_UUS 1500
+static volatile uint32_t final_deadline; /* DW IC time, in the units of beacon_time */
+#endif
+
+static volatile uint8_t tx_busy = 0;      /* A response, report, push or beacon is in flight, cleared by tx_done_cb() */
 static uint32_t detection_timeout = 2000; /* Timeout in ms */
 
+/* Set by the RX callback when a valid poll has been received, consumed by the main loop */
+static volatile uint8_t poll_event = 0;
+static volatile uint8_t poll_param = 0;
+static OutputMsg poll_status;          /* Output block of the last poll, written by the RX callback */
+
+/* Commanded outputs and the command block currently staged in the response and push. See NOTE 19 below. */
+static uint32_t tx_outputs = 0;
+static OutputMsg staged_command;
+
+/* Sequence number state of the link with the slave and push retransmissions. See NOTE 20 below. */
+#ifdef CONFIG_TDMA
+/* One link per slave polling in the superframes, the least recently polled one is reused for a new slave */
+static ArqLink slave_links[TDMA_MAX_SLAVES];
+static uint16_t slave_link_address[TDMA_MAX_SLAVES];
+static uint32_t slave_link_tick[TDMA_MAX_SLAVES];
+#else
+static ArqLink slave_link;
+#endif
+static volatile uint32_t last_poll_tick = 0;
+/* Slave this master serves, taken from the first poll and released when the slave is lost, or the paired slave, never
+ * released. See NOTE 21 below. */
+static volatile uint16_t slave_address = FRAME_BROADCAST;
+#ifdef CONFIG_PAIRING
+static volatile uint8_t paired = 0;
+static volatile uint8_t pair_event = 0;        /* The slave served has polled this master directly, pair with it */
+static uint16_t resp_pan = FRAME_BROADCAST;    /* PAN ID currently in the staged response and report */
+static uint32_t pairing_seed;                  /* Draws the broadcast polls an unpaired master answers */
+#endif
+
+#ifdef CONFIG_MULTI_RESPONDER
+/* Response slot taken from the responder table of the slave's poll. See NOTE 23 below. */
+#define MULTI_RESP_JOIN_SPREAD 4  /* A master not listed yet joins in one of the next this many polls */
+static uint8_t join_skip = 0;
+static int responder_slot(const uint8_t *table);
+#endif
+static uint8_t slave_lost = 0;
+
 /* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power of the spectrum at the current
  * temperature. These values can be calibrated prior to taking reference measurements. See NOTE 5 below. */
 extern dwt_txconfig_t txconfig_options;
 
-void transmit(void);
-void memcpy_byte(volatile uint8_t* dest, const uint8_t* src, size_t length);
-void set_tx_param(uint8_t parameter);
-void handle_feedback(RelayState r1State, RelayState r2State);
+static void rx_ok_cb(const dwt_cb_data_t *cb_data);
+static void rx_err_cb(const dwt_cb_data_t *cb_data);
+static void tx_done_cb(const dwt_cb_data_t *cb_data);
+static int send_response(uint32_t delay_uus);
+static int send_report(void);
+static void process_poll(uint8_t param, const OutputMsg *status);
+static void stage_command(uint32_t changed);
+#ifdef CONFIG_PUSH_COMMANDS
+static int send_push(uint8_t sn);
+#endif
+#ifdef CONFIG_TDMA
+static void send_beacon(void);
+static ArqLink *slave_link_of(uint16_t address);
+#endif
+void set_tx_outputs(uint32_t outputs);
+void handle_feedback(uint32_t outputs);
 
 /*! ------------------------------------------------------------------------------------------------------------------
  * @fn main()
@@ -114,6 +238,10 @@ int uwb_master(void)
     { };
   }
 
+#ifdef CONFIG_DWIC_REG_SHADOW
+  dwt_setregshadow(1);
+#endif
+
   /* Enabling LEDs here for debug so that for each TX the D1 LED will flash on DW3000 red eval-shield boards. */
   dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK) ;
 
@@ -132,186 +260,690 @@ int uwb_master(void)
   dwt_setrxantennadelay(RX_ANT_DLY);
   dwt_settxantennadelay(TX_ANT_DLY);
 
+  /* Short address hashed from the MCU unique ID, the DW IC drops frames for other nodes, and once paired for other
+   * pairs. See NOTE 21 below. */
+#ifdef CONFIG_PAIRING
+  uint16_t pan_id = FRAME_BROADCAST;
+
+  if (pairing_clear_requested() && pairing_store(PAIRING_NONE))
+  {
+    printf("Pairing cleared\r\n");
+  }
+  slave_address = pairing_load();
+  paired = (slave_address != PAIRING_NONE);
+  if (paired)
+  {
+    pan_id = pairing_pan_id(port_get_short_address());
+  }
+  resp_pan = pan_id;
+  pairing_seed = (HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2()) | 1;
+#else
+  uint16_t pan_id = CONFIG_PAN_ID;
+#endif
+  frame_set_address(pan_id, port_get_short_address());
+#ifdef CONFIG_FRAME_FILTERING
+  dwt_setpanid(pan_id);
+  dwt_setaddress16(frame_get_address());
+  dwt_configureframefilter(DWT_FF_ENABLE_802_15_4, DWT_FF_DATA_EN | DWT_FF_ACK_EN);
+#endif
+  printf("Master address 0x%04X, PAN 0x%04X\r\n", frame_get_address(), pan_id);
+
   /* Next can enable TX/RX states output on GPIOs 5 and 6 to help debug, and also TX/RX LEDs
    * Note, in real low power applications the LEDs should not be used. */
   dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
 
+  /* Install the event callbacks and unmask the DW IC interrupts. See NOTE 6 below. */
+  uwb_events_init(tx_done_cb, rx_ok_cb, rx_err_cb, rx_err_cb);
+
+  /* Constant parts of the frames go to the TX buffer once, only the changing bytes are written per exchange */
+  frame_stage(&resp_slot, tx_resp_msg);
+  frame_stage(&report_slot, tx_report_msg);
+#ifdef CONFIG_PUSH_COMMANDS
+  frame_stage(&push_slot, tx_push_msg);
+#endif
+#ifdef CONFIG_PAIRING
+  if (paired)
+  {
+    frame_set_dest(&resp_slot, slave_address);
+    frame_set_dest(&report_slot, slave_address);
+#ifdef CONFIG_PUSH_COMMANDS
+    frame_set_dest(&push_slot, slave_address);
+#endif
+    printf("Paired with slave 0x%04X, PAN 0x%04X\r\n", slave_address, pan_id);
+  }
+#endif
+#ifdef CONFIG_TDMA
+  frame_stage(&beacon_slot, tx_beacon_msg);
+#ifdef CONFIG_ALOHA
+  {
+    uint8_t block[ALOHA_BEACON_LEN];
+
+    aloha_beacon_encode(block);
+    frame_patch(&beacon_slot, BEACON_MSG_TDMA_IDX, block, sizeof(block));
+  }
+#else
+  tdma_init(&schedule);
+#endif
+#endif
+
+  /* Feedback outputs mirror the slave's channels */
+  output_channels_init();
+
+  /* Inputs are edge driven and debounced, the main loop only takes the latched change. Input n commands output
+   * channel n. See NOTE 17 below. */
+  controller_input_init(CONTROLLER_DEBOUNCE_MS);
+  set_tx_outputs(controller_input_state());
+
+#ifdef CONFIG_TDMA
+  for (int i = 0; i < TDMA_MAX_SLAVES; i++)
+  {
+    slave_link_address[i] = FRAME_BROADCAST;
+  }
+#else
+  arq_init(&slave_link, ARQ_MAX_RETRIES, HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2());
+#endif
+
+#ifdef CONFIG_PUSH_COMMANDS
+  cycle_counter_init();
+#endif
+
+  /* Activate reception immediately, the callbacks keep the receiver on from here. */
+  last_poll_tick = HAL_GetTick();
+  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+#ifdef CONFIG_TDMA
+  beacon_time = dwt_readsystimestamphi32();
+#endif
+
   /* Loop forever responding to ranging requests. */
   while (1)
   {
-    if (HAL_GPIO_ReadPin(CONTROLLER_IN_1_GPIO_Port, CONTROLLER_IN_1_Pin) &&
-        !HAL_GPIO_ReadPin(CONTROLLER_IN_2_GPIO_Port, CONTROLLER_IN_2_Pin))
+    uint8_t inputs;
+    if (controller_input_changed(&inputs) && inputs != tx_outputs)
     {
-      set_tx_param(1);  // Turn on the first relay
+      /* The RX callback sends the response from the TX buffer, keep it out while the command is patched */
+      decaIrqStatus_t stat = decamutexon();
+      set_tx_outputs(inputs);
+      decamutexoff(stat);
+#ifdef CONFIG_PUSH_COMMANDS
+      push_pending = 1;
+      push_edge_cycles = cycle_counter_read();
+#endif
     }
-    else if (!HAL_GPIO_ReadPin(CONTROLLER_IN_1_GPIO_Port, CONTROLLER_IN_1_Pin) &&
-        HAL_GPIO_ReadPin(CONTROLLER_IN_2_GPIO_Port, CONTROLLER_IN_2_Pin))
+
+#ifdef CONFIG_PUSH_COMMANDS
+    /* Pushed once the radio is free, an exchange in progress already carries the new command in its response */
+    if (push_pending)
     {
-      set_tx_param(2);  // Turn on the second relay
+      decaIrqStatus_t stat = decamutexon();
+      if (slave_address == FRAME_BROADCAST)
+      {
+        push_pending = 0; /* No slave yet, the response to its first poll carries the command */
+      }
+      else if (!tx_busy && !await_final)
+      {
+        /* A new push supersedes one still waiting for its acknowledgement */
+        arq_begin(&slave_link);
+        if (send_push(frame_seq_nb) == DWT_SUCCESS)
+        {
+          push_pending = 0;
+        }
+      }
+      decamutexoff(stat);
     }
-    else if (HAL_GPIO_ReadPin(CONTROLLER_IN_1_GPIO_Port, CONTROLLER_IN_1_Pin) &&
-        HAL_GPIO_ReadPin(CONTROLLER_IN_2_GPIO_Port, CONTROLLER_IN_2_Pin))
+
+    /* Neither an ACK nor a poll after the push: it or the acknowledgement was lost, send it again with the same number */
+    if (push_unacked && (HAL_GetTick() - push_sent_tick) >= push_retry_ms)
     {
-      set_tx_param(3);  // Turn on all the relays
+      decaIrqStatus_t stat = decamutexon();
+      if (push_unacked && !tx_busy && !await_final)
+      {
+        if (!arq_retry(&slave_link))
+        {
+          push_unacked = 0;
+          RANGING_LOG("\rPush not acknowledged, the next response carries the command\n");
+        }
+        else if (send_push(push_sn) == DWT_SUCCESS)
+        {
+          push_unacked = 0;
+        }
+      }
+      decamutexoff(stat);
     }
-    else
+
+    if (push_sent)
+    {
+      push_sent = 0;
+      RANGING_LOG("\rPushed outputs 0x%08lx, on air %lu us after the input change\n", (unsigned long)tx_outputs,
+                  (unsigned long)((push_done_cycles - push_edge_cycles) / (SystemCoreClock / 1000000)));
+    }
+
+    if (push_acked)
     {
-      set_tx_param(0);  // Turn off all the relays
+      push_acked = 0;
+      RANGING_LOG("\rPush acknowledged %lu us after the input change\n",
+                  (unsigned long)((push_ack_cycles - push_edge_cycles) / (SystemCoreClock / 1000000)));
     }
+#endif
 
-    transmit();
+#ifdef CONFIG_TDMA
+    send_beacon();
+#endif
+
+#ifdef CONFIG_PAIRING
+    /* The slave served has taken this master, from now on both only range with each other. See NOTE 21 below. */
+    if (pair_event)
+    {
+      uint16_t pair_pan_id = pairing_pan_id(frame_get_address());
+
+      pair_event = 0;
+      paired = 1;
+      if (!pairing_store(slave_address))
+      {
+        printf("\rPairing not stored, flash error\n");
+      }
+
+      /* The response and report follow the PAN of the poll, only the push is sent on the pair's PAN unasked */
+      decaIrqStatus_t stat = decamutexon();
+      frame_set_address(pair_pan_id, frame_get_address());
+#ifdef CONFIG_FRAME_FILTERING
+      dwt_setpanid(pair_pan_id);
+#endif
+#ifdef CONFIG_PUSH_COMMANDS
+      frame_set_pan(&push_slot, pair_pan_id);
+#endif
+      decamutexoff(stat);
+      printf("\rPaired with slave 0x%04X, PAN 0x%04X\n", slave_address, pair_pan_id);
+    }
+#endif
+
+    uint32_t poll_tick = last_poll_tick;
+    if (poll_event)
+    {
+      poll_event = 0;
+      slave_lost = 0;
+      process_poll(poll_param, &poll_status);
+    }
+    else if (!slave_lost && (HAL_GetTick() - poll_tick) >= detection_timeout)
+    {
+      /* Unable to detect slave, turn off feedback LEDs */
+      printf("\rUnable to find the slave module!\n");
+      handle_feedback(0);
+      errorLedOn();
+      slave_lost = 1;
+#ifdef CONFIG_PAIRING
+      if (!paired)
+#endif
+      {
+        slave_address = FRAME_BROADCAST; /* Serve whichever slave polls next */
+      }
+    }
+
+    if (distance_event)
+    {
+      distance_event = 0;
+      RANGING_LOG("\rDS-TWR distance: %ld mm\n", (long)distance_to_slave);
+    }
+
+    uwb_events_dispatch();
   }
 }
 
-void transmit(void)
+/* Runs from dwt_isr() on RXFCG. A valid poll is answered straight away so the delayed TX is programmed well within
+ * POLL_RX_TO_RESP_TX_DLY_UUS, everything else is left to the main loop. */
+static void rx_ok_cb(const dwt_cb_data_t *cb_data)
 {
-  /* Activate reception immediately. */
-  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+  int func_code;
+
+  status_reg = cb_data->status;
 
-  uint32_t tick_start = HAL_GetTick();
-  /* Poll for reception of a frame or error/timeout. See NOTE 6 below. */
-  while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_ALL_RX_ERR)))
+#ifdef CONFIG_PUSH_COMMANDS
+  /* Hardware acknowledgement of the last push, the receiver was turned on by the push itself. See NOTE 21 below. */
+  if (cb_data->datalength == FRAME_ACK_LEN)
   {
-    /* Poll until detection_timeout and turn off feedback LEDs if slave is not found */
-    if ((HAL_GetTick() - tick_start) >= detection_timeout)
+    if (push_unacked && frame_read_ack(cb_data->datalength) == push_sn)
     {
-      /* Unable to detect slave */
-      printf("\rUnable to find the slave module!\n");
-      handle_feedback(RELAY_OFF, RELAY_OFF);
-      errorLedOn();
+      push_ack_cycles = cycle_counter_read();
+      push_unacked = 0;
+      push_acked = 1;
+      arq_done(&slave_link);
     }
-  };
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    return;
+  }
+#endif
 
-  if (status_reg & SYS_STATUS_RXFCG_BIT_MASK)
+  /* Check that the frame is addressed to this node, only its header is read at this point. See NOTE 18 below. */
+  func_code = frame_read_header(rx_buffer, cb_data->datalength);
+
+#ifdef CONFIG_TDMA
+  /* Any slave with a slot is answered, a poll from an unknown one registers it. With slotted ALOHA any poll that got
+   * through is answered, the response acknowledges its slot. See NOTE 22 and 24 below. */
+  if (func_code == POLL_FUNC_CODE || func_code == DS_POLL_FUNC_CODE)
   {
-    uint32_t frame_len;
+#ifndef CONFIG_ALOHA
+    if (tdma_register(&schedule, frame_get_source(rx_buffer)) == TDMA_NO_SLOT)
+    {
+      func_code = FRAME_INVALID;
+    }
+    else
+#endif
+    if (frame_get_source(rx_buffer) != resp_dest)
+    {
+      resp_dest = frame_get_source(rx_buffer);
+      frame_set_dest(&resp_slot, resp_dest);
+      frame_set_dest(&report_slot, resp_dest);
+    }
+  }
+  else if (func_code != FRAME_INVALID && frame_get_source(rx_buffer) != resp_dest)
+  {
+    func_code = FRAME_INVALID;
+  }
+  ArqLink *link = (func_code == FRAME_INVALID) ? NULL : slave_link_of(frame_get_source(rx_buffer));
+#else
+  /* Only the slave served is answered; without one yet, the first to poll is taken. Unpaired, a broadcast poll is only
+   * answered with probability 1/2, so that masters powered up together do not always collide. See NOTE 21 below. */
+#ifdef CONFIG_PAIRING
+  if ((func_code == POLL_FUNC_CODE || func_code == DS_POLL_FUNC_CODE) && !paired &&
+      frame_get_dest(rx_buffer) == FRAME_BROADCAST && (xorshift32(&pairing_seed) & 1))
+  {
+    func_code = FRAME_INVALID;
+  }
+#endif
+  if ((func_code == POLL_FUNC_CODE || func_code == DS_POLL_FUNC_CODE) && slave_address == FRAME_BROADCAST)
+  {
+    slave_address = frame_get_source(rx_buffer);
+    frame_set_dest(&resp_slot, slave_address);
+    frame_set_dest(&report_slot, slave_address);
+#ifdef CONFIG_PUSH_COMMANDS
+    frame_set_dest(&push_slot, slave_address);
+#endif
+  }
+  if (func_code != FRAME_INVALID && frame_get_source(rx_buffer) != slave_address)
+  {
+    func_code = FRAME_INVALID;
+  }
+#ifdef CONFIG_PAIRING
+  if (func_code == POLL_FUNC_CODE || func_code == DS_POLL_FUNC_CODE)
+  {
+    /* Answered on the PAN of the poll: the broadcast PAN until the slave has paired too */
+    if (frame_get_pan(rx_buffer) != resp_pan)
+    {
+      resp_pan = frame_get_pan(rx_buffer);
+      frame_set_pan(&resp_slot, resp_pan);
+      frame_set_pan(&report_slot, resp_pan);
+    }
+    /* A poll addressed to this master means the slave has taken it */
+    if (!paired && frame_get_dest(rx_buffer) != FRAME_BROADCAST)
+    {
+      pair_event = 1;
+    }
+  }
+#endif
+  ArqLink *link = &slave_link;
+#endif
 
-    /* Clear good RX frame event in the DW IC status register. */
-    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG_BIT_MASK);
+  /* The poll carries the slave's outputs, needed to work out which channels the response changes */
+  if ((func_code == POLL_FUNC_CODE || func_code == DS_POLL_FUNC_CODE) &&
+      cb_data->datalength >= POLL_MSG_STATUS_IDX + 1 + FRAME_FCS_LEN &&
+      frame_read_payload(rx_buffer, sizeof(rx_buffer), cb_data->datalength) == DWT_SUCCESS &&
+      output_msg_decode(&rx_buffer[POLL_MSG_OUTPUT_IDX], &poll_status))
+  {
+    poll_param = rx_buffer[POLL_MSG_STATUS_IDX];
+    stage_command(tx_outputs ^ poll_status.state);
 
-    /* A frame has been received, read it into the local buffer. */
-    frame_len = dwt_read32bitreg(RX_FINFO_ID) & RXFLEN_MASK;
-    if (frame_len <= sizeof(rx_buffer))
+    /* A repeated poll is answered like a new one, each needs fresh timestamps. Any poll acknowledges a push. */
+    arq_receive(link, rx_buffer[FRAME_SN_IDX]);
+#ifdef CONFIG_PUSH_COMMANDS
+    if (push_unacked)
     {
-      dwt_readrxdata(rx_buffer, frame_len, 0);
+      push_unacked = 0;
+      arq_done(&slave_link);
+    }
+#endif
+    last_poll_tick = HAL_GetTick();
+    poll_event = 1;
+    await_final = 0;
 
-      /* Check that the frame is a poll sent by "SS TWR initiator" example.
-       * As the sequence number field of the frame is not relevant, it is cleared to simplify the validation of the frame. */
-      rx_buffer[ALL_MSG_SN_IDX] = 0;
+#ifdef CONFIG_MULTI_RESPONDER
+    /* One poll for all the masters, each answers in its own slot or not at all. See NOTE 23 below. */
+    int slot = -1;
 
-      if (memcmp(rx_buffer, rx_prefix, RX_PREFIX_LEN) == 0 &&
-          rx_buffer[ALL_MSG_COMMON_LEN - 1] == rx_suffix)
-      {
-        uint32_t resp_tx_time;
-        int ret;
+    if (func_code == POLL_FUNC_CODE && cb_data->datalength >= POLL_MSG_RESPONDERS_IDX + 2 * MULTI_RESP_MAX + FRAME_FCS_LEN)
+    {
+      slot = responder_slot(&rx_buffer[POLL_MSG_RESPONDERS_IDX]);
+    }
+    if (slot >= 0 && send_response(POLL_RX_TO_RESP_TX_DLY_UUS + (uint32_t)slot * MULTI_RESP_SLOT_UUS) == DWT_SUCCESS)
+#else
+    /* If dwt_starttx() returns an error, abandon this ranging exchange and proceed to the next one. See NOTE 10 below. */
+    if (send_response(POLL_RX_TO_RESP_TX_DLY_UUS) == DWT_SUCCESS)
+#endif
+    {
+      tx_busy = 1;
+#ifdef CONFIG_TDMA
+      final_deadline = (uint32_t)(resp_tx_ts >> 8) + (uint32_t)(((uint64_t)FINAL_WAIT_UUS * UUS_TO_DWT_TIME) >> 8);
+#endif
+      await_final = (func_code == DS_POLL_FUNC_CODE);
+      return; /* Receiver is re-armed from tx_done_cb() */
+    }
+  }
+  else if (func_code == FINAL_FUNC_CODE && await_final)
+  {
+    await_final = 0;
+    arq_receive(link, rx_buffer[FRAME_SN_IDX]);
 
-        /* Retrieve poll reception timestamp. */
-        poll_rx_ts = get_rx_timestamp_u64();
+    /* send_report() reads all three timestamps, a short final would leave stale bytes of an earlier frame in them */
+    if (cb_data->datalength >= FINAL_MSG_FINAL_TX_TS_IDX + FINAL_MSG_TS_LEN + FRAME_FCS_LEN &&
+        frame_read_payload(rx_buffer, sizeof(rx_buffer), cb_data->datalength) == DWT_SUCCESS &&
+        send_report() == DWT_SUCCESS)
+    {
+      tx_busy = 1;
+      return; /* Receiver is re-armed from tx_done_cb() */
+    }
+  }
 
-        /* Compute response message transmission time. See NOTE 7 below. */
-        resp_tx_time = (poll_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
-        dwt_setdelayedtrxtime(resp_tx_time);
+  /* Nothing to answer, go back to listening */
+  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
 
-        /* Response TX timestamp is the transmission time we programmed plus the antenna delay. */
-        resp_tx_ts = (((uint64_t)(resp_tx_time & 0xFFFFFFFEUL)) << 8) + TX_ANT_DLY;
+static void rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+  status_reg = cb_data->status;
 
-        /* Write all timestamps in the final message. See NOTE 8 below. */
-        resp_msg_set_ts(&tx_resp_msg[RESP_MSG_POLL_RX_TS_IDX], poll_rx_ts);
-        resp_msg_set_ts(&tx_resp_msg[RESP_MSG_RESP_TX_TS_IDX], resp_tx_ts);
+  /* A DS-TWR final received in error will not come again, the slave polls afresh */
+  await_final = 0;
 
-        /* Write and send the response message. See NOTE 9 below. */
-        tx_resp_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-        dwt_writetxdata(sizeof(tx_resp_msg), tx_resp_msg, 0); /* Zero offset in TX buffer. */
-        dwt_writetxfctrl(sizeof(tx_resp_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
-        ret = dwt_starttx(DWT_START_TX_DELAYED);
+  /* Error events are already cleared by dwt_isr(), re-arm the receiver */
+  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
 
-        /* If dwt_starttx() returns an error, abandon this ranging exchange and proceed to the next one. See NOTE 10 below. */
-        if (ret == DWT_SUCCESS)
-        {
-          /* Poll DW IC until TX frame sent event set. See NOTE 6 below. */
-          while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS_BIT_MASK))
-          { };
+static void tx_done_cb(const dwt_cb_data_t *cb_data)
+{
+  status_reg = cb_data->status;
 
-          /* Clear TXFRS event. */
-          dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS_BIT_MASK);
+  /* Increment frame sequence number after transmission of the response message (modulo 256). */
+  frame_seq_nb++;
 
-          /* Increment frame sequence number after transmission of the poll message (modulo 256). */
-          frame_seq_nb++;
-        }
+#ifdef CONFIG_PUSH_COMMANDS
+  if (push_in_flight)
+  {
+    push_done_cycles = cycle_counter_read();
+    push_in_flight = 0;
+    push_sent = 1;
+    push_sent_tick = HAL_GetTick();
+    push_unacked = (ARQ_MAX_RETRIES != 0);
+    tx_busy = 0;
+    return; /* The push turned the receiver on for the acknowledgement */
+  }
+#endif
+  tx_busy = 0;
 
-        printf("\r[ACK] Prefix suffix OK, param: %d\n", rx_buffer[RX_PARAM_IDX]);
-        switch (rx_buffer[RX_PARAM_IDX])
-        {
-          case ALL_OFF: /* All relays are off */
-            handle_feedback(RELAY_OFF, RELAY_OFF);
-            errorLedOff();
-            break;
-          case REL_1_ON:  /* 1st relay is ON */
-            handle_feedback(RELAY_ON, RELAY_OFF);
-            errorLedOff();
-            break;
-          case REL_2_ON: /* 2nd relay is ON */
-            handle_feedback(RELAY_OFF, RELAY_ON);
-            errorLedOff();
-            break;
-          case ALL_ON:  /* All relays are on */
-            handle_feedback(RELAY_ON, RELAY_ON);
-            errorLedOff();
-            break;
-          case OUT_OF_RANGE_CODE:
-            errorLedBlink();
-            break;
-          default:
-            printf("\rInvalid parameter!\n");
-        }
-      }
+  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/* Answers the poll delay_uus after its reception, the turn-around plus the responder slot if any */
+static int send_response(uint32_t delay_uus)
+{
+  uint8_t ts_fields[2 * RESP_MSG_TS_LEN];
+  uint32_t resp_tx_time;
+
+  /* Retrieve poll reception timestamp. */
+  poll_rx_ts = get_rx_timestamp_u64();
+
+  /* Compute response message transmission time. See NOTE 7 below. */
+  resp_tx_time = (poll_rx_ts + ((uint64_t)delay_uus * UUS_TO_DWT_TIME)) >> 8;
+  dwt_setdelayedtrxtime(resp_tx_time);
+
+  /* Response TX timestamp is the transmission time we programmed plus the antenna delay. */
+  resp_tx_ts = (((uint64_t)(resp_tx_time & 0xFFFFFFFEUL)) << 8) + TX_ANT_DLY;
+
+  /* Patch the timestamps and the sequence number into the staged response. See NOTE 8 and 18 below. */
+  resp_msg_set_ts(&ts_fields[0], poll_rx_ts);
+  resp_msg_set_ts(&ts_fields[RESP_MSG_TS_LEN], resp_tx_ts);
+  frame_patch(&resp_slot, RESP_MSG_POLL_RX_TS_IDX, ts_fields, sizeof(ts_fields));
+  frame_set_byte(&resp_slot, FRAME_SN_IDX, frame_seq_nb);
+  frame_select(&resp_slot);
+
+  return dwt_starttx(DWT_START_TX_DELAYED);
+}
+
+/* Completes a DS-TWR exchange: computes the distance from the final and sends it back to the initiator. See NOTE 14 below. */
+static int send_report(void)
+{
+  uint32_t poll_tx_ts, resp_rx_ts, final_tx_ts;
+  uint64_t final_rx_ts;
+  uint32_t report_tx_time;
+  uint8_t dist_field[4];
+  int32_t distance;
+
+  /* Retrieve final reception timestamp and the initiator's timestamps embedded in the final. See NOTE 8 below. */
+  final_rx_ts = get_rx_timestamp_u64();
+  final_msg_get_ts(&rx_buffer[FINAL_MSG_POLL_TX_TS_IDX], &poll_tx_ts);
+  final_msg_get_ts(&rx_buffer[FINAL_MSG_RESP_RX_TS_IDX], &resp_rx_ts);
+  final_msg_get_ts(&rx_buffer[FINAL_MSG_FINAL_TX_TS_IDX], &final_tx_ts);
+
+  distance = ds_twr_distance_mm(resp_rx_ts - poll_tx_ts,
+                                (uint32_t)resp_tx_ts - (uint32_t)poll_rx_ts,
+                                (uint32_t)final_rx_ts - (uint32_t)resp_tx_ts,
+                                final_tx_ts - resp_rx_ts);
+  distance_to_slave = distance;
+  distance_event = 1;
+
+  /* Same turn-around as the response, so the RX delay and timeout the initiator uses for the response also apply here. */
+  report_tx_time = (final_rx_ts + (POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+  dwt_setdelayedtrxtime(report_tx_time);
+
+  /* The distance goes in the same 4-byte little endian layout as the timestamps */
+  final_msg_set_ts(dist_field, (uint32_t)distance);
+  frame_patch(&report_slot, REPORT_MSG_DIST_IDX, dist_field, sizeof(dist_field));
+  frame_set_byte(&report_slot, FRAME_SN_IDX, frame_seq_nb);
+  frame_select(&report_slot);
+
+  return dwt_starttx(DWT_START_TX_DELAYED);
+}
+
+#ifdef CONFIG_PUSH_COMMANDS
+/* Sends the command straight away, the slave picks it up in its sniff window between exchanges. Called with the DW IC
+ * interrupt masked and only while no response or report is pending, so stopping the receiver cannot cut an exchange.
+ * A repeat carries the sequence number of the first send so that the slave can tell it apart. See NOTE 16 and 20 below. */
+static int send_push(uint8_t sn)
+{
+  dwt_forcetrxoff();
+
+  push_sn = sn;
+  push_retry_ms = ARQ_PUSH_ACK_MS + arq_backoff_us(&slave_link, 0, ARQ_PUSH_BACKOFF_MS); /* Span in ms, wait in ms */
+
+  /* The command is already in place, stage_command() patches it in both the response and the push */
+  frame_set_byte(&push_slot, FRAME_SN_IDX, sn);
+  frame_select(&push_slot);
+
+  /* The receiver goes on right after the frame for the slave's acknowledgement, and stays on for the polls */
+  if (dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED) != DWT_SUCCESS)
+  {
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    return DWT_ERROR;
+  }
+
+  /* tx_done_cb() times the push */
+  tx_busy = 1;
+  push_in_flight = 1;
+  return DWT_SUCCESS;
+}
+#endif
+
+#ifdef CONFIG_MULTI_RESPONDER
+/* Slot this master answers a poll in: its entry in the poll's responder table or, while not listed, the join slot after
+ * the table when there is a free entry. -1 when it stays silent this time. See NOTE 23 below. */
+static int responder_slot(const uint8_t *table)
+{
+  uint8_t i, free_entry = 0;
+
+  for (i = 0; i < MULTI_RESP_MAX; i++)
+  {
+    uint16_t address = (uint16_t)table[2 * i] | ((uint16_t)table[2 * i + 1] << 8);
+
+    if (address == frame_get_address())
+    {
+      return i;
     }
+    free_entry |= (address == FRAME_BROADCAST);
   }
-  else
+
+  /* Masters joining together collide in the join slot, each lets a random number of polls pass before trying again */
+  if (!free_entry || join_skip != 0)
   {
-    /* Clear RX error events in the DW IC status register. */
-    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
+    join_skip -= (join_skip != 0);
+    return -1;
   }
+  join_skip = (uint8_t)arq_backoff_us(&slave_link, 0, MULTI_RESP_JOIN_SPREAD);
+  return MULTI_RESP_MAX;
 }
+#endif
 
-void set_tx_param(uint8_t parameter)
+#ifdef CONFIG_TDMA
+/* Link of the slave at address, called from the RX callback for each frame of a slave that is answered */
+static ArqLink *slave_link_of(uint16_t address)
 {
-  switch (parameter)
+  uint32_t now = HAL_GetTick();
+  int reuse = 0;
+
+  for (int i = 0; i < TDMA_MAX_SLAVES; i++)
   {
-    case 0:
-      memcpy_byte(tx_resp_msg, tx_no_relay, ALL_MSG_COMMON_LEN);  // Turn off all the relays
-      break;
-    case 1:
-      memcpy_byte(tx_resp_msg, tx_first_relay, ALL_MSG_COMMON_LEN);  // Turn on the first relay
-      break;
-    case 2:
-      memcpy_byte(tx_resp_msg, tx_second_relay, ALL_MSG_COMMON_LEN);  // Turn on the second relay
-      break;
-    case 3:
-      memcpy_byte(tx_resp_msg, tx_all_relays, ALL_MSG_COMMON_LEN);  // Turn on all the relays
-      break;
+    if (slave_link_address[i] == address)
+    {
+      slave_link_tick[i] = now;
+      return &slave_links[i];
+    }
+    /* A free link first, otherwise the one polled least recently. With a TDMA registry, which holds at most
+     * TDMA_MAX_SLAVES, that slave has left; with slotted ALOHA it is the one idle longest. */
+    if (slave_link_address[reuse] != FRAME_BROADCAST &&
+        (slave_link_address[i] == FRAME_BROADCAST || now - slave_link_tick[i] > now - slave_link_tick[reuse]))
+    {
+      reuse = i;
+    }
   }
+
+  arq_init(&slave_links[reuse], ARQ_MAX_RETRIES, HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2() ^ address);
+  slave_link_address[reuse] = address;
+  slave_link_tick[reuse] = now;
+  return &slave_links[reuse];
 }
 
-void handle_feedback(RelayState r1State, RelayState r2State)
+#define TDMA_US_TO_DX(us) ((uint32_t)(((uint64_t)(us) * UUS_TO_DWT_TIME) >> 8))
+#define BEACON_MIN_LEAD_US 150 /* Below this the beacon is re-timed rather than risk a late delayed TX */
+
+/* Arms the beacon of the next superframe once the slots of the current one are over, one superframe after the previous
+ * beacon on the DW IC clock. Runs from every main loop iteration, the SysTick wake-up keeps them under TDMA_LAUNCH_US
+ * apart. See NOTE 22 below. */
+static void send_beacon(void)
 {
-  if (HAL_GPIO_ReadPin(RELAY_1_OUT_GPIO_Port, RELAY_1_OUT_Pin) != (GPIO_PinState)r1State)
+  decaIrqStatus_t stat = decamutexon();
+  uint32_t now = dwt_readsystimestamphi32();
+  int32_t lead = (int32_t)(beacon_time - now);
+
+  /* A lost final would otherwise hold the beacon back for good: without a beacon no slave polls again */
+  if (await_final && (int32_t)(now - final_deadline) >= 0)
+  {
+    await_final = 0;
+  }
+
+  if (lead > (int32_t)TDMA_US_TO_DX(TDMA_LAUNCH_US) || tx_busy || await_final)
   {
-    HAL_GPIO_WritePin(RELAY_1_OUT_GPIO_Port, RELAY_1_OUT_Pin, r1State);
+    decamutexoff(stat);
+    return;
   }
 
-  if (HAL_GPIO_ReadPin(RELAY_2_OUT_GPIO_Port, RELAY_2_OUT_Pin) != (GPIO_PinState)r2State)
+  /* First beacon or a late main loop: restart the superframe grid from now, the slaves follow the beacon */
+  if (lead < (int32_t)TDMA_US_TO_DX(BEACON_MIN_LEAD_US))
   {
-    HAL_GPIO_WritePin(RELAY_2_OUT_GPIO_Port, RELAY_2_OUT_Pin, r2State);
+    beacon_time = now + TDMA_US_TO_DX(TDMA_LAUNCH_US);
   }
+
+#ifndef CONFIG_ALOHA
+  tdma_start_superframe(&schedule);
+  if (schedule.changed)
+  {
+    uint8_t block[TDMA_BEACON_LEN];
+
+    tdma_beacon_encode(&schedule, block);
+    frame_patch(&beacon_slot, BEACON_MSG_TDMA_IDX, block, sizeof(block));
+  }
+#endif
+  frame_set_byte(&beacon_slot, FRAME_SN_IDX, frame_seq_nb);
+  frame_select(&beacon_slot);
+
+  /* The last slot is over, nothing is lost by stopping the receiver until the beacon has gone */
+  dwt_forcetrxoff();
+  dwt_setreferencetrxtime(beacon_time);
+  dwt_setdelayedtrxtime(0);
+  if (dwt_starttx(DWT_START_TX_DLY_REF) == DWT_SUCCESS)
+  {
+    tx_busy = 1; /* tx_done_cb() re-arms the receiver for the slots */
+  }
+  else
+  {
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+  }
+#ifdef CONFIG_ALOHA
+  beacon_time += TDMA_US_TO_DX(ALOHA_FRAME_US);
+#else
+  beacon_time += TDMA_US_TO_DX(tdma_superframe_us(&schedule));
+#endif
+
+  decamutexoff(stat);
+}
+#endif
+
+static void process_poll(uint8_t param, const OutputMsg *status)
+{
+  if (param == OUT_OF_RANGE_CODE)
+  {
+    errorLedBlink();
+    return;
+  }
+
+  RANGING_LOG("\r[ACK] Prefix suffix OK, outputs: 0x%08lx\n", (unsigned long)status->state);
+  if (status->mask)
+  {
+    RANGING_LOG("\rSlave applied channels 0x%08lx\n", (unsigned long)status->mask);
+  }
+  handle_feedback(status->state);
+  errorLedOff();
 }
 
-void memcpy_byte(volatile uint8_t* dest, const uint8_t* src, size_t length)
+/* Patches the command block of the response and push, only when it differs from the staged one. The channel count
+ * is never 0 once staged, so the first call always writes. See NOTE 19 below. */
+static void stage_command(uint32_t changed)
 {
-  for (int i = 0; i < length; i++)
+  uint8_t block[OUTPUT_MSG_LEN];
+
+  if (staged_command.channels != 0 && staged_command.state == tx_outputs && staged_command.mask == changed)
   {
-    dest[i] = src[i];
+    return;
   }
+
+  staged_command.channels = output_channels_count();
+  staged_command.state = tx_outputs;
+  staged_command.mask = changed;
+  output_msg_encode(block, &staged_command);
+
+  frame_patch(&resp_slot, RESP_MSG_OUTPUT_IDX, block, sizeof(block));
+#ifdef CONFIG_PUSH_COMMANDS
+  frame_patch(&push_slot, PUSH_MSG_OUTPUT_IDX, block, sizeof(block));
+#endif
+}
+
+/* Output channels commanded to the slave, bit n is channel n. Channels the slave did not report in its last poll as
+ * already set are flagged as changed. */
+void set_tx_outputs(uint32_t outputs)
+{
+  tx_outputs = outputs & output_channels_all();
+  stage_command(tx_outputs ^ poll_status.state);
+}
+
+/* Mirrors the slave's outputs on the feedback outputs */
+void handle_feedback(uint32_t outputs)
+{
+  output_channels_write(outputs, output_channels_all());
 }
 
 /*****************************************************************************************************************************************************
@@ -344,26 +976,28 @@ void memcpy_byte(volatile uint8_t* dest, const uint8_t* src, size_t length)
  *    The first 10 bytes of those frame are common and are composed of the following fields:
  *     - byte 0/1: frame control (0x8841 to indicate a data frame using 16-bit addressing).
  *     - byte 2: sequence number, incremented for each new frame.
- *     - byte 3/4: PAN ID (0xDECA).
+ *     - byte 3/4: PAN ID, see NOTE 4.
  *     - byte 5/6: destination address, see NOTE 4 below.
  *     - byte 7/8: source address, see NOTE 4 below.
  *     - byte 9: function code (specific values to indicate which message it is in the ranging process).
  *    The remaining bytes are specific to each message as follows:
  *    Poll message:
- *     - no more data
+ *     - byte 10 -> 19: output status block, see NOTE 19 below.
+ *     - byte 20: feedback parameter (OUT_OF_RANGE_CODE or 0).
  *    Response message:
  *     - byte 10 -> 13: poll message reception timestamp.
  *     - byte 14 -> 17: response message transmission timestamp.
+ *     - byte 18 -> 27: output command block, see NOTE 19 below.
  *    All messages end with a 2-byte checksum automatically set by DW IC.
- * 4. Source and destination addresses are hard coded constants in this example to keep it simple but for a real product every device should have a
- *    unique ID. Here, 16-bit addressing is used to keep the messages as short as possible but, in an actual application, this should be done only
- *    after an exchange of specific messages used to define those short addresses for each device participating to the ranging exchange.
+ * 4. Each device takes a 16-bit short address hashed from the MCU unique ID (port_get_short_address()), on the PAN of its pair (CONFIG_PAIRING)
+ *    or CONFIG_PAN_ID. The master answers its paired slave, or the first slave that polls it, and addresses its frames to that slave only.
+ *    See NOTE 21 below.
  * 5. In a real application, for optimum performance within regulatory limits, it may be necessary to set TX pulse bandwidth and TX power, (using
  *    the dwt_configuretxrf API call) to per device calibrated values saved in the target system or the DW IC OTP memory.
- * 6. We use polled mode of operation here to keep the example as simple as possible but all status events can be used to generate interrupts. Please
- *    refer to DW IC User Manual for more details on "interrupts". It is also to be noted that STATUS register is 5 bytes long but, as the event we
- *    use are all in the first bytes of the register, we can use the simple dwt_read32bitreg() API call to access it instead of reading the whole 5
- *    bytes.
+ * 6. The responder is event driven: TXFRS, RXFCG, RX timeout and RX error events are unmasked with dwt_setinterrupt() and dispatched by
+ *    dwt_isr() to the callbacks above, either from the DW_IRQn EXTI line (CONFIG_DWIC_IRQ_MODE) or by polling the IRQS bit from the main loop.
+ *    The RX callback programs the delayed response itself, so the turn-around does not depend on how busy the main loop is. Relay feedback,
+ *    LEDs and printf are handled by the main loop, which sleeps between events in IRQ mode.
  * 7. As we want to send final TX timestamp in the final message, we have to compute it in advance instead of relying on the reading of DW IC
  *    register. Timestamps and delayed transmission time are both expressed in device time units so we just have to add the desired response delay to
  *    response RX timestamp to get final transmission time. The delayed transmission time resolution is 512 device time units which means that the
@@ -387,4 +1021,77 @@ void memcpy_byte(volatile uint8_t* dest, const uint8_t* src, size_t length)
  *     thereafter.
  * 13. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
+ * 14. Double-sided TWR is selected by the slave (CONFIG_RANGING_DS_TWR or uwb_slave_set_ranging_mode()) and announced by the DS poll function
+ *     code, the responder follows whichever poll it receives. The exchange adds two frames to the SS-TWR one:
+ *
+ *    Initiator: |Poll TX| ..... |Resp RX| ..... |Final TX| ..... |Report RX|
+ *    Responder: |Poll RX| ..... |Resp TX| ..... |Final RX| ..... |Report TX|
+ *
+ *    The final carries the initiator's poll TX, response RX and final TX timestamps (bytes 10 -> 21), from which the responder computes the
+ *    distance with ds_twr_distance_mm(). The clock offset between the two ends cancels out, so a single exchange gives the distance without the
+ *    clock offset correction SS-TWR relies on. The report returns that distance in millimetres (bytes 10 -> 13) so both ends have it. Final and
+ *    report are sent on the same POLL_RX_TO_RESP_TX_DLY_UUS turn-around as the response.
+ * 15. CONFIG_HIGH_RATE_RANGING switches both roles to a 64 symbol preamble at 6.8 Mbps, the shortest profile the DW3000 supports, so each frame
+ *     spends as little time on air as possible. The response turn-around is unchanged. Per poll printf is compiled out as a UART line takes
+ *     longer than the ranging period.
+ * 16. With CONFIG_PUSH_COMMANDS a command no longer waits for the next poll (up to RNG_DELAY_MS plus the exchange): when the controller inputs
+ *     change, the main loop stops the receiver and sends a 22 byte command frame (PUSH_FUNC_CODE, same output block as the response)
+ *     right away. It is held back while a response or report is pending, that response already carries the new command. The slave listens
+ *     for it in sniff mode between its exchanges. The time from the input change being seen to the push leaving the antenna (TXFRS) is
+ *     printed; it starts when the main loop takes the debounced change (NOTE 17). Host-simulated with netsim from the input edge to the
+ *     slave's relay output write (make latency in Source/Tools): 20.23 ms with push, i.e. the 20 ms debounce plus 0.23 ms, against 28 ms to
+ *     978 ms without (CONFIG_NO_PUSH_COMMANDS), where the command waits for the next exchange.
+ * 17. CONTROLLER_IN_1/2 are EXTI inputs on both edges (controller_input.c). Each edge restarts a TIM3 one-shot of CONTROLLER_DEBOUNCE_MS and
+ *     the inputs are sampled when it expires, so a new command is latched once the contacts have settled and a bounce that ends on the
+ *     previous state produces nothing. The latched change wakes the main loop like a DW IC event; the loop no longer reads the pins.
+ * 18. The response, report and push frames are staged once in separate regions of the DW IC TX buffer (frame_codec.c). Per frame only the
+ *     bytes that change are written (timestamps or distance, then the sequence number) and TX_FCTRL is rewritten only when another frame
+ *     was sent last. On reception only the 10 byte header is read first; the rest of a final is fetched once the function code is known.
+ * 19. Output commands and feedback use a versioned output block (output_channels.h) instead of one ASCII digit: version, channel count, a
+ *     32-bit output state and a 32-bit mask, 10 bytes for up to OUTPUT_CHANNELS_MAX channels. In the response and the push the mask holds
+ *     the channels whose commanded state differs from what the slave reported in the poll, in the poll it holds the channels the slave applied
+ *     from the last command, i.e. per-channel acknowledgements. The block of the response is recomputed from each poll in the RX callback
+ *     and only rewritten in the TX buffer when it changes. Controller input n commands channel n; the feedback outputs mirror the slave.
+ * 20. Sequence numbers are checked per link (arq.c): a frame is new when it is up to ARQ_WINDOW ahead of the last accepted one, a
+ *     duplicate when equal to it and stale when behind it. Polls are always answered, a repeated poll needs fresh timestamps as much as a
+ *     new one, the check only feeds the link counters. A push is a transfer of its own: if no poll follows it within ARQ_PUSH_ACK_MS plus a
+ *     random backoff, it is sent again with the same sequence number, up to ARQ_MAX_RETRIES times. The slave applies it once and answers
+ *     each copy with a poll. A push given up is not lost, the response to the next poll carries the same command. With CONFIG_TDMA
+ *     each slave polling in the superframes has a link of its own, their sequence numbers are unrelated.
+ * 21. With CONFIG_FRAME_FILTERING the DW IC checks the frame type, PAN ID and destination address of each frame itself (data and ACK
+ *     frames only): frames for other nodes never raise an interrupt, and frame_check_header() repeats the checks in software when the filter
+ *     is off. With CONFIG_PAIRING (pairing.c) an unpaired master is on the broadcast PAN (0xFFFF) and answers a broadcast poll with
+ *     probability 1/2, so that masters powered up together do not always collide; it binds to the first slave it answers. That slave then
+ *     polls it directly, which pairs the master: the slave is stored in flash and never released, and the master moves to the PAN of the
+ *     pair (its own short address), where the DW IC drops the frames of other pairs. Only the broadcast PAN polls of unpaired slaves still
+ *     get through, the source check drops them. Responses and reports go on the PAN of the poll, the broadcast PAN until the slave has
+ *     paired too. Without CONFIG_PAIRING every node is on CONFIG_PAN_ID, the master binds to the source of the first poll until that slave is
+ *     lost, and nothing keeps pairs sharing a channel apart. A push sets the acknowledgement request bit and is sent with the receiver
+ *     following it, so the slave's DW IC answers with a 5 byte ACK of the same sequence number without any MCU work on the slave; the ACK
+ *     ends the push retries (ARQ_PUSH_ACK_MS), and the poll the slave sends next remains a second acknowledgement when the ACK is lost.
+ * 22. With CONFIG_TDMA the master serves up to TDMA_MAX_SLAVES slaves in a superframe: beacon, TDMA_FIRST_SLOT_US for the slaves to
+ *     arm their poll, the join slot, one TDMA_SLOT_US slot per registered slave and TDMA_LAUNCH_US left for arming the next beacon. The
+ *     registry (tdma.c) is keyed by short address, a poll from an unknown slave takes the lowest free slot and the slot is freed after
+ *     TDMA_EXPIRE_SUPERFRAMES without a poll; the superframe shrinks to the highest slot in use. The beacon lists the owner of each
+ *     slot and is sent with a reference time TX (dwt_setreferencetrxtime() + DWT_START_TX_DLY_REF) exactly one superframe after the
+ *     previous one, the slaves time their poll from its RX timestamp (DWT_START_TX_DLY_RS), so both sides count on DW IC clocks and
+ *     the MCU latency only has to fit in the guards. Polls are answered as before, with the response and report addressed to the
+ *     polling slave; the feedback LEDs follow the last slave polled. Push commands are not available, the next slot of each slave
+ *     delivers the command within one superframe. At the defaults netsim gives 108 exchanges/s with one slave and 780/s (24 per slave)
+ *     with 32, no radio losses. The per exchange UART lines, about 3.5 ms each at 115200 baud, make a slave skip every other 4.5 ms
+ *     superframe and make the master late for its beacons; with RANGING_LOG compiled out one slave reaches 214 exchanges/s.
+ * 23. With CONFIG_MULTI_RESPONDER several masters range with one slave from a single poll. The poll goes to the broadcast address
+ *     with the slave's responder table (bytes 21 onwards, MULTI_RESP_MAX short addresses, FRAME_BROADCAST when free) and the
+ *     master in entry n sends its usual response n * MULTI_RESP_SLOT_UUS later than in single-responder mode, the delayed TX
+ *     timestamp it carries accounting for it. A master not listed answers in the slot after the table while an entry is free,
+ *     letting a random number of polls pass between tries so that two new masters do not keep colliding. Each response is a
+ *     complete SS-TWR reply, so the slave gets N distances from N + 1 frames instead of 2N; the responses are addressed to the
+ *     slave, so the frame filter of the other masters drops them. The slot length must cover a response frame plus the slave's RX
+ *     callback re-arming its receiver.
+ * 24. CONFIG_ALOHA keeps the beacon and timing of CONFIG_TDMA but replaces the slot table by a contention frame of ALOHA_SLOTS slots
+ *     (aloha.c). The beacon block is constant and staged once, the frame length is fixed at ALOHA_FRAME_US and nothing is registered, so
+ *     slaves can appear and leave from one frame to the next. Every poll received intact is answered in its slot, which is the slave's
+ *     acknowledgement; two polls in the same slot are lost together and both slaves back off. Tools/aloha_sim.c simulates the access
+ *     for a tag count and slot number: at the default 16 slots (18.5 ms frame) 16 slaves each range about 18 times a second with 59% of
+ *     the polls answered, and past about 32 slaves the frame carries at most about 6 exchanges (16/e) shared between them.
  ****************************************************************************************************************************************************/
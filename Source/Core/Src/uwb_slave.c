@@ -11,15 +11,55 @@
 #include <uwb_slave.h>
 #include "main.h"
 #include "error_led.h"
+#include "uwb_events.h"
+#include "cycle_counter.h"
+#include "geofence.h"
+#include "failsafe.h"
+#include "frame_codec.h"
+#include "output_channels.h"
+#include "arq.h"
+#include "tdma.h"
+#include "aloha.h"
+#include "pairing.h"
 
-double calculate_distance(void);
-void control_relays(RelayState r1State, RelayState r2State);
-OutputStatus get_current_output_status();
+/* Between exchanges the receiver stays open for pushed commands or TDMA beacons */
+#if defined(CONFIG_PUSH_COMMANDS) || defined(CONFIG_TDMA)
+#define SLAVE_LISTENS
+#endif
+
+void control_relays(uint32_t state, uint32_t mask);
+static void send_poll(void);
+static int resend_poll(uint32_t backoff_us);
+static void exchange_failed(void);
+static int send_final(const dwt_rangingsnapshot_t *snapshot);
+static void process_response(void);
+static void apply_geofence_state(GeofenceState state);
+static uint32_t apply_command(const OutputMsg *command);
+static void set_master_address(uint16_t address);
+#ifdef CONFIG_PAIRING
+static void pair_with_master(void);
+#endif
+#ifdef CONFIG_PUSH_COMMANDS
+static int process_push(void);
+#endif
+#ifdef SLAVE_LISTENS
+static void start_listen(void);
+static void stop_listen(void);
+#endif
+static void rx_ok_cb(const dwt_cb_data_t *cb_data);
+#ifdef CONFIG_PUSH_COMMANDS
+static void tx_done_cb(const dwt_cb_data_t *cb_data);
+#endif
+static void rx_err_cb(const dwt_cb_data_t *cb_data);
 
 /* Default communication configuration. We use default non-STS DW mode. */
 static dwt_config_t config = {
         5,               /* Channel number. */
+#ifdef CONFIG_HIGH_RATE_RANGING
+        DWT_PLEN_64,     /* Preamble length. Used in TX only. Shortest supported, see NOTE 15 below. */
+#else
         DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+#endif
         DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
         9,               /* TX preamble code. Used in TX only. */
         9,               /* RX preamble code. Used in RX only. */
@@ -27,43 +67,76 @@ static dwt_config_t config = {
         DWT_BR_6M8,      /* Data rate. */
         DWT_PHRMODE_STD, /* PHY header mode. */
         DWT_PHRRATE_STD, /* PHY header rate. */
+#ifdef CONFIG_HIGH_RATE_RANGING
+        (65 + 8 - 8),    /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+#else
         (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+#endif
         DWT_STS_MODE_OFF, /* STS disabled */
         DWT_STS_LEN_64,/* STS length see allowed values in Enum dwt_sts_lengths_e */
         DWT_PDOA_M0      /* PDOA mode off */
 };
 
 /* Inter-ranging delay period, in milliseconds. */
+#ifdef CONFIG_HIGH_RATE_RANGING
+#define RNG_DELAY_MS RNG_HIGH_RATE_PERIOD_MS
+#else
 #define RNG_DELAY_MS 1000
+#endif
 
 /* Default antenna delay values for 64 MHz PRF. See NOTE 2 below. */
 #define TX_ANT_DLY 16385
 #define RX_ANT_DLY 16385
 
-#define RX_PARAM_IDX 8
-#define RX_PREFIX_LEN 8
-#define RX_SUFFIX_LEN 11
-static const uint8_t rx_prefix[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'E', 'S', 'D'};
-static const uint8_t rx_suffix = 0xE1;
-
-#define TX_PARAM_IDX 8
+/* Function codes of the single-sided and of the double-sided exchange. See NOTE 14 below. */
+#define POLL_FUNC_CODE 0xE0
+#define RESP_FUNC_CODE 0xE1
+#define DS_POLL_FUNC_CODE 0xE2
+#define FINAL_FUNC_CODE 0xE3
+#define REPORT_FUNC_CODE 0xE4
+/* Function code of a command pushed by the master between exchanges. See NOTE 18 below. */
+#define PUSH_FUNC_CODE 0xE5
+/* Function code of the TDMA superframe beacon. See NOTE 23 below. */
+#define BEACON_FUNC_CODE 0xE6
 
-/* Frames used in the ranging process. See NOTE 3 below. */
-static uint8_t tx_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 'B', 'I', 'T', 'R', 0xE0, 0, 0};
+/* Frames used in the ranging process, staged once in the DW IC TX buffer and patched in place. The PAN ID and
+ * addresses are filled in by frame_stage() and frame_set_dest(). See NOTE 3, 19 and 22 below. */
+#ifdef CONFIG_MULTI_RESPONDER
+/* Responder table after the parameter, patched in by send_poll() before the first poll. See NOTE 24 below. */
+#define POLL_MSG_RESPONDERS_IDX 21
+#define POLL_MSG_LEN (POLL_MSG_RESPONDERS_IDX + 2 * MULTI_RESP_MAX + FRAME_FCS_LEN)
+static const uint8_t tx_poll_msg[POLL_MSG_LEN] = {0x41, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 0, 0, POLL_FUNC_CODE};
+#else
+static const uint8_t tx_poll_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 0, 0, POLL_FUNC_CODE, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+#endif
+static const uint8_t tx_final_msg[] = {0x41, 0x88, 0, 0xCA, 0xDE, 0xFF, 0xFF, 0, 0, FINAL_FUNC_CODE, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static const FrameSlot poll_slot = {0, sizeof(tx_poll_msg), 1};
+static const FrameSlot final_slot = {64, sizeof(tx_final_msg), 1}; /* Clear of the longest poll */
+/* Function code, output block and parameter currently in the staged poll (bytes 9 to 20) */
+#define POLL_FIELDS_LEN (2 + OUTPUT_MSG_LEN)
+static uint8_t poll_fields[POLL_FIELDS_LEN];
 
-/* Length of the common part of the message (up to and including the function code, see NOTE 3 below). */
-#define ALL_MSG_COMMON_LEN 10
-/* Indexes to access some of the fields in the frames defined above. */
-#define ALL_MSG_SN_IDX 2
+/* Indexes to access some of the fields in the frames defined above, after the common header (FRAME_HDR_LEN). */
 #define RESP_MSG_POLL_RX_TS_IDX 10
 #define RESP_MSG_RESP_TX_TS_IDX 14
 #define RESP_MSG_TS_LEN 4
+#define FINAL_MSG_POLL_TX_TS_IDX 10
+#define FINAL_MSG_RESP_RX_TS_IDX 14
+#define FINAL_MSG_FINAL_TX_TS_IDX 18
+#define REPORT_MSG_DIST_IDX 10
+#define RESP_MSG_OUTPUT_IDX 18
+#define PUSH_MSG_OUTPUT_IDX 10
+#define POLL_MSG_STATUS_IDX 20
 /* Frame sequence number, incremented after each transmission. */
 static uint8_t frame_seq_nb = 0;
 
 /* Buffer to store received response message.
  * Its size is adjusted to longest frame that this example code is supposed to handle. */
-#define RX_BUF_LEN 20
+#ifdef CONFIG_TDMA
+#define RX_BUF_LEN (FRAME_HDR_LEN + TDMA_BEACON_LEN + FRAME_FCS_LEN)
+#else
+#define RX_BUF_LEN 30
+#endif
 static uint8_t rx_buffer[RX_BUF_LEN];
 
 /* Hold copy of status register state here for reference so that it can be examined at a debug breakpoint. */
@@ -73,13 +146,140 @@ static uint32_t status_reg = 0;
 #define POLL_TX_TO_RESP_RX_DLY_UUS 240
 /* Receive response timeout. See NOTE 5 below. */
 #define RESP_RX_TIMEOUT_UUS 210
+/* Receive window of the poll, covering every responder slot. See NOTE 24 below. */
+#ifdef CONFIG_MULTI_RESPONDER
+#define RESP_RX_WINDOW_UUS (RESP_RX_TIMEOUT_UUS + MULTI_RESP_MAX * MULTI_RESP_SLOT_UUS)
+#else
+#define RESP_RX_WINDOW_UUS RESP_RX_TIMEOUT_UUS
+#endif
+/* Response RX to final TX delay in DS-TWR, the same turn-around as the master's response. See NOTE 14 below. */
+#define RESP_RX_TO_FINAL_TX_DLY_UUS 450
+
+static int32_t distance_to_master;
+/* Workable range in millimetres. If the master goes beyond this, the slave will turn off all outputs. See NOTE 16 below. */
+#define ACCEPTABLE_RANGE_MM 1000
+#define RANGE_HYSTERESIS_MM 100          /* The master must come back within ACCEPTABLE_RANGE_MM - RANGE_HYSTERESIS_MM */
+#define RANGE_VALIDATION_TIMEOUT_MS 2000 /* Time the master must stay out of range before the outputs are turned off */
+#define MASTER_LOST_TIMEOUT_MS (2 * RNG_DELAY_MS) /* Time without a valid range before the master is considered lost */
+
+static const GeofenceConfig geofence_config = {
+  ACCEPTABLE_RANGE_MM,
+  ACCEPTABLE_RANGE_MM - RANGE_HYSTERESIS_MM,
+  RANGE_VALIDATION_TIMEOUT_MS,
+  MASTER_LOST_TIMEOUT_MS
+};
+static Geofence geofence;
+
+/* Retransmission and sequence number state of the link with the master. See NOTE 21 below. */
+static ArqLink master_link;
+
+#ifdef CONFIG_MULTI_RESPONDER
+/* Masters answering the poll, entry n answers in slot n. Updated by the callbacks while a poll is answered, read by the
+ * main loop in between. See NOTE 24 below. */
+typedef struct
+{
+  uint16_t address;   /* FRAME_BROADCAST when the entry is free */
+  uint8_t misses;     /* Polls in a row without a response, 0 if the last one was answered */
+  uint8_t heard;      /* Answered the poll in progress */
+  int32_t distance;   /* Millimetres, from the last response */
+} Responder;
+
+#define MULTI_POLL_DATA_UUS 50    /* Poll RMARKER to the end of its payload, the TX timestamp is taken at the RMARKER */
+#define MULTI_REARM_MIN_UUS 20    /* Less than this left of the response window is not worth re-arming for */
+static Responder responders[MULTI_RESP_MAX];
+static uint8_t responders_changed = 1;
+static uint8_t master_heard = 0;
+static void multi_response(const dwt_rangingsnapshot_t *snapshot, uint32_t length);
+static void multi_rearm(uint32_t timed_out);
+#endif
+
+/* Master this slave ranges with, taken from the first valid response and released when the master is lost, or the
+ * paired master, never released. Written by the main loop only. See NOTE 22 below. */
+static volatile uint16_t master_address = FRAME_BROADCAST;
+#ifdef CONFIG_PAIRING
+static uint8_t paired = 0;
+#endif
+static volatile uint16_t resp_source;  /* Source address of the last valid response */
+
+/* Initiator states, advanced from the DW IC event callbacks. See NOTE 8 below. */
+typedef enum
+{
+  SLAVE_IDLE,         /* Waiting for the next ranging period */
+  SLAVE_AWAIT_RESP,   /* Poll sent, receiver armed for the response */
+  SLAVE_AWAIT_REPORT, /* DS-TWR final sent, receiver armed for the distance report */
+  SLAVE_LISTEN        /* Between exchanges, sniff receiver armed for a pushed command */
+} SlaveState;
+
+/* Outcome of the last exchange, set by the callbacks and consumed by the main loop */
+typedef enum
+{
+  RANGING_NONE,
+  RANGING_OK,
+  RANGING_FAIL
+} RangingEvent;
+
+static volatile SlaveState slave_state = SLAVE_IDLE;
+static volatile RangingEvent ranging_event = RANGING_NONE;
+static OutputMsg resp_command;   /* Output block of the last response, written by the RX callback */
+static volatile uint8_t resp_fresh = 0; /* The response was new, not a duplicate or stale frame */
+static uint32_t applied_channels = 0; /* Channels of the last command that were applied, reported in the next poll */
+
+#ifdef CONFIG_RANGING_DS_TWR
+static volatile RangingMode ranging_mode = RANGING_DS_TWR;
+#else
+static volatile RangingMode ranging_mode = RANGING_SS_TWR;
+#endif
+/* Mode of the exchange in progress, latched when the poll is sent */
+static RangingMode exchange_mode = RANGING_SS_TWR;
+
+#ifdef CONFIG_PUSH_COMMANDS
+/* Command pushed by the master, set by the RX callback and consumed by the main loop. See NOTE 18 below. */
+static volatile uint8_t push_event = 0;
+static OutputMsg push_command;
+static volatile uint8_t push_duplicate = 0;
+static volatile uint32_t push_rx_cycles;
+static volatile uint8_t ack_pending = 0;  /* The DW IC is sending the acknowledgement of a push. See NOTE 22 below. */
+#endif
+
+#ifdef CONFIG_TDMA
+/* Slot given by the last beacon, set by the RX callback and consumed by the main loop. See NOTE 23 below. */
+#define TDMA_JOIN_SPREAD_MAX 64  /* Cap of the join backoff, in superframes */
+static volatile uint8_t beacon_event = 0;
+static volatile uint32_t slot_offset_us;  /* Beacon RX to the start of the slot */
+#ifdef CONFIG_ALOHA
+static AlohaTag aloha;                    /* Contention slot and backoff. See NOTE 25 below. */
+#else
+static uint8_t join_skip = 0;             /* Beacons to let pass before the next join attempt */
+static uint8_t join_spread = 2;           /* The next attempt is in one of this many superframes, doubled per attempt */
+#endif
+#endif
 
-static double distance_to_master;
-/* Workable range in meters. If the master goes beyond this, the slave will turn off all outputs */
-#define ACCEPTABLE_RANGE_M 1.0
-#define RANGE_VALIDATION_TIMEOUT_MS 2000 /* Poll time in milliseconds to detect if the master is out of range */
 
-static uint8_t detection_counter = 0;
+#ifdef CONFIG_HIGH_RATE_RANGING
+/* High-rate benchmark, cycle counts summed over the successful exchanges of one report period. See NOTE 15 below. */
+#define RATE_BENCH_REPORT_MS 1000
+#define RATE_BENCH_MARK(var) ((var) = cycle_counter_read())
+
+typedef struct
+{
+  uint32_t polls;
+  uint32_t ok;
+  uint32_t fail;
+  uint32_t setup_cycles;    /* send_poll() up to the TX start */
+  uint32_t air_cycles;      /* TX start up to the RX callback completing the exchange */
+  uint32_t cb_cycles;       /* inside that RX callback */
+  uint32_t decision_cycles; /* RX callback exit up to the relays being driven by the main loop */
+} RateBench;
+
+static RateBench rate_bench;
+static uint32_t rate_setup_start, rate_tx_start;
+static volatile uint32_t rate_cb_start, rate_cb_end;
+
+static void rate_bench_exchange(RangingEvent event);
+static void rate_bench_report(uint32_t period_ms);
+#else
+#define RATE_BENCH_MARK(var)
+#endif
 
 /* Values for the PG_DELAY and TX_POWER registers reflect the bandwidth and power of the spectrum at the current
  * temperature. These values can be calibrated prior to taking reference measurements. See NOTE 2 below. */
@@ -114,6 +314,10 @@ int uwb_slave(void)
     { };
   }
 
+#ifdef CONFIG_DWIC_REG_SHADOW
+  dwt_setregshadow(1);
+#endif
+
   /* Enabling LEDs here for debug so that for each TX the D1 LED will flash on DW3000 red eval-shield boards. */
   dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK) ;
 
@@ -132,201 +336,914 @@ int uwb_slave(void)
   dwt_setrxantennadelay(RX_ANT_DLY);
   dwt_settxantennadelay(TX_ANT_DLY);
 
+  /* Short address hashed from the MCU unique ID, the DW IC drops frames for other nodes, and once paired for other
+   * pairs, and acknowledges pushes itself. See NOTE 22 below. */
+#ifdef CONFIG_PAIRING
+  uint16_t pan_id = FRAME_BROADCAST;
+  uint16_t peer;
+
+  if (pairing_clear_requested() && pairing_store(PAIRING_NONE))
+  {
+    printf("Pairing cleared\r\n");
+  }
+  peer = pairing_load();
+  paired = (peer != PAIRING_NONE);
+  if (paired)
+  {
+    pan_id = pairing_pan_id(peer);
+  }
+#else
+  uint16_t pan_id = CONFIG_PAN_ID;
+#endif
+  frame_set_address(pan_id, port_get_short_address());
+#ifdef CONFIG_FRAME_FILTERING
+  dwt_setpanid(pan_id);
+  dwt_setaddress16(frame_get_address());
+  dwt_configureframefilter(DWT_FF_ENABLE_802_15_4, DWT_FF_DATA_EN);
+  dwt_enableautoack(0, 1);
+#endif
+  printf("Slave address 0x%04X, PAN 0x%04X\r\n", frame_get_address(), pan_id);
+
   /* Set expected response's delay and timeout. See NOTE 1 and 5 below.
     * As this example only handles one incoming frame with always the same delay and timeout, those values can be set here once for all. */
   dwt_setrxaftertxdelay(POLL_TX_TO_RESP_RX_DLY_UUS);
-  dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS);
+  dwt_setrxtimeout(RESP_RX_WINDOW_UUS);
 
   /* Next can enable TX/RX states output on GPIOs 5 and 6 to help debug, and also TX/RX LEDs
     * Note, in real low power applications the LEDs should not be used. */
   dwt_setlnapamode(DWT_LNA_ENABLE | DWT_PA_ENABLE);
 
+  output_channels_init();
+#ifdef CONFIG_MULTI_RESPONDER
+  for (uint8_t i = 0; i < MULTI_RESP_MAX; i++)
+  {
+    responders[i].address = FRAME_BROADCAST;
+  }
+#endif
+
+  /* Constant parts of the frames go to the TX buffer once, only the changing bytes are written per exchange */
+  frame_stage(&poll_slot, tx_poll_msg);
+  frame_stage(&final_slot, tx_final_msg);
+#ifdef CONFIG_PAIRING
+  if (paired)
+  {
+    set_master_address(peer);
+    printf("Paired with master 0x%04X, PAN 0x%04X\r\n", peer, pan_id);
+  }
+#endif
+
+  /* Install the event callbacks and unmask the DW IC interrupts. See NOTE 8 below. */
+#ifdef CONFIG_PUSH_COMMANDS
+  uwb_events_init(tx_done_cb, rx_ok_cb, rx_err_cb, rx_err_cb);
+#else
+  uwb_events_init(NULL, rx_ok_cb, rx_err_cb, rx_err_cb);
+#endif
+
+#ifndef CONFIG_TDMA
+  uint32_t last_poll_tick = HAL_GetTick() - RNG_DELAY_MS;
+#endif
+  GeofenceState geofence_state;
+
+  geofence_init(&geofence, &geofence_config, HAL_GetTick());
+  geofence_state = geofence.state;
+
+  /* The unique ID seeds the backoff so that two slaves failing together retry at different times */
+  arq_init(&master_link, ARQ_MAX_RETRIES, HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2());
+#ifdef CONFIG_ALOHA
+  aloha_init(&aloha, HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2());
+#endif
+
+  /* Hardware backstop for the geofence, armed by the first in-range exchange. See NOTE 17 below. */
+  FailsafeStats failsafe_state;
+  uint32_t failsafe_trips = 0;
+
+  failsafe_init(CONFIG_FAILSAFE_TIMEOUT_MS);
+
+#ifdef CONFIG_HIGH_RATE_RANGING
+  uint32_t last_report_tick = HAL_GetTick();
+
+  cycle_counter_init();
+  printf("rate_bench,period_ms,exchanges_per_s,ok,fail,success_pct,setup_us,air_us,cb_us,decision_us\r\n");
+#endif
+
   /* Loop forever initiating ranging exchanges. */
   while (1)
   {
-    /* Embed the feedback parameter to the tx buffer */
-    if (distance_to_master > ACCEPTABLE_RANGE_M)
+    if (ranging_event != RANGING_NONE)
     {
-      tx_poll_msg[TX_PARAM_IDX] = OUT_OF_RANGE_CODE;
+      if (ranging_event == RANGING_OK)
+      {
+        process_response();
+      }
+      else
+      {
+        RANGING_LOG("\rExchange failed, ARQ retries: %lu, recovered: %lu, dropped: %lu, duplicates: %lu, stale: %lu\n",
+                    (unsigned long)master_link.stats.retries, (unsigned long)master_link.stats.recovered,
+                    (unsigned long)master_link.stats.dropped, (unsigned long)master_link.stats.duplicates,
+                    (unsigned long)master_link.stats.stale);
+#ifdef CONFIG_ALOHA
+        RANGING_LOG("\rALOHA attempts: %lu, acknowledged: %lu, backoff window: %u frames\n",
+                    (unsigned long)aloha.stats.attempts, (unsigned long)aloha.stats.successes, aloha.window);
+#endif
+      }
+#ifdef CONFIG_ALOHA
+      /* The response is the acknowledgement of the contention slot */
+      aloha_result(&aloha, ranging_event == RANGING_OK);
+#endif
+#ifdef CONFIG_HIGH_RATE_RANGING
+      rate_bench_exchange(ranging_event);
+#endif
+      ranging_event = RANGING_NONE;
     }
-    else
+
+#ifdef CONFIG_PUSH_COMMANDS
+    if (push_event)
     {
-      tx_poll_msg[TX_PARAM_IDX] = (uint8_t)get_current_output_status();
+      push_event = 0;
+      if (process_push())
+      {
+        last_poll_tick = HAL_GetTick() - RNG_DELAY_MS; /* Range now so the master sees the new outputs */
+      }
     }
+#endif
 
-    /* Write frame data to DW IC and prepare transmission. See NOTE 7 below. */
-    tx_poll_msg[ALL_MSG_SN_IDX] = frame_seq_nb;
-    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS_BIT_MASK);
-    dwt_writetxdata(sizeof(tx_poll_msg), tx_poll_msg, 0); /* Zero offset in TX buffer. */
-    dwt_writetxfctrl(sizeof(tx_poll_msg), 0, 1); /* Zero offset in TX buffer, ranging. */
+    /* Time bound decisions: out of range and lost are declared even if no frame comes in */
+    if (geofence_tick(&geofence, HAL_GetTick()) != geofence_state)
+    {
+      geofence_state = geofence.state;
+      apply_geofence_state(geofence_state);
+    }
 
-    /* Start transmission, indicating that a response is expected so that reception is enabled automatically after the frame is sent and the delay
-      * set by dwt_setrxaftertxdelay() has elapsed. */
-    dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+    /* The supervisor has already cut the relays, only report it */
+    failsafe_stats(&failsafe_state);
+    if (failsafe_state.trips != failsafe_trips)
+    {
+      failsafe_trips = failsafe_state.trips;
+      printf("\rFail-safe cut the relays %lu us after the last valid range (worst %lu us)\n",
+             (unsigned long)failsafe_state.lastCutoffUs, (unsigned long)failsafe_state.maxCutoffUs);
+      errorLedOn();
+    }
 
-    /* We assume that the transmission is achieved correctly, poll for reception of a frame or error/timeout. See NOTE 8 below. */
-    while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR)))
-    { };
+#ifdef CONFIG_TDMA
+    /* Start an exchange in the slot given by the last beacon. See NOTE 23 below. */
+    if (beacon_event)
+    {
+      beacon_event = 0;
+      stop_listen();
+      send_poll();
+    }
+#else
+    /* Start an exchange once per ranging period */
+    if ((slave_state == SLAVE_IDLE || slave_state == SLAVE_LISTEN) && (HAL_GetTick() - last_poll_tick) >= RNG_DELAY_MS)
+    {
+#ifdef CONFIG_PUSH_COMMANDS
+      stop_listen();
+#endif
+      last_poll_tick = HAL_GetTick();
+      send_poll();
+    }
+#endif
+#ifdef SLAVE_LISTENS
+    else if (slave_state == SLAVE_IDLE)
+    {
+      start_listen();
+    }
+#endif
+
+#ifdef CONFIG_HIGH_RATE_RANGING
+    if ((HAL_GetTick() - last_report_tick) >= RATE_BENCH_REPORT_MS)
+    {
+      rate_bench_report(HAL_GetTick() - last_report_tick);
+      last_report_tick = HAL_GetTick();
+    }
+#endif
+
+    uwb_events_dispatch();
+  }
+}
+
+static void send_poll(void)
+{
+  uint8_t fields[POLL_FIELDS_LEN];
+  OutputMsg status;
+
+  RATE_BENCH_MARK(rate_setup_start);
 
-    /* Increment frame sequence number after transmission of the poll message (modulo 256). */
-    frame_seq_nb++;
+  /* The poll function code tells the master which exchange follows */
+#ifdef CONFIG_MULTI_RESPONDER
+  exchange_mode = RANGING_SS_TWR; /* Each response is a complete SS-TWR reply. See NOTE 24 below. */
+#else
+  exchange_mode = ranging_mode;
+#endif
+  fields[0] = (exchange_mode == RANGING_DS_TWR) ? DS_POLL_FUNC_CODE : POLL_FUNC_CODE;
 
-    if (status_reg & SYS_STATUS_RXFCG_BIT_MASK)
+  /* Actual outputs and the acknowledgement of the last command. See NOTE 20 below. */
+  status.channels = output_channels_count();
+  status.state = output_channels_read();
+  status.mask = applied_channels;
+  output_msg_encode(&fields[1], &status);
+
+  /* Embed the feedback parameter to the tx buffer */
+  if (geofence.state == GEOFENCE_SUSPECT || geofence.state == GEOFENCE_OUT_OF_RANGE)
+  {
+    fields[POLL_MSG_STATUS_IDX - FRAME_FUNC_IDX] = OUT_OF_RANGE_CODE;
+  }
+  else
+  {
+    fields[POLL_MSG_STATUS_IDX - FRAME_FUNC_IDX] = 0;
+  }
+
+  /* Patch the staged poll, function code, outputs and parameter only when they changed. See NOTE 19 below. */
+  if (memcmp(fields, poll_fields, sizeof(fields)) != 0)
+  {
+    frame_patch(&poll_slot, FRAME_FUNC_IDX, fields, sizeof(fields));
+    memcpy(poll_fields, fields, sizeof(fields));
+  }
+#ifdef CONFIG_MULTI_RESPONDER
+  if (responders_changed)
+  {
+    uint8_t table[2 * MULTI_RESP_MAX];
+    uint8_t i;
+
+    for (i = 0; i < MULTI_RESP_MAX; i++)
     {
-      uint32_t frame_len;
+      table[2 * i] = (uint8_t)responders[i].address;
+      table[2 * i + 1] = (uint8_t)(responders[i].address >> 8);
+    }
+    frame_patch(&poll_slot, POLL_MSG_RESPONDERS_IDX, table, sizeof(table));
+    responders_changed = 0;
+  }
+#endif
+  frame_set_byte(&poll_slot, FRAME_SN_IDX, frame_seq_nb);
+  frame_select(&poll_slot);
 
-      /* Clear good RX frame event in the DW IC status register. */
-      dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG_BIT_MASK);
+  /* Start transmission, indicating that a response is expected so that reception is enabled automatically after the frame is sent and the delay
+    * set by dwt_setrxaftertxdelay() has elapsed. The response, timeout or error is reported through the callbacks. */
+  slave_state = SLAVE_AWAIT_RESP;
+#ifdef CONFIG_TDMA
+  /* Slot start counted from the beacon RX timestamp, still in RX_TIME as the receiver was left off since */
+  dwt_setdelayedtrxtime((uint32_t)(((uint64_t)slot_offset_us * UUS_TO_DWT_TIME) >> 8));
+  if (dwt_starttx(DWT_START_TX_DLY_RS | DWT_RESPONSE_EXPECTED) != DWT_SUCCESS)
+  {
+    ranging_event = RANGING_FAIL; /* Slot missed, the next beacon gives another one */
+    slave_state = SLAVE_IDLE;
+    return;
+  }
+#else
+  dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+#endif
+  RATE_BENCH_MARK(rate_tx_start);
 
-      /* A frame has been received, read it into the local buffer. */
-      frame_len = dwt_read32bitreg(RX_FINFO_ID) & RXFLEN_MASK;
-      if (frame_len <= sizeof(rx_buffer))
-      {
-        dwt_readrxdata(rx_buffer, frame_len, 0);
+  /* Increment frame sequence number after transmission of the poll message (modulo 256). */
+  frame_seq_nb++;
+}
 
-        /* Check that the frame is the expected response from the companion "SS TWR responder" example.
-          * As the sequence number field of the frame is not relevant, it is cleared to simplify the validation of the frame. */
-        rx_buffer[ALL_MSG_SN_IDX] = 0;
+/* Sends the staged poll again, sequence number included, backoff_us UWB microseconds from now. Runs from the callbacks,
+ * the poll slot is left untouched by the final so the frame is still in place. See NOTE 21 below. */
+static int resend_poll(uint32_t backoff_us)
+{
+  frame_select(&poll_slot);
+  dwt_setdelayedtrxtime(dwt_readsystimestamphi32() + (uint32_t)(((uint64_t)backoff_us * UUS_TO_DWT_TIME) >> 8));
 
-        if (memcmp(rx_buffer, rx_prefix, RX_PREFIX_LEN) == 0 &&
-            rx_buffer[ALL_MSG_COMMON_LEN - 1] == rx_suffix)
-        {
-          detection_counter = 0; /* Reset the detection counter */
+  slave_state = SLAVE_AWAIT_RESP;
+  return dwt_starttx(DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED);
+}
 
-          distance_to_master = calculate_distance();
-          printf("\rDistance: %f, param: %c\n", distance_to_master, rx_buffer[RX_PARAM_IDX]);
+/* A response or report did not come or was not valid: retry the exchange after a random backoff while retries are
+ * left, otherwise report the failure to the main loop */
+static void exchange_failed(void)
+{
+#ifndef CONFIG_TDMA
+  /* With TDMA a retry would land in another slave's slot, the next superframe is the retry */
+  while (arq_retry(&master_link))
+  {
+    if (resend_poll(arq_backoff_us(&master_link, ARQ_BACKOFF_MIN_US, ARQ_BACKOFF_SPAN_US)) == DWT_SUCCESS)
+    {
+      return;
+    }
+  }
+#endif
 
-          if (distance_to_master > ACCEPTABLE_RANGE_M)
-          {
-            errorLedBlink();
+  ranging_event = RANGING_FAIL;
+  slave_state = SLAVE_IDLE;
+}
 
-            uint32_t tick_start = HAL_GetTick();
-            uint8_t should_skip = 0;
-            while (calculate_distance() > ACCEPTABLE_RANGE_M) /* Poll until the master is out of range */
-            {
-              /* Poll until detection_timeout and turn off all relays if master is still out of range */
-              if ((HAL_GetTick() - tick_start) >= RANGE_VALIDATION_TIMEOUT_MS)
-              {
-                /* Master is out of range */
-                printf("\rMaster is out of range! Turning off all relays.\n");
-                control_relays(RELAY_OFF, RELAY_OFF);
-
-                should_skip = 1;
-                break; /* Exit the loop */
-              }
-
-              Sleep(RNG_DELAY_MS); /* Execute a delay between ranging exchanges. */
-            }
+#ifdef CONFIG_MULTI_RESPONDER
+/* A response to the poll in progress: the distance goes to the responder's entry, a master answering in the join slot
+ * takes the first free one. The bound master, or the first to answer while unbound, also gives the geofence range and
+ * the command. See NOTE 24 below. */
+static void multi_response(const dwt_rangingsnapshot_t *snapshot, uint32_t length)
+{
+  uint16_t source = frame_get_source(rx_buffer);
+  Responder *entry = NULL;
+  uint8_t i;
 
-            if (should_skip) continue; /* Continue to the next iteration */
-          }
+  if (length < RESP_MSG_OUTPUT_IDX + OUTPUT_MSG_LEN + FRAME_FCS_LEN ||
+      frame_read_payload(rx_buffer, sizeof(rx_buffer), length) != DWT_SUCCESS)
+  {
+    return;
+  }
 
-          errorLedOff();
+  for (i = 0; i < MULTI_RESP_MAX && entry == NULL; i++)
+  {
+    if (responders[i].address == source)
+    {
+      entry = &responders[i];
+    }
+  }
+  for (i = 0; i < MULTI_RESP_MAX && entry == NULL; i++)
+  {
+    if (responders[i].address == FRAME_BROADCAST)
+    {
+      entry = &responders[i];
+      entry->address = source;
+      entry->misses = 0;
+      responders_changed = 1;
+    }
+  }
+  if (entry == NULL)
+  {
+    return;
+  }
 
-          switch (rx_buffer[RX_PARAM_IDX] - '0') /* Converting char to int */
-          {
-            case ALL_OFF:
-              printf("\rAll relays are OFF\n");
-              control_relays(RELAY_OFF, RELAY_OFF);
-              break;
-            case REL_1_ON:
-              printf("\r1st relay is ON\n");
-              control_relays(RELAY_ON, RELAY_OFF);
-              break;
-            case REL_2_ON:
-              printf("\r2nd relay is ON\n");
-              control_relays(RELAY_OFF, RELAY_ON);
-              break;
-            case ALL_ON:
-              printf("\rAll relays are ON\n");
-              control_relays(RELAY_ON, RELAY_ON);
-              break;
-            default:
-              printf("\rInvalid parameter!\n");
-          }
-        }
-      }
+  entry->distance = calculate_distance(snapshot);
+  entry->heard = 1;
+
+  if (!master_heard && (master_address == FRAME_BROADCAST || source == master_address) &&
+      output_msg_decode(&rx_buffer[RESP_MSG_OUTPUT_IDX], &resp_command))
+  {
+    resp_fresh = (arq_receive(&master_link, rx_buffer[FRAME_SN_IDX]) == ARQ_NEW);
+    resp_source = source;
+    distance_to_master = entry->distance;
+    master_heard = 1;
+  }
+}
+
+/* Keeps the receiver on until the last responder slot of the poll is over, then ends the exchange: entries silent for
+ * MULTI_RESP_EXPIRE_POLLS polls are freed, and the exchange succeeds if the master giving the range answered. */
+static void multi_rearm(uint32_t timed_out)
+{
+  uint8_t ok = master_heard;
+  uint8_t i;
+
+  if (!timed_out)
+  {
+    uint32_t window_end = dwt_readtxtimestamphi32() +
+        (uint32_t)(((uint64_t)(MULTI_POLL_DATA_UUS + POLL_TX_TO_RESP_RX_DLY_UUS + RESP_RX_WINDOW_UUS) * UUS_TO_DWT_TIME) >> 8);
+    int32_t left = (int32_t)(window_end - dwt_readsystimestamphi32());
+
+    /* Both hi32 values count 256 DW IC ticks, the window is a few milliseconds so left * 256 fits */
+    if (left > 0 && (uint32_t)left * 256 / UUS_TO_DWT_TIME > MULTI_REARM_MIN_UUS)
+    {
+      dwt_setrxtimeout((uint32_t)left * 256 / UUS_TO_DWT_TIME);
+      dwt_rxenable(DWT_START_RX_IMMEDIATE);
+      return;
     }
-    else
+  }
+
+  for (i = 0; i < MULTI_RESP_MAX; i++)
+  {
+    Responder *entry = &responders[i];
+
+    if (entry->heard)
+    {
+      entry->misses = 0;
+    }
+    else if (entry->address != FRAME_BROADCAST && ++entry->misses >= MULTI_RESP_EXPIRE_POLLS)
     {
-      /* Clear RX error/timeout events in the DW IC status register. */
-      dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR);
+      entry->address = FRAME_BROADCAST;
+      responders_changed = 1;
     }
+    entry->heard = 0;
+  }
+  master_heard = 0;
+  dwt_setrxtimeout(RESP_RX_WINDOW_UUS);
+
+  if (ok)
+  {
+    arq_done(&master_link);
+    RATE_BENCH_MARK(rate_cb_end);
+    ranging_event = RANGING_OK;
+    slave_state = SLAVE_IDLE;
+    return;
+  }
+
+  exchange_failed();
+}
+#endif
+
+/* Feeds a valid range to the geofence, the master's relay command is only applied while in range. See NOTE 16 below. */
+static void process_response(void)
+{
+  /* The first master to answer is the one ranged with until it is lost */
+  if (master_address == FRAME_BROADCAST)
+  {
+    set_master_address(resp_source);
+    printf("\rRanging with master 0x%04X\n", resp_source);
+  }
+#ifdef CONFIG_PAIRING
+  else if (!paired)
+  {
+    pair_with_master(); /* It answered a poll addressed to it, so it has paired */
+  }
+#endif
 
-    if (detection_counter > 0) /* Unable to detect master */
+  RANGING_LOG("\rDistance: %ld mm, outputs: 0x%08lx\n", (long)distance_to_master, (unsigned long)resp_command.state);
+#ifdef CONFIG_MULTI_RESPONDER
+  for (uint8_t i = 0; i < MULTI_RESP_MAX; i++)
+  {
+    if (responders[i].address != FRAME_BROADCAST && responders[i].misses == 0)
     {
+      RANGING_LOG("\r  master 0x%04X: %ld mm\n", responders[i].address, (long)responders[i].distance);
+    }
+  }
+#endif
+
+  if (geofence_range(&geofence, distance_to_master, HAL_GetTick()) != GEOFENCE_IN_RANGE)
+  {
+    applied_channels = 0;
+    return;
+  }
+
+  failsafe_kick();
+
+  /* A duplicate or stale response still gives a valid range, only its command is not applied */
+  if (resp_fresh)
+  {
+    apply_command(&resp_command);
+  }
+}
+
+/* Addresses the poll and final to one master, or to all with FRAME_BROADCAST. See NOTE 22 below. */
+static void set_master_address(uint16_t address)
+{
+  decaIrqStatus_t stat = decamutexon();
+
+  master_address = address;
+#ifndef CONFIG_MULTI_RESPONDER
+  /* With several responders the poll stays broadcast */
+  frame_set_dest(&poll_slot, address);
+#endif
+  frame_set_dest(&final_slot, address);
+
+  decamutexoff(stat);
+}
+
+#ifdef CONFIG_PAIRING
+/* Keeps the master ranged with for good and moves to the PAN of the pair. See NOTE 22 below. */
+static void pair_with_master(void)
+{
+  uint16_t pan_id = pairing_pan_id(master_address);
+  decaIrqStatus_t stat;
+
+  paired = 1;
+  if (!pairing_store(master_address))
+  {
+    printf("\rPairing not stored, flash error\n");
+  }
+
+  stat = decamutexon();
+  frame_set_address(pan_id, frame_get_address());
+#ifdef CONFIG_FRAME_FILTERING
+  dwt_setpanid(pan_id);
+#endif
+  frame_set_pan(&poll_slot, pan_id);
+  frame_set_pan(&final_slot, pan_id);
+  decamutexoff(stat);
+  printf("\rPaired with master 0x%04X, PAN 0x%04X\n", master_address, pan_id);
+}
+#endif
+
+/* Drives the channels a command changes, as carried by a response or a push. See NOTE 20 below. The relays go before
+ * the log line, which blocks for some ms on the UART. Returns the cycle counter as they were driven. */
+static uint32_t apply_command(const OutputMsg *command)
+{
+  uint32_t driven;
+
+  control_relays(command->state, command->mask);
+  driven = cycle_counter_read();
+  applied_channels = command->mask;
+  if (command->mask)
+  {
+    RANGING_LOG("\rOutputs 0x%08lx, changed 0x%08lx\n", (unsigned long)command->state, (unsigned long)command->mask);
+  }
+  return driven;
+}
+
+#ifdef CONFIG_PUSH_COMMANDS
+/* Applies a pushed command if the last range is in range, the cycle counter is running from failsafe_init().
+ * Returns 1 if the command was applied. See NOTE 18 below. */
+static int process_push(void)
+{
+  uint32_t driven;
+
+  if (geofence.state != GEOFENCE_IN_RANGE)
+  {
+    RANGING_LOG("\rPushed command ignored, master not in range\n");
+    applied_channels = 0;
+    return 0;
+  }
+
+  /* The master repeats a push when no poll follows it, the command is already applied */
+  if (push_duplicate)
+  {
+    RANGING_LOG("\rPushed command repeated, polling again\n");
+    return 1;
+  }
+
+  driven = apply_command(&push_command);
+  RANGING_LOG("\rPushed command applied %lu us after RX\n",
+              (unsigned long)((driven - push_rx_cycles) / (SystemCoreClock / 1000000)));
+  (void)driven; /* Without RANGING_LOG */
+  return 1;
+}
+#endif
+
+#ifdef SLAVE_LISTENS
+/* Opens the low duty receive window for pushed commands or beacons: sniff mode, no frame timeout */
+static void start_listen(void)
+{
+  decaIrqStatus_t stat = decamutexon();
+
+  dwt_setrxtimeout(0);
+  dwt_setsniffmode(1, PUSH_SNIFF_ON_PAC, PUSH_SNIFF_OFF_US);
+  slave_state = SLAVE_LISTEN;
+  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+
+  decamutexoff(stat);
+}
+
+/* Closes the listen window and restores the full time receiver and the response timeout before a poll */
+static void stop_listen(void)
+{
+  decaIrqStatus_t stat = decamutexon();
+
+  if (slave_state == SLAVE_LISTEN)
+  {
+    dwt_forcetrxoff();
+    dwt_setsniffmode(0, 0, 0);
+    dwt_setrxtimeout(RESP_RX_WINDOW_UUS);
+    slave_state = SLAVE_IDLE;
+  }
+
+  decamutexoff(stat);
+}
+#endif
+
+/* Outputs and error LED on entering a geofence state */
+static void apply_geofence_state(GeofenceState state)
+{
+  switch (state)
+  {
+    case GEOFENCE_IN_RANGE:
+      errorLedOff();
+      break;
+    case GEOFENCE_SUSPECT:
+      errorLedBlink(); /* Outputs are held until the confirmation window expires */
+      break;
+    case GEOFENCE_OUT_OF_RANGE:
+      printf("\rMaster is out of range! Turning off all relays.\n");
+      control_relays(0, output_channels_all());
+      errorLedBlink();
+      break;
+    case GEOFENCE_LOST:
       printf("\rUnable to find the master module!\n");
-      control_relays(RELAY_OFF, RELAY_OFF); /* Turn off all relays */
+      control_relays(0, output_channels_all());
       errorLedOn();
+#ifdef CONFIG_PAIRING
+      if (!paired) /* A paired slave only ever polls its own master */
+#endif
+      {
+        set_master_address(FRAME_BROADCAST); /* Range with whichever master answers next */
+      }
+      break;
+  }
+}
+
+/* Runs from dwt_isr() on RXFCG. The timestamps and clock offset of this exchange are only valid until the next poll,
+ * so the distance (SS-TWR) or the final (DS-TWR) is handled here and the rest is left to the main loop. */
+static void rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+  dwt_rangingsnapshot_t snapshot;
+  uint32_t report_distance;
+  int func_code;
+#ifdef CONFIG_PUSH_COMMANDS
+  uint32_t rx_cycles = cycle_counter_read();
+#endif
+
+  RATE_BENCH_MARK(rate_cb_start);
+  status_reg = cb_data->status;
+
+#ifdef CONFIG_PUSH_COMMANDS
+  /* The DW IC answers a push with an ACK on its own, the receiver is re-armed once it is sent. See NOTE 22 below. */
+  if (cb_data->status & SYS_STATUS_AAT_BIT_MASK)
+  {
+    ack_pending = 1;
+  }
+#endif
+
+  if (cb_data->datalength >= FRAME_HDR_LEN + FRAME_FCS_LEN && cb_data->datalength <= sizeof(rx_buffer))
+  {
+    /* A frame has been received, read its header together with the timestamps and clock offset. The payload is
+     * only fetched by the branch that needs it. See NOTE 19 below. */
+    dwt_readrangingsnapshot(&snapshot, rx_buffer, FRAME_HDR_LEN);
+
+    /* Check that the frame is addressed to this node and, once bound, that it comes from the master ranged with */
+    func_code = frame_check_header(rx_buffer);
+#ifdef CONFIG_MULTI_RESPONDER
+    /* Every master in the responder table answers the poll */
+    if (func_code != FRAME_INVALID && func_code != RESP_FUNC_CODE && master_address != FRAME_BROADCAST &&
+        frame_get_source(rx_buffer) != master_address)
+#else
+    if (func_code != FRAME_INVALID && master_address != FRAME_BROADCAST && frame_get_source(rx_buffer) != master_address)
+#endif
+    {
+      func_code = FRAME_INVALID;
     }
 
-    detection_counter++;
+    if (func_code != FRAME_INVALID)
+    {
+#ifdef CONFIG_TDMA
+      if (slave_state == SLAVE_LISTEN && func_code == BEACON_FUNC_CODE &&
+          frame_read_payload(rx_buffer, sizeof(rx_buffer), cb_data->datalength) == DWT_SUCCESS)
+      {
+        uint32_t offset_us;
+#ifdef CONFIG_ALOHA
+        /* Random slot of the contention frame, unless backing off after a collision. See NOTE 25 below. */
+        if (aloha_beacon_access(&aloha, &rx_buffer[FRAME_HDR_LEN], cb_data->datalength - FRAME_HDR_LEN - FRAME_FCS_LEN,
+                                &offset_us) != ALOHA_NO_SLOT)
+        {
+          slot_offset_us = offset_us;
+          beacon_event = 1;
+          return; /* The receiver stays off, RX_TIME keeps the beacon timestamp for the poll */
+        }
+#else
+        int slot = tdma_beacon_find(&rx_buffer[FRAME_HDR_LEN], cb_data->datalength - FRAME_HDR_LEN - FRAME_FCS_LEN,
+                                    frame_get_address(), &offset_us);
+
+        /* Not listed yet: join now, and if that collides with another new slave, in a random one of the next
+         * join_spread superframes (binary exponential backoff) */
+        if (slot == TDMA_JOIN_SLOT && join_skip != 0)
+        {
+          join_skip--;
+        }
+        else if (slot != TDMA_NO_SLOT)
+        {
+          if (slot == TDMA_JOIN_SLOT)
+          {
+            join_skip = (uint8_t)arq_backoff_us(&master_link, 0, join_spread);
+            if (join_spread < TDMA_JOIN_SPREAD_MAX)
+            {
+              join_spread *= 2;
+            }
+          }
+          else
+          {
+            join_spread = 2;
+          }
+          slot_offset_us = offset_us;
+          beacon_event = 1;
+          return; /* The receiver stays off, RX_TIME keeps the beacon timestamp for the poll */
+        }
+#endif
+      }
+      else
+#endif
+#ifdef CONFIG_PUSH_COMMANDS
+      if (slave_state == SLAVE_LISTEN && func_code == PUSH_FUNC_CODE &&
+          cb_data->datalength >= PUSH_MSG_OUTPUT_IDX + OUTPUT_MSG_LEN + FRAME_FCS_LEN &&
+          frame_read_payload(rx_buffer, sizeof(rx_buffer), cb_data->datalength) == DWT_SUCCESS &&
+          output_msg_decode(&rx_buffer[PUSH_MSG_OUTPUT_IDX], &push_command))
+      {
+        /* A late or reordered push is dropped, a repeated one still gets a poll as its acknowledgement */
+        ArqVerdict verdict = arq_receive(&master_link, rx_buffer[FRAME_SN_IDX]);
+
+        if (verdict != ARQ_STALE)
+        {
+          push_duplicate = (verdict == ARQ_DUPLICATE);
+          push_rx_cycles = rx_cycles;
+          push_event = 1;
+        }
+      }
+      else
+#endif
+#ifdef CONFIG_MULTI_RESPONDER
+      if (slave_state == SLAVE_AWAIT_RESP && func_code == RESP_FUNC_CODE)
+      {
+        multi_response(&snapshot, cb_data->datalength);
+      }
+      else
+#endif
+      if (slave_state == SLAVE_AWAIT_RESP && func_code == RESP_FUNC_CODE &&
+          cb_data->datalength >= RESP_MSG_OUTPUT_IDX + OUTPUT_MSG_LEN + FRAME_FCS_LEN &&
+          frame_read_payload(rx_buffer, sizeof(rx_buffer), cb_data->datalength) == DWT_SUCCESS &&
+          output_msg_decode(&rx_buffer[RESP_MSG_OUTPUT_IDX], &resp_command))
+      {
+        resp_fresh = (arq_receive(&master_link, rx_buffer[FRAME_SN_IDX]) == ARQ_NEW);
+        resp_source = frame_get_source(rx_buffer);
+
+        if (exchange_mode == RANGING_SS_TWR)
+        {
+          distance_to_master = calculate_distance(&snapshot);
+          arq_done(&master_link);
+          RATE_BENCH_MARK(rate_cb_end);
+          ranging_event = RANGING_OK;
+          slave_state = SLAVE_IDLE;
+          return;
+        }
 
-    /* Execute a delay between ranging exchanges. */
-    Sleep(RNG_DELAY_MS);
+        /* If the final cannot be sent in time the exchange fails like a missed response. See NOTE 14 below. */
+        if (send_final(&snapshot) == DWT_SUCCESS)
+        {
+          slave_state = SLAVE_AWAIT_REPORT;
+          return;
+        }
+      }
+      else if (slave_state == SLAVE_AWAIT_REPORT && func_code == REPORT_FUNC_CODE &&
+               cb_data->datalength >= REPORT_MSG_DIST_IDX + FINAL_MSG_TS_LEN + FRAME_FCS_LEN &&
+               frame_read_payload(rx_buffer, sizeof(rx_buffer), cb_data->datalength) == DWT_SUCCESS)
+      {
+        final_msg_get_ts(&rx_buffer[REPORT_MSG_DIST_IDX], &report_distance);
+        distance_to_master = (int32_t)report_distance;
+        arq_receive(&master_link, rx_buffer[FRAME_SN_IDX]);
+        arq_done(&master_link);
+        RATE_BENCH_MARK(rate_cb_end);
+        ranging_event = RANGING_OK;
+        slave_state = SLAVE_IDLE;
+        return;
+      }
+    }
   }
+
+#ifdef SLAVE_LISTENS
+  /* The listen window stays open until the next poll */
+  if (slave_state == SLAVE_LISTEN)
+  {
+#ifdef CONFIG_PUSH_COMMANDS
+    if (ack_pending)
+    {
+      return;
+    }
+#endif
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    return;
+  }
+#endif
+
+#ifdef CONFIG_MULTI_RESPONDER
+  /* Later slots may still bring responses */
+  if (slave_state == SLAVE_AWAIT_RESP)
+  {
+    multi_rearm(0);
+    return;
+  }
+#endif
+
+  exchange_failed();
 }
 
-OutputStatus get_current_output_status()
+#ifdef CONFIG_PUSH_COMMANDS
+/* Runs from dwt_isr() on TXFRS. The poll and final turn the receiver on by themselves, only the end of an automatic
+ * ACK needs it re-armed. */
+static void tx_done_cb(const dwt_cb_data_t *cb_data)
 {
-  GPIO_PinState rel1State = HAL_GPIO_ReadPin(RELAY_1_OUT_GPIO_Port, RELAY_1_OUT_Pin);
-  GPIO_PinState rel2State = HAL_GPIO_ReadPin(RELAY_2_OUT_GPIO_Port, RELAY_2_OUT_Pin);
+  (void)cb_data;
 
-  if (rel1State && !rel2State)
+  if (ack_pending)
   {
-    return REL_1_ON;
+    ack_pending = 0;
+    if (slave_state == SLAVE_LISTEN)
+    {
+      dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    }
   }
-  else if (!rel1State && rel2State)
+}
+#endif
+
+static void rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+  /* RX timeout/error events are already cleared by dwt_isr() */
+  status_reg = cb_data->status;
+#ifdef SLAVE_LISTENS
+  if (slave_state == SLAVE_LISTEN)
   {
-    return REL_2_ON;
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+    return;
   }
-  else if (rel1State && rel2State)
+#endif
+#ifdef CONFIG_MULTI_RESPONDER
+  if (slave_state == SLAVE_AWAIT_RESP)
   {
-    return ALL_ON;
+    multi_rearm(cb_data->status & SYS_STATUS_ALL_RX_TO);
+    return;
   }
-
-  return ALL_OFF;
+#endif
+  exchange_failed();
 }
 
-void control_relays(RelayState r1State, RelayState r2State)
+/* Sends the DS-TWR final with the poll TX, response RX and final TX timestamps. The master answers with the distance
+ * report on the same turn-around, so the RX delay and timeout set for the response apply. See NOTE 14 below. */
+static int send_final(const dwt_rangingsnapshot_t *snapshot)
 {
-  if (HAL_GPIO_ReadPin(RELAY_1_OUT_GPIO_Port, RELAY_1_OUT_Pin) != (GPIO_PinState)r1State)
+  uint8_t ts_fields[3 * RESP_MSG_TS_LEN];
+  uint32_t final_tx_time;
+  uint64_t final_tx_ts;
+
+  /* Compute final message transmission time, its timestamp is the programmed time plus the antenna delay. */
+  final_tx_time = (snapshot->rxStamp + (RESP_RX_TO_FINAL_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8;
+  dwt_setdelayedtrxtime(final_tx_time);
+  final_tx_ts = (((uint64_t)(final_tx_time & 0xFFFFFFFEUL)) << 8) + TX_ANT_DLY;
+
+  /* Bytes 10 -> 21 of the staged final, written in one go */
+  final_msg_set_ts(&ts_fields[FINAL_MSG_POLL_TX_TS_IDX - FRAME_HDR_LEN], snapshot->txStamp);
+  final_msg_set_ts(&ts_fields[FINAL_MSG_RESP_RX_TS_IDX - FRAME_HDR_LEN], snapshot->rxStamp);
+  final_msg_set_ts(&ts_fields[FINAL_MSG_FINAL_TX_TS_IDX - FRAME_HDR_LEN], final_tx_ts);
+  frame_patch(&final_slot, FRAME_HDR_LEN, ts_fields, sizeof(ts_fields));
+  frame_set_byte(&final_slot, FRAME_SN_IDX, frame_seq_nb);
+  frame_select(&final_slot);
+
+  if (dwt_starttx(DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED) != DWT_SUCCESS)
   {
-    HAL_GPIO_WritePin(RELAY_1_OUT_GPIO_Port, RELAY_1_OUT_Pin, r1State);
+    return DWT_ERROR;
   }
 
-  if (HAL_GPIO_ReadPin(RELAY_2_OUT_GPIO_Port, RELAY_2_OUT_Pin) != (GPIO_PinState)r2State)
+  frame_seq_nb++;
+  return DWT_SUCCESS;
+}
+
+#ifdef CONFIG_HIGH_RATE_RANGING
+/* Accounts one finished exchange, called by the main loop once the result has been applied */
+static void rate_bench_exchange(RangingEvent event)
+{
+  uint32_t now = cycle_counter_read();
+
+  if (event != RANGING_OK)
   {
-    HAL_GPIO_WritePin(RELAY_2_OUT_GPIO_Port, RELAY_2_OUT_Pin, r2State);
+    rate_bench.fail++;
+    return;
   }
+
+  rate_bench.ok++;
+  rate_bench.setup_cycles += rate_tx_start - rate_setup_start;
+  rate_bench.air_cycles += rate_cb_start - rate_tx_start;
+  rate_bench.cb_cycles += rate_cb_end - rate_cb_start;
+  rate_bench.decision_cycles += now - rate_cb_end;
 }
 
-double calculate_distance(void)
+/* Prints and clears the figures of the last report period: rate_bench,<period_ms>,<exchanges_per_s>,<ok>,<fail>,
+ * <success_pct>,<setup_us>,<air_us>,<cb_us>,<decision_us>. Phase times are averages over the successful exchanges. */
+static void rate_bench_report(uint32_t period_ms)
+{
+  uint32_t cycles_per_us = SystemCoreClock / 1000000;
+  uint32_t div = (rate_bench.ok ? rate_bench.ok : 1) * cycles_per_us;
+  uint32_t done = rate_bench.ok + rate_bench.fail;
+
+  printf("rate_bench,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+         (unsigned long)RNG_DELAY_MS,
+         (unsigned long)(rate_bench.ok * 1000 / (period_ms ? period_ms : 1)),
+         (unsigned long)rate_bench.ok,
+         (unsigned long)rate_bench.fail,
+         (unsigned long)(done ? rate_bench.ok * 100 / done : 0),
+         (unsigned long)(rate_bench.setup_cycles / div),
+         (unsigned long)(rate_bench.air_cycles / div),
+         (unsigned long)(rate_bench.cb_cycles / div),
+         (unsigned long)(rate_bench.decision_cycles / div));
+
+  rate_bench = (RateBench){0};
+}
+#endif
+
+void uwb_slave_set_ranging_mode(RangingMode mode)
+{
+  /* Takes effect from the next poll */
+  ranging_mode = mode;
+}
+
+/* Drives the output channels selected by mask to their level in state, bit n is channel n */
+void control_relays(uint32_t state, uint32_t mask)
+{
+  output_channels_write(state, mask);
+}
+
+/* Distance to the master in millimetres, in fixed point so no double arithmetic runs in the RX callback. See NOTE 11 below. */
+int32_t calculate_distance(const dwt_rangingsnapshot_t *snapshot)
 {
   uint32_t poll_tx_ts, resp_rx_ts, poll_rx_ts, resp_tx_ts;
   int32_t rtd_init, rtd_resp;
-  float clockOffsetRatio;
-  double distance;
 
   /* Retrieve poll transmission and response reception timestamps. See NOTE 9 below. */
-  poll_tx_ts = dwt_readtxtimestamplo32();
-  resp_rx_ts = dwt_readrxtimestamplo32();
-
-  /* Read carrier integrator value and calculate clock offset ratio. See NOTE 11 below. */
-  clockOffsetRatio = ((float)dwt_readclockoffset()) / (uint32_t)(1<<26);
+  poll_tx_ts = (uint32_t)snapshot->txStamp;
+  resp_rx_ts = (uint32_t)snapshot->rxStamp;
 
   /* Get timestamps embedded in response message. */
   resp_msg_get_ts(&rx_buffer[RESP_MSG_POLL_RX_TS_IDX], &poll_rx_ts);
   resp_msg_get_ts(&rx_buffer[RESP_MSG_RESP_TX_TS_IDX], &resp_tx_ts);
 
-  /* Compute time of flight and distance, using clock offset ratio to correct for differing local and remote clock rates */
+  /* Compute time of flight and distance, using the clock offset to correct for differing local and remote clock rates */
   rtd_init = resp_rx_ts - poll_tx_ts;
   rtd_resp = resp_tx_ts - poll_rx_ts;
 
-  double tof = ((rtd_init - rtd_resp * (1 - clockOffsetRatio)) / 2.0) * DWT_TIME_UNITS;
-  distance = tof * SPEED_OF_LIGHT;
-
-  return distance;
+  return ss_twr_distance_mm(rtd_init, rtd_resp, snapshot->clockOffset);
 }
 
 /*****************************************************************************************************************************************************
@@ -359,20 +1276,22 @@ double calculate_distance(void)
  *    The first 10 bytes of those frame are common and are composed of the following fields:
  *     - byte 0/1: frame control (0x8841 to indicate a data frame using 16-bit addressing).
  *     - byte 2: sequence number, incremented for each new frame.
- *     - byte 3/4: PAN ID (0xDECA).
+ *     - byte 3/4: PAN ID, see NOTE 4.
  *     - byte 5/6: destination address, see NOTE 4 below.
  *     - byte 7/8: source address, see NOTE 4 below.
  *     - byte 9: function code (specific values to indicate which message it is in the ranging process).
  *    The remaining bytes are specific to each message as follows:
  *    Poll message:
- *     - no more data
+ *     - byte 10 -> 19: output status block, see NOTE 20 below.
+ *     - byte 20: feedback parameter (OUT_OF_RANGE_CODE or 0).
+ *     - byte 21 -> 20 + 2 * MULTI_RESP_MAX: responder table, with CONFIG_MULTI_RESPONDER only, see NOTE 24 below.
  *    Response message:
  *     - byte 10 -> 13: poll message reception timestamp.
  *     - byte 14 -> 17: response message transmission timestamp.
+ *     - byte 18 -> 27: output command block, see NOTE 20 below.
  *    All messages end with a 2-byte checksum automatically set by DW IC.
- * 4. Source and destination addresses are hard coded constants in this example to keep it simple but for a real product every device should have a
- *    unique ID. Here, 16-bit addressing is used to keep the messages as short as possible but, in an actual application, this should be done only
- *    after an exchange of specific messages used to define those short addresses for each device participating to the ranging exchange.
+ * 4. Each device takes a 16-bit short address hashed from the MCU unique ID (port_get_short_address()), on the PAN of its pair (CONFIG_PAIRING)
+ *    or CONFIG_PAN_ID. The poll goes to the broadcast address until a master answers, then to that master only. See NOTE 22 below.
  * 5. This timeout is for complete reception of a frame, i.e. timeout duration must take into account the length of the expected frame. Here the value
  *    is arbitrary but chosen large enough to make sure that there is enough time to receive the complete response frame sent by the responder at the
  *    6.8M data rate used (around 200 µs).
@@ -381,10 +1300,9 @@ double calculate_distance(void)
  * 7. dwt_writetxdata() takes the full size of the message as a parameter but only copies (size - 2) bytes as the check-sum at the end of the frame is
  *    automatically appended by the DW IC. This means that our variable could be two bytes shorter without losing any data (but the sizeof would not
  *    work anymore then as we would still have to indicate the full length of the frame to dwt_writetxdata()).
- * 8. We use polled mode of operation here to keep the example as simple as possible but all status events can be used to generate interrupts. Please
- *    refer to DW IC User Manual for more details on "interrupts". It is also to be noted that STATUS register is 5 bytes long but, as the event we
- *    use are all in the first bytes of the register, we can use the simple dwt_read32bitreg() API call to access it instead of reading the whole 5
- *    bytes.
+ * 8. The initiator is event driven: RXFCG, RX timeout and RX error events are unmasked with dwt_setinterrupt() and dispatched by dwt_isr()
+ *    to the callbacks above, either from the DW_IRQn EXTI line (CONFIG_DWIC_IRQ_MODE) or by polling the IRQS bit from the main loop. The main
+ *    loop only starts a new exchange from SLAVE_IDLE and sleeps between events in IRQ mode.
  * 9. The high order byte of each 40-bit time-stamps is discarded here. This is acceptable as, on each device, those time-stamps are not separated by
  *    more than 2**32 device time units (which is around 67 ms) which means that the calculation of the round-trip delays can be handled by a 32-bit
  *    subtraction.
@@ -397,4 +1315,86 @@ double calculate_distance(void)
  *     thereafter.
  * 13. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *     configuration.
+ * 14. In double-sided TWR (CONFIG_RANGING_DS_TWR or uwb_slave_set_ranging_mode()) the poll carries DS_POLL_FUNC_CODE and the response is
+ *     answered with a final holding the poll TX, response RX and final TX timestamps (bytes 10 -> 21). The master computes the distance with
+ *     ds_twr_distance_mm() and sends it back in a report (bytes 10 -> 13, millimetres), so both ends have it:
+ *
+ *    Initiator: |Poll TX| ..... |Resp RX| ..... |Final TX| ..... |Report RX|
+ *    Responder: |Poll RX| ..... |Resp TX| ..... |Final RX| ..... |Report TX|
+ *
+ *    As the clock offset between the two ends cancels out, one exchange is enough where SS-TWR depends on the clock offset correction. Both
+ *    reply delays are 450 UWB microseconds so the report arrives in the same RX window as the response.
+ * 15. CONFIG_HIGH_RATE_RANGING ranges every RNG_HIGH_RATE_PERIOD_MS on a 64 symbol preamble at 6.8 Mbps, the shortest profile the DW3000
+ *     supports (the master must be built with the same option). The response turn-around and RX window are unchanged: the response ends at
+ *     the same time, only its preamble starts later. Per exchange printf is compiled out and the rate_bench line printed once a second gives
+ *     the achieved rate (successful exchanges per second), the success ratio and the average time of each phase:
+ *      - setup: writing the poll and starting the TX
+ *      - air: TX start up to the RX callback that completes the exchange (poll, turn-around, response, plus final and report in DS-TWR)
+ *      - cb: the completing RX callback (register reads and distance)
+ *      - decision: from the callback to the relays having been driven by the main loop
+ *     Lowering RNG_HIGH_RATE_PERIOD_MS until the achieved rate stops following it gives the ceiling of the hardware and firmware pair.
+ * 16. Range validation is a geofence state machine (geofence.c) fed by every valid range and ticked by every main loop iteration, so ranging
+ *     carries on while a range is being validated:
+ *      - IN_RANGE: relays follow the master's command.
+ *      - SUSPECT: a range above ACCEPTABLE_RANGE_MM was seen, relays are held and the error LED blinks. A range back within
+ *        ACCEPTABLE_RANGE_MM - RANGE_HYSTERESIS_MM returns to IN_RANGE.
+ *      - OUT_OF_RANGE: no range came back within the hysteresis band for RANGE_VALIDATION_TIMEOUT_MS, relays are turned off.
+ *      - LOST: no valid range for MASTER_LOST_TIMEOUT_MS, relays are turned off and the error LED is on.
+ *     Both decisions are bounded by their window plus one main loop iteration (at most a SysTick in IRQ mode), whatever the ranging rate.
+ * 17. The geofence runs in the main loop, so a stalled loop would leave the relays as they are. failsafe.c adds a TIM2 one-shot kicked by
+ *     every in-range exchange: when CONFIG_FAILSAFE_TIMEOUT_MS passes without a kick, the TIM2 interrupt (priority 0, above the DW IC EXTI)
+ *     drives both relays off. The time from the last kick to the relays being off is measured with the DWT cycle counter and printed with
+ *     its worst case, the part above CONFIG_FAILSAFE_TIMEOUT_MS is the interrupt latency. The timeout should stay above
+ *     MASTER_LOST_TIMEOUT_MS so that in normal operation the geofence turns the relays off first. On the host, "make failsafe" in
+ *     Source/Tools runs this path in netsim and requires the cutoff within the timeout plus 1 ms, the target's NVIC latency aside.
+ * 18. With CONFIG_PUSH_COMMANDS the master sends a command frame (PUSH_FUNC_CODE) as soon as its inputs change, instead of the command waiting
+ *     for the reply to the next poll, i.e. up to RNG_DELAY_MS plus the exchange. Between exchanges the slave keeps its receiver in sniff mode
+ *     (PUSH_SNIFF_ON_PAC / PUSH_SNIFF_OFF_US) with no frame timeout, and closes that window right before each poll. A pushed command is only
+ *     applied while the geofence is IN_RANGE; it does not kick the fail-safe as it carries no range, so the slave polls straight after it to
+ *     confirm the range and report the new outputs to the master. The time from the push RX callback to the relays being driven is printed.
+ * 19. The poll and final are staged once in the DW IC TX buffer (frame_codec.c) and patched in place: the poll only gets its sequence number,
+ *     plus the parameter, function code and output block when they change, the final its three timestamps. A received frame is read
+ *     header first through the ranging snapshot, the payload is only read once the function code says the frame is one this state expects.
+ * 20. The outputs are a table of channels (output_channels.c), driven through per-port lookup tables built at init: a command applies
+ *     its state to the channels of its mask with a fixed number of 4-channel lookups and one BSRR write per port, whatever the channel
+ *     count. The poll reports the output levels read back from the pins and, as acknowledgement, the mask of the last command applied; a
+ *     command received while the geofence is not IN_RANGE acknowledges nothing. A block with an unknown version is dropped with its frame.
+ * 21. A response or report that times out, fails its checks or is received with an error no longer costs the rest of the ranging period:
+ *     the staged poll is sent again from the callback, with its sequence number, ARQ_BACKOFF_MIN_US plus a random part of up to
+ *     attempt * ARQ_BACKOFF_SPAN_US later (delayed TX on the DW IC clock), up to ARQ_MAX_RETRIES times. The backoff is seeded from the MCU
+ *     unique ID so that slaves that failed together do not retry together. Frames from the master go through the sequence window (arq.c):
+ *     only a new response or push applies its command, a repeated push is answered with a poll and a stale one is dropped. The link
+ *     counters (retries, recovered, dropped, duplicates, stale) are printed with each failed exchange.
+ * 22. With CONFIG_FRAME_FILTERING the DW IC checks the frame type, PAN ID and destination address of each frame itself: frames for other
+ *     nodes are dropped before they raise an interrupt or cost an SPI read, and frame_check_header() repeats the checks in software when the
+ *     filter is off. The slave polls the broadcast address and binds to the first master that answers, from then on frames from other
+ *     sources are ignored. With CONFIG_PAIRING (pairing.c) an unpaired slave polls on the broadcast PAN (0xFFFF), and the response to its
+ *     first poll addressed to the bound master pairs it: the master is stored in flash, and the slave moves to the PAN of the pair (the
+ *     master's short address), where the DW IC drops the frames of other pairs. A paired slave keeps its master when it is lost, the relays
+ *     stay off until that master is back. Without CONFIG_PAIRING every node is on CONFIG_PAN_ID and the binding is released when the master
+ *     is lost, after which the slave takes whichever master answers, another pair's included.
+ *     Pushes carry the acknowledgement request bit and are answered by the DW IC with an ACK (dwt_enableautoack()) a few symbols after
+ *     the frame, without the MCU. While the ACK is sent (AAT status bit) the receiver cannot be re-armed, so tx_done_cb() does it on TXFRS.
+ *     The poll that follows a push is still sent, it reports the new outputs to the master.
+ * 23. With CONFIG_TDMA the slave no longer polls on its own timer: it keeps the listen window open (sniff mode, as for pushes) until a
+ *     beacon (BEACON_FUNC_CODE) comes in, looks its short address up in the slot table and polls at the start of its slot, counted from
+ *     the beacon RX timestamp with DWT_START_TX_DLY_RS so that MCU latency does not shift it. The receiver is left off between the beacon
+ *     and the poll to keep that timestamp in RX_TIME. A slave not listed polls in the join slot, which registers it with the
+ *     master; after a collision with another new slave it retries in a random one of the next 2, 4, ... TDMA_JOIN_SPREAD_MAX
+ *     superframes. A missed slot or a failed exchange is not retried within the
+ *     superframe, a retry would fall into another slave's slot; the next beacon gives the next attempt. The frame filter keeps the
+ *     other slaves' exchanges heard during the window from waking the MCU.
+ * 24. With CONFIG_MULTI_RESPONDER the slave ranges with up to MULTI_RESP_MAX masters from one poll. The slave stays the initiator, so a
+ *     single poll TX timestamp serves every response and each master only has to answer it. The poll goes to the broadcast address and
+ *     lists the masters heard recently; entry n answers n * MULTI_RESP_SLOT_UUS after the usual turn-around and a master not listed yet
+ *     answers in the join slot after the table. The receiver is re-armed after each response, CRC error or early timeout until the last
+ *     slot is over, counted from the poll TX timestamp. Each response is a full SS-TWR reply, so the exchange is SS-TWR whatever
+ *     ranging_mode is: N distances cost N + 1 frames instead of 2N. Only the bound master's response (or the first one while unbound)
+ *     feeds the geofence and gives the command, the other distances are logged. An entry silent for MULTI_RESP_EXPIRE_POLLS polls is
+ *     freed for another master. Moving the final to offset 64 of the TX buffer keeps it clear of the longer poll.
+ * 25. With CONFIG_ALOHA the beacon announces a contention frame instead of a slot table (aloha.c). On each beacon the slave either lets
+ *     the frame pass while backing off or polls in a slot drawn at random, timed from the beacon RX timestamp as in NOTE 23. The response
+ *     acknowledges the slot; without one, whether the poll collided with another slave's or was lost, the slave skips a random number
+ *     of frames out of a window doubled per failure (2, 4, ... 2^ALOHA_MAX_BACKOFF_EXP) before trying again, and a success takes it
+ *     back to trying every frame. ARQ retries stay off as with TDMA, a retry would fall into another slot.
  ****************************************************************************************************************************************************/
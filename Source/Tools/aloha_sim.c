@@ -0,0 +1,152 @@
+/*
+ * aloha_sim.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Host simulation of the slotted ALOHA access of CONFIG_ALOHA, frame by frame, running the slave side code of aloha.c
+ * for every tag. Two polls in one slot are both lost, a poll alone in its slot is answered unless dropped at random
+ * (loss_pct). Prints one CSV line per tag count, to size a site: number of slots, tags per master and the ranging
+ * rate and access delay each tag gets. Radio timing inside a slot is not modelled.
+ *
+ * Usage: aloha_sim [slots] [frames] [loss_pct]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aloha.h"
+
+#define MAX_TAGS 256
+#define DELAY_BINS 1024   /* Access delay histogram, in frames, the last bin collects the longer ones */
+
+static const int tag_counts[] = {1, 2, 4, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256};
+
+static AlohaTag tags[MAX_TAGS];
+static uint32_t waiting_since[MAX_TAGS];
+static uint32_t delay_hist[DELAY_BINS];
+
+/* Loss generator, kept apart from the tags' own */
+static uint32_t sim_seed = 0x2545F491;
+
+static uint32_t sim_random(void)
+{
+  sim_seed ^= sim_seed << 13;
+  sim_seed ^= sim_seed >> 17;
+  sim_seed ^= sim_seed << 5;
+  return sim_seed;
+}
+
+/* Frames within which the given share of the successes happened */
+static uint32_t delay_percentile(uint64_t total, uint32_t pct)
+{
+  uint64_t count = 0;
+  uint32_t i;
+
+  for (i = 0; i < DELAY_BINS; i++)
+  {
+    count += delay_hist[i];
+    if (count * 100 >= total * pct)
+    {
+      return i;
+    }
+  }
+
+  return DELAY_BINS - 1;
+}
+
+static void run(int count, uint8_t slots, uint32_t frames, uint32_t loss_pct, uint32_t frame_us)
+{
+  uint8_t occupancy[256];
+  int16_t chosen[MAX_TAGS];
+  uint64_t attempts = 0, successes = 0, delay_sum = 0, collided_slots = 0;
+  uint32_t frame;
+  int i;
+
+  for (i = 0; i < count; i++)
+  {
+    aloha_init(&tags[i], (uint32_t)(count << 16) + i); /* Close seeds, as the unique IDs of one batch */
+    waiting_since[i] = 0;
+  }
+  memset(delay_hist, 0, sizeof(delay_hist));
+
+  for (frame = 0; frame < frames; frame++)
+  {
+    memset(occupancy, 0, slots);
+
+    for (i = 0; i < count; i++)
+    {
+      chosen[i] = (int16_t)aloha_access(&tags[i], slots);
+      if (chosen[i] != ALOHA_NO_SLOT)
+      {
+        occupancy[chosen[i]]++;
+        attempts++;
+      }
+    }
+
+    for (i = 0; i < slots; i++)
+    {
+      collided_slots += (occupancy[i] > 1);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+      int acknowledged;
+      uint32_t delay;
+
+      if (chosen[i] == ALOHA_NO_SLOT)
+      {
+        continue;
+      }
+
+      acknowledged = occupancy[chosen[i]] == 1 && (sim_random() % 100) >= loss_pct;
+      aloha_result(&tags[i], acknowledged);
+      if (!acknowledged)
+      {
+        continue;
+      }
+
+      /* Frames from the one after the last success (or the start) to this one, 1 when it got through at once */
+      delay = frame + 1 - waiting_since[i];
+      waiting_since[i] = frame + 1;
+      delay_sum += delay;
+      delay_hist[delay < DELAY_BINS ? delay : DELAY_BINS - 1]++;
+      successes++;
+    }
+  }
+
+  printf("%d,%u,%.1f,%.2f,%.1f,%.2f,%.1f,%.1f,%.1f\n", count, slots,
+         attempts ? 100.0 * successes / attempts : 0.0,
+         (double)successes / frames,
+         100.0 * collided_slots / ((double)frames * slots),
+         (double)successes / count / (frames * (frame_us / 1e6)),
+         successes ? (double)delay_sum / successes * frame_us / 1000.0 : 0.0,
+         successes ? delay_percentile(successes, 95) * frame_us / 1000.0 : 0.0,
+         successes ? delay_percentile(successes, 99) * frame_us / 1000.0 : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t slots = argc > 1 ? (uint32_t)atoi(argv[1]) : ALOHA_SLOTS;
+  uint32_t frames = argc > 2 ? (uint32_t)atoi(argv[2]) : 20000;
+  uint32_t loss_pct = argc > 3 ? (uint32_t)atoi(argv[3]) : 0;
+  uint32_t frame_us;
+  unsigned i;
+
+  if (slots < 1 || slots > 255 || frames < 1 || loss_pct > 100)
+  {
+    fprintf(stderr, "usage: %s [slots 1-255] [frames] [loss_pct 0-100]\n", argv[0]);
+    return 1;
+  }
+
+  frame_us = TDMA_FIRST_SLOT_US + slots * TDMA_SLOT_US + TDMA_LAUNCH_US;
+  printf("# slotted ALOHA, %u slots, %u us frame, backoff up to %u frames, %u%% loss, %u frames per point\n", slots,
+         frame_us, 1u << ALOHA_MAX_BACKOFF_EXP, loss_pct, frames);
+  printf("tags,slots,attempt_success_pct,exchanges_per_frame,collided_slot_pct,per_tag_hz,mean_delay_ms,"
+         "p95_delay_ms,p99_delay_ms\n");
+
+  for (i = 0; i < sizeof(tag_counts) / sizeof(tag_counts[0]); i++)
+  {
+    run(tag_counts[i], (uint8_t)slots, frames, loss_pct, frame_us);
+  }
+
+  return 0;
+}
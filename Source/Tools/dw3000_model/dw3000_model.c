@@ -0,0 +1,850 @@
+/*
+ * dw3000_model.c
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <math.h>
+#include <string.h>
+#include "dw3000_model.h"
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "deca_vals.h"
+
+#define FILE_OF(id) ((id) >> 16)
+#define OFFSET_OF(id) ((id) & 0xFFFF)
+
+#define MASK40 0xFFFFFFFFFFULL
+#define HALF_PERIOD (1ULL << 39)
+
+#define PREAMBLE_SYMBOL_PS 1017630   /* PRF 64 MHz, the only PRF the firmware configures */
+#define UUS_PS 1025641               /* 512 / 499.2 MHz, unit of RX_FWTO and W4R_TIM */
+#define BIT_6M8_PS 128205
+#define BIT_850K_PS 1025641
+#define PHR_BITS 21
+#define TX_STARTUP_PS 2000000        /* Immediate TX command to first preamble symbol */
+#define RX_STARTUP_PS 1000000
+#define ACK_TURNAROUND_SYMBOLS 12    /* Floor of ACK_TIM */
+
+#define SYS_STATUS_TX_DONE (SYS_STATUS_TXFRB_BIT_MASK | SYS_STATUS_TXPRS_BIT_MASK | SYS_STATUS_TXPHS_BIT_MASK | \
+                            SYS_STATUS_TXFRS_BIT_MASK)
+#define SYS_STATUS_RX_DONE (SYS_STATUS_RXPRD_BIT_MASK | SYS_STATUS_RXSFDD_BIT_MASK | SYS_STATUS_RXPHD_BIT_MASK | \
+                            SYS_STATUS_RXFR_BIT_MASK)
+
+/* SYS_STATUS events feeding each FINT_STAT bit, see dwt_isr() */
+static const uint64_t fint_groups[8] = {
+  SYS_STATUS_TXFRS_BIT_MASK,
+  SYS_STATUS_AAT_BIT_MASK | ((uint64_t)SYS_STATUS_HI_CCA_FAIL_BIT_MASK << 32),
+  SYS_STATUS_CIAERR_BIT_MASK | SYS_STATUS_CPERR_BIT_MASK,
+  SYS_STATUS_RXFCG_BIT_MASK,
+  SYS_STATUS_RXPHE_BIT_MASK | SYS_STATUS_RXFCE_BIT_MASK | SYS_STATUS_RXFSL_BIT_MASK | SYS_STATUS_RXSTO_BIT_MASK |
+      SYS_STATUS_ARFE_BIT_MASK | SYS_STATUS_RXOVRR_BIT_MASK,
+  SYS_STATUS_RXFTO_BIT_MASK | SYS_STATUS_RXPTO_BIT_MASK,
+  SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK,
+  SYS_STATUS_SPICRCE_BIT_MASK | ((uint64_t)(SYS_STATUS_HI_AES_ERR_BIT_MASK | SYS_STATUS_HI_SPIERR_BIT_MASK |
+                                            SYS_STATUS_HI_SPI_UNF_BIT_MASK | SYS_STATUS_HI_SPI_OVF_BIT_MASK |
+                                            SYS_STATUS_HI_CMD_ERR_BIT_MASK) << 32)
+};
+
+/* Preamble lengths of the TXPSR field (PE and TXPSR bits together, the DWT_PLEN_ values) */
+static const uint16_t txpsr_symbols[16] = {0, 64, 1024, 4096, 32, 128, 1536, 72, 0, 256, 2048, 0, 0, 512, 0, 0};
+
+static uint8_t *reg(DwModel *dev, uint32_t id)
+{
+  return &dev->regs[FILE_OF(id)][OFFSET_OF(id)];
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static void put40(uint8_t *p, uint64_t v)
+{
+  put32(p, (uint32_t)v);
+  p[4] = (uint8_t)(v >> 32);
+}
+
+static uint64_t get40(const uint8_t *p)
+{
+  return get32(p) | ((uint64_t)p[4] << 32);
+}
+
+static uint32_t random32(DwModel *dev)
+{
+  uint32_t x = dev->seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  dev->seed = x;
+  return x;
+}
+
+/* Standard normal deviate, Box-Muller */
+static double gaussian(DwModel *dev)
+{
+  double u1 = (random32(dev) + 1.0) / 4294967297.0;
+  double u2 = random32(dev) / 4294967296.0;
+
+  return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+/* IEEE 802.15.4 FCS: CRC-16 ITU-T, reflected, initial value 0 */
+static uint16_t fcs16(const uint8_t *data, uint16_t length)
+{
+  uint16_t crc = 0;
+  uint16_t i;
+  int bit;
+
+  for (i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for (bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+    }
+  }
+
+  return crc;
+}
+
+/* SPI CRC-8: x^8 + x^2 + x + 1, MSB first, initial value 0, as dwt_generatecrc8() */
+static uint8_t spi_crc8(const uint8_t *data, uint16_t length, uint8_t crc)
+{
+  uint16_t i;
+  int bit;
+
+  for (i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for (bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+
+  return crc;
+}
+
+uint64_t dw_model_ticks(const DwModel *dev, int64_t t)
+{
+  return (uint64_t)(t * DW_MODEL_TICKS_PER_PS * (1.0 + dev->ppm * 1e-6) + dev->tick0);
+}
+
+int64_t dw_model_time_of(const DwModel *dev, uint64_t ticks)
+{
+  return (int64_t)llround(((double)ticks - dev->tick0) / (DW_MODEL_TICKS_PER_PS * (1.0 + dev->ppm * 1e-6)));
+}
+
+int64_t dw_model_preamble_ps(uint16_t symbols, int sfdLong)
+{
+  return (int64_t)(symbols + (sfdLong ? 16 : 8)) * PREAMBLE_SYMBOL_PS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_airtime_ps()
+ *
+ * @brief Duration of a frame on air: preamble and SFD, PHR (at 850 kb/s unless PHR_6M8) and the payload with its
+ *        Reed-Solomon parity, 48 bits per block of up to 330 bits.
+ *
+ * @param  preambleSymbols  preamble length
+ * @param  sfdLong          16 symbol SFD (SFD type 2) instead of 8
+ * @param  rate6m8          payload at 6.8 Mb/s, 850 kb/s otherwise
+ * @param  phr6m8           PHR at the payload rate
+ * @param  length           frame length including the FCS
+ *
+ * @return first preamble symbol to last payload bit, in picoseconds
+ */
+int64_t dw_model_airtime_ps(uint16_t preambleSymbols, int sfdLong, int rate6m8, int phr6m8, uint16_t length)
+{
+  int64_t bits = 8 * (int64_t)length;
+  int64_t payload_bit = rate6m8 ? BIT_6M8_PS : BIT_850K_PS;
+
+  bits += 48 * ((bits + 329) / 330);
+  return dw_model_preamble_ps(preambleSymbols, sfdLong) + PHR_BITS * ((rate6m8 && phr6m8) ? BIT_6M8_PS : BIT_850K_PS) +
+         bits * payload_bit;
+}
+
+static int sfd_long(DwModel *dev)
+{
+  return ((reg(dev, CHAN_CTRL_ID)[0] & CHAN_CTRL_SFD_TYPE_BIT_MASK) >> CHAN_CTRL_SFD_TYPE_BIT_OFFSET) == 2;
+}
+
+static int phr_6m8(DwModel *dev)
+{
+  return (reg(dev, SYS_CFG_ID)[0] & SYS_CFG_PHR_6M8_BIT_MASK) != 0;
+}
+
+static uint32_t sys_cfg(DwModel *dev)
+{
+  return get32(reg(dev, SYS_CFG_ID));
+}
+
+static uint64_t enable_mask(DwModel *dev)
+{
+  return get32(reg(dev, SYS_ENABLE_LO_ID)) | ((uint64_t)get16(reg(dev, SYS_ENABLE_HI_ID)) << 32);
+}
+
+int dw_model_irq(const DwModel *dev)
+{
+  return (dev->status & enable_mask((DwModel *)dev)) != 0;
+}
+
+int dw_model_listening(const DwModel *dev)
+{
+  return dev->state == DW_MODEL_RX;
+}
+
+int64_t dw_model_deadline(const DwModel *dev)
+{
+  return dev->deadline;
+}
+
+static void schedule(DwModel *dev, DwModelState state, int64_t at)
+{
+  dev->state = state;
+  dev->deadline = at;
+}
+
+/* Refreshes the registers whose content is computed, before a read */
+static void sync_registers(DwModel *dev, int64_t now)
+{
+  uint64_t status = dev->status & ~(uint64_t)SYS_STATUS_IRQS_BIT_MASK;
+  uint64_t active;
+  uint8_t fint = 0;
+  int i;
+
+  if (dw_model_irq(dev))
+  {
+    status |= SYS_STATUS_IRQS_BIT_MASK;
+  }
+  put32(reg(dev, SYS_STATUS_ID), (uint32_t)status);
+  reg(dev, SYS_STATUS_HI_ID)[0] = (uint8_t)(status >> 32);
+  reg(dev, SYS_STATUS_HI_ID)[1] = (uint8_t)(status >> 40);
+
+  active = dev->status & enable_mask(dev);
+  for (i = 0; i < 8; i++)
+  {
+    if (active & fint_groups[i])
+    {
+      fint |= (uint8_t)(1 << i);
+    }
+  }
+  reg(dev, FINT_STAT_ID)[0] = fint;
+
+  put32(reg(dev, SYS_TIME_ID), (uint32_t)(dw_model_ticks(dev, now) >> 8) & ~1UL);
+  put32(reg(dev, DEV_ID_ID), DWT_C0_DEV_ID);
+  put32(reg(dev, SYS_STATE_LO_ID), dev->state == DW_MODEL_IDLE ? 0x00030000UL : 0x00050000UL);
+  reg(dev, RX_CAL_STS_ID)[0] = 1;
+}
+
+static void stop(DwModel *dev)
+{
+  if (dev->state == DW_MODEL_TX && dev->ops->abort)
+  {
+    dev->ops->abort(dev->ctx, dev);
+  }
+  dev->w4r = 0;
+  dev->ackPending = 0;
+  dev->rxTimeoutAt = DW_MODEL_NEVER;
+  schedule(dev, DW_MODEL_IDLE, DW_MODEL_NEVER);
+}
+
+static void rx_on(DwModel *dev, int64_t at)
+{
+  uint32_t fwto = get32(reg(dev, RX_FWTO_ID)) & 0xFFFFF;
+
+  dev->rxTimeoutAt = DW_MODEL_NEVER;
+  if ((sys_cfg(dev) & SYS_CFG_RXWTOE_BIT_MASK) && fwto != 0)
+  {
+    dev->rxTimeoutAt = at + (int64_t)fwto * UUS_PS;
+  }
+
+  schedule(dev, DW_MODEL_RX, dev->rxTimeoutAt);
+  if (dev->ops->listen)
+  {
+    dev->ops->listen(dev->ctx, dev);
+  }
+}
+
+/* Fills dev->tx from TX_FCTRL and the TX buffer for an RMARKER leaving the digital side at rmarker_ps */
+static void prepare_tx(DwModel *dev, int64_t rmarker_ps, uint64_t tx_stamp)
+{
+  uint32_t fctrl = get32(reg(dev, TX_FCTRL_ID));
+  uint16_t length = (uint16_t)(fctrl & TX_FCTRL_TXFLEN_BIT_MASK);
+  uint16_t offset = (uint16_t)((fctrl & TX_FCTRL_TXB_OFFSET_BIT_MASK) >> TX_FCTRL_TXB_OFFSET_BIT_OFFSET);
+  uint16_t symbols = txpsr_symbols[(fctrl & TX_FCTRL_TXPSR_BIT_MASK) >> TX_FCTRL_TXPSR_BIT_OFFSET];
+  DwFrame *frame = &dev->tx;
+
+  if (offset > 127)
+  {
+    offset -= 128;   /* See dwt_writetxfctrl() */
+  }
+  if (length < 2)
+  {
+    length = 2;
+  }
+  if (offset + length > DW_MODEL_FILE_LEN)
+  {
+    length = (uint16_t)(DW_MODEL_FILE_LEN - offset);
+  }
+
+  memcpy(frame->data, &dev->regs[FILE_OF(TX_BUFFER_ID)][offset], length - 2);
+  if (!(sys_cfg(dev) & SYS_CFG_DIS_FCS_TX_BIT_MASK))
+  {
+    uint16_t fcs = fcs16(frame->data, length - 2);
+    frame->data[length - 2] = (uint8_t)fcs;
+    frame->data[length - 1] = (uint8_t)(fcs >> 8);
+  }
+
+  frame->length = length;
+  frame->ranging = (fctrl & TX_FCTRL_TR_BIT_MASK) != 0;
+  frame->rate6m8 = (fctrl & TX_FCTRL_TXBR_BIT_MASK) != 0;
+  frame->preambleSymbols = symbols ? symbols : 128;
+  frame->rmarkerPs = rmarker_ps + dev->trueAntDelayPs;
+  frame->startPs = frame->rmarkerPs - dw_model_preamble_ps(frame->preambleSymbols, sfd_long(dev));
+  frame->endPs = frame->startPs + dw_model_airtime_ps(frame->preambleSymbols, sfd_long(dev), frame->rate6m8,
+                                                      phr_6m8(dev), length);
+
+  put40(reg(dev, TX_TIME_LO_ID), (tx_stamp + get16(reg(dev, TX_ANTD_ID))) & MASK40);
+}
+
+static void start_tx_now(DwModel *dev, int64_t now)
+{
+  int64_t rmarker;
+
+  /* Preamble and SFD of the configured length ahead of the RMARKER */
+  prepare_tx(dev, 0, 0);
+  rmarker = now + TX_STARTUP_PS + (dev->tx.rmarkerPs - dev->tx.startPs);
+  prepare_tx(dev, rmarker, dw_model_ticks(dev, rmarker));
+  schedule(dev, DW_MODEL_TX_PENDING, dev->tx.startPs);
+}
+
+/* Delayed TX/RX target of a fast command, 0 with HPDWARN set if it lies more than half a period ahead (i.e. passed) */
+static int delayed_target(DwModel *dev, int64_t now, uint8_t cmd, uint64_t *target, int64_t *at)
+{
+  uint64_t base = 0;
+  uint64_t now_ticks = dw_model_ticks(dev, now);
+  uint64_t delta;
+
+  switch (cmd)
+  {
+  case CMD_DTX_REF:
+  case CMD_DRX_REF:
+  case CMD_DTX_REF_W4R:
+    base = (uint64_t)get32(reg(dev, DREF_TIME_ID)) << 8;
+    break;
+  case CMD_DTX_RS:
+  case CMD_DRX_RS:
+  case CMD_DTX_RS_W4R:
+    base = get40(reg(dev, RX_TIME_0_ID));
+    break;
+  case CMD_DTX_TS:
+  case CMD_DRX_TS:
+  case CMD_DTX_TS_W4R:
+    base = get40(reg(dev, TX_TIME_LO_ID));
+    break;
+  default:
+    break;
+  }
+
+  *target = (base + ((uint64_t)get32(reg(dev, DX_TIME_ID)) << 8)) & MASK40 & ~0x1FFULL;
+  delta = (*target - now_ticks) & MASK40;
+  dev->status &= ~(uint64_t)SYS_STATUS_HPDWARN_BIT_MASK;
+  if (delta >= HALF_PERIOD)
+  {
+    dev->status |= SYS_STATUS_HPDWARN_BIT_MASK;
+    dev->stats.txLate++;
+    return 0;
+  }
+
+  *at = dw_model_time_of(dev, now_ticks + delta);
+  return 1;
+}
+
+static void fast_command(DwModel *dev, int64_t now, uint8_t cmd)
+{
+  uint64_t target;
+  int64_t at;
+
+  dev->stats.fastCommands++;
+
+  switch (cmd)
+  {
+  case CMD_TXRXOFF:
+    stop(dev);
+    dev->status &= ~(uint64_t)(SYS_STATUS_ALL_TX | SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_ERR |
+                               SYS_STATUS_ALL_RX_TO | SYS_STATUS_HPDWARN_BIT_MASK);
+    break;
+
+  case CMD_TX:
+  case CMD_CCA_TX:
+  case CMD_TX_W4R:
+  case CMD_CCA_TX_W4R:
+    stop(dev);
+    dev->w4r = (cmd == CMD_TX_W4R || cmd == CMD_CCA_TX_W4R);
+    start_tx_now(dev, now);
+    break;
+
+  case CMD_DTX:
+  case CMD_DTX_TS:
+  case CMD_DTX_RS:
+  case CMD_DTX_REF:
+  case CMD_DTX_W4R:
+  case CMD_DTX_TS_W4R:
+  case CMD_DTX_RS_W4R:
+  case CMD_DTX_REF_W4R:
+    if (!delayed_target(dev, now, cmd, &target, &at))
+    {
+      break;
+    }
+    stop(dev);
+    dev->w4r = cmd >= CMD_DTX_W4R;
+    prepare_tx(dev, at, target);
+    if (dev->tx.startPs < now + TX_STARTUP_PS)
+    {
+      /* Too close to fit the preamble: the frame leaves late, TX_TIME still reports the programmed time */
+      int64_t late = now + TX_STARTUP_PS - dev->tx.startPs;
+      dev->tx.startPs += late;
+      dev->tx.rmarkerPs += late;
+      dev->tx.endPs += late;
+    }
+    schedule(dev, DW_MODEL_TX_PENDING, dev->tx.startPs);
+    break;
+
+  case CMD_RX:
+    stop(dev);
+    schedule(dev, DW_MODEL_RX_PENDING, now + RX_STARTUP_PS);
+    break;
+
+  case CMD_DRX:
+  case CMD_DRX_TS:
+  case CMD_DRX_RS:
+  case CMD_DRX_REF:
+    if (!delayed_target(dev, now, cmd, &target, &at))
+    {
+      break;
+    }
+    stop(dev);
+    schedule(dev, DW_MODEL_RX_PENDING, at > now + RX_STARTUP_PS ? at : now + RX_STARTUP_PS);
+    break;
+
+  case CMD_CLR_IRQS:
+    dev->status &= (uint64_t)(SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK | SYS_STATUS_CP_LOCK_BIT_MASK);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/* Writes with side effects, byte by byte. Returns 1 if the byte was consumed. */
+static int special_write(DwModel *dev, uint8_t file, uint16_t offset, uint8_t value)
+{
+  if (file == 0 && offset >= OFFSET_OF(SYS_STATUS_ID) && offset < OFFSET_OF(SYS_STATUS_HI_ID) + 2)
+  {
+    /* Write 1 to clear. The PLL relocks at once, see dwt_configure(). */
+    dev->status &= ~((uint64_t)value << (8 * (offset - OFFSET_OF(SYS_STATUS_ID))));
+    dev->status |= SYS_STATUS_CP_LOCK_BIT_MASK;
+    return 1;
+  }
+
+  if ((file == 0 && (offset < 4 || (offset >= OFFSET_OF(SYS_TIME_ID) && offset < OFFSET_OF(SYS_TIME_ID) + 4))) ||
+      (file == FILE_OF(RX_CAL_STS_ID) && offset == OFFSET_OF(RX_CAL_STS_ID)) || (file == FILE_OF(FINT_STAT_ID) && offset == 0))
+  {
+    return 1;   /* Read only, or write 1 to clear of a status that is always set */
+  }
+
+  return 0;
+}
+
+/* Resolves the indirect pointers to the file and offset they point at */
+static void resolve(DwModel *dev, uint8_t *file, uint16_t *offset)
+{
+  if (*file == FILE_OF(INDIRECT_POINTER_A_ID) || *file == FILE_OF(INDIRECT_POINTER_B_ID))
+  {
+    uint32_t addr_id = (*file == FILE_OF(INDIRECT_POINTER_A_ID)) ? INDIRECT_ADDR_A_ID : INDIRECT_ADDR_B_ID;
+    uint32_t offset_id = (*file == FILE_OF(INDIRECT_POINTER_A_ID)) ? ADDR_OFFSET_A_ID : ADDR_OFFSET_B_ID;
+
+    *offset = (uint16_t)(*offset + (get16(reg(dev, offset_id)) & 0x7FFF));
+    *file = reg(dev, addr_id)[0] & 0x1F;
+  }
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_spi()
+ *
+ * @brief One SPI transaction, decoded as the DW3000 does: fast command, short (1 byte header, offset 0) or full
+ *        (2 byte header) read or write, the latter also as 8/16/32-bit AND-OR. See dwt_xferheader().
+ *
+ * @param  dev           model
+ * @param  now           time the transaction completes (CS released)
+ * @param  header        header bytes
+ * @param  headerLength  1 or 2
+ * @param  txBody        bytes written, NULL for a read
+ * @param  rxBody        receives the bytes read, NULL for a write
+ * @param  bodyLength    body length, 0 for a fast command; with SPI CRC on, writes count the trailing CRC byte
+ *
+ * @return none
+ */
+void dw_model_spi(DwModel *dev, int64_t now, const uint8_t *header, uint16_t headerLength, const uint8_t *txBody,
+                  uint8_t *rxBody, uint16_t bodyLength)
+{
+  uint8_t write = (header[0] & 0x80) != 0;
+  uint8_t file;
+  uint16_t offset = 0;
+  uint8_t mode = 0;
+  uint16_t i;
+
+  dev->stats.transactions++;
+  dev->stats.bytes += headerLength + bodyLength;
+
+  dw_model_advance(dev, now);
+
+  if (write && (sys_cfg(dev) & SYS_CFG_SPI_CRC_BIT_MASK) && bodyLength > 0)
+  {
+    /* SPI CRC on: every write, fast commands included, ends with the CRC of all the bytes before it. The write is
+     * still carried out; a mismatch only raises SPICRCE. */
+    bodyLength--;
+    if (spi_crc8(txBody, bodyLength, spi_crc8(header, headerLength, 0)) != txBody[bodyLength])
+    {
+      dev->status |= SYS_STATUS_SPICRCE_BIT_MASK;
+      dev->stats.spiCrcErrors++;
+    }
+  }
+
+  if (headerLength == 1 && (header[0] & 0x41) == 0x01)
+  {
+    fast_command(dev, now, (header[0] >> 1) & 0x1F);
+    return;
+  }
+
+  file = (header[0] >> 1) & 0x1F;
+  if (headerLength >= 2 && (header[0] & 0x40))
+  {
+    offset = (uint16_t)(((header[0] & 1) << 6) | (header[1] >> 2));
+    mode = header[1] & 0x03;
+  }
+  resolve(dev, &file, &offset);
+
+  if (!write)
+  {
+    sync_registers(dev, now);
+    for (i = 0; i < bodyLength && rxBody; i++)
+    {
+      rxBody[i] = (offset + i < DW_MODEL_FILE_LEN) ? dev->regs[file][offset + i] : 0;
+    }
+    if ((sys_cfg(dev) & SYS_CFG_SPI_CRC_BIT_MASK) && rxBody &&
+        !(file == FILE_OF(SPICRC_CFG_ID) && offset == OFFSET_OF(SPICRC_CFG_ID)))
+    {
+      /* SPI_RD_CRC: CRC of the header and data of the last read, for dwt_xfer3000() to check */
+      reg(dev, SPICRC_CFG_ID)[0] = spi_crc8(rxBody, bodyLength, spi_crc8(header, headerLength, 0));
+    }
+    return;
+  }
+
+  if (mode != 0)
+  {
+    /* AND-OR: the body carries the AND mask then the OR mask, each 1, 2 or 4 bytes */
+    uint16_t width = (uint16_t)(1 << (mode - 1));
+
+    sync_registers(dev, now);
+    for (i = 0; i < width && 2 * width <= bodyLength; i++)
+    {
+      uint8_t value = (uint8_t)((dev->regs[file][offset + i] & txBody[i]) | txBody[width + i]);
+
+      if (!special_write(dev, file, (uint16_t)(offset + i), value))
+      {
+        dev->regs[file][offset + i] = value;
+      }
+    }
+    return;
+  }
+
+  for (i = 0; i < bodyLength && offset + i < DW_MODEL_FILE_LEN; i++)
+  {
+    if (!special_write(dev, file, (uint16_t)(offset + i), txBody[i]))
+    {
+      dev->regs[file][offset + i] = txBody[i];
+    }
+  }
+}
+
+static void send_ack(DwModel *dev, int64_t now)
+{
+  DwFrame *frame = &dev->tx;
+
+  frame->data[0] = 0x02;
+  frame->data[1] = 0x00;
+  frame->data[2] = dev->ackSeq;
+  frame->data[3] = (uint8_t)fcs16(frame->data, 3);
+  frame->data[4] = (uint8_t)(fcs16(frame->data, 3) >> 8);
+  frame->length = 5;
+  frame->ranging = 0;
+  frame->startPs = now;
+  frame->rmarkerPs = now + dw_model_preamble_ps(frame->preambleSymbols, sfd_long(dev));
+  frame->endPs = now + dw_model_airtime_ps(frame->preambleSymbols, sfd_long(dev), frame->rate6m8, phr_6m8(dev), 5);
+  dev->ackPending = 0;
+  dev->stats.acks++;
+  schedule(dev, DW_MODEL_TX, frame->endPs);
+  dev->ops->transmit(dev->ctx, dev, frame);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_advance()
+ *
+ * @brief Runs the internal events due at or before now: TX start and end, RX turn-on after a delay or W4R, frame
+ *        wait timeout and auto-ACK. Must be called at dw_model_deadline() at the latest.
+ *
+ * @param  dev  model
+ * @param  now  current time
+ *
+ * @return none
+ */
+void dw_model_advance(DwModel *dev, int64_t now)
+{
+  while (dev->deadline <= now)
+  {
+    int64_t at = dev->deadline;
+
+    switch (dev->state)
+    {
+    case DW_MODEL_TX_PENDING:
+      dev->status |= SYS_STATUS_TXFRB_BIT_MASK;
+      dev->stats.txFrames++;
+      schedule(dev, DW_MODEL_TX, dev->tx.endPs);
+      dev->ops->transmit(dev->ctx, dev, &dev->tx);
+      break;
+
+    case DW_MODEL_TX:
+      dev->status |= SYS_STATUS_TX_DONE;
+      if (dev->w4r)
+      {
+        dev->w4r = 0;
+        schedule(dev, DW_MODEL_RX_PENDING,
+                 at + (int64_t)(get32(reg(dev, ACK_RESP_ID)) & ACK_RESP_W4R_TIM_BIT_MASK) * UUS_PS);
+      }
+      else
+      {
+        schedule(dev, DW_MODEL_IDLE, DW_MODEL_NEVER);
+      }
+      break;
+
+    case DW_MODEL_RX_PENDING:
+      rx_on(dev, at);
+      break;
+
+    case DW_MODEL_RX:
+    case DW_MODEL_RX_LOCKED:
+      dev->status |= SYS_STATUS_RXFTO_BIT_MASK;
+      dev->stats.rxTimeouts++;
+      dev->rxTimeoutAt = DW_MODEL_NEVER;
+      schedule(dev, DW_MODEL_IDLE, DW_MODEL_NEVER);
+      break;
+
+    case DW_MODEL_ACK_PENDING:
+      send_ack(dev, at);
+      break;
+
+    default:
+      dev->deadline = DW_MODEL_NEVER;
+      break;
+    }
+  }
+}
+
+/* Preamble detected and SFD found: the frame wait timeout no longer applies */
+void dw_model_lock(DwModel *dev, int64_t now)
+{
+  (void)now;
+  if (dev->state == DW_MODEL_RX)
+  {
+    schedule(dev, DW_MODEL_RX_LOCKED, DW_MODEL_NEVER);
+  }
+}
+
+/* 802.15.4 frame filtering on frame type, destination PAN and short address. Returns 1 to accept. */
+static int filter(DwModel *dev, const DwFrame *frame)
+{
+  uint16_t fc, cfg, own_pan, own_addr;
+  uint8_t type, dst_mode;
+
+  if (!(sys_cfg(dev) & SYS_CFG_FFEN_BIT_MASK))
+  {
+    return 1;
+  }
+  if (frame->length < 5)
+  {
+    return 0;
+  }
+
+  fc = get16(frame->data);
+  cfg = get16(reg(dev, ADR_FILT_CFG_ID));
+  type = fc & 0x7;
+  dst_mode = (fc >> 10) & 0x3;
+
+  if (!(cfg & (1u << type)) || type > 3)
+  {
+    return 0;
+  }
+  if (type == 2)
+  {
+    return 1;   /* No addresses in an ACK */
+  }
+  if (dst_mode != 2 || frame->length < 9)
+  {
+    return 0;   /* Only short destination addresses are in use */
+  }
+
+  own_addr = get16(reg(dev, PANADR_ID));
+  own_pan = get16(reg(dev, PANADR_ID) + 2);
+  return (get16(&frame->data[3]) == own_pan || get16(&frame->data[3]) == 0xFFFF) &&
+         (get16(&frame->data[5]) == own_addr || get16(&frame->data[5]) == 0xFFFF);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_receive()
+ *
+ * @brief End of a frame the receiver had locked onto. A frame that survived the medium is filtered, stored in
+ *        RX_BUFFER_0 with its frame info, timestamp and clock offset, and auto-acknowledged if asked for. A corrupted one
+ *        raises RXFCE. The receiver goes idle either way, unless the frame was filtered out.
+ *
+ * @param  dev                model
+ * @param  now                end of the frame at this receiver
+ * @param  frame              frame as sent
+ * @param  rmarkerArrivalPs   RMARKER at this antenna
+ * @param  intact             0 if the frame collided or was corrupted
+ * @param  remotePpm          clock error of the sender, for the carrier integrator
+ *
+ * @return none
+ */
+void dw_model_receive(DwModel *dev, int64_t now, const DwFrame *frame, int64_t rmarkerArrivalPs, int intact,
+                      double remotePpm)
+{
+  uint64_t raw, stamp;
+  int32_t coe;
+  uint32_t finfo;
+
+  if (dev->state != DW_MODEL_RX_LOCKED)
+  {
+    return;
+  }
+
+  if (!intact)
+  {
+    dev->status |= SYS_STATUS_RXPRD_BIT_MASK | SYS_STATUS_RXSFDD_BIT_MASK | SYS_STATUS_RXPHD_BIT_MASK |
+                   SYS_STATUS_RXFCE_BIT_MASK;
+    dev->stats.rxErrors++;
+    dev->rxTimeoutAt = DW_MODEL_NEVER;
+    schedule(dev, DW_MODEL_IDLE, DW_MODEL_NEVER);
+    return;
+  }
+
+  if (!filter(dev, frame))
+  {
+    /* Rejected: ARFE and back to listening, within what is left of the frame wait timeout */
+    dev->status |= SYS_STATUS_ARFE_BIT_MASK;
+    dev->stats.rxFiltered++;
+    if (dev->rxTimeoutAt != DW_MODEL_NEVER && dev->rxTimeoutAt <= now)
+    {
+      dev->status |= SYS_STATUS_RXFTO_BIT_MASK;
+      dev->stats.rxTimeouts++;
+      dev->rxTimeoutAt = DW_MODEL_NEVER;
+      schedule(dev, DW_MODEL_IDLE, DW_MODEL_NEVER);
+      return;
+    }
+    schedule(dev, DW_MODEL_RX, dev->rxTimeoutAt);
+    return;
+  }
+
+  memcpy(&dev->regs[FILE_OF(RX_BUFFER_0_ID)][0], frame->data, frame->length);
+
+  raw = dw_model_ticks(dev, rmarkerArrivalPs + dev->trueAntDelayPs);
+  stamp = raw - get16(reg(dev, CIA_CONF_ID));
+  if (dev->rxJitterPs)
+  {
+    stamp += (uint64_t)(int64_t)llround(gaussian(dev) * dev->rxJitterPs * DW_MODEL_TICKS_PER_PS);
+  }
+  put40(reg(dev, RX_TIME_0_ID), stamp & MASK40);
+  put32(reg(dev, RX_TIME_RAW_ID), (uint32_t)(raw >> 8));
+
+  coe = (int32_t)lround((remotePpm - dev->ppm) * 1e-6 * 67108864.0);
+  coe = coe > 4095 ? 4095 : (coe < -4096 ? -4096 : coe);
+  put32(reg(dev, CIA_DIAG_0_ID), (get32(reg(dev, CIA_DIAG_0_ID)) & ~CIA_DIAG_0_COE_PPM_BIT_MASK) |
+                                     ((uint32_t)coe & CIA_DIAG_0_COE_PPM_BIT_MASK));
+
+  finfo = frame->length | (frame->ranging ? RX_FINFO_RNG_BIT_MASK : 0) | (frame->rate6m8 ? RX_FINFO_RXBR_BIT_MASK : 0) |
+          (2UL << RX_FINFO_RXPRF_BIT_OFFSET) | ((uint32_t)(frame->preambleSymbols - 8) << RX_FINFO_RXPACC_BIT_OFFSET);
+  put32(reg(dev, RX_FINFO_ID), finfo);
+
+  dev->status |= SYS_STATUS_RX_DONE | SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_CIADONE_BIT_MASK;
+  dev->stats.rxGood++;
+  dev->rxTimeoutAt = DW_MODEL_NEVER;
+  schedule(dev, DW_MODEL_IDLE, DW_MODEL_NEVER);
+
+  if ((sys_cfg(dev) & SYS_CFG_AUTO_ACK_BIT_MASK) && (sys_cfg(dev) & SYS_CFG_FFEN_BIT_MASK) &&
+      (get16(frame->data) & 0x0020) && (get16(frame->data) & 0x7) == 1 && get16(&frame->data[5]) != 0xFFFF)
+  {
+    uint8_t ack_tim = reg(dev, ACK_RESP_ID)[3];
+
+    dev->status |= SYS_STATUS_AAT_BIT_MASK;
+    dev->ackPending = 1;
+    dev->ackSeq = frame->data[2];
+    dev->tx.preambleSymbols = frame->preambleSymbols;
+    dev->tx.rate6m8 = frame->rate6m8;
+    schedule(dev, DW_MODEL_ACK_PENDING,
+             now + (int64_t)(ack_tim > ACK_TURNAROUND_SYMBOLS ? ack_tim : ACK_TURNAROUND_SYMBOLS) * PREAMBLE_SYMBOL_PS);
+  }
+}
+
+/* Supply removed: a frame on air is cut short, the IC stops and keeps nothing, the IRQ line drops */
+void dw_model_power_off(DwModel *dev)
+{
+  stop(dev);
+  dev->status = 0;
+  memset(dev->regs, 0, sizeof(dev->regs));
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn dw_model_init()
+ *
+ * @brief Powers a model up in IDLE_RC, with the start-up events (RCINIT, SPIRDY) and the PLL lock already latched.
+ *
+ * @param  dev    model
+ * @param  ppm    device clock error, parts per million
+ * @param  tick0  device time at simulation time 0, in DW time units
+ * @param  seed   timestamp noise generator seed
+ * @param  ops    medium hooks
+ * @param  ctx    passed back to the hooks
+ *
+ * @return none
+ */
+void dw_model_init(DwModel *dev, double ppm, double tick0, uint32_t seed, const DwModelOps *ops, void *ctx)
+{
+  memset(dev, 0, sizeof(*dev));
+  dev->ppm = ppm;
+  dev->tick0 = tick0;
+  dev->seed = seed ? seed : 1;
+  dev->ops = ops;
+  dev->ctx = ctx;
+  dev->trueAntDelayPs = 256426;   /* 16385 DW time units, the default TX_ANT_DLY/RX_ANT_DLY */
+  dev->rxTimeoutAt = DW_MODEL_NEVER;
+  dev->deadline = DW_MODEL_NEVER;
+  dev->status = SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK | SYS_STATUS_CP_LOCK_BIT_MASK;
+  put32(reg(dev, DEV_ID_ID), DWT_C0_DEV_ID);
+  put32(reg(dev, RX_CAL_RESI_ID), 0x100);
+  put32(reg(dev, RX_CAL_RESQ_ID), 0x100);
+}
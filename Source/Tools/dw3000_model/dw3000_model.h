@@ -0,0 +1,118 @@
+/*
+ * dw3000_model.h
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Register level model of one DW3000, driven through the same SPI transactions deca_device.c sends to the real IC.
+ * Covers what the ranging firmware uses: register files and buffers, fast commands, immediate and delayed TX/RX,
+ * wait-for-response, frame wait timeout, interrupt status and mask, 802.15.4 frame filtering, auto-ACK and the
+ * timestamps and clock offset of received frames, and the SPI CRC of writes and reads. Calibration and PLL sequences
+ * complete at once.
+ *
+ * The model knows nothing of a scheduler or of other devices: time is passed in by the caller, in picoseconds of
+ * simulation (true) time, and frames leave through DwModelOps. The air medium calls dw_model_lock() and
+ * dw_model_receive() to deliver them.
+ */
+
+#ifndef DW3000_MODEL_H_
+#define DW3000_MODEL_H_
+
+#include <stdint.h>
+
+#define DW_MODEL_FILES 32
+#define DW_MODEL_FILE_LEN 1024
+#define DW_MODEL_FRAME_MAX 1023
+#define DW_MODEL_NEVER INT64_MAX
+
+#define DW_MODEL_TICKS_PER_PS 0.0638976   /* 499.2 MHz * 128 */
+
+typedef enum
+{
+  DW_MODEL_IDLE,
+  DW_MODEL_TX_PENDING,   /* Delayed TX armed, or immediate TX starting up */
+  DW_MODEL_TX,           /* On air */
+  DW_MODEL_RX_PENDING,   /* Delayed RX or wait-for-response turnaround */
+  DW_MODEL_RX,           /* Listening for a preamble */
+  DW_MODEL_RX_LOCKED,    /* Receiving a frame, see dw_model_lock() */
+  DW_MODEL_ACK_PENDING   /* Auto-ACK turnaround */
+} DwModelState;
+
+/* One transmission, described for the medium */
+typedef struct
+{
+  uint8_t data[DW_MODEL_FRAME_MAX];
+  uint16_t length;          /* Including the 2-byte FCS, as TX_FCTRL */
+  uint8_t ranging;
+  uint8_t rate6m8;
+  uint16_t preambleSymbols;
+  int64_t startPs;          /* First preamble symbol leaves the antenna */
+  int64_t rmarkerPs;        /* RMARKER leaves the antenna */
+  int64_t endPs;            /* Last bit leaves the antenna */
+} DwFrame;
+
+typedef struct DwModel DwModel;
+
+typedef struct
+{
+  void (*transmit)(void *ctx, DwModel *dev, const DwFrame *frame);   /* Frame starts at frame->startPs (now) */
+  void (*abort)(void *ctx, DwModel *dev);                            /* TX cut short by TXRXOFF */
+  void (*listen)(void *ctx, DwModel *dev);                           /* Receiver has just turned on */
+} DwModelOps;
+
+typedef struct
+{
+  uint32_t transactions;    /* SPI transactions (CS frames) */
+  uint32_t bytes;           /* Header and body bytes clocked */
+  uint32_t fastCommands;
+  uint32_t txFrames;
+  uint32_t txLate;          /* Delayed TX/RX refused with HPDWARN */
+  uint32_t rxGood;
+  uint32_t rxErrors;
+  uint32_t rxTimeouts;
+  uint32_t rxFiltered;      /* Rejected by frame filtering */
+  uint32_t acks;            /* Auto-ACKs sent */
+  uint32_t spiCrcErrors;    /* Writes whose CRC byte did not match, see SYS_CFG SPI_CRC */
+} DwModelStats;
+
+struct DwModel
+{
+  uint8_t regs[DW_MODEL_FILES][DW_MODEL_FILE_LEN];
+  uint64_t status;          /* SYS_STATUS (bits 0-31) and SYS_STATUS_HI (bits 32-47) */
+
+  /* Device clock: ticks = (t_ps * DW_MODEL_TICKS_PER_PS) * (1 + ppm * 1e-6) + tick0 */
+  double ppm;
+  double tick0;
+  int64_t rxJitterPs;       /* Standard deviation of the RX timestamp error */
+  int64_t trueAntDelayPs;   /* Physical TX and RX antenna delay each, compared against TX_ANTD/CIA_CONF */
+  uint32_t seed;
+
+  DwModelState state;
+  int64_t deadline;         /* Next internal event, DW_MODEL_NEVER if none */
+  int64_t rxTimeoutAt;      /* Frame wait timeout, DW_MODEL_NEVER if off */
+  uint8_t w4r;              /* Turn RX on after the frame being sent */
+  uint8_t ackPending;
+  uint8_t ackSeq;
+  DwFrame tx;
+
+  const DwModelOps *ops;
+  void *ctx;
+  DwModelStats stats;
+};
+
+void dw_model_init(DwModel *dev, double ppm, double tick0, uint32_t seed, const DwModelOps *ops, void *ctx);
+void dw_model_spi(DwModel *dev, int64_t now, const uint8_t *header, uint16_t headerLength, const uint8_t *txBody,
+                  uint8_t *rxBody, uint16_t bodyLength);
+int64_t dw_model_deadline(const DwModel *dev);
+void dw_model_advance(DwModel *dev, int64_t now);
+int dw_model_irq(const DwModel *dev);
+int dw_model_listening(const DwModel *dev);
+void dw_model_lock(DwModel *dev, int64_t now);
+void dw_model_power_off(DwModel *dev);
+void dw_model_receive(DwModel *dev, int64_t now, const DwFrame *frame, int64_t rmarkerArrivalPs, int intact,
+                      double remotePpm);
+uint64_t dw_model_ticks(const DwModel *dev, int64_t t);
+int64_t dw_model_time_of(const DwModel *dev, uint64_t ticks);
+int64_t dw_model_preamble_ps(uint16_t symbols, int sfdLong);
+int64_t dw_model_airtime_ps(uint16_t preambleSymbols, int sfdLong, int rate6m8, int phr6m8, uint16_t length);
+
+#endif /* DW3000_MODEL_H_ */
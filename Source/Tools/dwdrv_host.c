@@ -0,0 +1,726 @@
+/*
+ * dwdrv_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * The DW3000 driver (deca_device.c) on the host: writetospi(), writetospiwithcrc() and readfromspi() are backed by two
+ * DW3000 models (dw3000_model/) on a line of sight link, so the driver's hot paths can be measured and regression
+ * checked without boards. For each SPI CRC mode (off, writes, writes and reads) both ICs are brought up as uwb_slave.c
+ * and uwb_master.c do it, then run single-sided TWR exchanges through dwt_isr() and the ranging calls of the firmware:
+ * dwt_readrangingsnapshot(), resp_msg_set_ts()/resp_msg_get_ts() and ss_twr_distance_mm(). Per phase it reports the
+ * SPI transactions, bytes and SPI time the driver used, and per mode the time to range (poll written to distance
+ * computed) and the range error.
+ *
+ * Time is simulated: a transaction takes its bits at the SPI clock plus the per path software overhead of
+ * deca_spi_host.c (estimates, not measurements), deca_sleep() and deca_usleep() take their argument, code runs in zero
+ * time and an interrupt is taken as soon as an IRQ line is high. Both ICs hang off the one host on their own chip
+ * selects; the driver is switched between them with dwt_setlocaldataptr().
+ *
+ * With -e N, one CRC protected SPI transaction in N has a bit flipped on the wire after its CRC was formed: MOSI for
+ * writes, caught by the model (SYS_STATUS SPICRCE), MISO for reads in write and read mode, caught by the driver
+ * (SPI_RD_CRC, the cbSPIRDErr callback). The exchanges themselves then go wrong in whatever way the fault leads to.
+ *
+ * Exits with 1 if a check fails: without faults, an exchange that did not complete, a range error beyond the tolerance
+ * or any CRC error; with faults, a corrupted transaction that was not caught.
+ *
+ * Usage: dwdrv_host [-n exchanges] [-d distance_m] [-p ppm] [-f spi_hz] [-e one_in_n] [-t tolerance_mm] [-S seed]
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+#include "dw3000_model.h"
+
+#define DEVICES 2
+#define INITIATOR 0
+#define RESPONDER 1
+
+#define PS_PER_US 1000000LL
+#define PS_PER_MS 1000000000LL
+#define LIGHT_M_PER_S 299792458.0
+#define ACQUIRE_PS (16 * PS_PER_US)   /* Preamble needed to acquire the signal, as netsim.c */
+
+/* Per path SPI overheads, as deca_spi_host.c */
+#define SPI_FAST_OVERHEAD_PS 300000LL
+#define SPI_HAL_OVERHEAD_PS 2000000LL
+
+/* Ranging constants of uwb_slave.c and uwb_master.c */
+#define ANT_DLY 16385
+#define POLL_TX_TO_RESP_RX_DLY_UUS 240
+#define RESP_RX_TIMEOUT_UUS 210
+#define POLL_RX_TO_RESP_TX_DLY_UUS 450
+#define EXCHANGE_PERIOD_PS (10 * PS_PER_MS)
+
+#define POLL_LEN 12
+#define RESP_LEN 20
+#define RESP_POLL_RX_TS_IDX 10
+#define RESP_RESP_TX_TS_IDX 14
+#define SEQ_IDX 2
+#define FUNC_CODE_IDX 9
+
+#define EVENTS_MASK (SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK | \
+                     SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK | \
+                     SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK | \
+                     SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK)
+
+typedef enum
+{
+  PH_INIT,      /* dwt_initialise() to interrupts unmasked, per IC */
+  PH_POLL,      /* Initiator: poll written and sent with response expected */
+  PH_RESP,      /* Responder: dwt_isr() on the poll, response programmed as a delayed TX */
+  PH_TXDONE,    /* Either: dwt_isr() on TX done */
+  PH_RANGE,     /* Initiator: dwt_isr() on the response, distance computed */
+  PH_OTHER,     /* Either: dwt_isr() on a timeout or error */
+  PH_COUNT
+} Phase;
+
+static const char *const phase_names[PH_COUNT] = {"init", "poll", "resp", "txdone", "range", "other"};
+
+typedef struct
+{
+  uint32_t calls;
+  uint64_t transactions;
+  uint64_t bytes;
+  int64_t spiPs;
+} PhaseStats;
+
+/* One frame on its way to the other IC */
+typedef struct
+{
+  DwFrame f;
+  int active;
+  int locked;
+  int aborted;
+  int64_t start;
+  int64_t lockAt;
+  int64_t rmarker;
+  int64_t end;
+} Air;
+
+static struct
+{
+  int exchanges;
+  double distanceM;
+  double ppm;
+  double spiHz;
+  uint32_t faultEvery;
+  double toleranceMm;
+  uint32_t seed;
+} opt = {1000, 5.0, 10.0, 42000000.0, 0, 100.0, 1};
+
+static DwModel dw[DEVICES];
+static Air air[DEVICES];           /* Indexed by the sender */
+static int cur;                    /* IC on the chip select the driver talks to */
+static int64_t sim_now;
+static int crc_mode;
+static int crc_armed[DEVICES];     /* dwt_enablespicrccheck() done on that IC */
+static Phase phase;
+static PhaseStats stats[PH_COUNT];
+
+static uint32_t fault_count;
+static uint32_t faults_wr, faults_rd;
+static uint32_t crc_rd_errors;
+static uint32_t rng_state;
+
+static uint8_t poll_msg[POLL_LEN] = {0x41, 0x88, 0, 0xCA, 0xDE, 'W', 'A', 'V', 'E', 0xE0, 0, 0};
+static uint8_t resp_msg[RESP_LEN] = {0x41, 0x88, 0, 0xCA, 0xDE, 'V', 'E', 'W', 'A', 0xE1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static uint8_t rx_buffer[RESP_LEN];
+
+/* Exchange in progress */
+static int64_t exchange_start;
+static int exchange_done;
+static int32_t exchange_mm;
+
+static dwt_config_t config = {
+        5,               /* Channel number. */
+        DWT_PLEN_128,    /* Preamble length. Used in TX only. */
+        DWT_PAC8,        /* Preamble acquisition chunk size. Used in RX only. */
+        9,               /* TX preamble code. Used in TX only. */
+        9,               /* RX preamble code. Used in RX only. */
+        1,               /* Non-standard 8 symbol SFD */
+        DWT_BR_6M8,      /* Data rate. */
+        DWT_PHRMODE_STD, /* PHY header mode. */
+        DWT_PHRRATE_STD, /* PHY header rate. */
+        (129 + 8 - 8),   /* SFD timeout (preamble length + 1 + SFD length - PAC size). Used in RX only. */
+        DWT_STS_MODE_OFF, /* STS disabled */
+        DWT_STS_LEN_64,  /* STS length see allowed values in Enum dwt_sts_lengths_e */
+        DWT_PDOA_M0      /* PDOA mode off */
+};
+
+static dwt_txconfig_t txconfig = {0x34, 0xfdfdfdfd, 0x0};
+
+static uint32_t sim_random(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+/* Link and clock ------------------------------------------------------------------------------------------------------ */
+
+static int64_t next_event(void)
+{
+  int64_t next = DW_MODEL_NEVER;
+
+  for (int i = 0; i < DEVICES; i++)
+  {
+    int64_t t = dw_model_deadline(&dw[i]);
+
+    if (t < next)
+    {
+      next = t;
+    }
+    if (air[i].active && !air[i].locked && air[i].lockAt < next)
+    {
+      next = air[i].lockAt;
+    }
+    if (air[i].active && air[i].end < next)
+    {
+      next = air[i].end;
+    }
+  }
+
+  return next;
+}
+
+static void link_transmit(void *ctx, DwModel *dev, const DwFrame *frame)
+{
+  Air *a = &air[(int)(intptr_t)ctx];
+  int64_t tof = llround(opt.distanceM / LIGHT_M_PER_S * 1e12);
+  (void)dev;
+
+  memset(a, 0, sizeof(*a));
+  a->f = *frame;
+  a->active = 1;
+  a->start = frame->startPs + tof;
+  a->lockAt = a->start + ACQUIRE_PS;
+  a->rmarker = frame->rmarkerPs + tof;
+  a->end = frame->endPs + tof;
+}
+
+static void link_abort(void *ctx, DwModel *dev)
+{
+  (void)dev;
+  air[(int)(intptr_t)ctx].aborted = 1;
+}
+
+/* The receiver has just turned on: it can still acquire a frame from the other IC if enough preamble is left */
+static void link_listen(void *ctx, DwModel *dev)
+{
+  Air *a = &air[1 - (int)(intptr_t)ctx];
+  (void)dev;
+
+  if (a->active && !a->locked)
+  {
+    a->lockAt = (sim_now > a->start ? sim_now : a->start) + ACQUIRE_PS;
+  }
+}
+
+static const DwModelOps link_ops = {link_transmit, link_abort, link_listen};
+
+/* Runs both ICs and the link up to t */
+static void advance_to(int64_t t)
+{
+  for (;;)
+  {
+    int64_t next = next_event();
+
+    if (next > t)
+    {
+      break;
+    }
+    sim_now = next;
+    for (int i = 0; i < DEVICES; i++)
+    {
+      Air *a = &air[i];
+      DwModel *rx = &dw[1 - i];
+
+      if (dw_model_deadline(&dw[i]) <= sim_now)
+      {
+        dw_model_advance(&dw[i], sim_now);
+      }
+      if (a->active && !a->locked && a->lockAt <= sim_now)
+      {
+        if (dw_model_listening(rx) && a->lockAt <= a->rmarker)
+        {
+          a->locked = 1;
+          dw_model_lock(rx, sim_now);
+        }
+        else
+        {
+          a->lockAt = DW_MODEL_NEVER;   /* Until the receiver turns on, see link_listen() */
+        }
+      }
+      if (a->active && a->end <= sim_now)
+      {
+        a->active = 0;
+        if (a->locked)
+        {
+          dw_model_receive(rx, sim_now, &a->f, a->rmarker, !a->aborted, i == INITIATOR ? 0.0 : opt.ppm);
+        }
+      }
+    }
+  }
+  if (t > sim_now)
+  {
+    sim_now = t;
+  }
+}
+
+/* Platform functions of deca_device.c --------------------------------------------------------------------------------- */
+
+static int64_t spi_bit_ps(void)
+{
+  return llround(1e12 / opt.spiHz);
+}
+
+static int64_t spi_overhead(uint16_t headerLength, uint16_t bodyLength)
+{
+  if ((uint32_t)headerLength + bodyLength < DECA_SPI_FAST_LIMIT)
+  {
+    return SPI_FAST_OVERHEAD_PS;
+  }
+  return SPI_HAL_OVERHEAD_PS;   /* Bodies of DECA_SPI_DMA_THRESHOLD or more go by DMA, overhead of the same order */
+}
+
+/* One CS frame to the selected IC, with a bit flipped on the wire if its turn has come */
+static void spi_xfer(int64_t overhead, uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength,
+                     const uint8_t *bodyBuffer, uint8_t *readBuffer)
+{
+  int64_t t = overhead + (int64_t)(headerLength + bodyLength) * 8 * spi_bit_ps();
+  uint8_t body[bodyLength + 1];
+  int eligible = crc_armed[cur] &&
+                 (readBuffer ? crc_mode == DWT_SPI_CRC_MODE_WRRD : crc_mode != DWT_SPI_CRC_MODE_NO);
+  int fault = eligible && opt.faultEvery && bodyLength > 0 && ++fault_count % opt.faultEvery == 0;
+  uint32_t bit = fault ? sim_random() % (8U * bodyLength) : 0;
+
+  advance_to(sim_now + t);
+  stats[phase].transactions++;
+  stats[phase].bytes += headerLength + bodyLength;
+  stats[phase].spiPs += t;
+
+  if (fault && !readBuffer)
+  {
+    memcpy(body, bodyBuffer, bodyLength);
+    body[bit / 8] ^= (uint8_t)(1U << (bit % 8));
+    bodyBuffer = body;
+    faults_wr++;
+  }
+  dw_model_spi(&dw[cur], sim_now, headerBuffer, headerLength, bodyBuffer, readBuffer, bodyLength);
+  if (fault && readBuffer)
+  {
+    readBuffer[bit / 8] ^= (uint8_t)(1U << (bit % 8));
+    faults_rd++;
+  }
+}
+
+int writetospiwithcrc(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength,
+                      volatile const uint8_t *bodyBuffer, uint8_t crc8)
+{
+  uint8_t body[bodyLength + 1];
+
+  memcpy(body, (const uint8_t *)bodyBuffer, bodyLength);
+  body[bodyLength] = crc8;
+  spi_xfer(SPI_HAL_OVERHEAD_PS, headerLength, headerBuffer, bodyLength + 1, body, NULL);
+  return 0;
+}
+
+int writetospi(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength,
+               volatile const uint8_t *bodyBuffer)
+{
+  spi_xfer(spi_overhead(headerLength, bodyLength), headerLength, headerBuffer, bodyLength,
+           (const uint8_t *)bodyBuffer, NULL);
+  return 0;
+}
+
+int readfromspi(uint16_t headerLength, uint8_t *headerBuffer, uint16_t readLength, volatile uint8_t *readBuffer)
+{
+  spi_xfer(spi_overhead(headerLength, readLength), headerLength, headerBuffer, readLength, NULL,
+           (uint8_t *)readBuffer);
+  return 0;
+}
+
+/* The asynchronous path is not exercised here: dwt_xfer_async() and the helpers on it return DWT_ERROR with no
+ * fallback. spi_async_host checks them through the shim's queue. */
+int queuetospi(const dwt_spi_xfer_t *xfers, uint8_t count, dwt_xfer_cb_t cb, void *arg)
+{
+  (void)xfers;
+  (void)count;
+  (void)cb;
+  (void)arg;
+  return -1;
+}
+
+decaIrqStatus_t decamutexon(void)
+{
+  return 0;
+}
+
+void decamutexoff(decaIrqStatus_t s)
+{
+  (void)s;
+}
+
+void deca_sleep(unsigned int time_ms)
+{
+  advance_to(sim_now + (int64_t)time_ms * PS_PER_MS);
+}
+
+void deca_usleep(unsigned long time_us)
+{
+  advance_to(sim_now + (int64_t)time_us * PS_PER_US);
+}
+
+void wakeup_device_with_io(void)
+{
+}
+
+/* Callbacks --------------------------------------------------------------------------------------------------------- */
+
+static void select_ic(int index)
+{
+  cur = index;
+  dwt_setlocaldataptr((unsigned int)index);
+}
+
+static void spi_rd_err_cb(void)
+{
+  crc_rd_errors++;
+}
+
+static void initiator_rx_ok(const dwt_cb_data_t *cb_data)
+{
+  dwt_rangingsnapshot_t snapshot;
+  uint32_t poll_rx_ts, resp_tx_ts;
+
+  if (cb_data->datalength != RESP_LEN)
+  {
+    return;
+  }
+  dwt_readrangingsnapshot(&snapshot, rx_buffer, RESP_LEN);
+  if (rx_buffer[FUNC_CODE_IDX] != resp_msg[FUNC_CODE_IDX])
+  {
+    return;
+  }
+
+  resp_msg_get_ts(&rx_buffer[RESP_POLL_RX_TS_IDX], &poll_rx_ts);
+  resp_msg_get_ts(&rx_buffer[RESP_RESP_TX_TS_IDX], &resp_tx_ts);
+  exchange_mm = ss_twr_distance_mm((int32_t)((uint32_t)snapshot.rxStamp - (uint32_t)snapshot.txStamp),
+                                   (int32_t)(resp_tx_ts - poll_rx_ts), snapshot.clockOffset);
+  exchange_done = 1;
+}
+
+static void initiator_rx_fail(const dwt_cb_data_t *cb_data)
+{
+  (void)cb_data;
+  exchange_done = -1;
+}
+
+static void responder_rx_ok(const dwt_cb_data_t *cb_data)
+{
+  dwt_rangingsnapshot_t snapshot;
+  uint32_t resp_tx_time;
+  uint64_t resp_tx_ts;
+
+  if (cb_data->datalength == POLL_LEN)
+  {
+    dwt_readrangingsnapshot(&snapshot, rx_buffer, POLL_LEN);
+    if (rx_buffer[FUNC_CODE_IDX] == poll_msg[FUNC_CODE_IDX])
+    {
+      resp_tx_time = (uint32_t)((snapshot.rxStamp + ((uint64_t)POLL_RX_TO_RESP_TX_DLY_UUS * UUS_TO_DWT_TIME)) >> 8);
+      dwt_setdelayedtrxtime(resp_tx_time);
+      resp_tx_ts = (((uint64_t)(resp_tx_time & 0xFFFFFFFEUL)) << 8) + ANT_DLY;
+
+      resp_msg[SEQ_IDX] = rx_buffer[SEQ_IDX];
+      resp_msg_set_ts(&resp_msg[RESP_POLL_RX_TS_IDX], snapshot.rxStamp);
+      resp_msg_set_ts(&resp_msg[RESP_RESP_TX_TS_IDX], resp_tx_ts);
+      dwt_writetxdata(RESP_LEN, resp_msg, 0);
+      dwt_writetxfctrl(RESP_LEN, 0, 1);
+      if (dwt_starttx(DWT_START_TX_DELAYED) == DWT_SUCCESS)
+      {
+        return;
+      }
+    }
+  }
+  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+static void responder_rearm(const dwt_cb_data_t *cb_data)
+{
+  (void)cb_data;
+  dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/* Harness ------------------------------------------------------------------------------------------------------------ */
+
+static int bring_up(int index)
+{
+  select_ic(index);
+  phase = PH_INIT;
+  stats[phase].calls++;
+
+  while (!dwt_checkidlerc())
+  {
+    deca_usleep(10);
+  }
+  if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
+  {
+    return -1;
+  }
+  dwt_enablespicrccheck((dwt_spi_crc_mode_e)crc_mode, spi_rd_err_cb);
+  crc_armed[index] = 1;
+  dwt_setregshadow(1);
+  if (dwt_configure(&config))
+  {
+    return -1;
+  }
+  dwt_configuretxrf(&txconfig);
+  dwt_setrxantennadelay(ANT_DLY);
+  dwt_settxantennadelay(ANT_DLY);
+
+  if (index == INITIATOR)
+  {
+    dwt_setrxaftertxdelay(POLL_TX_TO_RESP_RX_DLY_UUS);
+    dwt_setrxtimeout(RESP_RX_TIMEOUT_UUS);
+    dwt_setcallbacks(NULL, initiator_rx_ok, initiator_rx_fail, initiator_rx_fail, NULL, NULL);
+  }
+  else
+  {
+    dwt_setcallbacks(responder_rearm, responder_rx_ok, responder_rearm, responder_rearm, NULL, NULL);
+  }
+  dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_TX | SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_TO |
+                    SYS_STATUS_ALL_RX_ERR);
+  dwt_setinterrupt(EVENTS_MASK, 0, DWT_ENABLE_INT_ONLY);
+
+  if (index == RESPONDER)
+  {
+    dwt_rxenable(DWT_START_RX_IMMEDIATE);
+  }
+  return 0;
+}
+
+/* Waits for an IRQ line up to until, then runs dwt_isr() for that IC. Returns 0 if none rose in time. */
+static int service(int64_t until)
+{
+  for (;;)
+  {
+    for (int i = 0; i < DEVICES; i++)
+    {
+      if (dw_model_irq(&dw[i]))
+      {
+        uint64_t status = dw[i].status;
+
+        if (status & SYS_STATUS_TXFRS_BIT_MASK)
+        {
+          phase = PH_TXDONE;
+        }
+        else if (status & SYS_STATUS_RXFCG_BIT_MASK)
+        {
+          phase = (i == INITIATOR) ? PH_RANGE : PH_RESP;
+        }
+        else
+        {
+          phase = PH_OTHER;
+        }
+        stats[phase].calls++;
+        select_ic(i);
+        dwt_isr();
+        return 1;
+      }
+    }
+
+    int64_t next = next_event();
+
+    if (next > until)
+    {
+      advance_to(until);
+      return 0;
+    }
+    advance_to(next);
+  }
+}
+
+/* One poll and its response. Returns 1 with the distance in *mm, 0 if the exchange failed. */
+static int exchange(uint8_t seq, int32_t *mm)
+{
+  int64_t deadline;
+
+  exchange_done = 0;
+  exchange_start = sim_now;
+
+  select_ic(INITIATOR);
+  phase = PH_POLL;
+  stats[phase].calls++;
+  poll_msg[SEQ_IDX] = seq;
+  dwt_writetxdata(POLL_LEN, poll_msg, 0);
+  dwt_writetxfctrl(POLL_LEN, 0, 1);
+  dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+
+  deadline = exchange_start + 5 * PS_PER_MS;
+  while (exchange_done == 0 && service(deadline))
+  {
+  }
+  /* Let the responder finish (TX done, receiver back on) before the next poll */
+  while (service(sim_now))
+  {
+  }
+
+  *mm = exchange_mm;
+  return exchange_done == 1;
+}
+
+typedef struct
+{
+  int ok;
+  double ttrSum, ttrMin, ttrMax;
+  double errSum, errSq, errMax;
+} ModeResult;
+
+static int run_mode(int mode, const char *name)
+{
+  ModeResult r = {0, 0.0, 1e300, 0.0, 0.0, 0.0, 0.0};
+  uint32_t crc_wr_errors = 0;
+  int failed = 0;
+
+  memset(stats, 0, sizeof(stats));
+  memset(air, 0, sizeof(air));
+  memset(crc_armed, 0, sizeof(crc_armed));
+  fault_count = faults_wr = faults_rd = crc_rd_errors = 0;
+  crc_mode = mode;
+  sim_now = 0;
+  for (int i = 0; i < DEVICES; i++)
+  {
+    dw_model_init(&dw[i], i == INITIATOR ? 0.0 : opt.ppm, (double)sim_random() * 256.0,
+                  sim_random(), &link_ops, (void *)(intptr_t)i);
+  }
+
+  for (int i = 0; i < DEVICES; i++)
+  {
+    if (bring_up(i))
+    {
+      fprintf(stderr, "%s: IC %d failed to initialise\n", name, i);
+      return 1;
+    }
+  }
+
+  for (int n = 0; n < opt.exchanges; n++)
+  {
+    int64_t next = sim_now + EXCHANGE_PERIOD_PS;
+    int32_t mm;
+
+    if (exchange((uint8_t)n, &mm))
+    {
+      double ttr = (double)(sim_now - exchange_start) / PS_PER_US;
+      double err = mm - opt.distanceM * 1000.0;
+
+      r.ok++;
+      r.ttrSum += ttr;
+      r.ttrMin = fmin(r.ttrMin, ttr);
+      r.ttrMax = fmax(r.ttrMax, ttr);
+      r.errSum += err;
+      r.errSq += err * err;
+      r.errMax = fmax(r.errMax, fabs(err));
+    }
+    while (service(next))
+    {
+    }
+  }
+
+  for (int i = 0; i < DEVICES; i++)
+  {
+    crc_wr_errors += dw[i].stats.spiCrcErrors;
+  }
+
+  for (int p = 0; p < PH_COUNT; p++)
+  {
+    const PhaseStats *s = &stats[p];
+
+    if (s->calls)
+    {
+      printf("%s,%s,%u,%.2f,%.1f,%.2f\n", name, phase_names[p], s->calls, (double)s->transactions / s->calls,
+             (double)s->bytes / s->calls, (double)s->spiPs / s->calls / PS_PER_US);
+    }
+  }
+  printf("# %s: %d/%d exchanges, time to range %.1f us (min %.1f max %.1f), range error mean %.1f mm rms %.1f mm "
+         "max %.1f mm, CRC errors write %u/%u injected, read %u/%u injected\n",
+         name, r.ok, opt.exchanges, r.ok ? r.ttrSum / r.ok : 0.0, r.ok ? r.ttrMin : 0.0, r.ttrMax,
+         r.ok ? r.errSum / r.ok : 0.0, r.ok ? sqrt(r.errSq / r.ok) : 0.0, r.errMax, crc_wr_errors, faults_wr,
+         crc_rd_errors, faults_rd);
+
+  if (opt.faultEvery)
+  {
+    failed = crc_wr_errors != faults_wr || crc_rd_errors != faults_rd;
+  }
+  else
+  {
+    failed = r.ok != opt.exchanges || r.errMax > opt.toleranceMm || crc_wr_errors || crc_rd_errors;
+  }
+  if (failed)
+  {
+    printf("# %s: FAILED\n", name);
+  }
+  return failed;
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-n exchanges] [-d distance_m] [-p ppm] [-f spi_hz] [-e one_in_n] [-t tolerance_mm] "
+          "[-S seed]\n", name);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  int c;
+  int failed = 0;
+
+  while ((c = getopt(argc, argv, "n:d:p:f:e:t:S:")) != -1)
+  {
+    switch (c)
+    {
+    case 'n':
+      opt.exchanges = atoi(optarg);
+      break;
+    case 'd':
+      opt.distanceM = atof(optarg);
+      break;
+    case 'p':
+      opt.ppm = atof(optarg);
+      break;
+    case 'f':
+      opt.spiHz = atof(optarg);
+      break;
+    case 'e':
+      opt.faultEvery = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 't':
+      opt.toleranceMm = atof(optarg);
+      break;
+    case 'S':
+      opt.seed = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (opt.exchanges <= 0 || opt.spiHz <= 0.0)
+  {
+    usage(argv[0]);
+  }
+  rng_state = opt.seed ? opt.seed : 1;
+
+  printf("crc_mode,phase,calls,transactions,bytes,spi_us\n");
+  failed |= run_mode(DWT_SPI_CRC_MODE_NO, "off");
+  failed |= run_mode(DWT_SPI_CRC_MODE_WR, "wr");
+  failed |= run_mode(DWT_SPI_CRC_MODE_WRRD, "wrrd");
+
+  return failed;
+}
@@ -0,0 +1,215 @@
+/*! ----------------------------------------------------------------------------
+ * @file    deca_spi_host.c
+ * @brief   SPI access functions for the host build, in place of deca_spi.c
+ *
+ * Each transaction is handed to the simulated DW IC in one piece and holds the node for the time it would take on
+ * SPI1: the bits at the current prescaler plus a fixed software overhead per path (register level, HAL polled, DMA),
+ * which are estimates rather than measurements. The path is chosen with the same limits as deca_spi.c.
+ * The asynchronous queue runs its transactions at once; only the completion callback is deferred, to the next
+ * service point, where it runs as from the DMA interrupt.
+ */
+
+#include <string.h>
+#include <deca_spi.h>
+#include <deca_device_api.h>
+#include <port.h>
+#include "hal_shim.h"
+#include "main.h"
+
+extern  SPI_HandleTypeDef hspi1;
+
+#define SPI_FAST_OVERHEAD_PS    300000LL        /* register level path: CS, SPE check, BSY wait */
+#define SPI_HAL_OVERHEAD_PS     2000000LL       /* HAL_SPI_Transmit() calls and polled body */
+#define SPI_DMA_OVERHEAD_PS     3000000LL       /* header, DMA stream set-up and completion interrupt */
+
+static uint16_t         spi_dma_threshold = DECA_SPI_DMA_THRESHOLD;
+static uint16_t         spi_fast_limit = DECA_SPI_FAST_LIMIT;
+static uint32_t         spi_xfer_cnt = 0;
+static volatile uint8_t spi_dma_active = 0;
+
+int openspi(void)
+{
+    return 0;
+} // end openspi()
+
+int closespi(void)
+{
+    return 0;
+} // end closespi()
+
+void spi_dma_set_threshold(uint16_t bytes)
+{
+    spi_dma_threshold = bytes;
+} // end spi_dma_set_threshold()
+
+void spi_fast_set_limit(uint16_t bytes)
+{
+    spi_fast_limit = bytes;
+} // end spi_fast_set_limit()
+
+uint32_t spi_xfer_count(void)
+{
+    return spi_xfer_cnt;
+} // end spi_xfer_count()
+
+int spi_dma_busy(void)
+{
+    return spi_dma_active;
+} // end spi_dma_busy()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_bit_ps()
+ *
+ * returns the SPI1 bit time in ps: PCLK2 divided by the prescaler in hspi1.Init, as port.c sets it
+ */
+static int64_t spi_bit_ps(void)
+{
+    uint32_t div = 2U << (hspi1.Init.BaudRatePrescaler >> 3);
+
+    return 1000000000000LL * div / HAL_SHIM_APB2_HZ;
+} // end spi_bit_ps()
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: spi_host_xfer()
+ *
+ * One CS frame: holds the node for the transfer, with the DW IC IRQ masked, then applies it to the DW IC
+ */
+static void spi_host_xfer(int64_t overhead, uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength,
+                          const uint8_t *bodyBuffer, uint8_t *readBuffer)
+{
+    decaIrqStatus_t  stat ;
+
+    stat = decamutexon() ;
+    spi_xfer_cnt++;
+    hal_shim_busy(overhead + (int64_t)(headerLength + bodyLength) * 8 * spi_bit_ps());
+    hal_shim_spi(headerBuffer, headerLength, bodyBuffer, readBuffer, bodyLength);
+    decamutexoff(stat);
+} // end spi_host_xfer()
+
+static int64_t spi_overhead(uint16_t headerLength, uint16_t bodyLength)
+{
+    if((uint32_t)headerLength + bodyLength < spi_fast_limit)
+    {
+        return SPI_FAST_OVERHEAD_PS;
+    }
+    if((spi_dma_threshold != 0) && (bodyLength >= spi_dma_threshold))
+    {
+        return SPI_DMA_OVERHEAD_PS;
+    }
+    return SPI_HAL_OVERHEAD_PS;
+} // end spi_overhead()
+
+int writetospiwithcrc(
+                uint16_t      headerLength,
+                const uint8_t *headerBuffer,
+                uint16_t      bodyLength,
+                volatile const uint8_t *bodyBuffer,
+                uint8_t crc8)
+{
+    uint8_t body[bodyLength + 1];
+
+    memcpy(body, (const uint8_t *)bodyBuffer, bodyLength);
+    body[bodyLength] = crc8;
+    spi_host_xfer(SPI_HAL_OVERHEAD_PS, headerLength, headerBuffer, bodyLength + 1, body, NULL);
+    return 0;
+} // end writetospiwithcrc()
+
+int writetospi(uint16_t       headerLength,
+               const uint8_t  *headerBuffer,
+               uint16_t       bodyLength,
+               volatile const uint8_t *bodyBuffer)
+{
+    spi_host_xfer(spi_overhead(headerLength, bodyLength), headerLength, headerBuffer, bodyLength,
+                  (const uint8_t *)bodyBuffer, NULL);
+    return 0;
+} // end writetospi()
+
+uint16_t spi_cs_low_delay(uint16_t delay_ms)
+{
+    /* CS held low wakes the DW IC from sleep, which the model never enters */
+    Sleep(delay_ms);
+    return 0;
+}
+
+int readfromspi(uint16_t  headerLength,
+                uint8_t   *headerBuffer,
+                uint16_t  readlength,
+                volatile uint8_t *readBuffer)
+{
+    spi_host_xfer(spi_overhead(headerLength, readlength), headerLength, headerBuffer, readlength, NULL,
+                  (uint8_t *)readBuffer);
+    return 0;
+} // end readfromspi()
+
+int queuetospi(const dwt_spi_xfer_t *xfers, uint8_t count, dwt_xfer_cb_t cb, void *arg)
+{
+    uint8_t  i;
+
+    if((count == 0) || (count > DECA_SPI_QUEUE_LEN))
+    {
+        return -1;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        if(xfers[i].headerLength > DECA_MAX_SPI_HEADER_LENGTH)
+        {
+            return -1;
+        }
+    }
+
+    spi_dma_active = 1;
+    for(i = 0; i < count; i++)
+    {
+        const dwt_spi_xfer_t *xfer = &xfers[i];
+
+        spi_host_xfer(SPI_DMA_OVERHEAD_PS, xfer->headerLength, xfer->header, xfer->length,
+                      xfer->read ? NULL : xfer->buffer, xfer->read ? xfer->buffer : NULL);
+    }
+    spi_dma_active = 0;
+
+    if(cb != NULL)
+    {
+        hal_shim_defer(cb, 0, arg);
+    }
+
+    return 0;
+} // end queuetospi()
+
+int readfromspi_dma(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t readlength, uint8_t *readBuffer,
+                    spi_dma_cb_t cb, void *arg)
+{
+    dwt_spi_xfer_t xfer;
+
+    if(headerLength > DECA_MAX_SPI_HEADER_LENGTH)
+    {
+        return -1;
+    }
+
+    memcpy(xfer.header, headerBuffer, headerLength);
+    xfer.headerLength = headerLength;
+    xfer.read = 1;
+    xfer.length = readlength;
+    xfer.buffer = readBuffer;
+
+    return queuetospi(&xfer, 1, cb, arg);
+} // end readfromspi_dma()
+
+int writetospi_dma(uint16_t headerLength, const uint8_t *headerBuffer, uint16_t bodyLength, const uint8_t *bodyBuffer,
+                   spi_dma_cb_t cb, void *arg)
+{
+    dwt_spi_xfer_t xfer;
+
+    if(headerLength > DECA_MAX_SPI_HEADER_LENGTH)
+    {
+        return -1;
+    }
+
+    memcpy(xfer.header, headerBuffer, headerLength);
+    xfer.headerLength = headerLength;
+    xfer.read = 0;
+    xfer.length = bodyLength;
+    xfer.buffer = (uint8_t *)bodyBuffer;
+
+    return queuetospi(&xfer, 1, cb, arg);
+} // end writetospi_dma()
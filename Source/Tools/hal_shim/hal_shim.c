@@ -0,0 +1,758 @@
+/*
+ * hal_shim.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Host implementation of the HAL, CMSIS and libc entry points the firmware uses, one instance per loaded node. The
+ * node's time is the simulator's, scaled by its MCU crystal error. It only advances where the firmware waits:
+ * HAL_Delay(), __WFI(), __NOP() busy loops, SPI transactions (deca_spi_host.c) and UART output. Everything else runs
+ * in zero time.
+ *
+ * Interrupts are delivered at service points, i.e. after each of those waits and when interrupts are re-enabled:
+ * TIM2/TIM3 update (one-pulse timers as failsafe.c and controller_input.c set them up), the DW IC IRQ line on EXTI9_5
+ * (rising edge, as port.c configures it), the controller inputs on EXTI0/EXTI1 (both edges, as gpio.c configures them)
+ * and completions of queued SPI transfers. Handlers do not nest.
+ *
+ * The controller inputs read the levels the simulator drives (SimServices.inputs), every other pin reads back its
+ * output. Output changes are reported to the simulator (SimServices.outputs) as they are applied.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal_shim.h"
+#include "main.h"
+#include "tim.h"
+#include "spi.h"
+#include "usart.h"
+
+#define PS_PER_MS 1000000000LL
+#define PS_PER_S 1000000000000LL
+#define NOP_PS (1000000LL / 12)          /* usleep() in port.c counts 12 NOPs per us */
+#define GET_TICK_PS 100000LL             /* HAL_GetTick() call and compare */
+#define DW_IRQ_PIN GPIO_PIN_9            /* DW_IRQn_Pin on GPIOA */
+#define INPUT_PINS (CONTROLLER_IN_1_Pin | CONTROLLER_IN_2_Pin)   /* On GPIOC, driven by the simulator */
+#define SHIM_INPUTS 2
+#define SHIM_TIMERS 3
+#define SHIM_DEFERRED 4
+#define FLASH_BYTES (512 * 1024)
+#define FLASH_PROGRAM_PS 16000000LL     /* Word programming at x32 parallelism, typical */
+
+typedef struct
+{
+  int running;
+  int64_t startLocal;
+} ShimTimer;
+
+typedef struct
+{
+  void (*fn)(int status, void *arg);
+  int status;
+  void *arg;
+} ShimDeferred;
+
+static struct
+{
+  const SimServices *svc;
+  void *node;
+  SimNodeConfig cfg;
+  double scale;                      /* Local (MCU) time per simulation time */
+  int64_t pendingPs;                 /* Busy loop time not yet handed to the simulator */
+  uint32_t primask;
+  int inIsr;
+  int inService;
+  int irqLine;
+  int extiPending;
+  uint32_t inputs;                   /* Controller input levels last seen */
+  uint32_t inputEdges;               /* Controller input edges not yet taken, EXTI0/EXTI1 pending */
+  uint32_t odr[3];                   /* Output data last reported to the simulator */
+  int64_t cycBase;                   /* Local time CYCCNT last counted from */
+  uint32_t cycLast;
+  ShimTimer tim[SHIM_TIMERS];
+  ShimDeferred deferred[SHIM_DEFERRED];
+  int deferredCount;
+} shim;
+
+NVIC_Type hal_shim_nvic;
+static DWT_Type hal_shim_dwt;
+CoreDebug_Type hal_shim_core_debug;
+GPIO_TypeDef hal_shim_gpio[3];
+TIM_TypeDef hal_shim_tim[3];
+uint32_t SystemCoreClock = HAL_SHIM_CORE_HZ;
+
+TIM_HandleTypeDef htim1 = {.Instance = TIM1};
+TIM_HandleTypeDef htim2 = {.Instance = TIM2};
+TIM_HandleTypeDef htim3 = {.Instance = TIM3};
+SPI_HandleTypeDef hspi1 = {.Init = {.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16}};
+uint32_t hal_shim_usart2;
+uint32_t hal_shim_flash[FLASH_BYTES / 4];
+
+static void settle(void);
+
+/* Time ------------------------------------------------------------------------------------------------------------ */
+
+static int64_t local_of(int64_t t)
+{
+  return (int64_t)((double)t * shim.scale);
+}
+
+static int64_t true_of(int64_t local)
+{
+  return (int64_t)((double)local / shim.scale) + 1;
+}
+
+static int64_t local_now(void)
+{
+  return local_of(shim.svc->now(shim.node));
+}
+
+static const uint16_t input_pins[SHIM_INPUTS] = {CONTROLLER_IN_1_Pin, CONTROLLER_IN_2_Pin};
+static const IRQn_Type input_irqs[SHIM_INPUTS] = {EXTI0_IRQn, EXTI1_IRQn};
+
+static int irq_enabled(IRQn_Type irq)
+{
+  return (hal_shim_nvic.ISER[irq >> 5] >> (irq & 31)) & 1;
+}
+
+/* An EXTI line has an edge waiting for its handler */
+static int exti_pending(void)
+{
+  for (int i = 0; i < SHIM_INPUTS; i++)
+  {
+    if ((shim.inputEdges & input_pins[i]) && irq_enabled(input_irqs[i]))
+    {
+      return 1;
+    }
+  }
+  return shim.extiPending && irq_enabled(EXTI9_5_IRQn);
+}
+
+/* A rising DW IC IRQ line or a controller input edge would be taken straight away, so waits end on them */
+static int wake_on(void)
+{
+  int wake = 0;
+
+  if (shim.primask || shim.inIsr || shim.inService)
+  {
+    return 0;
+  }
+  if (!shim.irqLine && irq_enabled(EXTI9_5_IRQn))
+  {
+    wake |= SIM_WAKE_DW_IRQ;
+  }
+  if (shim.svc->inputs && (irq_enabled(EXTI0_IRQn) || irq_enabled(EXTI1_IRQn)))
+  {
+    wake |= SIM_WAKE_INPUT;
+  }
+  return wake;
+}
+
+/* Counts times ps per count would overflow for long periods (TIM2 at 2.5 s is 2.1e20 ps * Hz), so the clock is taken in
+ * kHz: up to 2^32 counts of 1e9 ps fit in int64 */
+static int64_t timer_period(const TIM_TypeDef *tim)
+{
+  int64_t counts = (int64_t)(tim->PSC + 1) * (int64_t)(tim->ARR + 1);
+
+  return counts * PS_PER_MS / (int64_t)(tim_apb1_clock_hz() / 1000);
+}
+
+/* Earliest local time a timer update is due, INT64_MAX if none */
+static int64_t next_timer_event(void)
+{
+  int64_t next = INT64_MAX;
+
+  for (int i = 0; i < SHIM_TIMERS; i++)
+  {
+    if (shim.tim[i].running)
+    {
+      int64_t due = shim.tim[i].startLocal + timer_period(&hal_shim_tim[i]);
+      if (due < next)
+      {
+        next = due;
+      }
+    }
+  }
+  return next;
+}
+
+/* Suspends the node until the given local time, or earlier on the SIM_WAKE_* events in wake */
+static void wait_local(int64_t until, int wake)
+{
+  shim.svc->wait(shim.node, true_of(until), wake);
+}
+
+/* Hands accumulated busy loop time to the simulator so the next timestamp or SPI access is taken after it */
+static void flush(void)
+{
+  if (shim.pendingPs > 0)
+  {
+    int64_t ps = shim.pendingPs;
+
+    shim.pendingPs = 0;
+    hal_shim_busy(ps);
+  }
+}
+
+int64_t hal_shim_now(void)
+{
+  flush();
+  return local_now();
+}
+
+/* Busy wait of the given local duration, interrupts are serviced on the way as they fall due */
+void hal_shim_busy(int64_t ps)
+{
+  int64_t until = local_now() + ps;
+
+  settle();
+  for (int64_t now = local_now(); now < until; now = local_now())
+  {
+    int64_t next = next_timer_event();
+
+    wait_local(next < until ? next : until, wake_on());
+    hal_shim_service();
+  }
+}
+
+/* Peripherals ----------------------------------------------------------------------------------------------------- */
+
+/* Applies pending BSRR writes and refreshes input data: pin 9 of GPIOA follows the DW IC IRQ line, the controller
+ * inputs on GPIOC the simulator */
+static void settle_gpio(void)
+{
+  uint32_t inputs = shim.svc->inputs ? shim.svc->inputs(shim.node) & INPUT_PINS : 0;
+
+  for (int i = 0; i < 3; i++)
+  {
+    GPIO_TypeDef *port = &hal_shim_gpio[i];
+    uint32_t bsrr = port->BSRR;
+
+    if (bsrr)
+    {
+      port->ODR = (port->ODR & ~(bsrr >> 16)) | (bsrr & 0xFFFF);
+      port->BSRR = 0;
+    }
+    port->IDR = port->ODR & 0xFFFF;
+    if (port->ODR != shim.odr[i])
+    {
+      shim.odr[i] = port->ODR;
+      if (shim.svc->outputs)
+      {
+        shim.svc->outputs(shim.node, i, port->ODR);
+      }
+    }
+  }
+
+  GPIOC->IDR = (GPIOC->IDR & ~INPUT_PINS) | inputs;
+  shim.inputEdges |= inputs ^ shim.inputs;
+  shim.inputs = inputs;
+
+  int line = shim.svc->irq_line(shim.node);
+  if (line && !shim.irqLine)
+  {
+    shim.extiPending = 1;
+  }
+  shim.irqLine = line;
+  if (line)
+  {
+    GPIOA->IDR |= DW_IRQ_PIN;
+  }
+  else
+  {
+    GPIOA->IDR &= ~DW_IRQ_PIN;
+  }
+}
+
+/* Follows register writes to the timers: UG restarts the count, CEN starts it, expiry sets UIF and in one-pulse
+ * mode clears CEN */
+static void settle_timers(void)
+{
+  int64_t now = local_now();
+
+  for (int i = 0; i < SHIM_TIMERS; i++)
+  {
+    TIM_TypeDef *tim = &hal_shim_tim[i];
+    ShimTimer *st = &shim.tim[i];
+
+    if (tim->EGR & TIM_EGR_UG)
+    {
+      tim->EGR = 0;
+      st->startLocal = now;
+      if (!(tim->CR1 & TIM_CR1_URS))
+      {
+        tim->SR |= TIM_SR_UIF;
+      }
+    }
+    if (!(tim->CR1 & TIM_CR1_CEN))
+    {
+      st->running = 0;
+      continue;
+    }
+    if (!st->running)
+    {
+      st->running = 1;
+      st->startLocal = now;
+    }
+    int64_t period = timer_period(tim);
+    if (now >= st->startLocal + period)
+    {
+      tim->SR |= TIM_SR_UIF;
+      if (tim->CR1 & TIM_CR1_OPM)
+      {
+        tim->CR1 &= ~TIM_CR1_CEN;
+        st->running = 0;
+      }
+      else
+      {
+        st->startLocal += ((now - st->startLocal) / period) * period;
+      }
+    }
+  }
+}
+
+static void settle(void)
+{
+  settle_gpio();
+  settle_timers();
+}
+
+void hal_shim_defer(void (*fn)(int status, void *arg), int status, void *arg)
+{
+  if (shim.deferredCount < SHIM_DEFERRED)
+  {
+    shim.deferred[shim.deferredCount++] = (ShimDeferred){fn, status, arg};
+  }
+}
+
+/* Service point: runs the handlers of whatever is pending and enabled */
+void hal_shim_service(void)
+{
+  static TIM_HandleTypeDef *const handles[SHIM_TIMERS] = {&htim1, &htim2, &htim3};
+  static const IRQn_Type timer_irqs[SHIM_TIMERS] = {TIM1_CC_IRQn, TIM2_IRQn, TIM3_IRQn};
+
+  settle();
+  if (shim.primask || shim.inIsr || shim.inService)
+  {
+    return;
+  }
+  shim.inService = 1;
+
+  while (shim.deferredCount)
+  {
+    ShimDeferred d = shim.deferred[0];
+
+    shim.deferredCount--;
+    memmove(&shim.deferred[0], &shim.deferred[1], shim.deferredCount * sizeof(shim.deferred[0]));
+    shim.inIsr = 1;
+    d.fn(d.status, d.arg);
+    shim.inIsr = 0;
+    settle();
+  }
+
+  for (int i = 0; i < SHIM_TIMERS; i++)
+  {
+    TIM_TypeDef *tim = &hal_shim_tim[i];
+
+    if ((tim->SR & TIM_SR_UIF) && (tim->DIER & TIM_DIER_UIE) && irq_enabled(timer_irqs[i]))
+    {
+      tim->SR &= ~TIM_SR_UIF;
+      shim.inIsr = 1;
+      HAL_TIM_PeriodElapsedCallback(handles[i]);
+      shim.inIsr = 0;
+      settle();
+    }
+  }
+
+  if (shim.extiPending && irq_enabled(EXTI9_5_IRQn))
+  {
+    shim.extiPending = 0;
+    shim.inIsr = 1;
+    HAL_GPIO_EXTI_Callback(DW_IRQ_PIN);
+    shim.inIsr = 0;
+    settle();
+  }
+
+  for (int i = 0; i < SHIM_INPUTS; i++)
+  {
+    if ((shim.inputEdges & input_pins[i]) && irq_enabled(input_irqs[i]))
+    {
+      shim.inputEdges &= ~(uint32_t)input_pins[i];
+      shim.inIsr = 1;
+      HAL_GPIO_EXTI_Callback(input_pins[i]);
+      shim.inIsr = 0;
+      settle();
+    }
+  }
+
+  shim.inService = 0;
+}
+
+void hal_shim_start(const SimServices *services, void *node, const SimNodeConfig *config)
+{
+  shim.svc = services;
+  shim.node = node;
+  shim.cfg = *config;
+  shim.scale = 1.0 + config->mcuPpm * 1e-6;
+  for (int i = 0; i < 8; i++)
+  {
+    hal_shim_nvic.ISER[i] = 0;
+  }
+  /* Enabled by HAL_TIM_Base_MspInit() and MX_GPIO_Init() on target, the DW IC EXTI line is left to port.c */
+  hal_shim_nvic.ISER[TIM2_IRQn >> 5] |= 1UL << (TIM2_IRQn & 31);
+  hal_shim_nvic.ISER[TIM3_IRQn >> 5] |= 1UL << (TIM3_IRQn & 31);
+  hal_shim_nvic.ISER[EXTI0_IRQn >> 5] |= 1UL << (EXTI0_IRQn & 31);
+  hal_shim_nvic.ISER[EXTI1_IRQn >> 5] |= 1UL << (EXTI1_IRQn & 31);
+  memset(hal_shim_flash, 0xFF, sizeof(hal_shim_flash));
+  settle();
+}
+
+void hal_shim_halt(void)
+{
+  shim.svc->halt(shim.node);
+}
+
+void hal_shim_spi(const uint8_t *header, uint16_t headerLength, const uint8_t *txBody, uint8_t *rxBody,
+                  uint16_t bodyLength)
+{
+  shim.svc->spi(shim.node, header, headerLength, txBody, rxBody, bodyLength);
+  settle_gpio();
+}
+
+/* CMSIS ------------------------------------------------------------------------------------------------------------ */
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  hal_shim_nvic.ISER[IRQn >> 5] |= 1UL << (IRQn & 31);
+  flush();
+  hal_shim_service();
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  hal_shim_nvic.ISER[IRQn >> 5] &= ~(1UL << (IRQn & 31));
+}
+
+void __NOP(void)
+{
+  shim.pendingPs += NOP_PS;
+  if (shim.pendingPs >= PS_PER_MS)
+  {
+    flush();
+  }
+}
+
+/* Sleeps until the DW IC IRQ rises, a controller input changes, a timer expires or the next SysTick */
+void __WFI(void)
+{
+  int64_t now = hal_shim_now();
+  int64_t until = (now / PS_PER_MS + 1) * PS_PER_MS;
+  int64_t next = next_timer_event();
+
+  settle_gpio();
+  if (!exti_pending())
+  {
+    /* EXTI is edge triggered: a line already high does not wake the core */
+    wait_local(next < until ? next : until, wake_on());
+  }
+  hal_shim_service();
+}
+
+void __disable_irq(void)
+{
+  shim.primask = 1;
+}
+
+void __enable_irq(void)
+{
+  shim.primask = 0;
+  flush();
+  hal_shim_service();
+}
+
+uint32_t __get_PRIMASK(void)
+{
+  return shim.primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+  if (priMask)
+  {
+    __disable_irq();
+  }
+  else
+  {
+    __enable_irq();
+  }
+}
+
+/* GPIO ------------------------------------------------------------------------------------------------------------- */
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+  (void)GPIOx;
+  (void)GPIO_Init;
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+  (void)GPIOx;
+  (void)GPIO_Pin;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  flush();
+  settle_gpio();
+  return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  GPIOx->BSRR = PinState == GPIO_PIN_RESET ? (uint32_t)GPIO_Pin << 16 : GPIO_Pin;
+  settle_gpio();
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  GPIOx->ODR ^= GPIO_Pin;
+  settle_gpio();
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+  (void)IRQn;
+  (void)PreemptPriority;
+  (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  NVIC_EnableIRQ(IRQn);
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  NVIC_DisableIRQ(IRQn);
+}
+
+/* Timers, SPI, clocks ---------------------------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  (void)htim;
+  (void)Channel;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  (void)htim;
+  (void)Channel;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  (void)htim;
+  (void)Channel;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  (void)htim;
+  (void)Channel;
+  return HAL_OK;
+}
+
+uint32_t tim_apb1_clock_hz(void)
+{
+  return 2 * HAL_SHIM_APB1_HZ;
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+  (void)hspi;
+  return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+  return HAL_SHIM_APB1_HZ;
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+  return HAL_SHIM_APB2_HZ;
+}
+
+uint32_t HAL_GetUIDw0(void)
+{
+  return shim.cfg.uid[0];
+}
+
+uint32_t HAL_GetUIDw1(void)
+{
+  return shim.cfg.uid[1];
+}
+
+uint32_t HAL_GetUIDw2(void)
+{
+  return shim.cfg.uid[2];
+}
+
+/* SysTick ---------------------------------------------------------------------------------------------------------- */
+
+uint32_t HAL_GetTick(void)
+{
+  shim.pendingPs += GET_TICK_PS;
+
+  int64_t now = hal_shim_now();
+  hal_shim_service();
+  return (uint32_t)(now / PS_PER_MS);
+}
+
+/* As the HAL: at least Delay whole SysTick periods */
+void HAL_Delay(uint32_t Delay)
+{
+  int64_t now = hal_shim_now();
+  int64_t until = (now / PS_PER_MS + (int64_t)Delay + 1) * PS_PER_MS;
+
+  hal_shim_busy(until - now);
+}
+
+/* DWT cycle counter, SystemCoreClock cycles of local time. The cycle is not a whole number of ps (11904.76 at 84 MHz),
+ * so cycles are counted from ns with the clock in MHz rather than from a rounded cycle time. */
+DWT_Type *hal_shim_dwt_sync(void)
+{
+  const int64_t core_mhz = HAL_SHIM_CORE_HZ / 1000000;
+  int64_t now = hal_shim_now();
+
+  if (hal_shim_dwt.CYCCNT != shim.cycLast)
+  {
+    shim.cycBase = now - (int64_t)hal_shim_dwt.CYCCNT * 1000000 / core_mhz;
+  }
+  if (hal_shim_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk)
+  {
+    hal_shim_dwt.CYCCNT = (uint32_t)((now - shim.cycBase) / 1000 * core_mhz / 1000);
+  }
+  shim.cycLast = hal_shim_dwt.CYCCNT;
+  return &hal_shim_dwt;
+}
+
+/* Flash ------------------------------------------------------------------------------------------------------------ */
+
+/* The CPU stalls while the flash is busy, interrupts are taken once it is done. Sectors 0-3 are 16 KB, 4 is 64 KB and
+ * 5-7 are 128 KB, erased in 250 ms, 550 ms and 1 s (typical, x32). */
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data)
+{
+  if (TypeProgram != FLASH_TYPEPROGRAM_WORD || Address < FLASH_BASE || Address >= FLASH_BASE + FLASH_BYTES ||
+      (Address & 3))
+  {
+    return HAL_ERROR;
+  }
+  hal_shim_flash[(Address - FLASH_BASE) / 4] &= (uint32_t)Data;
+  shim.pendingPs += FLASH_PROGRAM_PS;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+  for (uint32_t sector = pEraseInit->Sector; sector < pEraseInit->Sector + pEraseInit->NbSectors; sector++)
+  {
+    static const uint32_t erase_ms[3] = {250, 550, 1000};
+    uint32_t start = sector < 4 ? sector * 0x4000 : sector == 4 ? 0x10000 : (sector - 4) * 0x20000;
+    uint32_t size = sector < 4 ? 0x4000 : sector == 4 ? 0x10000 : 0x20000;
+
+    if (sector > 7)
+    {
+      *SectorError = sector;
+      return HAL_ERROR;
+    }
+    memset((uint8_t *)hal_shim_flash + start, 0xFF, size);
+    shim.pendingPs += erase_ms[sector < 4 ? 0 : sector == 4 ? 1 : 2] * PS_PER_MS;
+  }
+  *SectorError = 0xFFFFFFFFU;
+  return HAL_OK;
+}
+
+/* Console ---------------------------------------------------------------------------------------------------------- */
+
+/* UART2 8N1, blocking: the caller is held for the time the bytes take on the wire. Output reaches the simulator as it
+ * is sent; main.c is not run, so the baud rate is HAL_SHIM_UART_BAUD unless HAL_UART_Init() set another. */
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+  HAL_UART_MspInit(huart);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  uint32_t baud = huart->Init.BaudRate ? huart->Init.BaudRate : HAL_SHIM_UART_BAUD;
+  (void)Timeout;
+
+  if (Size == 0)
+  {
+    return HAL_OK;
+  }
+  flush();
+  shim.svc->uart(shim.node, (const char *)pData, Size);
+  hal_shim_busy((int64_t)Size * 10 * PS_PER_S / baud);
+  return HAL_OK;
+}
+
+/* Nothing is ever typed on the host console */
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  (void)huart;
+  (void)pData;
+  (void)Size;
+  (void)Timeout;
+  return HAL_ERROR;
+}
+
+/* stdio of the firmware goes to _write() in usart.c, as newlib's does on the target */
+int _write(int file, char *ptr, int len);
+
+int printf(const char *format, ...)
+{
+  char buf[256];
+  va_list ap;
+
+  va_start(ap, format);
+  int n = vsnprintf(buf, sizeof(buf), format, ap);
+  va_end(ap);
+  if (n >= (int)sizeof(buf))
+  {
+    n = sizeof(buf) - 1;
+  }
+  return n > 0 ? _write(1, buf, n) : n;
+}
+
+int puts(const char *s)
+{
+  int n = _write(1, (char *)s, (int)strlen(s));
+
+  _write(1, "\n", 1);
+  return n + 1;
+}
+
+int putchar(int c)
+{
+  char ch = (char)c;
+
+  _write(1, &ch, 1);
+  return c;
+}
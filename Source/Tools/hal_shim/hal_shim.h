@@ -0,0 +1,30 @@
+/*
+ * hal_shim.h
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Shim internals shared by hal_shim.c, deca_spi_host.c and node_main.c.
+ */
+
+#ifndef HAL_SHIM_H_
+#define HAL_SHIM_H_
+
+#include <stdint.h>
+#include "sim_services.h"
+#include "stm32f4xx_hal.h"
+
+#define HAL_SHIM_CORE_HZ 84000000UL
+#define HAL_SHIM_APB1_HZ 42000000UL
+#define HAL_SHIM_APB2_HZ 84000000UL
+#define HAL_SHIM_UART_BAUD 115200UL
+
+void hal_shim_start(const SimServices *services, void *node, const SimNodeConfig *config);
+void hal_shim_halt(void);
+int64_t hal_shim_now(void);
+void hal_shim_busy(int64_t ps);
+void hal_shim_service(void);
+void hal_shim_spi(const uint8_t *header, uint16_t headerLength, const uint8_t *txBody, uint8_t *rxBody,
+                  uint16_t bodyLength);
+void hal_shim_defer(void (*fn)(int status, void *arg), int status, void *arg);
+
+#endif /* HAL_SHIM_H_ */
@@ -0,0 +1,37 @@
+/*
+ * node_main.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Entry point of a simulated node, in place of main(): the peripherals are already up in the shim, so this goes
+ * straight to the application code main() runs after the CubeMX initialisation, with the role given by the simulator
+ * instead of the uwb_master()/uwb_slave() line chosen at build time.
+ */
+
+#include "hal_shim.h"
+#include "main.h"
+#include "error_led.h"
+#include "uwb_master.h"
+#include "uwb_slave.h"
+
+void sim_node_entry(const SimServices *services, void *node, const SimNodeConfig *config)
+{
+  hal_shim_start(services, node, config);
+  initErrorLed();
+
+  if (config->role == SIM_ROLE_SLAVE)
+  {
+    uwb_slave();
+  }
+  else
+  {
+    uwb_master();
+  }
+  hal_shim_halt();
+}
+
+void Error_Handler(void)
+{
+  __disable_irq();
+  hal_shim_halt();
+}
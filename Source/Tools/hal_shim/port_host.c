@@ -0,0 +1,15 @@
+/*
+ * port_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Builds port.c unchanged for the host. port.h declares portGetTickCnt() as returning unsigned long while port.c
+ * defines it as uint32_t, which only agree on the 32-bit target, so the declaration is renamed out of the way before
+ * port.c is pulled in.
+ */
+
+#define portGetTickCnt portGetTickCnt_declaration
+#include <port.h>
+#undef portGetTickCnt
+
+#include "../../Core/Src/platform/port.c"
@@ -0,0 +1,52 @@
+/*
+ * sim_services.h
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Interface between a simulated node (the firmware linked against the HAL shim, built as libbitrad_node.so) and the
+ * simulator hosting it. Times are picoseconds of simulation time, the shim applies the node's own MCU clock error.
+ */
+
+#ifndef SIM_SERVICES_H_
+#define SIM_SERVICES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIM_ROLE_MASTER 0
+#define SIM_ROLE_SLAVE 1
+
+#define SIM_NODE_ENTRY "sim_node_entry"
+
+/* What ends a wait early, SimServices.wait() */
+#define SIM_WAKE_DW_IRQ 1      /* The DW IC IRQ line is high */
+#define SIM_WAKE_INPUT 2       /* The inputs() levels change */
+
+typedef struct
+{
+  int role;              /* SIM_ROLE_MASTER or SIM_ROLE_SLAVE */
+  uint32_t uid[3];       /* MCU unique ID, the short address is derived from it */
+  double mcuPpm;         /* MCU crystal error: SysTick, timers and busy loops run this much fast */
+} SimNodeConfig;
+
+typedef struct
+{
+  int64_t (*now)(void *node);
+  /* Suspends the node until the given time, or earlier on the SIM_WAKE_* events set in wake_on */
+  void (*wait)(void *node, int64_t until, int wake_on);
+  /* One SPI transaction, applied to the DW IC at the current time */
+  void (*spi)(void *node, const uint8_t *header, uint16_t headerLength, const uint8_t *txBody, uint8_t *rxBody,
+              uint16_t bodyLength);
+  int (*irq_line)(void *node);
+  void (*uart)(void *node, const char *text, size_t length);
+  /* Error_Handler() or a return from the application: the node stops for good, does not return */
+  void (*halt)(void *node);
+  /* Levels driven onto the controller inputs, bit n is pin n of GPIOC (CONTROLLER_IN_1/2), NULL if never driven */
+  uint32_t (*inputs)(void *node);
+  /* A GPIO output data register changed, port 0 to 2 is GPIOA to GPIOC, NULL if not followed */
+  void (*outputs)(void *node, int port, uint32_t odr);
+} SimServices;
+
+typedef void (*SimNodeEntry)(const SimServices *services, void *node, const SimNodeConfig *config);
+
+#endif /* SIM_SERVICES_H_ */
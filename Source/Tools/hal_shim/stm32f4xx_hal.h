@@ -0,0 +1,370 @@
+/*
+ * stm32f4xx_hal.h
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Host stand-in for the STM32F4 HAL and CMSIS headers, just the part the application, port.c and the DW IC driver use.
+ * Peripherals are plain structures (one set per loaded node) that hal_shim.c brings up to date at each service point:
+ * timer counts and update interrupts, GPIO BSRR writes and the EXTI line of the DW IC IRQ. Time only advances in
+ * waits (HAL_Delay, __WFI, busy loops of __NOP, SPI transactions, UART output), see hal_shim.c.
+ */
+
+#ifndef HAL_SHIM_STM32F4XX_HAL_H_
+#define HAL_SHIM_STM32F4XX_HAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define __IO volatile
+#define __INLINE
+#define __packed __attribute__((packed))
+#define UNUSED(X) (void)(X)
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+typedef enum
+{
+  HAL_OK = 0x00U,
+  HAL_ERROR = 0x01U,
+  HAL_BUSY = 0x02U,
+  HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+  HAL_UNLOCKED = 0x00U,
+  HAL_LOCKED = 0x01U
+} HAL_LockTypeDef;
+
+#define __HAL_LOCK(__HANDLE__)                                                                                          \
+  do                                                                                                                    \
+  {                                                                                                                     \
+    if ((__HANDLE__)->Lock == HAL_LOCKED)                                                                               \
+    {                                                                                                                   \
+      return HAL_BUSY;                                                                                                  \
+    }                                                                                                                   \
+    (__HANDLE__)->Lock = HAL_LOCKED;                                                                                    \
+  } while (0U)
+#define __HAL_UNLOCK(__HANDLE__) ((__HANDLE__)->Lock = HAL_UNLOCKED)
+
+typedef enum
+{
+  RESET = 0U,
+  SET = !RESET
+} FlagStatus, ITStatus;
+
+/* Cortex-M4 ------------------------------------------------------------------------------------------------------- */
+
+typedef enum
+{
+  EXTI0_IRQn = 6,
+  EXTI1_IRQn = 7,
+  EXTI9_5_IRQn = 23,
+  TIM1_CC_IRQn = 27,
+  TIM2_IRQn = 28,
+  TIM3_IRQn = 29,
+  USART2_IRQn = 38
+} IRQn_Type;
+
+typedef struct
+{
+  __IO uint32_t ISER[8];
+} NVIC_Type;
+
+typedef struct
+{
+  __IO uint32_t CTRL;
+  __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  __IO uint32_t DHCSR;
+  __IO uint32_t DCRSR;
+  __IO uint32_t DCRDR;
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern NVIC_Type hal_shim_nvic;
+extern CoreDebug_Type hal_shim_core_debug;
+extern uint32_t SystemCoreClock;
+
+#define NVIC (&hal_shim_nvic)
+#define DWT (hal_shim_dwt_sync())
+#define CoreDebug (&hal_shim_core_debug)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk 1UL
+
+/* Brings CYCCNT up to the node's time before each access, a write to it restarts the count from that value */
+DWT_Type *hal_shim_dwt_sync(void);
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void __NOP(void);
+void __WFI(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+
+/* GPIO ------------------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  __IO uint32_t MODER;
+  __IO uint32_t OTYPER;
+  __IO uint32_t OSPEEDR;
+  __IO uint32_t PUPDR;
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+  __IO uint32_t BSRR;
+  __IO uint32_t LCKR;
+  __IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef hal_shim_gpio[3];
+
+#define GPIOA (&hal_shim_gpio[0])
+#define GPIOB (&hal_shim_gpio[1])
+#define GPIOC (&hal_shim_gpio[2])
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT 0x00000000U
+#define GPIO_MODE_OUTPUT_PP 0x00000001U
+#define GPIO_MODE_OUTPUT_OD 0x00000011U
+#define GPIO_MODE_IT_RISING 0x10110000U
+#define GPIO_MODE_IT_FALLING 0x10210000U
+#define GPIO_MODE_IT_RISING_FALLING 0x10310000U
+#define GPIO_MODE_AF_PP 0x00000002U
+#define GPIO_NOPULL 0x00000000U
+#define GPIO_PULLUP 0x00000001U
+#define GPIO_PULLDOWN 0x00000002U
+#define GPIO_SPEED_FREQ_LOW 0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM 0x00000001U
+#define GPIO_SPEED_FREQ_HIGH 0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH 0x00000003U
+
+#define GPIO_AF7_USART2 ((uint8_t)0x07)
+
+#define __HAL_GPIO_EXTI_CLEAR_IT(__EXTI_LINE__) ((void)(__EXTI_LINE__))
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/* Timers ----------------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t SMCR;
+  __IO uint32_t DIER;
+  __IO uint32_t SR;
+  __IO uint32_t EGR;
+  __IO uint32_t CCMR1;
+  __IO uint32_t CCMR2;
+  __IO uint32_t CCER;
+  __IO uint32_t CNT;
+  __IO uint32_t PSC;
+  __IO uint32_t ARR;
+  __IO uint32_t RCR;
+  __IO uint32_t CCR1;
+  __IO uint32_t CCR2;
+  __IO uint32_t CCR3;
+  __IO uint32_t CCR4;
+  __IO uint32_t BDTR;
+} TIM_TypeDef;
+
+typedef struct
+{
+  uint32_t Prescaler;
+  uint32_t CounterMode;
+  uint32_t Period;
+  uint32_t ClockDivision;
+  uint32_t RepetitionCounter;
+  uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+  TIM_TypeDef *Instance;
+  TIM_Base_InitTypeDef Init;
+  HAL_LockTypeDef Lock;
+} TIM_HandleTypeDef;
+
+extern TIM_TypeDef hal_shim_tim[3];
+
+#define TIM1 (&hal_shim_tim[0])
+#define TIM2 (&hal_shim_tim[1])
+#define TIM3 (&hal_shim_tim[2])
+
+#define TIM_CR1_CEN 0x0001U
+#define TIM_CR1_URS 0x0004U
+#define TIM_CR1_OPM 0x0008U
+#define TIM_EGR_UG 0x0001U
+#define TIM_SR_UIF 0x0001U
+#define TIM_DIER_UIE 0x0001U
+#define TIM_FLAG_UPDATE TIM_SR_UIF
+#define TIM_IT_UPDATE TIM_DIER_UIE
+#define TIM_CHANNEL_1 0x00000000U
+#define TIM_CHANNEL_2 0x00000004U
+#define TIM_CHANNEL_3 0x00000008U
+#define TIM_CHANNEL_4 0x0000000CU
+
+#define __HAL_TIM_ENABLE(__HANDLE__) ((__HANDLE__)->Instance->CR1 |= TIM_CR1_CEN)
+#define __HAL_TIM_DISABLE(__HANDLE__) ((__HANDLE__)->Instance->CR1 &= ~TIM_CR1_CEN)
+#define __HAL_TIM_SET_PRESCALER(__HANDLE__, __PRESC__) ((__HANDLE__)->Instance->PSC = (__PRESC__))
+#define __HAL_TIM_SET_AUTORELOAD(__HANDLE__, __AUTORELOAD__)                                                            \
+  do                                                                                                                    \
+  {                                                                                                                     \
+    (__HANDLE__)->Instance->ARR = (__AUTORELOAD__);                                                                     \
+    (__HANDLE__)->Init.Period = (__AUTORELOAD__);                                                                       \
+  } while (0)
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__)                                                     \
+  (*(&(__HANDLE__)->Instance->CCR1 + ((__CHANNEL__) >> 2U)) = (__COMPARE__))
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__) ((__HANDLE__)->Instance->SR = ~(__FLAG__))
+#define __HAL_TIM_ENABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DIER |= (__INTERRUPT__))
+#define __HAL_TIM_DISABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DIER &= ~(__INTERRUPT__))
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Stop_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+/* SPI and UART ----------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  uint32_t Mode;
+  uint32_t BaudRatePrescaler;
+} SPI_InitTypeDef;
+
+typedef struct
+{
+  void *Instance;
+  SPI_InitTypeDef Init;
+  HAL_LockTypeDef Lock;
+} SPI_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t BaudRate;
+  uint32_t WordLength;
+  uint32_t StopBits;
+  uint32_t Parity;
+  uint32_t Mode;
+  uint32_t HwFlowCtl;
+  uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+  void *Instance;
+  UART_InitTypeDef Init;
+  HAL_LockTypeDef Lock;
+} UART_HandleTypeDef;
+
+extern uint32_t hal_shim_usart2;
+
+#define USART2 ((void *)&hal_shim_usart2)
+
+#define SPI_BAUDRATEPRESCALER_2 0x00000000U
+#define SPI_BAUDRATEPRESCALER_4 0x00000008U
+#define SPI_BAUDRATEPRESCALER_8 0x00000010U
+#define SPI_BAUDRATEPRESCALER_16 0x00000018U
+#define SPI_BAUDRATEPRESCALER_32 0x00000020U
+#define SPI_BAUDRATEPRESCALER_64 0x00000028U
+#define SPI_BAUDRATEPRESCALER_128 0x00000030U
+#define SPI_BAUDRATEPRESCALER_256 0x00000038U
+
+#define UART_WORDLENGTH_8B 0x00000000U
+#define UART_STOPBITS_1 0x00000000U
+#define UART_PARITY_NONE 0x00000000U
+#define UART_MODE_TX_RX 0x0000000CU
+#define UART_HWCONTROL_NONE 0x00000000U
+#define UART_OVERSAMPLING_16 0x00000000U
+
+#define __HAL_RCC_USART2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_USART2_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+void HAL_UART_MspInit(UART_HandleTypeDef *huart);
+
+/* Flash ------------------------------------------------------------------------------------------------------------ */
+
+/* The 512 KB of the STM32F411RE as memory of the node, erased at start. Programming only clears bits, as on target;
+ * addresses are host pointers, so Address is not a uint32_t here. */
+extern uint32_t hal_shim_flash[];
+
+#define FLASH_BASE ((uintptr_t)hal_shim_flash)
+#define FLASH_TYPEERASE_SECTORS 0x00000000U
+#define FLASH_TYPEPROGRAM_WORD 0x00000002U
+#define FLASH_VOLTAGE_RANGE_3 0x00000002U
+#define FLASH_SECTOR_7 7U
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Sector;
+  uint32_t NbSectors;
+  uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
+
+/* System ----------------------------------------------------------------------------------------------------------- */
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetUIDw0(void);
+uint32_t HAL_GetUIDw1(void);
+uint32_t HAL_GetUIDw2(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+#endif /* HAL_SHIM_STM32F4XX_HAL_H_ */
@@ -0,0 +1,105 @@
+/*
+ * hot_bench_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Runs the firmware's hot path micro-benchmark (Core/Src/hot_bench.c) on the host: the firmware is linked against the
+ * HAL shim as for a simulated node, with one DW3000 model alone on its SPI bus and the UART going to stdout. The
+ * benchmark is timed with the monotonic clock, so its figures are host CPU time in ns per call and only compare with
+ * each other and with earlier host runs, not with the DWT cycle counts of a target run. Calls that go over SPI
+ * (get_rx_timestamp_u64(), get_tx_timestamp_u64()) include the shim and model code in place of the SPI transfer.
+ *
+ * Usage: hot_bench_host
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "dw3000_model.h"
+#include "error_led.h"
+#include "hal_shim.h"
+#include "hot_bench.h"
+
+static DwModel dw;
+static int64_t sim_now;
+
+uint32_t hot_bench_host_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+/* Nothing else on the air: transmitted frames are lost and the receiver never hears anything */
+static void air_transmit(void *ctx, DwModel *dev, const DwFrame *frame)
+{
+  (void)ctx;
+  (void)dev;
+  (void)frame;
+}
+
+static const DwModelOps air_ops = { air_transmit, NULL, NULL };
+
+static int64_t node_now(void *node)
+{
+  (void)node;
+  return sim_now;
+}
+
+/* Runs the model's own events up to until, or to the first that raises its IRQ line with SIM_WAKE_DW_IRQ */
+static void node_wait(void *node, int64_t until, int wake_on)
+{
+  (void)node;
+  while (dw_model_deadline(&dw) <= until)
+  {
+    sim_now = dw_model_deadline(&dw) > sim_now ? dw_model_deadline(&dw) : sim_now;
+    dw_model_advance(&dw, sim_now);
+    if ((wake_on & SIM_WAKE_DW_IRQ) && dw_model_irq(&dw))
+    {
+      return;
+    }
+  }
+  sim_now = until > sim_now ? until : sim_now;
+}
+
+static void node_spi(void *node, const uint8_t *header, uint16_t headerLength, const uint8_t *txBody, uint8_t *rxBody,
+                     uint16_t bodyLength)
+{
+  (void)node;
+  dw_model_spi(&dw, sim_now, header, headerLength, txBody, rxBody, bodyLength);
+}
+
+static int node_irq_line(void *node)
+{
+  (void)node;
+  return dw_model_irq(&dw);
+}
+
+static void node_uart(void *node, const char *text, size_t length)
+{
+  (void)node;
+  fwrite(text, 1, length, stdout);
+}
+
+static void node_halt(void *node)
+{
+  (void)node;
+  fprintf(stderr, "hot_bench_host: firmware halted\n");
+  exit(1);
+}
+
+static const SimServices services = {
+  node_now, node_wait, node_spi, node_irq_line, node_uart, node_halt, NULL, NULL,
+};
+
+int main(void)
+{
+  SimNodeConfig config = { .role = SIM_ROLE_SLAVE, .uid = { 1, 2, 3 }, .mcuPpm = 0.0 };
+
+  dw_model_init(&dw, 0.0, 0.0, 1, &air_ops, NULL);
+  hal_shim_start(&services, NULL, &config);
+  initErrorLed();
+  hot_bench_run();
+  fflush(stdout);
+  return 0;
+}
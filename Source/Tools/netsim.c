@@ -0,0 +1,1207 @@
+/*
+ * netsim.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Discrete-event simulation of a BitRad site on the host. Every node runs the unmodified firmware (uwb_master.c or
+ * uwb_slave.c with deca_device.c, built as libbitrad_node.so over the HAL shim) against its own DW3000 model, and
+ * the models share one air medium:
+ *  - time of flight from the node positions, frame airtime from the PHY settings the firmware programs
+ *  - independent MCU and DW IC crystal errors per node, so timers, reply delays and timestamps drift
+ *  - a frame is received if the receiver was listening early enough to acquire its preamble, no other frame overlapped
+ *    it at that receiver (unless it is stronger by the capture margin) and it was not dropped at random
+ *  - receivers are half duplex, TX and RX share the model's state machine
+ * Each node is a coroutine that only yields when its firmware waits (see hal_shim.c), so an hour of site runs in
+ * seconds. Per node it reports airtime, collisions, the exchange latency (first poll on air to the slave's Distance
+ * line) and the range error against the true distance, parsed from the slaves' UART output; the per-exchange lines need
+ * the default RANGING_LOG build. A CONFIG_HIGH_RATE_RANGING slave only prints a rate_bench line once a second, its
+ * exchanges and failures are counted from those (up to the last full second), with no latency or range figures.
+ *
+ * With -k, a node loses its supply at the given time; the first of each timeout line the others print after that (the
+ * master's slave detection timeout, the slave's geofence and fail-safe) is reported with its delay, so the 1 s to 2.5 s
+ * timeouts of the firmware can be checked in a fraction of a second of wall clock time.
+ * Fail-safe trips a slave reports are summarised with the cutoff latency its firmware measured (last kick to relays off).
+ * For each slave, the number of masters it started ranging with and the master it paired with are reported.
+ *
+ * With -i, the controller inputs of a node (a master) are driven to the given mask at the given time. For each such
+ * change, every slave's relays (RELAY_1/2 as channel bits, like the inputs) are followed up to the next change: the
+ * time from the input edge to the relay output write that brings them to the mask, and how many relays switched in
+ * the meantime. This is the command latency end to end, the debounce (CONTROLLER_DEBOUNCE_MS) included; several -i close
+ * together make contact bounce, which only the last of them should get through.
+ *
+ * Limitations: interrupts are taken at the node's next yield point, code runs in zero time apart from SPI, UART and
+ * waits, and the frame wait timeout stops at preamble acquisition.
+ *
+ * Usage: netsim [-m masters] [-s slaves] [-t seconds] [-r radius_m] [-d spacing_m] [-R range_m] [-l loss_pct]
+ *               [-p ppm] [-j jitter_ps] [-c capture_db] [-k node:seconds]... [-i node:seconds:mask]... [-S seed]
+ *               [-L library] [-v]
+ */
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "dw3000_model.h"
+#include "sim_services.h"
+
+#define MAX_NODES 256
+#define STACK_SIZE (512 * 1024)
+#define LINE_MAX_LEN 256
+#define MAX_SAMPLES 65536
+
+#define PS_PER_US 1000000LL
+#define PS_PER_MS 1000000000LL
+#define PS_PER_S 1000000000000LL
+#define LIGHT_M_PER_S 299792458.0
+#define ACQUIRE_PS (16 * PS_PER_US)   /* Preamble needed to acquire the signal, two 8-symbol PACs and margin */
+#define POLL_FUNC_CODE 0xE0           /* Slave polls, the start of an exchange (see uwb_slave.c) */
+#define DS_POLL_FUNC_CODE 0xE2
+#define MAX_POWER_OFFS 16
+#define MAX_INPUTS 16
+#define RELAY_1_PORT 1                /* RELAY_1_OUT on PB0, RELAY_2_OUT on PA4 (main.h) */
+#define RELAY_1_PIN 0x0001
+#define RELAY_2_PORT 0
+#define RELAY_2_PIN 0x0010
+
+typedef enum
+{
+  EV_WAKE,
+  EV_DW,
+  EV_ARRIVAL_START,
+  EV_LOCK,
+  EV_ARRIVAL_END,
+  EV_POWER_OFF,
+  EV_INPUT
+} EventType;
+
+/* UART lines of the firmware's timeouts, timed from the last node powered off (-k) */
+static const char *const timeout_lines[] = {
+  "Unable to find the slave module!",     /* Master, detection_timeout */
+  "Unable to find the master module!",    /* Slave, geofence lost */
+  "Master is out of range!",              /* Slave, geofence out of range */
+  "Fail-safe cut the relays"              /* Slave, CONFIG_FAILSAFE_TIMEOUT_MS */
+};
+#define TIMEOUT_LINES (sizeof(timeout_lines) / sizeof(timeout_lines[0]))
+
+struct Arrival;
+
+typedef struct
+{
+  int64_t t;
+  uint64_t seq;
+  EventType type;
+  int node;
+  uint32_t gen;
+  struct Arrival *arrival;
+} Event;
+
+/* One transmission on air, shared by its arrivals */
+typedef struct
+{
+  DwFrame f;
+  int sender;
+  int refs;
+  int collided;
+  int aborted;
+  double ppm;
+} AirFrame;
+
+/* A transmission as seen by one receiver */
+typedef struct Arrival
+{
+  AirFrame *frame;
+  int rcv;
+  int64_t start, rmarker, end;
+  double power;
+  int lost;
+  int corrupt;
+  struct Arrival *next;
+} Arrival;
+
+typedef struct
+{
+  SimNodeConfig cfg;
+  double x, y;
+  double dwPpm;
+  DwModel dw;
+
+  ucontext_t ctx;
+  void *stack;
+  SimNodeEntry entry;
+  int64_t t;
+  int halted;
+  int64_t offAt;            /* Powered off with -k, -1 if not */
+  int wakeOn;               /* SIM_WAKE_* events that end the current wait */
+  uint32_t wakeGen;
+  uint32_t dwGen;
+  int64_t dwAt;
+
+  Arrival *active;
+  Arrival *locked;
+  AirFrame *txFrame;
+
+  char line[LINE_MAX_LEN];
+  size_t lineLen;
+  uint16_t address;
+  uint16_t master;
+  uint16_t peer;            /* Paired with, 0 if not */
+  uint32_t bindings;        /* Masters a slave has started ranging with */
+  int64_t pollStart;
+
+  uint32_t framesTx, framesCollided, rxCompleted, rxCollided;
+  int64_t airtime;
+  uint32_t exchanges, failures;
+  uint32_t latN;
+  double latSum, latMax;
+  uint32_t rangeN;
+  double rangeSum, rangeSq, rangeMaxAbs;
+  int64_t timeoutAt[TIMEOUT_LINES];
+  uint32_t failsafeTrips;
+  unsigned long failsafeLastUs, failsafeMaxUs;  /* As the firmware measures them, last kick to relays off */
+
+  uint32_t inputs;          /* Controller input levels driven with -i */
+  uint32_t odr[3];
+  uint32_t relays;          /* Slave relays as channel bits */
+  int64_t relayAt[MAX_INPUTS];        /* Relays reached the mask of each -i, -1 if not (yet) */
+  uint32_t relayChanges[MAX_INPUTS];  /* Relays switched while each -i was the latest */
+} Node;
+
+static Node nodes[MAX_NODES];
+static int node_count;
+static int master_count;
+static ucontext_t sched_ctx;
+static Node *current;
+static int64_t sim_now;
+static int64_t sim_end;
+
+static Event *heap;
+static size_t heap_len, heap_cap;
+static uint64_t event_seq;
+
+static struct
+{
+  double rangeM;
+  double lossPct;
+  double captureDb;
+  int verbose;
+} opt = {100.0, 0.0, 0.0, 0};
+
+static struct
+{
+  uint64_t frames, collided, received, receivedCollided;
+  int64_t airtimeSum, airtimeUnion, busyUntil;
+  double latencies[MAX_SAMPLES];
+  uint32_t latCount;
+} totals;
+
+static struct
+{
+  int node;
+  int64_t t;
+} power_offs[MAX_POWER_OFFS];
+static int power_off_count;
+static int64_t last_power_off = -1;
+
+static struct
+{
+  int node;
+  int64_t t;
+  uint32_t mask;
+} inputs[MAX_INPUTS];
+static int input_count;
+static int last_input = -1;
+
+static uint64_t rng_state;
+
+static uint64_t sim_random(void)
+{
+  uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static double uniform(double lo, double hi)
+{
+  return lo + (hi - lo) * (double)(sim_random() >> 11) / 9007199254740992.0;
+}
+
+/* Event queue ------------------------------------------------------------------------------------------------------- */
+
+static int event_before(const Event *a, const Event *b)
+{
+  return a->t < b->t || (a->t == b->t && a->seq < b->seq);
+}
+
+static void push(int64_t t, EventType type, int node, uint32_t gen, Arrival *arrival)
+{
+  size_t i;
+
+  if (heap_len == heap_cap)
+  {
+    heap_cap = heap_cap ? heap_cap * 2 : 1024;
+    heap = realloc(heap, heap_cap * sizeof(*heap));
+    if (!heap)
+    {
+      perror("netsim");
+      exit(1);
+    }
+  }
+  i = heap_len++;
+  heap[i] = (Event){t, event_seq++, type, node, gen, arrival};
+  while (i && event_before(&heap[i], &heap[(i - 1) / 2]))
+  {
+    Event tmp = heap[i];
+    heap[i] = heap[(i - 1) / 2];
+    heap[(i - 1) / 2] = tmp;
+    i = (i - 1) / 2;
+  }
+}
+
+static Event pop(void)
+{
+  Event top = heap[0];
+  size_t i = 0;
+
+  heap[0] = heap[--heap_len];
+  for (;;)
+  {
+    size_t l = 2 * i + 1, r = l + 1, m = i;
+
+    if (l < heap_len && event_before(&heap[l], &heap[m]))
+    {
+      m = l;
+    }
+    if (r < heap_len && event_before(&heap[r], &heap[m]))
+    {
+      m = r;
+    }
+    if (m == i)
+    {
+      break;
+    }
+    Event tmp = heap[i];
+    heap[i] = heap[m];
+    heap[m] = tmp;
+    i = m;
+  }
+  return top;
+}
+
+/* Wake-ups and DW IC deadlines are superseded by later ones rather than removed */
+static int stale(const Event *ev)
+{
+  if (ev->type == EV_WAKE)
+  {
+    return ev->gen != nodes[ev->node].wakeGen || nodes[ev->node].halted;
+  }
+  if (ev->type == EV_DW)
+  {
+    return ev->gen != nodes[ev->node].dwGen;
+  }
+  return 0;
+}
+
+static int64_t next_event_time(void)
+{
+  while (heap_len && stale(&heap[0]))
+  {
+    (void)pop();
+  }
+  return heap_len ? heap[0].t : INT64_MAX;
+}
+
+/* Nodes ------------------------------------------------------------------------------------------------------------- */
+
+static int index_of(const Node *n)
+{
+  return (int)(n - nodes);
+}
+
+static int64_t time_now(void)
+{
+  return current ? current->t : sim_now;
+}
+
+static void wake(Node *n)
+{
+  n->wakeOn = 0;
+  n->wakeGen++;
+  push(sim_now, EV_WAKE, index_of(n), n->wakeGen, NULL);
+}
+
+/* Follows a change of the model's state: reschedules its deadline and wakes the node on a rising IRQ line */
+static void dw_changed(Node *n)
+{
+  int64_t deadline = dw_model_deadline(&n->dw);
+
+  if (deadline != n->dwAt)
+  {
+    n->dwAt = deadline;
+    n->dwGen++;
+    if (deadline != DW_MODEL_NEVER)
+    {
+      push(deadline, EV_DW, index_of(n), n->dwGen, NULL);
+    }
+  }
+  if (n != current && (n->wakeOn & SIM_WAKE_DW_IRQ) && dw_model_irq(&n->dw))
+  {
+    wake(n);
+  }
+}
+
+static void resume(Node *n)
+{
+  current = n;
+  n->t = sim_now;
+  swapcontext(&sched_ctx, &n->ctx);
+  current = NULL;
+}
+
+static void yield(Node *n)
+{
+  swapcontext(&n->ctx, &sched_ctx);
+}
+
+/* Medium ------------------------------------------------------------------------------------------------------------ */
+
+static double distance(const Node *a, const Node *b)
+{
+  return hypot(a->x - b->x, a->y - b->y);
+}
+
+/* A frame is counted as collided once it has left the air everywhere */
+static void release(AirFrame *frame)
+{
+  if (frame && --frame->refs == 0)
+  {
+    if (frame->collided)
+    {
+      nodes[frame->sender].framesCollided++;
+      totals.collided++;
+    }
+    free(frame);
+  }
+}
+
+static void medium_transmit(void *ctx, DwModel *dev, const DwFrame *frame)
+{
+  Node *n = ctx;
+  AirFrame *air = calloc(1, sizeof(*air));
+  int64_t airtime = frame->endPs - frame->startPs;
+  (void)dev;
+
+  air->f = *frame;
+  air->sender = index_of(n);
+  air->ppm = n->dwPpm;
+  air->refs = 1;
+  release(n->txFrame);
+  n->txFrame = air;
+
+  n->framesTx++;
+  n->airtime += airtime;
+  totals.frames++;
+  totals.airtimeSum += airtime;
+  if (frame->startPs >= totals.busyUntil)
+  {
+    totals.airtimeUnion += airtime;
+  }
+  else if (frame->endPs > totals.busyUntil)
+  {
+    totals.airtimeUnion += frame->endPs - totals.busyUntil;
+  }
+  if (frame->endPs > totals.busyUntil)
+  {
+    totals.busyUntil = frame->endPs;
+  }
+
+  if (n->cfg.role == SIM_ROLE_SLAVE && n->pollStart < 0 && frame->length >= 12 && (frame->data[0] & 0x7) == 1 &&
+      (frame->data[9] == POLL_FUNC_CODE || frame->data[9] == DS_POLL_FUNC_CODE))
+  {
+    n->pollStart = frame->startPs;
+  }
+
+  for (int i = 0; i < node_count; i++)
+  {
+    Node *r = &nodes[i];
+    double d = distance(n, r);
+
+    if (r == n || d > opt.rangeM)
+    {
+      continue;
+    }
+
+    Arrival *a = calloc(1, sizeof(*a));
+    int64_t tof = llround(d / LIGHT_M_PER_S * 1e12);
+
+    a->frame = air;
+    air->refs++;
+    a->rcv = i;
+    a->start = frame->startPs + tof;
+    a->rmarker = frame->rmarkerPs + tof;
+    a->end = frame->endPs + tof;
+    a->power = -20.0 * log10(d > 0.1 ? d : 0.1);
+    a->lost = uniform(0.0, 100.0) < opt.lossPct;
+    push(a->start, EV_ARRIVAL_START, i, 0, a);
+  }
+}
+
+static void medium_abort(void *ctx, DwModel *dev)
+{
+  Node *n = ctx;
+  (void)dev;
+
+  if (n->txFrame)
+  {
+    n->txFrame->aborted = 1;
+  }
+}
+
+/* The receiver has just turned on: it can acquire any frame whose preamble is still long enough */
+static void medium_listen(void *ctx, DwModel *dev)
+{
+  Node *n = ctx;
+  int64_t now = time_now();
+  (void)dev;
+
+  n->locked = NULL;
+  for (Arrival *a = n->active; a; a = a->next)
+  {
+    if (!a->lost && now + ACQUIRE_PS <= a->rmarker)
+    {
+      push(now + ACQUIRE_PS, EV_LOCK, index_of(n), 0, a);
+    }
+  }
+}
+
+static const DwModelOps medium_ops = {medium_transmit, medium_abort, medium_listen};
+
+/* Two frames overlapping at a receiver: both are lost there, unless one is stronger by the capture margin */
+static void overlap(Arrival *a, Arrival *b)
+{
+  a->frame->collided = 1;
+  b->frame->collided = 1;
+  if (opt.captureDb > 0.0 && a->power - b->power >= opt.captureDb)
+  {
+    b->corrupt = 1;
+  }
+  else if (opt.captureDb > 0.0 && b->power - a->power >= opt.captureDb)
+  {
+    a->corrupt = 1;
+  }
+  else
+  {
+    a->corrupt = 1;
+    b->corrupt = 1;
+  }
+}
+
+static void arrival_start(Arrival *a)
+{
+  Node *r = &nodes[a->rcv];
+
+  for (Arrival *b = r->active; b; b = b->next)
+  {
+    overlap(a, b);
+  }
+  a->next = r->active;
+  r->active = a;
+  push(a->end, EV_ARRIVAL_END, a->rcv, 0, a);
+
+  if (!a->lost && !r->locked && dw_model_listening(&r->dw) && a->start + ACQUIRE_PS <= a->rmarker)
+  {
+    push(a->start + ACQUIRE_PS, EV_LOCK, a->rcv, 0, a);
+  }
+}
+
+static void arrival_lock(Arrival *a)
+{
+  Node *r = &nodes[a->rcv];
+
+  if (!r->locked && dw_model_listening(&r->dw))
+  {
+    r->locked = a;
+    dw_model_lock(&r->dw, sim_now);
+    dw_changed(r);
+  }
+}
+
+static void arrival_end(Arrival *a)
+{
+  Node *r = &nodes[a->rcv];
+  Arrival **p = &r->active;
+
+  while (*p != a)
+  {
+    p = &(*p)->next;
+  }
+  *p = a->next;
+
+  if (r->locked == a)
+  {
+    r->locked = NULL;
+    r->rxCompleted++;
+    totals.received++;
+    if (a->corrupt)
+    {
+      r->rxCollided++;
+      totals.receivedCollided++;
+    }
+    dw_model_receive(&r->dw, sim_now, &a->frame->f, a->rmarker, !a->corrupt && !a->frame->aborted, a->frame->ppm);
+    if (dw_model_listening(&r->dw))
+    {
+      /* Filtered out, back to listening */
+      medium_listen(r, &r->dw);
+    }
+    dw_changed(r);
+  }
+
+  release(a->frame);
+  free(a);
+}
+
+/* UART output ------------------------------------------------------------------------------------------------------- */
+
+static Node *master_by_address(uint16_t address)
+{
+  for (int i = 0; i < node_count; i++)
+  {
+    if (nodes[i].cfg.role == SIM_ROLE_MASTER && nodes[i].address == address)
+    {
+      return &nodes[i];
+    }
+  }
+  return NULL;
+}
+
+static void record_range(Node *n, uint16_t master, long mm)
+{
+  Node *m = master_by_address(master);
+
+  if (!m)
+  {
+    return;
+  }
+  double err = (double)mm - distance(n, m) * 1000.0;
+
+  n->rangeN++;
+  n->rangeSum += err;
+  n->rangeSq += err * err;
+  if (fabs(err) > n->rangeMaxAbs)
+  {
+    n->rangeMaxAbs = fabs(err);
+  }
+}
+
+static void handle_line(Node *n, int64_t t, char *line)
+{
+  unsigned address, pan;
+  unsigned long last_us, max_us, period_ms, rate, ok, fail;
+  long mm;
+
+  while (*line == '\r')
+  {
+    line++;
+  }
+  line[strcspn(line, "\r\n")] = '\0';
+  if (opt.verbose)
+  {
+    fprintf(stderr, "%10.3f ms node %d: %s\n", (double)t / PS_PER_MS, index_of(n), line);
+  }
+
+  for (size_t i = 0; i < TIMEOUT_LINES; i++)
+  {
+    if (last_power_off >= 0 && n->timeoutAt[i] < 0 && strncmp(line, timeout_lines[i], strlen(timeout_lines[i])) == 0)
+    {
+      n->timeoutAt[i] = t;
+    }
+  }
+
+  if (sscanf(line, "Master address 0x%x, PAN 0x%x", &address, &pan) == 2 ||
+      sscanf(line, "Slave address 0x%x, PAN 0x%x", &address, &pan) == 2)
+  {
+    n->address = (uint16_t)address;
+  }
+  else if (sscanf(line, "Ranging with master 0x%x", &address) == 1)
+  {
+    n->master = (uint16_t)address;
+    n->bindings++;
+  }
+  else if (sscanf(line, "Paired with master 0x%x", &address) == 1)
+  {
+    n->master = (uint16_t)address;
+    n->peer = (uint16_t)address;
+  }
+  else if (sscanf(line, "Paired with slave 0x%x", &address) == 1)
+  {
+    n->peer = (uint16_t)address;
+  }
+  else if (sscanf(line, "Distance: %ld mm", &mm) == 1)
+  {
+    n->exchanges++;
+    record_range(n, n->master, mm);
+    if (n->pollStart >= 0)
+    {
+      double ms = (double)(t - n->pollStart) / PS_PER_MS;
+
+      n->latN++;
+      n->latSum += ms;
+      if (ms > n->latMax)
+      {
+        n->latMax = ms;
+      }
+      if (totals.latCount < MAX_SAMPLES)
+      {
+        totals.latencies[totals.latCount++] = ms;
+      }
+      n->pollStart = -1;
+    }
+  }
+  else if (sscanf(line, "master 0x%x: %ld mm", &address, &mm) == 2 ||
+           sscanf(line, " master 0x%x: %ld mm", &address, &mm) == 2)
+  {
+    record_range(n, (uint16_t)address, mm);
+  }
+  else if (strncmp(line, "Exchange failed", 15) == 0)
+  {
+    n->failures++;
+    n->pollStart = -1;
+  }
+  else if (sscanf(line, "rate_bench,%lu,%lu,%lu,%lu", &period_ms, &rate, &ok, &fail) == 4)
+  {
+    n->exchanges += ok;
+    n->failures += fail;
+  }
+  else if (sscanf(line, "Fail-safe cut the relays %lu us after the last valid range (worst %lu us)", &last_us,
+                  &max_us) == 2)
+  {
+    n->failsafeTrips++;
+    n->failsafeLastUs = last_us;
+    n->failsafeMaxUs = max_us;
+  }
+}
+
+/* Services ---------------------------------------------------------------------------------------------------------- */
+
+static int64_t svc_now(void *node)
+{
+  return ((Node *)node)->t;
+}
+
+static void svc_wait(void *node, int64_t until, int wake_on)
+{
+  Node *n = node;
+
+  if (until <= n->t || ((wake_on & SIM_WAKE_DW_IRQ) && dw_model_irq(&n->dw)))
+  {
+    return;
+  }
+  if (until <= next_event_time() && until <= sim_end)
+  {
+    /* Nothing else happens in between, no need to switch */
+    n->t = until;
+    return;
+  }
+  n->wakeGen++;
+  push(until, EV_WAKE, index_of(n), n->wakeGen, NULL);
+  n->wakeOn = wake_on;
+  yield(n);
+  n->wakeOn = 0;
+}
+
+static void svc_spi(void *node, const uint8_t *header, uint16_t headerLength, const uint8_t *txBody, uint8_t *rxBody,
+                    uint16_t bodyLength)
+{
+  Node *n = node;
+
+  dw_model_spi(&n->dw, n->t, header, headerLength, txBody, rxBody, bodyLength);
+  dw_changed(n);
+}
+
+static int svc_irq_line(void *node)
+{
+  return dw_model_irq(&((Node *)node)->dw);
+}
+
+static void svc_uart(void *node, const char *text, size_t length)
+{
+  Node *n = node;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    if (n->lineLen < LINE_MAX_LEN - 1)
+    {
+      n->line[n->lineLen++] = text[i];
+    }
+    if (text[i] == '\n')
+    {
+      n->line[n->lineLen] = '\0';
+      handle_line(n, n->t, n->line);
+      n->lineLen = 0;
+    }
+  }
+}
+
+static void svc_halt(void *node)
+{
+  Node *n = node;
+
+  n->halted = 1;
+  if (opt.verbose)
+  {
+    fprintf(stderr, "%10.3f ms node %d halted\n", (double)n->t / PS_PER_MS, index_of(n));
+  }
+  for (;;)
+  {
+    yield(n);
+  }
+}
+
+static uint32_t svc_inputs(void *node)
+{
+  return ((Node *)node)->inputs;
+}
+
+/* Follows the slaves' relays against the latest -i */
+static void svc_outputs(void *node, int port, uint32_t odr)
+{
+  Node *n = node;
+  uint32_t relays;
+
+  n->odr[port] = odr;
+  if (n->cfg.role != SIM_ROLE_SLAVE || last_input < 0 || (port != RELAY_1_PORT && port != RELAY_2_PORT))
+  {
+    return;
+  }
+  relays = ((n->odr[RELAY_1_PORT] & RELAY_1_PIN) ? 1 : 0) | ((n->odr[RELAY_2_PORT] & RELAY_2_PIN) ? 2 : 0);
+  if (relays == n->relays)
+  {
+    return;
+  }
+  n->relayChanges[last_input] += (uint32_t)__builtin_popcount(relays ^ n->relays);
+  n->relays = relays;
+  if (n->relayAt[last_input] < 0 && relays == inputs[last_input].mask)
+  {
+    n->relayAt[last_input] = n->t;
+  }
+  if (opt.verbose)
+  {
+    fprintf(stderr, "%10.3f ms node %d relays 0x%X\n", (double)n->t / PS_PER_MS, index_of(n), relays);
+  }
+}
+
+static const SimServices services = {svc_now,  svc_wait, svc_spi,    svc_irq_line,
+                                     svc_uart, svc_halt, svc_inputs, svc_outputs};
+
+/* -k: the node loses its supply, firmware and DW IC stop where they are. Timeouts of the others are timed from here. */
+static void power_off(Node *n)
+{
+  if (n->offAt >= 0)
+  {
+    return;
+  }
+  n->halted = 1;
+  n->offAt = sim_now;
+  n->locked = NULL;
+  dw_model_power_off(&n->dw);
+  dw_changed(n);
+  last_power_off = sim_now;
+  for (int i = 0; i < node_count; i++)
+  {
+    for (size_t j = 0; j < TIMEOUT_LINES; j++)
+    {
+      nodes[i].timeoutAt[j] = -1;
+    }
+  }
+  if (opt.verbose)
+  {
+    fprintf(stderr, "%10.3f ms node %d powered off\n", (double)sim_now / PS_PER_MS, index_of(n));
+  }
+}
+
+/* -i: the node's controller inputs change, the wait it is in ends if it asked for that */
+static void input_change(int index)
+{
+  Node *n = &nodes[inputs[index].node];
+
+  n->inputs = inputs[index].mask;
+  last_input = index;
+  if (opt.verbose)
+  {
+    fprintf(stderr, "%10.3f ms node %d inputs 0x%X\n", (double)sim_now / PS_PER_MS, index_of(n), n->inputs);
+  }
+  if (!n->halted && (n->wakeOn & SIM_WAKE_INPUT))
+  {
+    wake(n);
+  }
+}
+
+static void node_start(int index)
+{
+  Node *n = &nodes[index];
+
+  n->entry(&services, n, &n->cfg);
+  svc_halt(n);
+}
+
+/* Set-up ------------------------------------------------------------------------------------------------------------ */
+
+/* Each node needs its own copy of the firmware's globals, dlopen() only maps a path once */
+static SimNodeEntry load_node(const char *library)
+{
+  char path[] = "/tmp/netsim-node-XXXXXX";
+  char buf[65536];
+  ssize_t len;
+  int in = open(library, O_RDONLY);
+  int out = mkstemp(path);
+
+  if (in < 0 || out < 0)
+  {
+    perror(library);
+    exit(1);
+  }
+  while ((len = read(in, buf, sizeof(buf))) > 0)
+  {
+    if (write(out, buf, (size_t)len) != len)
+    {
+      perror(path);
+      exit(1);
+    }
+  }
+  close(in);
+  close(out);
+
+  void *lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  unlink(path);
+  if (!lib)
+  {
+    fprintf(stderr, "netsim: %s\n", dlerror());
+    exit(1);
+  }
+  SimNodeEntry entry = (SimNodeEntry)(uintptr_t)dlsym(lib, SIM_NODE_ENTRY);
+  if (!entry)
+  {
+    fprintf(stderr, "netsim: %s has no %s\n", library, SIM_NODE_ENTRY);
+    exit(1);
+  }
+  return entry;
+}
+
+static void add_node(int role, double x, double y, double ppm, int64_t boot_spread, uint32_t jitter_ps,
+                     const char *library)
+{
+  Node *n = &nodes[node_count];
+  int index = node_count++;
+
+  n->cfg.role = role;
+  n->cfg.uid[0] = (uint32_t)sim_random();
+  n->cfg.uid[1] = (uint32_t)sim_random();
+  n->cfg.uid[2] = (uint32_t)sim_random();
+  n->cfg.mcuPpm = uniform(-ppm, ppm);
+  n->x = x;
+  n->y = y;
+  n->dwPpm = uniform(-ppm, ppm);
+  n->dwAt = DW_MODEL_NEVER;
+  n->pollStart = -1;
+  n->offAt = -1;
+  for (size_t i = 0; i < TIMEOUT_LINES; i++)
+  {
+    n->timeoutAt[i] = -1;
+  }
+  for (int i = 0; i < MAX_INPUTS; i++)
+  {
+    n->relayAt[i] = -1;
+  }
+  dw_model_init(&n->dw, n->dwPpm, uniform(0.0, 1099511627776.0), (uint32_t)sim_random(), &medium_ops, n);
+  n->dw.rxJitterPs = jitter_ps;
+
+  n->entry = load_node(library);
+  n->stack = malloc(STACK_SIZE);
+  getcontext(&n->ctx);
+  n->ctx.uc_stack.ss_sp = n->stack;
+  n->ctx.uc_stack.ss_size = STACK_SIZE;
+  n->ctx.uc_link = &sched_ctx;
+  makecontext(&n->ctx, (void (*)(void))node_start, 1, index);
+
+  push(boot_spread ? (int64_t)(uniform(0.0, 1.0) * (double)boot_spread) : 0, EV_WAKE, index, 0, NULL);
+}
+
+/* Report ------------------------------------------------------------------------------------------------------------ */
+
+static int compare_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+static double nearest_master(const Node *n)
+{
+  double best = INFINITY;
+
+  for (int i = 0; i < master_count; i++)
+  {
+    double d = distance(n, &nodes[i]);
+    if (d < best)
+    {
+      best = d;
+    }
+  }
+  return best;
+}
+
+static void report(double seconds, double wall)
+{
+  uint64_t exchanges = 0, failures = 0;
+
+  printf("node,role,address,x_m,y_m,master_m,tx_frames,airtime_ms,collided_frames,rx_good,rx_errors,rx_timeouts,"
+         "rx_filtered,rx_collided,spi_xfers,exchanges,failures,latency_mean_ms,latency_max_ms,range_bias_mm,"
+         "range_std_mm,range_max_abs_mm,halted\n");
+  for (int i = 0; i < node_count; i++)
+  {
+    Node *n = &nodes[i];
+    double bias = n->rangeN ? n->rangeSum / n->rangeN : 0.0;
+    double std = n->rangeN ? sqrt(fmax(n->rangeSq / n->rangeN - bias * bias, 0.0)) : 0.0;
+
+    printf("%d,%s,0x%04X,%.2f,%.2f,%.2f,%u,%.3f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.3f,%.3f,%.1f,%.1f,%.1f,%d\n", i,
+           n->cfg.role == SIM_ROLE_MASTER ? "master" : "slave", n->address, n->x, n->y,
+           n->cfg.role == SIM_ROLE_MASTER ? 0.0 : nearest_master(n), n->framesTx, (double)n->airtime / PS_PER_MS,
+           n->framesCollided, n->dw.stats.rxGood, n->dw.stats.rxErrors, n->dw.stats.rxTimeouts,
+           n->dw.stats.rxFiltered, n->rxCollided, n->dw.stats.transactions, n->exchanges, n->failures,
+           n->latN ? n->latSum / n->latN : 0.0, n->latMax, bias, std, n->rangeMaxAbs, n->halted);
+    exchanges += n->exchanges;
+    failures += n->failures;
+
+    for (int j = 0; j < i; j++)
+    {
+      if (nodes[j].address == n->address && n->address)
+      {
+        fprintf(stderr, "netsim: nodes %d and %d share address 0x%04X\n", j, i, n->address);
+      }
+    }
+  }
+
+  printf("# simulated %.1f s in %.2f s wall clock (%.0fx real time)\n", seconds, wall, seconds / wall);
+  printf("# airtime utilisation %.3f%% (sum of frames %.3f%%)\n",
+         100.0 * (double)totals.airtimeUnion / (double)sim_end, 100.0 * (double)totals.airtimeSum / (double)sim_end);
+  printf("# frames %llu, collided %llu (%.2f%%), receptions %llu, lost to collision %llu (%.2f%%)\n",
+         (unsigned long long)totals.frames, (unsigned long long)totals.collided,
+         totals.frames ? 100.0 * (double)totals.collided / (double)totals.frames : 0.0,
+         (unsigned long long)totals.received, (unsigned long long)totals.receivedCollided,
+         totals.received ? 100.0 * (double)totals.receivedCollided / (double)totals.received : 0.0);
+  printf("# exchanges %llu, failed %llu\n", (unsigned long long)exchanges, (unsigned long long)failures);
+  for (int i = 0; i < node_count; i++)
+  {
+    if (nodes[i].failsafeTrips)
+    {
+      printf("# node %d fail-safe trips %u, last %lu us, worst %lu us after the last valid range\n", i,
+             nodes[i].failsafeTrips, nodes[i].failsafeLastUs, nodes[i].failsafeMaxUs);
+    }
+  }
+  for (int i = 0; i < node_count; i++)
+  {
+    Node *m = master_by_address(nodes[i].peer);
+
+    if (nodes[i].cfg.role == SIM_ROLE_SLAVE && (nodes[i].bindings || m))
+    {
+      printf("# node %d bound %u times, paired with node %d\n", i, nodes[i].bindings, m ? index_of(m) : -1);
+    }
+  }
+  for (int i = 0; i < node_count; i++)
+  {
+    for (size_t j = 0; j < TIMEOUT_LINES; j++)
+    {
+      if (nodes[i].timeoutAt[j] >= 0)
+      {
+        printf("# node %d \"%s\" %.3f s after the last power-off\n", i, timeout_lines[j],
+               (double)(nodes[i].timeoutAt[j] - last_power_off) / PS_PER_S);
+      }
+    }
+  }
+  for (int i = 0; i < input_count; i++)
+  {
+    for (int j = 0; j < node_count; j++)
+    {
+      if (nodes[j].cfg.role != SIM_ROLE_SLAVE)
+      {
+        continue;
+      }
+      if (nodes[j].relayAt[i] >= 0)
+      {
+        printf("# input 0x%X on node %d at %.3f s: node %d relays followed %.3f ms later, %u relay changes\n",
+               inputs[i].mask, inputs[i].node, (double)inputs[i].t / PS_PER_S, j,
+               (double)(nodes[j].relayAt[i] - inputs[i].t) / PS_PER_MS, nodes[j].relayChanges[i]);
+      }
+      else
+      {
+        printf("# input 0x%X on node %d at %.3f s: node %d relays did not follow, %u relay changes\n",
+               inputs[i].mask, inputs[i].node, (double)inputs[i].t / PS_PER_S, j, nodes[j].relayChanges[i]);
+      }
+    }
+  }
+  if (totals.latCount)
+  {
+    qsort(totals.latencies, totals.latCount, sizeof(double), compare_double);
+    printf("# exchange latency median %.3f ms, p95 %.3f ms, max %.3f ms\n", totals.latencies[totals.latCount / 2],
+           totals.latencies[(totals.latCount * 95) / 100], totals.latencies[totals.latCount - 1]);
+  }
+}
+
+/* Drops the senders' references, so the last frames are counted too */
+static void count_collisions(void)
+{
+  for (int i = 0; i < node_count; i++)
+  {
+    release(nodes[i].txFrame);
+    nodes[i].txFrame = NULL;
+  }
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-m masters] [-s slaves] [-t seconds] [-r radius_m] [-d spacing_m] [-R range_m] [-l loss_pct]\n"
+          "       [-p ppm] [-j jitter_ps] [-c capture_db] [-k node:seconds]... [-i node:seconds:mask]... [-S seed]\n"
+          "       [-L library] [-v]\n",
+          name);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  int masters = 1, slaves = 4, c;
+  double seconds = 10.0, radius = 20.0, spacing = 10.0, ppm = 10.0;
+  uint32_t jitter_ps = 100;
+  const char *library = "./libbitrad_node.so";
+  struct timespec t0, t1;
+
+  rng_state = 1;
+  while ((c = getopt(argc, argv, "m:s:t:r:d:R:l:p:j:c:k:i:S:L:v")) != -1)
+  {
+    switch (c)
+    {
+    case 'm': masters = atoi(optarg); break;
+    case 's': slaves = atoi(optarg); break;
+    case 't': seconds = atof(optarg); break;
+    case 'r': radius = atof(optarg); break;
+    case 'd': spacing = atof(optarg); break;
+    case 'R': opt.rangeM = atof(optarg); break;
+    case 'l': opt.lossPct = atof(optarg); break;
+    case 'p': ppm = atof(optarg); break;
+    case 'j': jitter_ps = (uint32_t)atoi(optarg); break;
+    case 'c': opt.captureDb = atof(optarg); break;
+    case 'k':
+      if (power_off_count == MAX_POWER_OFFS || strchr(optarg, ':') == NULL)
+      {
+        usage(argv[0]);
+      }
+      power_offs[power_off_count].node = atoi(optarg);
+      power_offs[power_off_count++].t = (int64_t)(atof(strchr(optarg, ':') + 1) * PS_PER_S);
+      break;
+    case 'i':
+    {
+      double t;
+      int mask;
+
+      if (input_count == MAX_INPUTS || sscanf(optarg, "%d:%lf:%i", &inputs[input_count].node, &t, &mask) != 3)
+      {
+        usage(argv[0]);
+      }
+      inputs[input_count].t = (int64_t)(t * PS_PER_S);
+      inputs[input_count++].mask = (uint32_t)mask;
+      break;
+    }
+    case 'S': rng_state = strtoull(optarg, NULL, 0); break;
+    case 'L': library = optarg; break;
+    case 'v': opt.verbose = 1; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (masters < 1 || slaves < 0 || masters + slaves > MAX_NODES || seconds <= 0.0)
+  {
+    usage(argv[0]);
+  }
+
+  sim_end = (int64_t)(seconds * PS_PER_S);
+  master_count = masters;
+  for (int i = 0; i < masters; i++)
+  {
+    add_node(SIM_ROLE_MASTER, (i - (masters - 1) / 2.0) * spacing, 0.0, ppm, PS_PER_S, jitter_ps, library);
+  }
+  for (int i = 0; i < slaves; i++)
+  {
+    double r = radius * sqrt(uniform(0.0, 1.0)), a = uniform(0.0, 2.0 * M_PI);
+
+    add_node(SIM_ROLE_SLAVE, r * cos(a), r * sin(a), ppm, PS_PER_S, jitter_ps, library);
+  }
+
+  for (int i = 0; i < power_off_count; i++)
+  {
+    if (power_offs[i].node < 0 || power_offs[i].node >= node_count)
+    {
+      usage(argv[0]);
+    }
+    push(power_offs[i].t, EV_POWER_OFF, power_offs[i].node, 0, NULL);
+  }
+  for (int i = 0; i < input_count; i++)
+  {
+    if (inputs[i].node < 0 || inputs[i].node >= node_count)
+    {
+      usage(argv[0]);
+    }
+    push(inputs[i].t, EV_INPUT, inputs[i].node, (uint32_t)i, NULL);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  while (next_event_time() <= sim_end)
+  {
+    Event ev = pop();
+
+    sim_now = ev.t;
+    switch (ev.type)
+    {
+    case EV_WAKE:
+      resume(&nodes[ev.node]);
+      break;
+
+    case EV_DW:
+      dw_model_advance(&nodes[ev.node].dw, sim_now);
+      nodes[ev.node].dwAt = INT64_MIN;
+      dw_changed(&nodes[ev.node]);
+      break;
+
+    case EV_ARRIVAL_START:
+      arrival_start(ev.arrival);
+      break;
+
+    case EV_LOCK:
+      arrival_lock(ev.arrival);
+      break;
+
+    case EV_ARRIVAL_END:
+      arrival_end(ev.arrival);
+      break;
+
+    case EV_POWER_OFF:
+      power_off(&nodes[ev.node]);
+      break;
+
+    case EV_INPUT:
+      input_change((int)ev.gen);     /* The index of the -i */
+      break;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  count_collisions();
+  report(seconds, (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9);
+  return 0;
+}
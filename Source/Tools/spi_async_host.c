@@ -0,0 +1,323 @@
+/*
+ * spi_async_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Host check of the asynchronous SPI path of the DW IC driver: dwt_xfer_async() and the dwt_*_async() helpers built
+ * on it, through the shim's queuetospi() (hal_shim/deca_spi_host.c) to one DW3000 model. The shim runs the SPI
+ * transactions of a batch at once and defers the completion callback to the next service point, where it runs as from
+ * the DMA interrupt, so this checks what the driver hands to the queue and when it reports completion:
+ *  - batching: one SPI transaction per descriptor, one callback per batch with its arg, batches over
+ *    DWT_XFER_MAX_BATCH, empty batches and SPI CRC mode refused without a transaction or a callback
+ *  - ordering: the descriptors of a batch reach the DW IC in order (a read sees the writes before it), batches in the
+ *    order they were queued, and their callbacks complete in that order
+ *  - callbacks: not called before dwt_xfer_async() returns, called once at the next service point; a second
+ *    dwt_readdiagnostics_async() is refused while the first is pending
+ *  - the async helpers return the same bytes as their blocking counterparts, direct and indirect offsets
+ * Prints one line per check, spi_async,<check>,ok|FAIL, and exits 1 if any failed. UART output is a service point of
+ * the shim, so whatever must be seen before the callbacks run is recorded before the first line is printed.
+ *
+ * Usage: spi_async_host
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deca_device_api.h>
+#include <deca_regs.h>
+#include <deca_spi.h>
+#include <port.h>
+#include "dw3000_model.h"
+#include "hal_shim.h"
+
+#define MAX_CALLS 8
+#define DW_FILE(id) (&dw.regs[(id) >> 16][(id) & 0xFFFF])  /* The model's copy of a register file */
+
+static DwModel dw;
+static int64_t sim_now;
+static int failures;
+
+/* Completions in the order they ran */
+static struct
+{
+  int status;
+  void *arg;
+  uint32_t spiXfers;      /* spi_xfer_count() when the callback ran */
+} calls[MAX_CALLS];
+static int call_count;
+
+static void xfer_done(int status, void *arg)
+{
+  if (call_count < MAX_CALLS)
+  {
+    calls[call_count].status = status;
+    calls[call_count].arg = arg;
+    calls[call_count].spiXfers = spi_xfer_count();
+  }
+  call_count++;
+}
+
+static void check(const char *name, int ok)
+{
+  printf("spi_async,%s,%s\n", name, ok ? "ok" : "FAIL");
+  failures += !ok;
+}
+
+/* Lets the deferred callbacks run, as the main loop would between two DMA interrupts */
+static void service(void)
+{
+  Sleep(1);
+}
+
+static void reset_calls(void)
+{
+  memset(calls, 0, sizeof(calls));
+  call_count = 0;
+}
+
+/* Nothing else on the air: transmitted frames are lost and the receiver never hears anything */
+static void air_transmit(void *ctx, DwModel *dev, const DwFrame *frame)
+{
+  (void)ctx;
+  (void)dev;
+  (void)frame;
+}
+
+static const DwModelOps air_ops = { air_transmit, NULL, NULL };
+
+static int64_t node_now(void *node)
+{
+  (void)node;
+  return sim_now;
+}
+
+static void node_wait(void *node, int64_t until, int wake_on)
+{
+  (void)node;
+  while (dw_model_deadline(&dw) <= until)
+  {
+    sim_now = dw_model_deadline(&dw) > sim_now ? dw_model_deadline(&dw) : sim_now;
+    dw_model_advance(&dw, sim_now);
+    if ((wake_on & SIM_WAKE_DW_IRQ) && dw_model_irq(&dw))
+    {
+      return;
+    }
+  }
+  sim_now = until > sim_now ? until : sim_now;
+}
+
+static void node_spi(void *node, const uint8_t *header, uint16_t headerLength, const uint8_t *txBody, uint8_t *rxBody,
+                     uint16_t bodyLength)
+{
+  (void)node;
+  dw_model_spi(&dw, sim_now, header, headerLength, txBody, rxBody, bodyLength);
+}
+
+static int node_irq_line(void *node)
+{
+  (void)node;
+  return dw_model_irq(&dw);
+}
+
+static void node_uart(void *node, const char *text, size_t length)
+{
+  (void)node;
+  fwrite(text, 1, length, stdout);
+}
+
+static void node_halt(void *node)
+{
+  (void)node;
+  fprintf(stderr, "spi_async_host: firmware halted\n");
+  exit(1);
+}
+
+static const SimServices services = {
+  node_now, node_wait, node_spi, node_irq_line, node_uart, node_halt, NULL, NULL,
+};
+
+static void fill(uint8_t *buffer, uint16_t length, uint8_t seed)
+{
+  for (uint16_t i = 0; i < length; i++)
+  {
+    buffer[i] = (uint8_t)(seed + 7 * i);
+  }
+}
+
+static void check_refused(void)
+{
+  uint8_t data[4] = {0};
+  dwt_xfer_t xfers[DWT_XFER_MAX_BATCH + 1];
+  uint32_t before;
+
+  for (int i = 0; i <= DWT_XFER_MAX_BATCH; i++)
+  {
+    xfers[i] = (dwt_xfer_t){ SCRATCH_RAM_ID, (uint16_t)(4 * i), 4, data, DWT_XFER_WRITE };
+  }
+
+  reset_calls();
+  before = spi_xfer_count();
+  check("refuse_empty_batch", dwt_xfer_async(xfers, 0, xfer_done, NULL) == DWT_ERROR);
+  check("refuse_oversized_batch", dwt_xfer_async(xfers, DWT_XFER_MAX_BATCH + 1, xfer_done, NULL) == DWT_ERROR);
+
+  xfers[1].length = 0;
+  check("refuse_empty_access", dwt_xfer_async(xfers, 2, xfer_done, NULL) == DWT_ERROR);
+  xfers[1].length = 4;
+
+  dwt_enablespicrccheck(DWT_SPI_CRC_MODE_WR, NULL);
+  check("refuse_spi_crc_mode", dwt_xfer_async(xfers, 1, xfer_done, NULL) == DWT_ERROR);
+  dwt_enablespicrccheck(DWT_SPI_CRC_MODE_NO, NULL);
+
+  service();
+  check("refused_no_callback", call_count == 0);
+  /* dwt_enablespicrccheck() itself goes over SPI, the refused batches must not */
+  before = spi_xfer_count() - before;
+  check("refused_no_transaction", before <= 2);
+}
+
+/* A full batch: writes then a read over them, on one callback */
+static void check_batch(void)
+{
+  uint8_t a[16], b[16], c[16], back[48] = {0}, expect[48];
+  int tag = 0;
+  dwt_xfer_t xfers[DWT_XFER_MAX_BATCH] = {
+    { SCRATCH_RAM_ID, 0, 16, a, DWT_XFER_WRITE },
+    { SCRATCH_RAM_ID, 16, 16, b, DWT_XFER_WRITE },
+    { SCRATCH_RAM_ID, 32, 16, c, DWT_XFER_WRITE },
+    { SCRATCH_RAM_ID, 0, 48, back, DWT_XFER_READ },
+  };
+  uint32_t before;
+  int queued, pending;
+
+  fill(a, 16, 1);
+  fill(b, 16, 50);
+  fill(c, 16, 100);
+  memcpy(expect, a, 16);
+  memcpy(&expect[16], b, 16);
+  memcpy(&expect[32], c, 16);
+
+  reset_calls();
+  before = spi_xfer_count();
+  queued = dwt_xfer_async(xfers, DWT_XFER_MAX_BATCH, xfer_done, &tag);
+  before = spi_xfer_count() - before;
+  pending = call_count;
+  check("batch_queued", queued == DWT_SUCCESS);
+  check("batch_one_transaction_per_access", before == DWT_XFER_MAX_BATCH);
+  check("batch_callback_deferred", pending == 0);
+  check("batch_queue_idle", !spi_dma_busy());
+
+  service();
+  check("batch_one_callback", call_count == 1);
+  check("batch_callback_status_arg", calls[0].status == DWT_SUCCESS && calls[0].arg == &tag);
+  check("batch_read_after_writes", memcmp(back, expect, sizeof(expect)) == 0);
+}
+
+/* Two batches to the same bytes: the second write wins and the callbacks complete in queue order */
+static void check_order(void)
+{
+  uint8_t first[8], second[8], back[8] = {0};
+  int tag1 = 1, tag2 = 2;
+  int queued1, queued2, pending;
+  uint32_t start;
+  dwt_xfer_t batch1[1] = { { SCRATCH_RAM_ID, 64, 8, first, DWT_XFER_WRITE } };
+  dwt_xfer_t batch2[2] = {
+    { SCRATCH_RAM_ID, 64, 8, second, DWT_XFER_WRITE },
+    { SCRATCH_RAM_ID, 64, 8, back, DWT_XFER_READ },
+  };
+
+  fill(first, 8, 3);
+  fill(second, 8, 200);
+
+  /* The first callback may run while the second batch is on the bus, as the DMA interrupt would */
+  reset_calls();
+  start = spi_xfer_count();
+  queued1 = dwt_xfer_async(batch1, 1, xfer_done, &tag1);
+  queued2 = dwt_xfer_async(batch2, 2, xfer_done, &tag2);
+  pending = call_count;
+  check("order_first_queued", queued1 == DWT_SUCCESS);
+  check("order_second_queued", queued2 == DWT_SUCCESS);
+  check("order_last_callback_deferred", pending < 2);
+
+  service();
+  check("order_two_callbacks", call_count == 2);
+  check("order_callbacks_in_queue_order", calls[0].arg == &tag1 && calls[1].arg == &tag2);
+  check("order_callbacks_after_their_batch", calls[0].spiXfers >= start + 1 && calls[1].spiXfers >= start + 3);
+  check("order_later_write_wins", memcmp(back, second, sizeof(second)) == 0);
+}
+
+/* The helpers against the model's buffers and the blocking calls, on both sides of the direct offset limit (above it
+ * the driver goes through the indirect pointer, three accesses in one batch) */
+static void check_helpers(void)
+{
+  static const uint16_t offsets[] = {0, REG_DIRECT_OFFSET_MAX_LEN + 1};
+  uint8_t data[32], async_back[32], sync_back[32];
+  dwt_rxdiag_t diag_async, diag_sync;
+  int tag = 0;
+  int pending, queued1, queued2;
+
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+  {
+    char name[48];
+
+    fill(data, sizeof(data), (uint8_t)(10 + i));
+    reset_calls();
+    queued1 = dwt_writetxdata_async(sizeof(data), data, offsets[i], xfer_done, &tag);
+    pending = call_count;
+    service();
+    snprintf(name, sizeof(name), "writetxdata_offset_%u", offsets[i]);
+    check(name, queued1 == DWT_SUCCESS && pending == 0 && call_count == 1 && calls[0].status == DWT_SUCCESS &&
+                memcmp(DW_FILE(TX_BUFFER_ID) + offsets[i], data, sizeof(data)) == 0);
+
+    fill(data, sizeof(data), (uint8_t)(90 + i));
+    memcpy(DW_FILE(RX_BUFFER_0_ID) + offsets[i], data, sizeof(data));
+    memset(async_back, 0, sizeof(async_back));
+    reset_calls();
+    queued1 = dwt_readrxdata_async(async_back, sizeof(async_back), offsets[i], xfer_done, &tag);
+    pending = call_count;
+    service();
+    dwt_readrxdata(sync_back, sizeof(sync_back), offsets[i]);
+    snprintf(name, sizeof(name), "readrxdata_offset_%u", offsets[i]);
+    check(name, queued1 == DWT_SUCCESS && pending == 0 && call_count == 1 &&
+                memcmp(async_back, data, sizeof(data)) == 0 && memcmp(sync_back, data, sizeof(data)) == 0);
+  }
+
+  /* Diagnostics: one request at a time, same result as the blocking read */
+  dwt_configciadiag(DW_CIA_DIAG_LOG_ALL);
+  memset(&diag_async, 0xA5, sizeof(diag_async));
+  reset_calls();
+  queued1 = dwt_readdiagnostics_async(&diag_async, xfer_done, &tag);
+  queued2 = dwt_readdiagnostics_async(&diag_async, xfer_done, &tag);
+  pending = call_count;
+  service();
+  memset(&diag_sync, 0xA5, sizeof(diag_sync));
+  dwt_readdiagnostics(&diag_sync);
+  check("readdiagnostics_queued", queued1 == DWT_SUCCESS && pending == 0);
+  check("readdiagnostics_one_pending", queued2 == DWT_ERROR);
+  check("readdiagnostics_same_as_blocking",
+        call_count == 1 && calls[0].status == DWT_SUCCESS && memcmp(&diag_async, &diag_sync, sizeof(diag_sync)) == 0);
+}
+
+int main(void)
+{
+  SimNodeConfig config = { .role = SIM_ROLE_SLAVE, .uid = { 1, 2, 3 }, .mcuPpm = 0.0 };
+
+  dw_model_init(&dw, 0.0, 0.0, 1, &air_ops, NULL);
+  hal_shim_start(&services, NULL, &config);
+
+  port_set_dw_ic_spi_fastrate();
+  reset_DWIC();
+  Sleep(2);
+  while (!dwt_checkidlerc()) { };
+  if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
+  {
+    fprintf(stderr, "spi_async_host: INIT FAILED\n");
+    return 1;
+  }
+
+  check_refused();
+  check_batch();
+  check_order();
+  check_helpers();
+
+  printf("# %d failed\n", failures);
+  return failures != 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * twr_accuracy.c
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Accuracy check of the fixed point ranging kernels in shared_functions.c, ss_twr_distance_mm() and
+ * ds_twr_distance_mm(), against the same formulas evaluated in long double from the same integer inputs. The inputs
+ * are what the firmware feeds them: timestamps differences in device time units as the DW IC counts them, from a true
+ * distance, reply delays and crystal offsets drawn at random over
+ *  - distance -5 m to 605 m (the documented bound is stated up to 600 m), or to the -d distance
+ *  - reply delays 200 us to 30 ms, below the 2^31 unit (33 ms) limit of ds_twr_distance_mm()
+ *  - crystal offsets +/-60 ppm, the whole 13-bit clock offset range of SS-TWR (dwt_readclockoffset())
+ * plus the corners of the input ranges, where the results must saturate rather than wrap.
+ *
+ * Fails (exit 1) if any error exceeds the bound documented in shared_functions.h: 0.51 mm of rounding (to the
+ * millimetre and of the Q10 time of flight) plus 0.75 ppm of the distance (the Q16 scale factor).
+ *
+ * Usage: twr_accuracy [-n cases] [-d max_distance_m] [-S seed]
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <deca_device_api.h>
+#include <shared_defines.h>
+#include <shared_functions.h>
+
+#define DTU_PER_US (499.2 * 128.0)
+#define MM_PER_DTU ((long double)DWT_TIME_UNITS * SPEED_OF_LIGHT * 1000.0L)
+#define CLOCK_OFFSET_MAX 4095          /* 13-bit signed, 2^-26 per unit: 61 ppm */
+#define DIST_MIN_M -5.0
+#define REPLY_MIN_US 200.0
+#define REPLY_MAX_US 30000.0
+#define PPM_MAX 60.0
+
+#define BOUND_ROUND_MM 0.51
+#define BOUND_SCALE_PPM 0.75
+
+typedef struct
+{
+  const char *name;
+  uint64_t cases;
+  uint64_t failures;
+  double errMax;           /* Largest error, mm */
+  double errMaxAt;         /* Reference distance it was seen at, mm */
+  double boundUse;         /* Largest error as a fraction of its bound */
+} Result;
+
+static struct
+{
+  uint64_t cases;
+  double maxDistanceM;
+  uint64_t seed;
+} opt = {2000000, 605.0, 1};
+
+static uint64_t rng_state;
+
+static uint64_t sim_random(void)
+{
+  uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static double uniform(double lo, double hi)
+{
+  return lo + (hi - lo) * (double)(sim_random() >> 11) / 9007199254740992.0;
+}
+
+static double bound_mm(long double ref_mm)
+{
+  return BOUND_ROUND_MM + BOUND_SCALE_PPM * 1e-6 * fabs((double)ref_mm);
+}
+
+/* The kernels saturate to the int32 range, so does the reference */
+static long double saturate(long double mm)
+{
+  return mm > INT32_MAX ? INT32_MAX : (mm < INT32_MIN ? INT32_MIN : mm);
+}
+
+static void check(Result *r, int32_t got, long double ref_mm, const char *what)
+{
+  long double ref = saturate(ref_mm);
+  double err = fabs((double)((long double)got - ref));
+  double bound = bound_mm(ref);
+
+  r->cases++;
+  if (err > r->errMax)
+  {
+    r->errMax = err;
+    r->errMaxAt = (double)ref;
+  }
+  if (err / bound > r->boundUse)
+  {
+    r->boundUse = err / bound;
+  }
+  if (err > bound)
+  {
+    if (r->failures++ < 10)
+    {
+      printf("# %s: %s gives %ld mm, reference %.3Lf mm, error %.3f mm above the %.3f mm bound\n", r->name, what,
+             (long)got, ref, err, bound);
+    }
+  }
+}
+
+/* distance = (rtd_init - rtd_resp * (1 - clock_offset / 2^26)) / 2, in device time units */
+static long double ss_reference(int32_t rtd_init, int32_t rtd_resp, int16_t clock_offset)
+{
+  long double tof = ((long double)rtd_init - (long double)rtd_resp * (1.0L - clock_offset / 67108864.0L)) / 2.0L;
+
+  return tof * MM_PER_DTU;
+}
+
+static long double ds_reference(uint32_t round1, uint32_t reply1, uint32_t round2, uint32_t reply2)
+{
+  long double num = (long double)round1 * round2 - (long double)reply1 * reply2;
+
+  return num / ((long double)round1 + round2 + reply1 + reply2) * MM_PER_DTU;
+}
+
+/* SS-TWR as uwb_slave.c sees it: the responder's reply delay on its own clock, the clock offset it estimates from the
+ * carrier, and the round trip on the initiator's clock, all whole device time units */
+static void sweep_ss(Result *r)
+{
+  static const int32_t corners[] = {INT32_MIN, -1, 0, 1, INT32_MAX};
+  static const int16_t offsets[] = {-CLOCK_OFFSET_MAX - 1, 0, CLOCK_OFFSET_MAX, INT16_MIN, INT16_MAX};
+  char what[96];
+
+  for (uint64_t i = 0; i < opt.cases; i++)
+  {
+    double tof = uniform(DIST_MIN_M, opt.maxDistanceM) * 1000.0 / (double)MM_PER_DTU;
+    double reply = uniform(REPLY_MIN_US, REPLY_MAX_US) * DTU_PER_US;
+    int16_t clock_offset = (int16_t)llround(uniform(-CLOCK_OFFSET_MAX - 1, CLOCK_OFFSET_MAX));
+    int32_t rtd_resp = (int32_t)llround(reply);
+    int32_t rtd_init = (int32_t)llround(2.0 * tof + reply * (1.0 - clock_offset / 67108864.0));
+
+    snprintf(what, sizeof(what), "ss(%ld, %ld, %d)", (long)rtd_init, (long)rtd_resp, clock_offset);
+    check(r, ss_twr_distance_mm(rtd_init, rtd_resp, clock_offset), ss_reference(rtd_init, rtd_resp, clock_offset),
+          what);
+  }
+
+  for (size_t a = 0; a < sizeof(corners) / sizeof(corners[0]); a++)
+  {
+    for (size_t b = 0; b < sizeof(corners) / sizeof(corners[0]); b++)
+    {
+      for (size_t c = 0; c < sizeof(offsets) / sizeof(offsets[0]); c++)
+      {
+        snprintf(what, sizeof(what), "ss(%ld, %ld, %d)", (long)corners[a], (long)corners[b], offsets[c]);
+        check(r, ss_twr_distance_mm(corners[a], corners[b], offsets[c]),
+              ss_reference(corners[a], corners[b], offsets[c]), what);
+      }
+    }
+  }
+}
+
+/* DS-TWR as uwb_master.c sees it: round1 and reply2 on the initiator's clock, reply1 and round2 on the responder's */
+static void sweep_ds(Result *r)
+{
+  static const uint32_t corners[] = {0, 1, 0x7FFFFFFFUL};
+  char what[96];
+
+  for (uint64_t i = 0; i < opt.cases; i++)
+  {
+    double tof = uniform(DIST_MIN_M, opt.maxDistanceM) * 1000.0 / (double)MM_PER_DTU;
+    double reply_a = uniform(REPLY_MIN_US, REPLY_MAX_US) * DTU_PER_US;   /* Initiator, response RX to final TX */
+    double reply_b = uniform(REPLY_MIN_US, REPLY_MAX_US) * DTU_PER_US;   /* Responder, poll RX to response TX */
+    double ka = 1.0 + uniform(-PPM_MAX, PPM_MAX) * 1e-6;
+    double kb = 1.0 + uniform(-PPM_MAX, PPM_MAX) * 1e-6;
+    uint32_t round1 = (uint32_t)llround((2.0 * tof + reply_b) * ka);
+    uint32_t reply1 = (uint32_t)llround(reply_b * kb);
+    uint32_t round2 = (uint32_t)llround((2.0 * tof + reply_a) * kb);
+    uint32_t reply2 = (uint32_t)llround(reply_a * ka);
+
+    snprintf(what, sizeof(what), "ds(%lu, %lu, %lu, %lu)", (unsigned long)round1, (unsigned long)reply1,
+             (unsigned long)round2, (unsigned long)reply2);
+    check(r, ds_twr_distance_mm(round1, reply1, round2, reply2), ds_reference(round1, reply1, round2, reply2), what);
+  }
+
+  for (size_t a = 0; a < 3; a++)
+  {
+    for (size_t b = 0; b < 3; b++)
+    {
+      for (size_t c = 0; c < 3; c++)
+      {
+        for (size_t d = 0; d < 3; d++)
+        {
+          uint32_t in[4] = {corners[a], corners[b], corners[c], corners[d]};
+
+          if ((uint64_t)in[0] + in[1] + in[2] + in[3] == 0)
+          {
+            continue; /* No delay at all, INT32_MAX by definition */
+          }
+          snprintf(what, sizeof(what), "ds(%lu, %lu, %lu, %lu)", (unsigned long)in[0], (unsigned long)in[1],
+                   (unsigned long)in[2], (unsigned long)in[3]);
+          check(r, ds_twr_distance_mm(in[0], in[1], in[2], in[3]), ds_reference(in[0], in[1], in[2], in[3]), what);
+        }
+      }
+    }
+  }
+
+  /* A delay of 2^31 units or more is refused */
+  r->cases++;
+  if (ds_twr_distance_mm(0x80000000UL, 1, 1, 1) != INT32_MAX)
+  {
+    printf("# %s: a delay of 2^31 units is not refused\n", r->name);
+    r->failures++;
+  }
+}
+
+static void report(const Result *r)
+{
+  printf("%s,%llu,%llu,%.3f,%.1f,%.3f\n", r->name, (unsigned long long)r->cases, (unsigned long long)r->failures,
+         r->errMax, r->errMaxAt / 1000.0, r->boundUse);
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-n cases] [-d max_distance_m] [-S seed]\n", name);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  Result ss = {"ss_twr_distance_mm", 0, 0, 0.0, 0.0, 0.0};
+  Result ds = {"ds_twr_distance_mm", 0, 0, 0.0, 0.0, 0.0};
+  int c;
+
+  while ((c = getopt(argc, argv, "n:d:S:")) != -1)
+  {
+    switch (c)
+    {
+    case 'n':
+      opt.cases = strtoull(optarg, NULL, 0);
+      break;
+    case 'd':
+      opt.maxDistanceM = atof(optarg);
+      break;
+    case 'S':
+      opt.seed = strtoull(optarg, NULL, 0);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (opt.cases == 0 || opt.maxDistanceM <= DIST_MIN_M)
+  {
+    usage(argv[0]);
+  }
+  rng_state = opt.seed;
+
+  sweep_ss(&ss);
+  sweep_ds(&ds);
+
+  printf("kernel,cases,failures,max_error_mm,at_m,max_error_of_bound\n");
+  report(&ss);
+  report(&ds);
+  printf("# distance %.0f m to %.0f m, bound %.2f mm + %.2f ppm of the distance\n", DIST_MIN_M, opt.maxDistanceM,
+         BOUND_ROUND_MM, BOUND_SCALE_PPM);
+
+  return ss.failures || ds.failures;
+}